@@ -0,0 +1,94 @@
+#!/usr/bin/env python
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Copyright (C) 2020 Red Hat, Inc.
+#
+
+#
+# This example measures the throughput of adding many profiles, once
+# with one AddConnection2() call per profile, and once with a single
+# ModifyConnections() call. The profiles are deleted again afterwards.
+#
+# Usage: bulk-add-connections.py [COUNT] [to-disk|in-memory]
+#
+
+import dbus, sys, time, uuid
+
+NM_SETTINGS_ADD_CONNECTION2_FLAG_TO_DISK = 0x1
+NM_SETTINGS_ADD_CONNECTION2_FLAG_IN_MEMORY = 0x2
+NM_SETTINGS_ADD_CONNECTION2_FLAG_BLOCK_AUTOCONNECT = 0x20
+
+count = int(sys.argv[1]) if len(sys.argv) > 1 else 1000
+if len(sys.argv) > 2 and sys.argv[2] == "to-disk":
+    flags = NM_SETTINGS_ADD_CONNECTION2_FLAG_TO_DISK
+else:
+    flags = NM_SETTINGS_ADD_CONNECTION2_FLAG_IN_MEMORY
+flags |= NM_SETTINGS_ADD_CONNECTION2_FLAG_BLOCK_AUTOCONNECT
+
+
+def make_profiles(prefix):
+    profiles = []
+    for i in range(count):
+        s_con = dbus.Dictionary(
+            {
+                "type": "802-3-ethernet",
+                "uuid": str(uuid.uuid4()),
+                "id": "%s-%d" % (prefix, i),
+                "interface-name": "bulk%d" % (i),
+                "autoconnect": False,
+            }
+        )
+        profiles.append(
+            dbus.Dictionary(
+                {
+                    "connection": s_con,
+                    "802-3-ethernet": dbus.Dictionary({}, signature="sv"),
+                    "ipv4": dbus.Dictionary({"method": "disabled"}),
+                    "ipv6": dbus.Dictionary({"method": "ignore"}),
+                }
+            )
+        )
+    return profiles
+
+
+def report(what, start, paths):
+    elapsed = time.time() - start
+    print(
+        "%-30s %6d profiles in %8.3f sec (%8.1f profiles/sec)"
+        % (what, len(paths), elapsed, len(paths) / elapsed if elapsed > 0 else 0.0)
+    )
+
+
+bus = dbus.SystemBus()
+proxy = bus.get_object(
+    "org.freedesktop.NetworkManager", "/org/freedesktop/NetworkManager/Settings"
+)
+settings = dbus.Interface(proxy, "org.freedesktop.NetworkManager.Settings")
+
+empty_args = dbus.Dictionary({}, signature="sv")
+no_paths = dbus.Array([], signature="o")
+
+profiles = make_profiles("bulk-single")
+start = time.time()
+paths = []
+for p in profiles:
+    path, result = settings.AddConnection2(p, dbus.UInt32(flags), empty_args)
+    paths.append(path)
+report("AddConnection2", start, paths)
+
+start = time.time()
+settings.ModifyConnections(
+    dbus.Array([], signature="a{sa{sv}}"), paths, dbus.UInt32(flags), empty_args
+)
+report("ModifyConnections (delete)", start, paths)
+
+profiles = make_profiles("bulk-batch")
+start = time.time()
+paths, result = settings.ModifyConnections(
+    profiles, no_paths, dbus.UInt32(flags), empty_args
+)
+report("ModifyConnections (add)", start, paths)
+
+settings.ModifyConnections(
+    dbus.Array([], signature="a{sa{sv}}"), paths, dbus.UInt32(flags), empty_args
+)
@@ -767,6 +767,13 @@ typedef struct {
 	 *
 	 * However, a few hooks there are... see NMSettInfoSettGendata. */
 	const NMSettInfoSettGendata *gendata_info;
+
+	/* if set, then the setting tracks state that is not visible in the
+	 * D-Bus representation of its properties, but which is still considered
+	 * by compare_property(), or its properties hold boxed elements that can
+	 * be modified in place without a property notification. Such settings
+	 * cannot be compared by their cached content hash. */
+	bool no_content_hash;
 } NMSettInfoSettDetail;
 
 struct _NMSettInfoSetting {
@@ -102,6 +102,24 @@ nm_keyfile_plugin_get_setting_name_for_alias (const char *alias)
 	return NULL;
 }
 
+/* Returns the name of the group in @kf for the setting @group. That is
+ * either @group itself, or its alias if only the alias exists.
+ *
+ * The readers look up many keys that don't exist. Resolving the group
+ * up front avoids allocating a GError for each of them, only to find out
+ * whether the group is missing. */
+static const char *
+_kf_group (GKeyFile *kf, const char *group)
+{
+	const char *alias;
+
+	alias = nm_keyfile_plugin_get_alias_for_setting_name (group);
+	if (   alias
+	    && !g_key_file_has_group (kf, group))
+		return alias;
+	return group;
+}
+
 /*****************************************************************************/
 
 char **
@@ -112,20 +130,9 @@ nm_keyfile_plugin_kf_get_string_list (GKeyFile *kf,
                                       GError **error)
 {
 	char **list;
-	const char *alias;
-	GError *local = NULL;
 	gsize l;
 
-	list = g_key_file_get_string_list (kf, group, key, &l, &local);
-	if (nm_g_error_matches (local, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_GROUP_NOT_FOUND)) {
-		alias = nm_keyfile_plugin_get_alias_for_setting_name (group);
-		if (alias) {
-			g_clear_error (&local);
-			list = g_key_file_get_string_list (kf, alias, key, &l, &local);
-		}
-	}
-	if (local)
-		g_propagate_error (error, local);
+	list = g_key_file_get_string_list (kf, _kf_group (kf, group), key, &l, error);
 	if (!list)
 		l = 0;
 	NM_SET_OUT (out_length, l);
@@ -241,21 +248,7 @@ fcn_name (GKeyFile *kf, \
           const char *key, \
           GError **error) \
 { \
-	get_ctype val; \
-	const char *alias; \
-	GError *local = NULL; \
-\
-	val = key_file_get_fcn (kf, group, key, &local); \
-	if (nm_g_error_matches (local, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_GROUP_NOT_FOUND)) { \
-		alias = nm_keyfile_plugin_get_alias_for_setting_name (group); \
-		if (alias) { \
-			g_clear_error (&local); \
-			val = key_file_get_fcn (kf, alias, key, &local); \
-		} \
-	} \
-	if (local) \
-		g_propagate_error (error, local); \
-	return val; \
+	return key_file_get_fcn (kf, _kf_group (kf, group), key, error); \
 }
 
 DEFINE_KF_WRAPPER_GET (nm_keyfile_plugin_kf_get_string,  char *,   g_key_file_get_string);
@@ -318,25 +311,13 @@ nm_keyfile_plugin_kf_get_keys (GKeyFile *kf,
                                GError **error)
 {
 	char **keys;
-	const char *alias;
-	GError *local = NULL;
 	gsize l;
 
-	keys = g_key_file_get_keys (kf, group, &l, &local);
-	if (nm_g_error_matches (local, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_GROUP_NOT_FOUND)) {
-		alias = nm_keyfile_plugin_get_alias_for_setting_name (group);
-		if (alias) {
-			g_clear_error (&local);
-			keys = g_key_file_get_keys (kf, alias, &l, error ? &local : NULL);
-		}
-	}
-	nm_assert ((!local) != (!keys));
+	keys = g_key_file_get_keys (kf, _kf_group (kf, group), &l, error);
 	if (!keys)
 		l = 0;
 	nm_assert (l == NM_PTRARRAY_LEN (keys));
 	NM_SET_OUT (out_length, l);
-	if (local)
-		g_propagate_error (error, local);
 	return keys;
 }
 
@@ -346,21 +327,7 @@ nm_keyfile_plugin_kf_has_key (GKeyFile *kf,
                               const char *key,
                               GError **error)
 {
-	gboolean has;
-	const char *alias;
-	GError *local = NULL;
-
-	has = g_key_file_has_key (kf, group, key, &local);
-	if (nm_g_error_matches (local, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_GROUP_NOT_FOUND)) {
-		alias = nm_keyfile_plugin_get_alias_for_setting_name (group);
-		if (alias) {
-			g_clear_error (&local);
-			has = g_key_file_has_key (kf, alias, key, &local);
-		}
-	}
-	if (local)
-		g_propagate_error (error, local);
-	return has;
+	return g_key_file_has_key (kf, _kf_group (kf, group), key, error);
 }
 
 /*****************************************************************************/
@@ -38,6 +38,12 @@ typedef struct {
 	GError *error;
 	const char *group;
 	NMSetting *setting;
+
+	/* the keys of the current setting's group. They are fetched on demand
+	 * by _reader_info_get_setting_keys(), so that parsers which need to
+	 * iterate over the keys share one copy. */
+	char **setting_keys;
+	gsize setting_keys_len;
 } KeyfileReaderInfo;
 
 typedef struct {
@@ -806,22 +812,42 @@ _build_list_match_key_w_name_impl (const char *key,
 #define _build_list_match_key_w_name(key, base_name, out_key_idx) \
 	_build_list_match_key_w_name_impl (key, base_name, NM_STRLEN (base_name), out_key_idx)
 
+static const char *const*
+_reader_info_get_setting_keys (KeyfileReaderInfo *info,
+                               gsize *out_len)
+{
+	nm_assert (NM_IS_SETTING (info->setting));
+
+	if (!info->setting_keys) {
+		info->setting_keys = nm_keyfile_plugin_kf_get_keys (info->keyfile,
+		                                                    nm_setting_get_name (info->setting),
+		                                                    &info->setting_keys_len,
+		                                                    NULL);
+		if (!info->setting_keys) {
+			info->setting_keys = g_new0 (char *, 1);
+			info->setting_keys_len = 0;
+		}
+	}
+
+	*out_len = info->setting_keys_len;
+	return (const char *const*) info->setting_keys;
+}
+
 static BuildListData *
-_build_list_create (GKeyFile *keyfile,
-                    const char *group_name,
+_build_list_create (KeyfileReaderInfo *info,
                     BuildListType build_list_type,
-                    gsize *out_build_list_len,
-                    char ***out_keys_strv)
+                    gsize *out_build_list_len)
 {
-	gs_strfreev char **keys = NULL;
+	const char *const*keys;
 	gsize i_keys, n_keys;
 	gs_free BuildListData *build_list = NULL;
 	gsize build_list_len = 0;
 
 	nm_assert (out_build_list_len && *out_build_list_len == 0);
-	nm_assert (out_keys_strv && !*out_keys_strv);
 
-	keys = nm_keyfile_plugin_kf_get_keys (keyfile, group_name, &n_keys, NULL);
+	/* the returned list points to the keys of @info, which are valid
+	 * until the setting is read. */
+	keys = _reader_info_get_setting_keys (info, &n_keys);
 	if (n_keys == 0)
 		return NULL;
 
@@ -880,7 +906,6 @@ _build_list_create (GKeyFile *keyfile,
 	}
 
 	*out_build_list_len = build_list_len;
-	*out_keys_strv = g_steal_pointer (&keys);
 	return g_steal_pointer (&build_list);
 }
 
@@ -892,17 +917,14 @@ ip_address_or_route_parser (KeyfileReaderInfo *info, NMSetting *setting, const c
 	gboolean is_routes = nm_streq (setting_key, "routes");
 	gs_free char *gateway = NULL;
 	gs_unref_ptrarray GPtrArray *list = NULL;
-	gs_strfreev char **keys = NULL;
 	gs_free BuildListData *build_list = NULL;
 	gsize i_build_list, build_list_len = 0;
 
-	build_list = _build_list_create (info->keyfile,
-	                                 setting_name,
+	build_list = _build_list_create (info,
 	                                   is_routes
 	                                 ? BUILD_LIST_TYPE_ROUTES
 	                                 : BUILD_LIST_TYPE_ADDRESSES,
-	                                 &build_list_len,
-	                                 &keys);
+	                                 &build_list_len);
 	if (!build_list)
 		return;
 
@@ -960,15 +982,12 @@ ip_routing_rule_parser_full (KeyfileReaderInfo *info,
 {
 	const char *setting_name = nm_setting_get_name (setting);
 	gboolean is_ipv6 = nm_streq (setting_name, "ipv6");
-	gs_strfreev char **keys = NULL;
 	gs_free BuildListData *build_list = NULL;
 	gsize i_build_list, build_list_len = 0;
 
-	build_list = _build_list_create (info->keyfile,
-	                                 setting_name,
+	build_list = _build_list_create (info,
 	                                 BUILD_LIST_TYPE_ROUTING_RULES,
-	                                 &build_list_len,
-	                                 &keys);
+	                                 &build_list_len);
 	if (!build_list)
 		return;
 
@@ -3532,6 +3551,8 @@ _read_setting (KeyfileReaderInfo *info)
 
 out:
 	info->setting = NULL;
+	nm_clear_pointer (&info->setting_keys, g_strfreev);
+	info->setting_keys_len = 0;
 	if (!info->error)
 		nm_connection_add_setting (info->connection, g_steal_pointer (&setting));
 }
@@ -163,8 +163,53 @@ struct NMIPAddress {
 	int prefix, family;
 
 	GHashTable *attributes;
+
+	/* whether @attributes may be shared with a copy. See _attributes_cow(). */
+	bool attributes_shared;
 };
 
+/* The attributes of NMIPAddress and NMIPRoute are not copied by nm_ip_address_dup()
+ * and nm_ip_route_dup(). Instead, the original and the copy share the same hash
+ * table, until one of them gets modified. Duplicating connections with many
+ * addresses or routes is thus cheap.
+ *
+ * Before modifying the attributes, call this function to get a hash table that
+ * is owned exclusively. */
+static GHashTable *
+_attributes_cow (GHashTable **p_attributes, bool *p_shared)
+{
+	GHashTable *old = *p_attributes;
+
+	if (!old || *p_shared) {
+		*p_attributes = g_hash_table_new_full (nm_str_hash, g_str_equal,
+		                                       g_free, (GDestroyNotify) g_variant_unref);
+		if (old) {
+			GHashTableIter iter;
+			const char *key;
+			GVariant *value;
+
+			g_hash_table_iter_init (&iter, old);
+			while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &value))
+				g_hash_table_insert (*p_attributes, g_strdup (key), g_variant_ref (value));
+			g_hash_table_unref (old);
+		}
+		*p_shared = FALSE;
+	}
+	return *p_attributes;
+}
+
+static GHashTable *
+_attributes_share (GHashTable *attributes, bool *p_shared_src, bool *p_shared_dst)
+{
+	if (   !attributes
+	    || g_hash_table_size (attributes) == 0)
+		return NULL;
+
+	*p_shared_src = TRUE;
+	*p_shared_dst = TRUE;
+	return g_hash_table_ref (attributes);
+}
+
 /**
  * nm_ip_address_new:
  * @family: the IP address family (<literal>AF_INET</literal> or
@@ -314,7 +359,8 @@ nm_ip_address_cmp_full (const NMIPAddress *a, const NMIPAddress *b, NMIPAddressC
 		n = a->attributes ? g_hash_table_size (a->attributes) : 0u;
 		NM_CMP_DIRECT (n, (b->attributes ? g_hash_table_size (b->attributes) : 0u));
 
-		if (n > 0) {
+		if (   n > 0
+		    && a->attributes != b->attributes) {
 			g_hash_table_iter_init (&iter, a->attributes);
 			while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &value)) {
 				value2 = g_hash_table_lookup (b->attributes, key);
@@ -369,19 +415,18 @@ nm_ip_address_dup (NMIPAddress *address)
 	g_return_val_if_fail (address != NULL, NULL);
 	g_return_val_if_fail (address->refcount > 0, NULL);
 
-	copy = nm_ip_address_new (address->family,
-	                          address->address, address->prefix,
-	                          NULL);
-	if (address->attributes) {
-		GHashTableIter iter;
-		const char *key;
-		GVariant *value;
-
-		g_hash_table_iter_init (&iter, address->attributes);
-		while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &value))
-			nm_ip_address_set_attribute (copy, key, value);
-	}
-
+	/* @address is already valid and canonicalized. There is no need to
+	 * parse it again, like nm_ip_address_new() would. */
+	copy = g_slice_new (NMIPAddress);
+	*copy = (NMIPAddress) {
+		.refcount = 1,
+		.family   = address->family,
+		.address  = g_strdup (address->address),
+		.prefix   = address->prefix,
+	};
+	copy->attributes = _attributes_share (address->attributes,
+	                                      &address->attributes_shared,
+	                                      &copy->attributes_shared);
 	return copy;
 }
 
@@ -582,11 +627,14 @@ nm_ip_address_set_attribute (NMIPAddress *address, const char *name, GVariant *v
 	g_return_if_fail (name != NULL && *name != '\0');
 	g_return_if_fail (strcmp (name, "address") != 0 && strcmp (name, "prefix") != 0);
 
-	if (!address->attributes) {
-		address->attributes = g_hash_table_new_full (nm_str_hash, g_str_equal,
-		                                             g_free, (GDestroyNotify) g_variant_unref);
+	if (!value) {
+		if (   !address->attributes
+		    || !g_hash_table_contains (address->attributes, name))
+			return;
 	}
 
+	_attributes_cow (&address->attributes, &address->attributes_shared);
+
 	if (value)
 		g_hash_table_insert (address->attributes, g_strdup (name), g_variant_ref_sink (value));
 	else
@@ -609,6 +657,9 @@ struct NMIPRoute {
 	gint64 metric;
 
 	GHashTable *attributes;
+
+	/* whether @attributes may be shared with a copy. See _attributes_cow(). */
+	bool attributes_shared;
 };
 
 /**
@@ -784,7 +835,8 @@ nm_ip_route_equal_full (NMIPRoute *route, NMIPRoute *other, guint cmp_flags)
 		n = route->attributes ? g_hash_table_size (route->attributes) : 0u;
 		if (n != (other->attributes ? g_hash_table_size (other->attributes) : 0u))
 			return FALSE;
-		if (n) {
+		if (   n
+		    && route->attributes != other->attributes) {
 			g_hash_table_iter_init (&iter, route->attributes);
 			while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &value)) {
 				value2 = g_hash_table_lookup (other->attributes, key);
@@ -830,20 +882,20 @@ nm_ip_route_dup (NMIPRoute *route)
 	g_return_val_if_fail (route != NULL, NULL);
 	g_return_val_if_fail (route->refcount > 0, NULL);
 
-	copy = nm_ip_route_new (route->family,
-	                        route->dest, route->prefix,
-	                        route->next_hop, route->metric,
-	                        NULL);
-	if (route->attributes) {
-		GHashTableIter iter;
-		const char *key;
-		GVariant *value;
-
-		g_hash_table_iter_init (&iter, route->attributes);
-		while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &value))
-			nm_ip_route_set_attribute (copy, key, value);
-	}
-
+	/* @route is already valid and canonicalized. There is no need to
+	 * parse the addresses again, like nm_ip_route_new() would. */
+	copy = g_slice_new (NMIPRoute);
+	*copy = (NMIPRoute) {
+		.refcount = 1,
+		.family   = route->family,
+		.dest     = g_strdup (route->dest),
+		.prefix   = route->prefix,
+		.next_hop = g_strdup (route->next_hop),
+		.metric   = route->metric,
+	};
+	copy->attributes = _attributes_share (route->attributes,
+	                                      &route->attributes_shared,
+	                                      &copy->attributes_shared);
 	return copy;
 }
 
@@ -1188,11 +1240,14 @@ nm_ip_route_set_attribute (NMIPRoute *route, const char *name, GVariant *value)
 	g_return_if_fail (   strcmp (name, "dest") != 0 && strcmp (name, "prefix") != 0
 	                  && strcmp (name, "next-hop") != 0 && strcmp (name, "metric") != 0);
 
-	if (!route->attributes) {
-		route->attributes = g_hash_table_new_full (nm_str_hash, g_str_equal,
-		                                           g_free, (GDestroyNotify) g_variant_unref);
+	if (!value) {
+		if (   !route->attributes
+		    || !g_hash_table_contains (route->attributes, name))
+			return;
 	}
 
+	_attributes_cow (&route->attributes, &route->attributes_shared);
+
 	if (value)
 		g_hash_table_insert (route->attributes, g_strdup (name), g_variant_ref_sink (value));
 	else
@@ -5218,6 +5273,70 @@ compare_property (const NMSettInfoSetting *sett_info,
 		return TRUE;
 	}
 
+	if (NM_IN_STRSET (sett_info->property_infos[property_idx].name, NM_SETTING_IP_CONFIG_DNS,
+	                                                                NM_SETTING_IP_CONFIG_DNS_SEARCH,
+	                                                                NM_SETTING_IP_CONFIG_DNS_OPTIONS)) {
+		const GPtrArray *a_arr;
+		const GPtrArray *b_arr;
+		NMTernary result;
+
+		/* compare the string lists directly, instead of converting them to strv
+		 * and GVariant first. Let the parent class first decide, whether the flags
+		 * exclude the property from the comparison. */
+		result = NM_SETTING_CLASS (nm_setting_ip_config_parent_class)->compare_property (sett_info,
+		                                                                                 property_idx,
+		                                                                                 con_a,
+		                                                                                 set_a,
+		                                                                                 NULL,
+		                                                                                 NULL,
+		                                                                                 flags);
+		if (   result != NM_TERNARY_TRUE
+		    || !set_b)
+			return result;
+
+		a_priv = NM_SETTING_IP_CONFIG_GET_PRIVATE (set_a);
+		b_priv = NM_SETTING_IP_CONFIG_GET_PRIVATE (set_b);
+
+		if (nm_streq (sett_info->property_infos[property_idx].name, NM_SETTING_IP_CONFIG_DNS)) {
+			const int addr_family = NM_SETTING_IP_CONFIG_GET_FAMILY (set_a);
+
+			/* on D-Bus, the DNS servers are binary addresses. Compare them the
+			 * same way, so that different notations of an address are equal. */
+			if (a_priv->dns->len != b_priv->dns->len)
+				return FALSE;
+			for (i = 0; i < a_priv->dns->len; i++) {
+				const char *a_str = a_priv->dns->pdata[i];
+				const char *b_str = b_priv->dns->pdata[i];
+				NMIPAddr a_addr;
+				NMIPAddr b_addr;
+
+				if (   nm_utils_parse_inaddr_bin (addr_family, a_str, NULL, &a_addr)
+				    && nm_utils_parse_inaddr_bin (addr_family, b_str, NULL, &b_addr)) {
+					if (memcmp (&a_addr, &b_addr, nm_utils_addr_family_to_size (addr_family)) != 0)
+						return FALSE;
+				} else if (!nm_streq (a_str, b_str))
+					return FALSE;
+			}
+			return TRUE;
+		}
+
+		if (nm_streq (sett_info->property_infos[property_idx].name, NM_SETTING_IP_CONFIG_DNS_SEARCH)) {
+			a_arr = a_priv->dns_search;
+			b_arr = b_priv->dns_search;
+		} else {
+			/* for dns-options, an empty list differs from no list (%NULL). */
+			a_arr = a_priv->dns_options;
+			b_arr = b_priv->dns_options;
+			if ((!a_arr) != (!b_arr))
+				return FALSE;
+			if (!a_arr)
+				return TRUE;
+		}
+
+		return _nm_utils_strv_cmp_n ((const char *const*) a_arr->pdata, a_arr->len,
+		                             (const char *const*) b_arr->pdata, b_arr->len) == 0;
+	}
+
 	if (nm_streq (sett_info->property_infos[property_idx].name, NM_SETTING_IP_CONFIG_ROUTING_RULES)) {
 		if (set_b) {
 			guint n;
@@ -920,6 +920,11 @@ nm_setting_ip4_config_class_init (NMSettingIP4ConfigClass *klass)
 
 	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
 
+	/* the NMIPAddress and NMIPRoute instances returned by the getters can be
+	 * modified in place, without notifying the setting. */
 	_nm_setting_class_commit_full (setting_class, NM_META_SETTING_TYPE_IP4_CONFIG,
-	                               NULL, properties_override);
+	                               NM_SETT_INFO_SETT_DETAIL (
+	                                 .no_content_hash = TRUE,
+	                               ),
+	                               properties_override);
 }
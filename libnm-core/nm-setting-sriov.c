@@ -1376,6 +1376,11 @@ nm_setting_sriov_class_init (NMSettingSriovClass *klass)
 
 	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
 
+	/* the NMSriovVF instances returned by nm_setting_sriov_get_vf() can be
+	 * modified in place, without notifying the setting. */
 	_nm_setting_class_commit_full (setting_class, NM_META_SETTING_TYPE_SRIOV,
-	                               NULL, properties_override);
+	                               NM_SETT_INFO_SETT_DETAIL (
+	                                 .no_content_hash = TRUE,
+	                               ),
+	                               properties_override);
 }
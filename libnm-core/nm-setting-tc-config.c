@@ -1856,6 +1856,11 @@ nm_setting_tc_config_class_init (NMSettingTCConfigClass *klass)
 
 	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
 
+	/* the NMTCQdisc and NMTCTfilter instances returned by the getters can be
+	 * modified in place, without notifying the setting. */
 	_nm_setting_class_commit_full (setting_class, NM_META_SETTING_TYPE_TC_CONFIG,
-	                               NULL, properties_override);
+	                               NM_SETT_INFO_SETT_DETAIL (
+	                                 .no_content_hash = TRUE,
+	                               ),
+	                               properties_override);
 }
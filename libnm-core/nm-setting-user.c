@@ -576,5 +576,8 @@ nm_setting_user_class_init (NMSettingUserClass *klass)
 	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
 
 	_nm_setting_class_commit_full (setting_class, NM_META_SETTING_TYPE_USER,
-	                               NULL, properties_override);
+	                               NM_SETT_INFO_SETT_DETAIL (
+	                                 .no_content_hash = TRUE,
+	                               ),
+	                               properties_override);
 }
@@ -46,6 +46,12 @@ NM_GOBJECT_PROPERTIES_DEFINE (NMSetting,
 
 typedef struct {
 	GenData *gendata;
+
+	/* a SHA256 checksum over the properties of the setting. It is computed
+	 * lazily by _content_hash_get() and invalidated whenever the setting
+	 * emits a property-changed notification. */
+	guint8 content_hash[NM_UTILS_CHECKSUM_LENGTH_SHA256];
+	bool content_hash_valid:1;
 } NMSettingPrivate;
 
 G_DEFINE_ABSTRACT_TYPE (NMSetting, nm_setting, G_TYPE_OBJECT)
@@ -1153,6 +1159,18 @@ nm_setting_duplicate (NMSetting *setting)
 	nm_assert (sett_info);
 
 	klass->duplicate_copy_properties (sett_info, setting, dst);
+
+	/* the copy has the same content. Share the cached hash, so that comparing
+	 * both settings does not need to compute it again. */
+	if (NM_SETTING_GET_PRIVATE (setting)->content_hash_valid) {
+		NMSettingPrivate *priv_dst = NM_SETTING_GET_PRIVATE (dst);
+
+		memcpy (priv_dst->content_hash,
+		        NM_SETTING_GET_PRIVATE (setting)->content_hash,
+		        sizeof (priv_dst->content_hash));
+		priv_dst->content_hash_valid = TRUE;
+	}
+
 	return dst;
 }
 
@@ -1372,6 +1390,77 @@ compare_property (const NMSettInfoSetting *sett_info,
 	return NM_TERNARY_TRUE;
 }
 
+static gboolean
+_property_depends_on_connection (const NMSettInfoProperty *property_info)
+{
+	/* the value of these properties is not taken from the setting itself,
+	 * but from the connection that contains it. */
+	return property_info->property_type == &nm_sett_info_propert_type_deprecated_interface_name;
+}
+
+static const guint8 *
+_content_hash_get (const NMSettInfoSetting *sett_info,
+                   NMSetting *setting)
+{
+	NMSettingPrivate *priv = NM_SETTING_GET_PRIVATE (setting);
+	nm_auto_free_checksum GChecksum *sum = NULL;
+	guint i;
+
+	if (priv->content_hash_valid)
+		return priv->content_hash;
+
+	sum = g_checksum_new (G_CHECKSUM_SHA256);
+
+	for (i = 0; i < sett_info->property_infos_len; i++) {
+		gs_unref_variant GVariant *variant = NULL;
+		guint64 n;
+
+		if (_property_depends_on_connection (&sett_info->property_infos[i]))
+			continue;
+
+		/* Hash the same representation of the property, that compare_property()
+		 * compares. */
+		variant = property_to_dbus (sett_info, i, NULL, setting, NM_CONNECTION_SERIALIZE_ALL, NULL, TRUE, TRUE);
+		if (!variant)
+			continue;
+
+		n = i;
+		g_checksum_update (sum, (const guchar *) &n, sizeof (n));
+		n = g_variant_get_size (variant);
+		g_checksum_update (sum, (const guchar *) &n, sizeof (n));
+		g_checksum_update (sum, g_variant_get_data (variant), n);
+	}
+
+	nm_utils_checksum_get_digest (sum, priv->content_hash);
+	priv->content_hash_valid = TRUE;
+	return priv->content_hash;
+}
+
+/*
+ * _content_hash_equal:
+ *
+ * Checks whether both settings have the same content, based on their
+ * cached content hash. If this returns %TRUE, all properties compare
+ * equal, except those for which _property_depends_on_connection().
+ * A %FALSE result means nothing, the settings may still compare equal
+ * (for example, because the order of a dictionary differs).
+ */
+static gboolean
+_content_hash_equal (const NMSettInfoSetting *sett_info,
+                     NMSetting *a,
+                     NMSetting *b)
+{
+	if (a == b)
+		return TRUE;
+
+	if (sett_info->detail.no_content_hash)
+		return FALSE;
+
+	return memcmp (_content_hash_get (sett_info, a),
+	               _content_hash_get (sett_info, b),
+	               NM_UTILS_CHECKSUM_LENGTH_SHA256) == 0;
+}
+
 static NMTernary
 _compare_property (const NMSettInfoSetting *sett_info,
                    guint property_idx,
@@ -1450,6 +1539,7 @@ _nm_setting_compare (NMConnection *con_a,
                      NMSettingCompareFlags flags)
 {
 	const NMSettInfoSetting *sett_info;
+	gboolean same_content;
 	guint i;
 
 	g_return_val_if_fail (NM_IS_SETTING (a), FALSE);
@@ -1474,7 +1564,12 @@ _nm_setting_compare (NMConnection *con_a,
 		                                  g_variant_equal);
 	}
 
+	same_content = _content_hash_equal (sett_info, a, b);
+
 	for (i = 0; i < sett_info->property_infos_len; i++) {
+		if (   same_content
+		    && !_property_depends_on_connection (&sett_info->property_infos[i]))
+			continue;
 		if (_compare_property (sett_info, i, con_a, a, con_b, b, flags) == NM_TERNARY_FALSE)
 			return FALSE;
 	}
@@ -1546,6 +1641,7 @@ _nm_setting_diff (NMConnection *con_a,
 	gboolean results_created = FALSE;
 	gboolean compared_any = FALSE;
 	gboolean diff_found = FALSE;
+	gboolean same_content;
 
 	g_return_val_if_fail (results != NULL, FALSE);
 	g_return_val_if_fail (NM_IS_SETTING (a), FALSE);
@@ -1627,12 +1723,21 @@ _nm_setting_diff (NMConnection *con_a,
 			}
 		}
 	} else {
+		/* if both settings have the same content, no property can differ and
+		 * there is nothing to add to @results. */
+		same_content =    b
+		               && _content_hash_equal (sett_info, a, b);
+
 		for (i = 0; i < sett_info->property_infos_len; i++) {
 			NMSettingDiffResult r = NM_SETTING_DIFF_RESULT_UNKNOWN;
 			const NMSettInfoProperty *property_info;
 			NMTernary compare_result;
 			GParamSpec *prop_spec;
 
+			if (   same_content
+			    && !_property_depends_on_connection (&sett_info->property_infos[i]))
+				continue;
+
 			compare_result = _compare_property (sett_info, i, con_a, a, con_b, b, flags);
 			if (compare_result == NM_TERNARY_DEFAULT)
 				continue;
@@ -2820,6 +2925,15 @@ get_property (GObject *object, guint prop_id,
 
 /*****************************************************************************/
 
+static void
+notify (GObject *object, GParamSpec *pspec)
+{
+	/* all modifications of a setting are announced via a property-changed
+	 * notification (see also _nm_setting_emit_property_changed()). Drop the
+	 * cached content hash. */
+	NM_SETTING_GET_PRIVATE (object)->content_hash_valid = FALSE;
+}
+
 static void
 nm_setting_init (NMSetting *setting)
 {
@@ -2848,6 +2962,7 @@ nm_setting_class_init (NMSettingClass *setting_class)
 	g_type_class_add_private (setting_class, sizeof (NMSettingPrivate));
 
 	object_class->get_property = get_property;
+	object_class->notify       = notify;
 	object_class->finalize     = finalize;
 
 	setting_class->update_one_secret         = update_one_secret;
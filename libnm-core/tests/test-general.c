@@ -2031,6 +2031,65 @@ test_setting_ip_route_attributes (void)
 #undef TEST_ATTR
 }
 
+static void
+test_setting_ip_route_dup_attributes (void)
+{
+	NMIPRoute *route;
+	NMIPRoute *copy1;
+	NMIPRoute *copy2;
+	NMIPAddress *address;
+	NMIPAddress *address_copy;
+	GVariant *variant;
+
+	route = nm_ip_route_new (AF_INET, "10.0.0.0", 8, "192.168.1.1", 100, NULL);
+	g_assert (route);
+	nm_ip_route_set_attribute (route, NM_IP_ROUTE_ATTRIBUTE_MTU, g_variant_new_uint32 (1300));
+
+	/* the copies share the attributes until one of them is modified. */
+	copy1 = nm_ip_route_dup (route);
+	copy2 = nm_ip_route_dup (copy1);
+	g_assert (nm_ip_route_equal (route, copy1));
+	g_assert (nm_ip_route_equal (route, copy2));
+
+	nm_ip_route_set_attribute (copy1, NM_IP_ROUTE_ATTRIBUTE_MTU, g_variant_new_uint32 (1400));
+	nm_ip_route_set_attribute (copy2, NM_IP_ROUTE_ATTRIBUTE_TABLE, g_variant_new_uint32 (5));
+	nm_ip_route_set_attribute (route, NM_IP_ROUTE_ATTRIBUTE_MTU, NULL);
+
+	g_assert (!nm_ip_route_get_attribute (route, NM_IP_ROUTE_ATTRIBUTE_MTU));
+	g_assert (!nm_ip_route_get_attribute (route, NM_IP_ROUTE_ATTRIBUTE_TABLE));
+
+	variant = nm_ip_route_get_attribute (copy1, NM_IP_ROUTE_ATTRIBUTE_MTU);
+	g_assert (variant);
+	g_assert_cmpint (g_variant_get_uint32 (variant), ==, 1400);
+	g_assert (!nm_ip_route_get_attribute (copy1, NM_IP_ROUTE_ATTRIBUTE_TABLE));
+
+	variant = nm_ip_route_get_attribute (copy2, NM_IP_ROUTE_ATTRIBUTE_MTU);
+	g_assert (variant);
+	g_assert_cmpint (g_variant_get_uint32 (variant), ==, 1300);
+	variant = nm_ip_route_get_attribute (copy2, NM_IP_ROUTE_ATTRIBUTE_TABLE);
+	g_assert (variant);
+	g_assert_cmpint (g_variant_get_uint32 (variant), ==, 5);
+
+	g_assert_cmpstr (nm_ip_route_get_dest (copy2), ==, "10.0.0.0");
+	g_assert_cmpstr (nm_ip_route_get_next_hop (copy2), ==, "192.168.1.1");
+	g_assert_cmpint (nm_ip_route_get_metric (copy2), ==, 100);
+
+	nm_ip_route_unref (route);
+	nm_ip_route_unref (copy1);
+	nm_ip_route_unref (copy2);
+
+	address = nm_ip_address_new (AF_INET6, "fd01::1", 64, NULL);
+	g_assert (address);
+	nm_ip_address_set_attribute (address, "label", g_variant_new_string ("foo"));
+	address_copy = nm_ip_address_dup (address);
+	g_assert (nm_ip_address_equal (address, address_copy));
+	nm_ip_address_set_attribute (address_copy, "label", NULL);
+	g_assert (nm_ip_address_get_attribute (address, "label"));
+	g_assert (!nm_ip_address_get_attribute (address_copy, "label"));
+	nm_ip_address_unref (address);
+	nm_ip_address_unref (address_copy);
+}
+
 static void
 test_setting_gsm_apn_spaces (void)
 {
@@ -3865,6 +3924,67 @@ test_setting_compare_routes (void)
 	nm_clear_pointer (&result, g_hash_table_unref);
 }
 
+static void
+test_setting_compare_cached_hash (void)
+{
+	gs_unref_object NMSetting *s1 = NULL;
+	gs_unref_object NMSetting *s2 = NULL;
+	GHashTable *result = NULL;
+	NMIPRoute *r;
+
+	s1 = nm_setting_ip4_config_new ();
+	nm_setting_ip_config_add_dns ((NMSettingIPConfig *) s1, "192.168.1.1");
+	nm_setting_ip_config_add_dns_search ((NMSettingIPConfig *) s1, "example.com");
+	r = nm_ip_route_new (AF_INET, "192.168.12.0", 24, "192.168.11.1", 473, NULL);
+	nm_setting_ip_config_add_route ((NMSettingIPConfig *) s1, r);
+	nm_ip_route_unref (r);
+
+	/* compare once, so that the content hash of @s1 gets cached. */
+	s2 = nm_setting_duplicate (s1);
+	g_assert (nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	/* the cached content hash must be invalidated by each modification. */
+	nm_setting_ip_config_add_dns ((NMSettingIPConfig *) s2, "192.168.1.2");
+	g_assert (!nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_assert (!nm_setting_diff (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT, FALSE, &result));
+	g_assert (result);
+	g_assert (g_hash_table_contains (result, NM_SETTING_IP_CONFIG_DNS));
+	nm_clear_pointer (&result, g_hash_table_unref);
+
+	nm_setting_ip_config_remove_dns ((NMSettingIPConfig *) s2, 1);
+	g_assert (nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_assert (nm_setting_diff (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT, FALSE, &result));
+	g_assert (!result);
+
+	g_object_set (s1, NM_SETTING_IP_CONFIG_DNS_OPTIONS, NULL, NULL);
+	g_assert (nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+	nm_setting_ip_config_clear_dns_options ((NMSettingIPConfig *) s1, TRUE);
+	g_assert (!nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	nm_setting_ip_config_clear_dns_options ((NMSettingIPConfig *) s2, TRUE);
+	g_assert (nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	/* routes can be modified in place, without a notification. */
+	nm_ip_route_set_metric (nm_setting_ip_config_get_route ((NMSettingIPConfig *) s2, 0), 474);
+	g_assert (!nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+	nm_ip_route_set_metric (nm_setting_ip_config_get_route ((NMSettingIPConfig *) s2, 0), 473);
+	g_assert (nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	nm_setting_ip_config_clear_routes ((NMSettingIPConfig *) s2);
+	g_assert (!nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	/* DNS servers are compared as addresses, not by their notation. */
+	g_clear_object (&s1);
+	g_clear_object (&s2);
+	s1 = nm_setting_ip6_config_new ();
+	s2 = nm_setting_ip6_config_new ();
+	g_object_set (s1, NM_SETTING_IP_CONFIG_DNS, NM_MAKE_STRV ("::1", "fe80::1"), NULL);
+	g_object_set (s2, NM_SETTING_IP_CONFIG_DNS, NM_MAKE_STRV ("0:0::1", "FE80:0::1"), NULL);
+	g_assert (nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_object_set (s2, NM_SETTING_IP_CONFIG_DNS, NM_MAKE_STRV ("fe80::1", "::1"), NULL);
+	g_assert (!nm_setting_compare (s1, s2, NM_SETTING_COMPARE_FLAG_EXACT));
+}
+
 static void
 test_setting_compare_wired_cloned_mac_address (void)
 {
@@ -9184,6 +9304,7 @@ int main (int argc, char **argv)
 	g_test_add_func ("/core/general/test_setting_ip4_config_labels", test_setting_ip4_config_labels);
 	g_test_add_func ("/core/general/test_setting_ip4_config_address_data", test_setting_ip4_config_address_data);
 	g_test_add_func ("/core/general/test_setting_ip_route_attributes", test_setting_ip_route_attributes);
+	g_test_add_func ("/core/general/test_setting_ip_route_dup_attributes", test_setting_ip_route_dup_attributes);
 	g_test_add_func ("/core/general/test_setting_gsm_apn_spaces", test_setting_gsm_apn_spaces);
 	g_test_add_func ("/core/general/test_setting_gsm_apn_bad_chars", test_setting_gsm_apn_bad_chars);
 	g_test_add_func ("/core/general/test_setting_gsm_apn_underscore", test_setting_gsm_apn_underscore);
@@ -9197,6 +9318,7 @@ int main (int argc, char **argv)
 	g_test_add_func ("/core/general/test_setting_compare_id", test_setting_compare_id);
 	g_test_add_func ("/core/general/test_setting_compare_addresses", test_setting_compare_addresses);
 	g_test_add_func ("/core/general/test_setting_compare_routes", test_setting_compare_routes);
+	g_test_add_func ("/core/general/test_setting_compare_cached_hash", test_setting_compare_cached_hash);
 	g_test_add_func ("/core/general/test_setting_compare_wired_cloned_mac_address", test_setting_compare_wired_cloned_mac_address);
 	g_test_add_func ("/core/general/test_setting_compare_wirless_cloned_mac_address", test_setting_compare_wireless_cloned_mac_address);
 	g_test_add_func ("/core/general/test_setting_compare_timestamp", test_setting_compare_timestamp);
@@ -841,6 +841,74 @@ test_bridge_port_vlans (void)
 
 /*****************************************************************************/
 
+static void
+test_ip_routes_many (void)
+{
+	gs_unref_object NMConnection *con = NULL;
+	nm_auto_free_gstring GString *str = NULL;
+	NMSettingIPConfig *s_ip4;
+	NMSettingWired *s_wired;
+	NMIPRoute *route;
+	const guint n_routes = nmtst_test_quick () ? 200 : 5000;
+	guint i;
+
+	str = g_string_new ("[connection]\n"
+	                    "id=t\n"
+	                    "type=ethernet\n"
+	                    "interface-name=eth1\n"
+	                    "\n"
+	                    "[ethernet]\n"
+	                    "mtu=1400\n"
+	                    "\n"
+	                    "[ipv4]\n"
+	                    "method=manual\n"
+	                    "address1=192.168.0.5/24,192.168.0.1\n");
+
+	/* write the routes in reverse order. The reader must order them by index. */
+	for (i = n_routes; i > 0; i--) {
+		g_string_append_printf (str,
+		                        "route%u=10.%u.%u.0/24,,%u\n",
+		                        i,
+		                        (i >> 8) & 0xFF,
+		                        i & 0xFF,
+		                        i);
+		if (i % 100 == 0)
+			g_string_append_printf (str, "route%u_options=mtu=%u\n", i, 1000 + i);
+	}
+
+	con = nmtst_create_connection_from_keyfile (str->str, "/test_ip_routes_many");
+
+	s_wired = nm_connection_get_setting_wired (con);
+	g_assert (s_wired);
+	g_assert_cmpint (nm_setting_wired_get_mtu (s_wired), ==, 1400);
+
+	s_ip4 = nm_connection_get_setting_ip4_config (con);
+	g_assert (s_ip4);
+	g_assert_cmpint (nm_setting_ip_config_get_num_addresses (s_ip4), ==, 1);
+	g_assert_cmpstr (nm_setting_ip_config_get_gateway (s_ip4), ==, "192.168.0.1");
+	g_assert_cmpint (nm_setting_ip_config_get_num_routes (s_ip4), ==, n_routes);
+
+	for (i = 1; i <= n_routes; i++) {
+		char dest[30];
+		GVariant *attr;
+
+		route = nm_setting_ip_config_get_route (s_ip4, i - 1);
+		nm_sprintf_buf (dest, "10.%u.%u.0", (i >> 8) & 0xFF, i & 0xFF);
+		g_assert_cmpstr (nm_ip_route_get_dest (route), ==, dest);
+		g_assert_cmpint (nm_ip_route_get_prefix (route), ==, 24);
+		g_assert_cmpint (nm_ip_route_get_metric (route), ==, i);
+
+		attr = nm_ip_route_get_attribute (route, NM_IP_ROUTE_ATTRIBUTE_MTU);
+		if (i % 100 == 0) {
+			g_assert (attr);
+			g_assert_cmpint (g_variant_get_uint32 (attr), ==, 1000 + i);
+		} else
+			g_assert (!attr);
+	}
+}
+
+/*****************************************************************************/
+
 NMTST_DEFINE ();
 
 int main (int argc, char **argv)
@@ -857,6 +925,7 @@ int main (int argc, char **argv)
 	g_test_add_func ("/core/keyfile/test_vpn/1", test_vpn_1);
 	g_test_add_func ("/core/keyfile/bridge/vlans", test_bridge_vlans);
 	g_test_add_func ("/core/keyfile/bridge-port/vlans", test_bridge_port_vlans);
+	g_test_add_func ("/core/keyfile/ip/routes-many", test_ip_routes_many);
 
 	return g_test_run ();
 }
@@ -483,9 +483,17 @@ _c_public_ NDhcp4ClientProbe *n_dhcp4_client_probe_free(NDhcp4ClientProbe *probe
         c_list_for_each_entry_safe(node, t_node, &probe->event_list, probe_link)
                 n_dhcp4_c_event_node_free(node);
 
-        if (probe == probe->client->current_probe)
+        if (probe == probe->client->current_probe) {
                 probe->client->current_probe = NULL;
 
+                /*
+                 * With an external timer, the caller reads the timeout of
+                 * the client. Don't leave the one of this probe behind.
+                 */
+                if (probe->client->config->external_timer)
+                        n_dhcp4_client_arm_timer(probe->client);
+        }
+
         n_dhcp4_client_lease_unref(probe->current_lease);
         n_dhcp4_c_connection_deinit(&probe->connection);
         n_dhcp4_client_unref(probe->client);
@@ -90,6 +90,7 @@ int n_dhcp4_client_config_dup(NDhcp4ClientConfig *config, NDhcp4ClientConfig **d
         dup->ifindex = config->ifindex;
         dup->transport = config->transport;
         dup->request_broadcast = config->request_broadcast;
+        dup->external_timer = config->external_timer;
         memcpy(dup->mac, config->mac, sizeof(dup->mac));
         dup->n_mac = config->n_mac;
         memcpy(dup->broadcast_mac, config->broadcast_mac, sizeof(dup->broadcast_mac));
@@ -161,6 +162,24 @@ _c_public_ void n_dhcp4_client_config_set_request_broadcast(NDhcp4ClientConfig *
         config->request_broadcast = request_broadcast;
 }
 
+/**
+ * n_dhcp4_client_config_set_external_timer() - set external-timer property
+ * @config:                     configuration to operate on
+ * @external_timer:             value to set
+ *
+ * This sets the external_timer property of the given configuration object.
+ *
+ * The default is false, in which case each client uses its own timerfd, which
+ * is part of the FD returned by n_dhcp4_client_get_fd(). If set to true, the
+ * client does not allocate a timerfd. Instead, the caller must query the next
+ * timeout via n_dhcp4_client_get_timeout() after each call into the client,
+ * and call n_dhcp4_client_dispatch() once it elapsed. This allows callers that
+ * run many clients to multiplex all their timeouts onto a single timer.
+ */
+_c_public_ void n_dhcp4_client_config_set_external_timer(NDhcp4ClientConfig *config, bool external_timer) {
+        config->external_timer = external_timer;
+}
+
 /**
  * n_dhcp4_client_config_set_mac() - set mac property
  * @config:                     client configuration to operate on
@@ -421,6 +440,12 @@ _c_public_ int n_dhcp4_client_new(NDhcp4Client **clientp, NDhcp4ClientConfig *co
         if (client->fd_epoll < 0)
                 return -errno;
 
+        if (client->config->external_timer) {
+                *clientp = client;
+                client = NULL;
+                return 0;
+        }
+
         client->fd_timer = timerfd_create(CLOCK_BOOTTIME, TFD_CLOEXEC | TFD_NONBLOCK);
         if (client->fd_timer < 0 && errno == EINVAL)
                 client->fd_timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
@@ -609,6 +634,12 @@ void n_dhcp4_client_arm_timer(NDhcp4Client *client) {
         if (client->current_probe)
                 n_dhcp4_client_probe_get_timeout(client->current_probe, &timeout);
 
+        if (client->config->external_timer) {
+                /* the caller polls n_dhcp4_client_get_timeout() */
+                client->scheduled_timeout = timeout;
+                return;
+        }
+
         if (timeout != client->scheduled_timeout) {
                 /*
                  * Across our codebase, timeouts are specified as absolute
@@ -660,8 +691,50 @@ _c_public_ void n_dhcp4_client_get_fd(NDhcp4Client *client, int *fdp) {
         *fdp = client->fd_epoll;
 }
 
+/**
+ * n_dhcp4_client_get_timeout() - retrieve next timeout
+ * @client:                     client to operate on
+ * @timeoutp:                   output argument to store the timeout
+ *
+ * This retrieves the time when @client must be dispatched next, as absolute
+ * timestamp in nanoseconds on CLOCK_BOOTTIME. 0 is returned in @timeoutp if no
+ * timeout is pending.
+ *
+ * This is only needed if the client was configured with an external timer,
+ * see n_dhcp4_client_config_set_external_timer(). The timeout can change with
+ * any call into the client, so the caller should query it after each of them.
+ */
+_c_public_ void n_dhcp4_client_get_timeout(NDhcp4Client *client, uint64_t *timeoutp) {
+        *timeoutp = client->scheduled_timeout;
+}
+
+static int n_dhcp4_client_dispatch_timeout(NDhcp4Client *client) {
+        uint64_t ns_now;
+
+        /*
+         * Forward the timer-event to the active probe. Timers should
+         * not fire if there is no probe running, but lets ignore them
+         * for now, so probe-internals are not leaked to this generic
+         * client dispatcher.
+         */
+        if (!client->current_probe)
+                return 0;
+
+        /*
+         * Read the current time *after* dispatching the timer,
+         * to make sure we do not miss wakeups.
+         */
+        ns_now = n_dhcp4_gettime(CLOCK_BOOTTIME);
+
+        if (client->config->external_timer &&
+            (!client->scheduled_timeout || ns_now < client->scheduled_timeout))
+                return 0;
+
+        return n_dhcp4_client_probe_dispatch_timer(client->current_probe, ns_now);
+}
+
 static int n_dhcp4_client_dispatch_timer(NDhcp4Client *client, struct epoll_event *event) {
-        uint64_t v, ns_now;
+        uint64_t v;
         int r;
 
         if (event->events & (EPOLLHUP | EPOLLERR)) {
@@ -700,24 +773,9 @@ static int n_dhcp4_client_dispatch_timer(NDhcp4Client *client, struct epoll_even
                         return -ENOTRECOVERABLE;
                 }
 
-                /*
-                 * Forward the timer-event to the active probe. Timers should
-                 * not fire if there is no probe running, but lets ignore them
-                 * for now, so probe-internals are not leaked to this generic
-                 * client dispatcher.
-                 */
-                if (client->current_probe) {
-                        /*
-                         * Read the current time *after* dispatching the timer,
-                         * to make sure we do not miss wakeups.
-                         */
-                        ns_now = n_dhcp4_gettime(CLOCK_BOOTTIME);
-
-                        r = n_dhcp4_client_probe_dispatch_timer(client->current_probe,
-                                                                ns_now);
-                        if (r)
-                                return r;
-                }
+                r = n_dhcp4_client_dispatch_timeout(client);
+                if (r)
+                        return r;
         }
 
         return 0;
@@ -735,6 +793,26 @@ static int n_dhcp4_client_dispatch_io(NDhcp4Client *client, struct epoll_event *
         return r;
 }
 
+static int n_dhcp4_client_dispatch_result(NDhcp4Client *client, int r) {
+        if (r == N_DHCP4_E_DOWN) {
+                /* continue normally */
+                return n_dhcp4_client_raise(client,
+                                            NULL,
+                                            N_DHCP4_CLIENT_EVENT_DOWN);
+        } else if (r) {
+                if (r >= _N_DHCP4_E_INTERNAL) {
+                        n_dhcp4_log(&client->log_queue,
+                                    LOG_ERR,
+                                    "invalid internal error code %d after dispatch",
+                                    r);
+                        return N_DHCP4_E_INTERNAL;
+                }
+                return r;
+        }
+
+        return 0;
+}
+
 /**
  * n_dhcp4_client_dispatch() - dispatch client
  * @client:                     client to operate on
@@ -744,6 +822,9 @@ static int n_dhcp4_client_dispatch_io(NDhcp4Client *client, struct epoll_event *
  *
  * This function never blocks.
  *
+ * If the client uses an external timer, this also handles the timeout
+ * returned by n_dhcp4_client_get_timeout(), if it elapsed.
+ *
  * If there are more events to dispatch, than would be reasonable to do in a
  * single dispatch, this will return N_DHCP4_E_PREEMPTED. In this case the
  * caller is expected to call into this function again when it is ready to
@@ -780,26 +861,16 @@ _c_public_ int n_dhcp4_client_dispatch(NDhcp4Client *client) {
                         break;
                 }
 
-                if (r) {
-                        if (r == N_DHCP4_E_DOWN) {
-                                r = n_dhcp4_client_raise(client,
-                                                         NULL,
-                                                         N_DHCP4_CLIENT_EVENT_DOWN);
-                                if (r)
-                                        return r;
-
-                                /* continue normally */
-                        } else if (r) {
-                                if (r >= _N_DHCP4_E_INTERNAL) {
-                                        n_dhcp4_log(&client->log_queue,
-                                                    LOG_ERR,
-                                                    "invalid internal error code %d after dispatch",
-                                                    r);
-                                        return N_DHCP4_E_INTERNAL;
-                                }
-                                return r;
-                        }
-                }
+                r = n_dhcp4_client_dispatch_result(client, r);
+                if (r)
+                        return r;
+        }
+
+        if (client->config->external_timer) {
+                r = n_dhcp4_client_dispatch_timeout(client);
+                r = n_dhcp4_client_dispatch_result(client, r);
+                if (r)
+                        return r;
         }
 
         n_dhcp4_client_arm_timer(client);
@@ -237,6 +237,7 @@ struct NDhcp4ClientConfig {
         int ifindex;
         unsigned int transport;
         bool request_broadcast;
+        bool external_timer;
         uint8_t mac[32]; /* MAX_ADDR_LEN */
         size_t n_mac;
         uint8_t broadcast_mac[32]; /* MAX_ADDR_LEN */
@@ -117,6 +117,7 @@ NDhcp4ClientConfig *n_dhcp4_client_config_free(NDhcp4ClientConfig *config);
 void n_dhcp4_client_config_set_ifindex(NDhcp4ClientConfig *config, int ifindex);
 void n_dhcp4_client_config_set_transport(NDhcp4ClientConfig *config, unsigned int transport);
 void n_dhcp4_client_config_set_request_broadcast(NDhcp4ClientConfig *config, bool request_broadcast);
+void n_dhcp4_client_config_set_external_timer(NDhcp4ClientConfig *config, bool external_timer);
 void n_dhcp4_client_config_set_mac(NDhcp4ClientConfig *config, const uint8_t *mac, size_t n_mac);
 void n_dhcp4_client_config_set_broadcast_mac(NDhcp4ClientConfig *config, const uint8_t *mac, size_t n_mac);
 int n_dhcp4_client_config_set_client_id(NDhcp4ClientConfig *config, const uint8_t *id, size_t n_id);
@@ -143,6 +144,7 @@ NDhcp4Client *n_dhcp4_client_ref(NDhcp4Client *client);
 NDhcp4Client *n_dhcp4_client_unref(NDhcp4Client *client);
 
 void n_dhcp4_client_get_fd(NDhcp4Client *client, int *fdp);
+void n_dhcp4_client_get_timeout(NDhcp4Client *client, uint64_t *timeoutp);
 int n_dhcp4_client_dispatch(NDhcp4Client *client);
 int n_dhcp4_client_pop_event(NDhcp4Client *client, NDhcp4ClientEvent **eventp);
 
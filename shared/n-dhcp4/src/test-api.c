@@ -67,6 +67,7 @@ static void test_api_functions(void) {
                 (void *)n_dhcp4_client_config_set_ifindex,
                 (void *)n_dhcp4_client_config_set_transport,
                 (void *)n_dhcp4_client_config_set_request_broadcast,
+                (void *)n_dhcp4_client_config_set_external_timer,
                 (void *)n_dhcp4_client_config_set_mac,
                 (void *)n_dhcp4_client_config_set_broadcast_mac,
                 (void *)n_dhcp4_client_config_set_client_id,
@@ -88,6 +89,7 @@ static void test_api_functions(void) {
                 (void *)n_dhcp4_client_unrefp,
                 (void *)n_dhcp4_client_unrefv,
                 (void *)n_dhcp4_client_get_fd,
+                (void *)n_dhcp4_client_get_timeout,
                 (void *)n_dhcp4_client_dispatch,
                 (void *)n_dhcp4_client_pop_event,
                 (void *)n_dhcp4_client_update_mtu,
@@ -0,0 +1,172 @@
+/*
+ * Tests for the External Client Timer
+ * With an external timer, the client has no timerfd. The caller reads the
+ * next timeout via n_dhcp4_client_get_timeout() and dispatches the client
+ * once it passed.
+ */
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "n-dhcp4-private.h"
+#include "test.h"
+#include "util/link.h"
+#include "util/netns.h"
+
+static void test_server_receive(NDhcp4SConnection *connection, uint8_t expected_type) {
+        _c_cleanup_(n_dhcp4_incoming_freep) NDhcp4Incoming *message = NULL;
+        struct pollfd pfd = {};
+        uint8_t received_type;
+        int r, fd;
+
+        n_dhcp4_s_connection_get_fd(connection, &fd);
+        pfd = (struct pollfd){ .fd = fd, .events = POLLIN };
+        r = poll(&pfd, 1, 5000);
+        c_assert(r == 1);
+
+        r = n_dhcp4_s_connection_dispatch_io(connection, &message);
+        c_assert(!r);
+        c_assert(message);
+
+        r = n_dhcp4_incoming_query_message_type(message, &received_type);
+        c_assert(!r);
+        c_assert(received_type == expected_type);
+}
+
+static void test_server_receive_none(NDhcp4SConnection *connection) {
+        struct pollfd pfd = {};
+        int r, fd;
+
+        n_dhcp4_s_connection_get_fd(connection, &fd);
+        pfd = (struct pollfd){ .fd = fd, .events = POLLIN };
+        r = poll(&pfd, 1, 0);
+        c_assert(r == 0);
+}
+
+static void test_sleep_until(uint64_t timeout) {
+        struct timespec ts = {
+                .tv_sec = timeout / UINT64_C(1000000000),
+                .tv_nsec = timeout % UINT64_C(1000000000),
+        };
+        int r;
+
+        do {
+                r = clock_nanosleep(CLOCK_BOOTTIME, TIMER_ABSTIME, &ts, NULL);
+        } while (r == EINTR);
+        c_assert(!r);
+}
+
+static void test_external_timer(void) {
+        const struct in_addr addr_server = (struct in_addr){ htonl(10 << 24 | 1) };
+        _c_cleanup_(netns_closep) int ns_server = -1, ns_client = -1;
+        _c_cleanup_(link_deinit) Link link_server = LINK_NULL(link_server);
+        _c_cleanup_(link_deinit) Link link_client = LINK_NULL(link_client);
+        _c_cleanup_(n_dhcp4_client_config_freep) NDhcp4ClientConfig *client_config = NULL;
+        _c_cleanup_(n_dhcp4_client_probe_config_freep) NDhcp4ClientProbeConfig *probe_config = NULL;
+        _c_cleanup_(n_dhcp4_client_unrefp) NDhcp4Client *client = NULL;
+        _c_cleanup_(n_dhcp4_client_probe_freep) NDhcp4ClientProbe *probe = NULL;
+        NDhcp4SConnection connection_server = N_DHCP4_S_CONNECTION_NULL(connection_server);
+        NDhcp4SConnectionIp connection_server_ip = N_DHCP4_S_CONNECTION_IP_NULL(connection_server_ip);
+        uint64_t timeout, timeout2;
+        int r, oldns;
+
+        /* setup */
+
+        netns_new(&ns_server);
+        netns_new(&ns_client);
+
+        link_new_veth(&link_server, &link_client, ns_server, ns_client);
+        link_add_ip4(&link_server, &addr_server, 8);
+
+        netns_get(&oldns);
+        netns_set(ns_server);
+        r = n_dhcp4_s_connection_init(&connection_server, link_server.ifindex);
+        c_assert(!r);
+        netns_set(oldns);
+        n_dhcp4_s_connection_ip_init(&connection_server_ip, addr_server);
+        n_dhcp4_s_connection_ip_link(&connection_server_ip, &connection_server);
+
+        r = n_dhcp4_client_config_new(&client_config);
+        c_assert(!r);
+
+        n_dhcp4_client_config_set_ifindex(client_config, link_client.ifindex);
+        n_dhcp4_client_config_set_transport(client_config, N_DHCP4_TRANSPORT_ETHERNET);
+        n_dhcp4_client_config_set_external_timer(client_config, true);
+        n_dhcp4_client_config_set_mac(client_config, link_client.mac.ether_addr_octet, ETH_ALEN);
+        n_dhcp4_client_config_set_broadcast_mac(client_config,
+                                                (const uint8_t[]){
+                                                        0xff, 0xff, 0xff,
+                                                        0xff, 0xff, 0xff,
+                                                },
+                                                ETH_ALEN);
+        r = n_dhcp4_client_config_set_client_id(client_config,
+                                                (void *)"client-id",
+                                                strlen("client-id"));
+        c_assert(!r);
+
+        r = n_dhcp4_client_probe_config_new(&probe_config);
+        c_assert(!r);
+        n_dhcp4_client_probe_config_set_start_delay(probe_config, 200);
+
+        netns_get(&oldns);
+        netns_set(ns_client);
+
+        r = n_dhcp4_client_new(&client, client_config);
+        c_assert(!r);
+
+        /* the client has no timer of its own, and nothing is scheduled */
+        c_assert(client->fd_timer < 0);
+        n_dhcp4_client_get_timeout(client, &timeout);
+        c_assert(timeout == 0);
+
+        /* the deferred start of the probe is the first timeout */
+        r = n_dhcp4_client_probe(client, &probe, probe_config);
+        c_assert(!r);
+        n_dhcp4_client_get_timeout(client, &timeout);
+        c_assert(timeout > 0);
+
+        netns_set(oldns);
+
+        /* dispatching early does not fire the timeout */
+        if (n_dhcp4_gettime(CLOCK_BOOTTIME) < timeout) {
+                r = n_dhcp4_client_dispatch(client);
+                c_assert(!r);
+                n_dhcp4_client_get_timeout(client, &timeout2);
+                c_assert(timeout2 == timeout);
+                test_server_receive_none(&connection_server);
+        }
+
+        /* once it passed, dispatching sends the DISCOVER and schedules the retransmission */
+        test_sleep_until(timeout);
+        r = n_dhcp4_client_dispatch(client);
+        c_assert(!r);
+        test_server_receive(&connection_server, N_DHCP4_MESSAGE_DISCOVER);
+
+        n_dhcp4_client_get_timeout(client, &timeout2);
+        c_assert(timeout2 > timeout);
+
+        /* without a probe, there is no timeout */
+        probe = n_dhcp4_client_probe_free(probe);
+        n_dhcp4_client_get_timeout(client, &timeout);
+        c_assert(timeout == 0);
+
+        /* teardown */
+
+        n_dhcp4_s_connection_ip_unlink(&connection_server_ip);
+        n_dhcp4_s_connection_ip_deinit(&connection_server_ip);
+        n_dhcp4_s_connection_deinit(&connection_server);
+        link_del_ip4(&link_server, &addr_server, 8);
+}
+
+int main(int argc, char **argv) {
+        test_setup();
+
+        test_external_timer();
+
+        return 0;
+}
@@ -10,23 +10,47 @@
 #include <syslog.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "nm-io-utils.h"
 
 /*****************************************************************************/
 
+/* Changes are not written by rewriting the entire file. Instead, the changed
+ * entries are appended to a journal file next to it ("$FILENAME.journal").
+ * The journal is itself a keyfile with the same group, where later entries
+ * override earlier ones. Once the journal grows larger than the main file
+ * (or on a forced write, or when entries are removed), the main file is
+ * rewritten and the journal deleted.
+ *
+ * If we crash after rewriting the main file but before deleting the journal,
+ * outdated entries from the journal get applied again. For the timestamps
+ * and seen-bssids that we store here, that is acceptable. */
+#define JOURNAL_SUFFIX   ".journal"
+#define JOURNAL_MIN_SIZE ((gsize) (16 * 1024))
+
 struct _NMKeyFileDB {
 	NMKeyFileDBLogFcn log_fcn;
 	NMKeyFileDBGotDirtyFcn got_dirty_fcn;
 	gpointer user_data;
 	const char *group_name;
 	GKeyFile *kf;
+
+	/* the keys that changed since the last write. */
+	GHashTable *changed_keys;
+
+	gsize file_size;
+	gsize journal_size;
+
 	guint ref_count;
 
 	bool is_started:1;
 	bool dirty:1;
 	bool destroyed:1;
 
+	/* whether the next write must rewrite the main file. */
+	bool needs_compact:1;
+
 	char filename[];
 };
 
@@ -95,6 +119,7 @@ nm_key_file_db_new (const char *filename,
 	self->user_data = user_data;
 	self->kf = g_key_file_new ();
 	g_key_file_set_list_separator (self->kf, ',');
+	self->changed_keys = g_hash_table_new_full (nm_str_hash, g_str_equal, g_free, NULL);
 	memcpy (self->filename, filename, l_filename + 1);
 	self->group_name = &self->filename[l_filename + 1];
 	memcpy ((char *) self->group_name, group_name, l_group + 1);
@@ -127,6 +152,7 @@ nm_key_file_db_unref (NMKeyFileDB *self)
 		return;
 
 	g_key_file_unref (self->kf);
+	g_hash_table_unref (self->changed_keys);
 
 	g_free (self);
 }
@@ -162,6 +188,128 @@ nm_key_file_db_destroy (NMKeyFileDB *self)
 
 /*****************************************************************************/
 
+static char *
+_journal_filename (NMKeyFileDB *self)
+{
+	return g_strconcat (self->filename, JOURNAL_SUFFIX, NULL);
+}
+
+static void
+_journal_load (NMKeyFileDB *self)
+{
+	gs_free char *filename = NULL;
+	gs_free char *contents = NULL;
+	gs_unref_keyfile GKeyFile *kf = NULL;
+	gs_strfreev char **keys = NULL;
+	gsize contents_len;
+	gsize i, n_keys;
+	int errsv;
+
+	filename = _journal_filename (self);
+
+	if (!nm_utils_file_get_contents (-1,
+	                                 filename,
+	                                 20*1024*1024,
+	                                 NM_UTILS_FILE_GET_CONTENTS_FLAG_NONE,
+	                                 &contents,
+	                                 &contents_len,
+	                                 &errsv,
+	                                 NULL)) {
+		if (errsv != ENOENT) {
+			/* we don't know what the journal contains. Never append to
+			 * (or truncate) it, but rewrite the main file with the next write. */
+			_LOGD ("failed to read journal \"%s\": %s", filename, nm_strerror_native (errsv));
+			self->needs_compact = TRUE;
+		}
+		return;
+	}
+
+	kf = g_key_file_new ();
+	if (!g_key_file_load_from_data (kf,
+	                                contents,
+	                                contents_len,
+	                                G_KEY_FILE_NONE,
+	                                NULL)) {
+		/* the journal is unusable. Drop it with the next write. */
+		_LOGD ("failed to load journal \"%s\"", filename);
+		self->needs_compact = TRUE;
+		return;
+	}
+
+	keys = g_key_file_get_keys (kf, self->group_name, &n_keys, NULL);
+	for (i = 0; i < n_keys; i++) {
+		gs_free char *value = NULL;
+
+		value = g_key_file_get_value (kf, self->group_name, keys[i], NULL);
+		if (value)
+			g_key_file_set_value (self->kf, self->group_name, keys[i], value);
+	}
+
+	self->journal_size = contents_len;
+
+	_LOGD ("loaded journal \"%s\" with %zu entries", filename, n_keys);
+}
+
+static gboolean
+_journal_append (NMKeyFileDB *self)
+{
+	nm_auto_free_gstring GString *str = NULL;
+	gs_free char *filename = NULL;
+	nm_auto_close int fd = -1;
+	GHashTableIter iter;
+	const char *key;
+	const char *buf;
+	gsize len;
+
+	str = g_string_new (NULL);
+	if (self->journal_size == 0)
+		g_string_append_printf (str, "[%s]\n", self->group_name);
+
+	g_hash_table_iter_init (&iter, self->changed_keys);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &key, NULL)) {
+		gs_free char *value = NULL;
+
+		value = g_key_file_get_value (self->kf, self->group_name, key, NULL);
+		if (value)
+			g_string_append_printf (str, "%s=%s\n", key, value);
+	}
+
+	filename = _journal_filename (self);
+
+	fd = open (filename,
+	           O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (self->journal_size == 0 ? O_TRUNC : 0),
+	           0644);
+	if (fd < 0) {
+		_LOGD ("failure to open journal \"%s\": %s", filename, nm_strerror_native (errno));
+		return FALSE;
+	}
+
+	buf = str->str;
+	len = str->len;
+	while (len > 0) {
+		gssize n;
+
+		n = write (fd, buf, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			/* the journal might now have a partial line. The caller
+			 * rewrites the main file, which also deletes the journal. */
+			_LOGD ("failure to write journal \"%s\": %s", filename, nm_strerror_native (errno));
+			return FALSE;
+		}
+		buf += n;
+		len -= n;
+	}
+
+	self->journal_size += str->len;
+
+	_LOGD ("append %u entries to journal \"%s\"", g_hash_table_size (self->changed_keys), filename);
+	return TRUE;
+}
+
+/*****************************************************************************/
+
 /* nm_key_file_db_start() is supposed to be called right away, after creating the
  * instance.
  *
@@ -189,19 +337,29 @@ nm_key_file_db_start (NMKeyFileDB *self)
 	                                 NULL,
 	                                 &error)) {
 		_LOGD ("failed to read \"%s\": %s", self->filename, error->message);
-		return;
-	}
-
-	if (!g_key_file_load_from_data (self->kf,
-	                                contents,
-	                                contents_len,
-	                                G_KEY_FILE_KEEP_COMMENTS,
-	                                &error)) {
+		g_clear_error (&error);
+	} else if (!g_key_file_load_from_data (self->kf,
+	                                       contents,
+	                                       contents_len,
+	                                       G_KEY_FILE_KEEP_COMMENTS,
+	                                       &error)) {
 		_LOGD ("failed to load keyfile \"%s\": %s", self->filename, error->message);
-		return;
+		g_clear_error (&error);
+
+		/* drop what might have been parsed partially and replace the broken
+		 * file with the next write. */
+		g_key_file_unref (self->kf);
+		self->kf = g_key_file_new ();
+		g_key_file_set_list_separator (self->kf, ',');
+		self->needs_compact = TRUE;
+	} else {
+		self->file_size = contents_len;
+		_LOGD ("loaded keyfile-db for \"%s\"", self->filename);
 	}
 
-	_LOGD ("loaded keyfile-db for \"%s\"", self->filename);
+	/* also when the main file is missing or broken, the journal may have entries
+	 * that were written afterwards. They must not get lost. */
+	_journal_load (self);
 }
 
 /*****************************************************************************/
@@ -247,10 +405,20 @@ nm_key_file_db_get_string_list (NMKeyFileDB *self,
 
 static void
 _got_dirty (NMKeyFileDB *self,
-            const char *key)
+            const char *key,
+            gboolean is_removed)
 {
 	nm_assert (_IS_KEY_FILE_DB (self, TRUE, FALSE));
-	nm_assert (!self->dirty);
+
+	/* the journal cannot express removals. */
+	if (is_removed) {
+		g_hash_table_remove (self->changed_keys, key);
+		self->needs_compact = TRUE;
+	} else
+		g_hash_table_add (self->changed_keys, g_strdup (key));
+
+	if (self->dirty)
+		return;
 
 	_LOGD ("updated entry for %s.%s", self->group_name, key);
 
@@ -265,23 +433,13 @@ void
 nm_key_file_db_remove_key (NMKeyFileDB *self,
                            const char *key)
 {
-	gboolean got_dirty = FALSE;
-
 	g_return_if_fail (_IS_KEY_FILE_DB (self, TRUE, FALSE));
 
 	if (!key)
 		return;
 
-	if (!self->dirty) {
-		gs_free_error GError *error = NULL;
-
-		g_key_file_has_key (self->kf, self->group_name, key, &error);
-		got_dirty = (error != NULL);
-	}
-	g_key_file_remove_key (self->kf, self->group_name, key, NULL);
-
-	if (got_dirty)
-		_got_dirty (self, key);
+	if (g_key_file_remove_key (self->kf, self->group_name, key, NULL))
+		_got_dirty (self, key, TRUE);
 }
 
 void
@@ -290,7 +448,7 @@ nm_key_file_db_set_value (NMKeyFileDB *self,
                           const char *value)
 {
 	gs_free char *old_value = NULL;
-	gboolean got_dirty = FALSE;
+	gs_free char *new_value = NULL;
 
 	g_return_if_fail (_IS_KEY_FILE_DB (self, TRUE, FALSE));
 	g_return_if_fail (key);
@@ -300,30 +458,14 @@ nm_key_file_db_set_value (NMKeyFileDB *self,
 		return;
 	}
 
-	if (!self->dirty) {
-		gs_free_error GError *error = NULL;
-
-		old_value = g_key_file_get_value (self->kf, self->group_name, key, &error);
-		if (error)
-			got_dirty = TRUE;
-	}
+	old_value = g_key_file_get_value (self->kf, self->group_name, key, NULL);
 
 	g_key_file_set_value (self->kf, self->group_name, key, value);
 
-	if (   !self->dirty
-	    && !got_dirty) {
-		gs_free_error GError *error = NULL;
-		gs_free char *new_value = NULL;
-
-		new_value = g_key_file_get_value (self->kf, self->group_name, key, &error);
-		if (   error
-		    || !new_value
-		    || !nm_streq0 (old_value, new_value))
-			got_dirty = TRUE;
-	}
-
-	if (got_dirty)
-		_got_dirty (self, key);
+	new_value = g_key_file_get_value (self->kf, self->group_name, key, NULL);
+	if (   !new_value
+	    || !nm_streq0 (old_value, new_value))
+		_got_dirty (self, key, FALSE);
 }
 
 void
@@ -333,7 +475,7 @@ nm_key_file_db_set_string_list (NMKeyFileDB *self,
                                 gssize len)
 {
 	gs_free char *old_value = NULL;
-	gboolean got_dirty = FALSE;;
+	gs_free char *new_value = NULL;
 
 	g_return_if_fail (_IS_KEY_FILE_DB (self, TRUE, FALSE));
 	g_return_if_fail (key);
@@ -343,42 +485,38 @@ nm_key_file_db_set_string_list (NMKeyFileDB *self,
 		return;
 	}
 
-	if (!self->dirty) {
-		gs_free_error GError *error = NULL;
-
-		old_value = g_key_file_get_value (self->kf, self->group_name, key, &error);
-		if (error)
-			got_dirty = TRUE;
-	}
+	old_value = g_key_file_get_value (self->kf, self->group_name, key, NULL);
 
 	if (len < 0)
 		len = NM_PTRARRAY_LEN (value);
 
 	g_key_file_set_string_list (self->kf, self->group_name, key, value, len);
 
-	if (   !self->dirty
-	    && !got_dirty) {
-		gs_free_error GError *error = NULL;
-		gs_free char *new_value = NULL;
-
-		new_value = g_key_file_get_value (self->kf, self->group_name, key, &error);
-		if (   error
-		    || !new_value
-		    || !nm_streq0 (old_value, new_value))
-			got_dirty = TRUE;
-	}
-
-	if (got_dirty)
-		_got_dirty (self, key);
+	new_value = g_key_file_get_value (self->kf, self->group_name, key, NULL);
+	if (   !new_value
+	    || !nm_streq0 (old_value, new_value))
+		_got_dirty (self, key, FALSE);
 }
 
 /*****************************************************************************/
 
+/**
+ * nm_key_file_db_to_file:
+ * @self: the #NMKeyFileDB
+ * @force: if %TRUE, always rewrite the file, even if nothing changed.
+ *
+ * Persist the changes. Usually, only the changed entries are appended
+ * to the journal. The main file is rewritten (and the journal deleted)
+ * if @force is set, entries were removed, or the journal got too large.
+ */
 void
 nm_key_file_db_to_file (NMKeyFileDB *self,
                         gboolean force)
 {
 	gs_free_error GError *error = NULL;
+	gs_free char *journal_filename = NULL;
+	gs_free char *contents = NULL;
+	gsize contents_len;
 
 	g_return_if_fail (_IS_KEY_FILE_DB (self, TRUE, FALSE));
 
@@ -388,10 +526,38 @@ nm_key_file_db_to_file (NMKeyFileDB *self,
 
 	self->dirty = FALSE;
 
-	if (!g_key_file_save_to_file (self->kf,
-	                              self->filename,
-	                              &error)) {
+	if (   !force
+	    && !self->needs_compact
+	    && self->journal_size < NM_MAX (self->file_size, JOURNAL_MIN_SIZE)) {
+		if (_journal_append (self)) {
+			g_hash_table_remove_all (self->changed_keys);
+			return;
+		}
+	}
+
+	g_hash_table_remove_all (self->changed_keys);
+
+	contents = g_key_file_to_data (self->kf, &contents_len, NULL);
+	if (!g_file_set_contents (self->filename,
+	                          contents,
+	                          contents_len,
+	                          &error)) {
 		_LOGD ("failure to write keyfile \"%s\": %s", self->filename, error->message);
-	} else
-		_LOGD ("write keyfile: \"%s\"", self->filename);
+		return;
+	}
+
+	_LOGD ("write keyfile: \"%s\"", self->filename);
+
+	self->file_size = contents_len;
+	self->needs_compact = FALSE;
+
+	/* the journal is now merged into the main file. */
+	journal_filename = _journal_filename (self);
+	if (   unlink (journal_filename) != 0
+	    && errno != ENOENT) {
+		_LOGD ("failure to delete journal \"%s\": %s", journal_filename, nm_strerror_native (errno));
+		self->needs_compact = TRUE;
+		return;
+	}
+	self->journal_size = 0;
 }
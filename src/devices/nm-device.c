@@ -160,6 +160,35 @@ typedef struct {
 	                          that the original configuration didn't change. */
 } AppliedConfig;
 
+typedef struct {
+	GPtrArray *addresses;  /* NMPObject addresses of the last successful commit */
+	GPtrArray *routes;     /* NMPObject routes of the last successful commit */
+	int ifindex;
+	NMIPRouteTableSyncMode route_table_sync;
+	bool valid:1;
+	/* whether platform notified about address/route changes on the
+	 * ifindex since the last commit. */
+	bool platform_changed:1;
+	/* set during the commit, to ignore the platform events that the
+	 * commit itself causes. */
+	bool committing:1;
+} L3CommitData;
+
+typedef enum {
+	ACTIVATION_TRACE_PREPARE,
+	ACTIVATION_TRACE_CONFIG,
+	ACTIVATION_TRACE_IP_CONFIG,
+	ACTIVATION_TRACE_DHCP4_LEASE,
+	ACTIVATION_TRACE_DHCP6_LEASE,
+	ACTIVATION_TRACE_DAD6_DONE,
+	ACTIVATION_TRACE_IP4_DONE,
+	ACTIVATION_TRACE_IP6_DONE,
+	ACTIVATION_TRACE_PRE_UP_DONE,
+	ACTIVATION_TRACE_ACTIVATED,
+	ACTIVATION_TRACE_UP_DONE,
+	_ACTIVATION_TRACE_NUM,
+} ActivationTraceEvent;
+
 typedef struct {
 	NMDhcpClient *client;
 	NMDhcpConfig *config;
@@ -251,6 +280,7 @@ NM_GOBJECT_PROPERTIES_DEFINE (NMDevice,
 	PROP_IP4_CONNECTIVITY,
 	PROP_IP6_CONNECTIVITY,
 	PROP_INTERFACE_FLAGS,
+	PROP_ACTIVATION_TIMESTAMPS,
 );
 
 typedef struct _NMDevicePrivate {
@@ -384,8 +414,19 @@ typedef struct _NMDevicePrivate {
 		NMDispatcherCallId *call_id;
 		NMDeviceState       post_state;
 		NMDeviceStateReason post_state_reason;
+
+		/* the "up" call is not waited for, it's only tracked for
+		 * the activation timestamps. */
+		NMDispatcherCallId *up_call_id;
+
+		/* whether the "pre-down" call for the shutdown was already started. */
+		bool pre_down_on_quit:1;
 	} dispatcher;
 
+	/* Monotonic timestamps in msec of the steps of the current (or last)
+	 * activation. Zero means that the step was not reached (yet). */
+	gint64 activation_trace[_ACTIVATION_TRACE_NUM];
+
 	/* Link stuff */
 	guint           link_connected_id;
 	guint           link_disconnected_id;
@@ -459,6 +500,10 @@ typedef struct _NMDevicePrivate {
 		NMIPConfig *ip_config_x[2];
 	};
 
+	/* What was last committed to platform, to skip re-syncing an unchanged
+	 * configuration. Indexed by IS_IPv4. */
+	L3CommitData l3_commit_x[2];
+
 	/* Config from DHCP, PPP, LLv4, etc */
 	AppliedConfig  dev_ip_config_4;
 
@@ -610,6 +655,10 @@ typedef struct _NMDevicePrivate {
 		/* the currently configured max periodic interval. */
 		guint p_max_interval;
 
+		/* the interval up to which we back off while the connectivity
+		 * stays full. It is at least p_max_interval. */
+		guint p_stable_interval;
+
 		/* the current interval. If we are probing, the interval might be lower
 		 * then the configured max interval. */
 		guint p_cur_interval;
@@ -1703,6 +1752,90 @@ _get_stable_id (NMDevice *self,
 
 /*****************************************************************************/
 
+static
+NM_UTILS_LOOKUP_STR_DEFINE (_activation_trace_to_string, ActivationTraceEvent,
+	NM_UTILS_LOOKUP_DEFAULT_WARN ("unknown"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_PREPARE,      "prepare"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_CONFIG,       "config"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_IP_CONFIG,    "ip-config"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_DHCP4_LEASE,  "dhcp4-lease"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_DHCP6_LEASE,  "dhcp6-lease"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_DAD6_DONE,    "dad6-done"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_IP4_DONE,     "ip4-done"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_IP6_DONE,     "ip6-done"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_PRE_UP_DONE,  "pre-up-dispatcher-done"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_ACTIVATED,    "activated"),
+	NM_UTILS_LOOKUP_STR_ITEM (ACTIVATION_TRACE_UP_DONE,      "up-dispatcher-done"),
+	NM_UTILS_LOOKUP_ITEM_IGNORE (_ACTIVATION_TRACE_NUM),
+);
+
+static void
+_activation_trace_reset (NMDevice *self)
+{
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+
+	if (priv->dispatcher.up_call_id)
+		nm_dispatcher_call_cancel (g_steal_pointer (&priv->dispatcher.up_call_id));
+
+	if (priv->activation_trace[ACTIVATION_TRACE_PREPARE] == 0)
+		return;
+
+	memset (priv->activation_trace, 0, sizeof (priv->activation_trace));
+	_notify (self, PROP_ACTIVATION_TIMESTAMPS);
+}
+
+/* Record the time when @event happened during the current activation. Only
+ * the first occurrence is recorded, so that for example DHCP renewals don't
+ * overwrite the time of the initial lease. */
+static void
+_activation_trace (NMDevice *self, ActivationTraceEvent event)
+{
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+	gint64 now_msec;
+
+	nm_assert (event >= 0 && event < _ACTIVATION_TRACE_NUM);
+
+	if (priv->activation_trace[event] != 0)
+		return;
+
+	if (   event != ACTIVATION_TRACE_PREPARE
+	    && priv->activation_trace[ACTIVATION_TRACE_PREPARE] == 0) {
+		/* not part of an activation that we track. */
+		return;
+	}
+
+	now_msec = nm_utils_get_monotonic_timestamp_msec ();
+	priv->activation_trace[event] = now_msec;
+
+	_LOGT (LOGD_DEVICE, "activation-trace: %s at +%"G_GINT64_FORMAT" msec",
+	       _activation_trace_to_string (event),
+	       now_msec - priv->activation_trace[ACTIVATION_TRACE_PREPARE]);
+
+	_notify (self, PROP_ACTIVATION_TIMESTAMPS);
+}
+
+static GVariant *
+_activation_trace_to_variant (NMDevice *self)
+{
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+	GVariantBuilder builder;
+	ActivationTraceEvent event;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+	for (event = 0; event < _ACTIVATION_TRACE_NUM; event++) {
+		if (priv->activation_trace[event] == 0)
+			continue;
+		g_variant_builder_add (&builder,
+		                       "{st}",
+		                       _activation_trace_to_string (event),
+		                       (guint64) nm_utils_monotonic_timestamp_as_boottime (priv->activation_trace[event],
+		                                                                           NM_UTILS_NSEC_PER_MSEC));
+	}
+	return g_variant_builder_end (&builder);
+}
+
+/*****************************************************************************/
+
 static
 NM_UTILS_LOOKUP_STR_DEFINE (_ip_state_to_string, NMDeviceIPState,
 	NM_UTILS_LOOKUP_DEFAULT_WARN ("unknown"),
@@ -1740,6 +1873,10 @@ _set_ip_state (NMDevice *self, int addr_family, NMDeviceIPState new_state)
 		                                    addr_family == AF_INET
 		                                      ? NM_ACTIVATION_STATE_FLAG_IP4_READY
 		                                      : NM_ACTIVATION_STATE_FLAG_IP6_READY);
+		_activation_trace (self,
+		                     IS_IPv4
+		                   ? ACTIVATION_TRACE_IP4_DONE
+		                   : ACTIVATION_TRACE_IP6_DONE);
 	}
 }
 
@@ -2995,6 +3132,8 @@ typedef enum {
 	CONCHECK_SCHEDULE_RETURNED_MIN,
 	CONCHECK_SCHEDULE_RETURNED_BUMP,
 	CONCHECK_SCHEDULE_RETURNED_MAX,
+	CONCHECK_SCHEDULE_RETURNED_STABLE,
+	CONCHECK_SCHEDULE_NETWORK_CHANGED,
 } ConcheckScheduleMode;
 
 static NMDeviceConnectivityHandle *concheck_start (NMDevice *self,
@@ -3045,6 +3184,8 @@ concheck_is_possible (NMDevice *self)
 	return TRUE;
 }
 
+#define CONCHECK_P_JITTER_MIN_INTERVAL 10
+
 static gboolean
 concheck_periodic_schedule_do (NMDevice *self, int addr_family, gint64 now_ns)
 {
@@ -3075,6 +3216,14 @@ concheck_periodic_schedule_do (NMDevice *self, int addr_family, gint64 now_ns)
 	expiry = priv->concheck_x[IS_IPv4].p_cur_basetime_ns + (priv->concheck_x[IS_IPv4].p_cur_interval * NM_UTILS_NSEC_PER_SEC);
 	tdiff = expiry - now_ns;
 
+	/* delay longer intervals by a random part, so that devices (and hosts) that
+	 * started at the same time don't keep checking in lock-step. The jitter is not
+	 * added to the basetime, so it doesn't accumulate. */
+	if (priv->concheck_x[IS_IPv4].p_cur_interval >= CONCHECK_P_JITTER_MIN_INTERVAL) {
+		tdiff += g_random_int_range (0, (priv->concheck_x[IS_IPv4].p_cur_interval * 1000u) / 4)
+		         * NM_UTILS_NSEC_PER_MSEC;
+	}
+
 	_LOGT (LOGD_CONCHECK, "connectivity: [IPv%c] periodic-check: %sscheduled in %lld milliseconds (%u seconds interval)",
 	       nm_utils_addr_family_to_char (addr_family),
 	       periodic_check_disabled ? "re-" : "",
@@ -3096,6 +3245,11 @@ out:
 
 #define CONCHECK_P_PROBE_INTERVAL 1
 
+/* after the network changed, recheck after a random delay in this range. Devices
+ * that see the same change (e.g. a switch coming back) don't all check together. */
+#define CONCHECK_P_NETWORK_CHANGED_MIN_MSEC 1000
+#define CONCHECK_P_NETWORK_CHANGED_MAX_MSEC 5000
+
 static void
 concheck_periodic_schedule_set (NMDevice *self, int addr_family, ConcheckScheduleMode mode)
 {
@@ -3135,7 +3289,7 @@ concheck_periodic_schedule_set (NMDevice *self, int addr_family, ConcheckSchedul
 		nm_assert (priv->concheck_x[IS_IPv4].p_max_interval > 0);
 		nm_assert (priv->concheck_x[IS_IPv4].p_cur_interval > 0);
 
-		if (priv->concheck_x[IS_IPv4].p_cur_interval <= priv->concheck_x[IS_IPv4].p_max_interval) {
+		if (priv->concheck_x[IS_IPv4].p_cur_interval <= priv->concheck_x[IS_IPv4].p_stable_interval) {
 			/* we currently have a shorter interval set, than what we now have. Either,
 			 * because we are probing, or because the previous max interval was shorter.
 			 *
@@ -3144,10 +3298,10 @@ concheck_periodic_schedule_set (NMDevice *self, int addr_family, ConcheckSchedul
 			return;
 		}
 
-		cur_expiry = priv->concheck_x[IS_IPv4].p_cur_basetime_ns + (priv->concheck_x[IS_IPv4].p_max_interval * NM_UTILS_NSEC_PER_SEC);
+		cur_expiry = priv->concheck_x[IS_IPv4].p_cur_basetime_ns + (priv->concheck_x[IS_IPv4].p_stable_interval * NM_UTILS_NSEC_PER_SEC);
 		nm_utils_get_monotonic_timestamp_nsec_cached (&now_ns);
 
-		priv->concheck_x[IS_IPv4].p_cur_interval = priv->concheck_x[IS_IPv4].p_max_interval;
+		priv->concheck_x[IS_IPv4].p_cur_interval = priv->concheck_x[IS_IPv4].p_stable_interval;
 		if (cur_expiry <= now_ns) {
 			/* Since the last time we scheduled a periodic check, already more than the
 			 * new max_interval passed. We need to start a check right away (and
@@ -3166,6 +3320,23 @@ concheck_periodic_schedule_set (NMDevice *self, int addr_family, ConcheckSchedul
 		}
 		return;
 
+	case CONCHECK_SCHEDULE_NETWORK_CHANGED:
+		/* carrier, addresses or routes changed. Check again soon, but don't postpone
+		 * a check that is already due. A burst of changes thus results in one check. */
+		nm_utils_get_monotonic_timestamp_nsec_cached (&now_ns);
+		tdiff = g_random_int_range (CONCHECK_P_NETWORK_CHANGED_MIN_MSEC,
+		                            CONCHECK_P_NETWORK_CHANGED_MAX_MSEC + 1);
+		tdiff = NM_MIN (tdiff, (gint64) priv->concheck_x[IS_IPv4].p_max_interval * 1000);
+		tdiff *= NM_UTILS_NSEC_PER_MSEC;
+		cur_expiry = priv->concheck_x[IS_IPv4].p_cur_basetime_ns + (priv->concheck_x[IS_IPv4].p_cur_interval * NM_UTILS_NSEC_PER_SEC);
+		if (cur_expiry <= now_ns + tdiff)
+			return;
+		priv->concheck_x[IS_IPv4].p_cur_interval = NM_MIN (priv->concheck_x[IS_IPv4].p_max_interval, CONCHECK_P_PROBE_INTERVAL);
+		/* set the basetime so that the check expires after @tdiff. */
+		priv->concheck_x[IS_IPv4].p_cur_basetime_ns = now_ns + tdiff - (priv->concheck_x[IS_IPv4].p_cur_interval * NM_UTILS_NSEC_PER_SEC);
+		concheck_periodic_schedule_do (self, addr_family, now_ns);
+		return;
+
 	case CONCHECK_SCHEDULE_CHECK_EXTERNAL:
 		/* a external connectivity check delays our periodic check. We reset the counter. */
 		priv->concheck_x[IS_IPv4].p_cur_basetime_ns = nm_utils_get_monotonic_timestamp_nsec_cached (&now_ns);
@@ -3188,7 +3359,8 @@ concheck_periodic_schedule_set (NMDevice *self, int addr_family, ConcheckSchedul
 				any_periodic_pending = TRUE;
 			}
 		}
-		if (any_periodic_pending) {
+		if (   any_periodic_pending
+		    && old_interval < priv->concheck_x[IS_IPv4].p_max_interval) {
 			/* we reached a timeout to schedule a new periodic request, however we still
 			 * have period requests pending that didn't complete yet. We need to bump the
 			 * interval already. */
@@ -3229,6 +3401,14 @@ concheck_periodic_schedule_set (NMDevice *self, int addr_family, ConcheckSchedul
 	case CONCHECK_SCHEDULE_RETURNED_BUMP:
 		priv->concheck_x[IS_IPv4].p_cur_interval = NM_MIN (priv->concheck_x[IS_IPv4].p_cur_interval * 2, priv->concheck_x[IS_IPv4].p_max_interval);
 		break;
+	case CONCHECK_SCHEDULE_RETURNED_STABLE:
+		/* the connectivity is still full. There is no need to probe our way up,
+		 * and past the max interval we back off further. */
+		if (priv->concheck_x[IS_IPv4].p_cur_interval < priv->concheck_x[IS_IPv4].p_max_interval)
+			priv->concheck_x[IS_IPv4].p_cur_interval = priv->concheck_x[IS_IPv4].p_max_interval;
+		else
+			priv->concheck_x[IS_IPv4].p_cur_interval = NM_MIN (priv->concheck_x[IS_IPv4].p_cur_interval * 2, priv->concheck_x[IS_IPv4].p_stable_interval);
+		break;
 	}
 
 	/* we are here, because we returned from a connectivity check and adjust the current interval.
@@ -3260,6 +3440,10 @@ concheck_update_interval (NMDevice *self, int addr_family, gboolean check_now)
 		priv->concheck_x[IS_IPv4].p_max_interval = new_interval;
 	}
 
+	priv->concheck_x[IS_IPv4].p_stable_interval = NM_CLAMP (nm_connectivity_get_max_interval (concheck_get_mgr (self)),
+	                                                        new_interval,
+	                                                        NM_MAX (new_interval, 7 * 24 * 3600));
+
 	if (!new_interval) {
 		/* this will cancel any potentially pending timeout because max-interval is zero.
 		 * But it logs a nice message... */
@@ -3284,6 +3468,20 @@ nm_device_check_connectivity_update_interval (NMDevice *self)
 	concheck_update_interval (self, AF_INET6, TRUE);
 }
 
+static void
+concheck_network_changed (NMDevice *self, int addr_family)
+{
+	nm_connectivity_network_changed (concheck_get_mgr (self),
+	                                 addr_family,
+	                                 nm_device_get_ip_iface (self));
+
+	if (addr_family == AF_UNSPEC) {
+		concheck_periodic_schedule_set (self, AF_INET, CONCHECK_SCHEDULE_NETWORK_CHANGED);
+		concheck_periodic_schedule_set (self, AF_INET6, CONCHECK_SCHEDULE_NETWORK_CHANGED);
+	} else
+		concheck_periodic_schedule_set (self, addr_family, CONCHECK_SCHEDULE_NETWORK_CHANGED);
+}
+
 static void
 concheck_update_state (NMDevice *self,
                        int addr_family,
@@ -3326,9 +3524,14 @@ concheck_update_state (NMDevice *self,
 
 	if (priv->concheck_x[IS_IPv4].state == state) {
 		/* we got a connectivity update, but the state didn't change. If we were probing,
-		 * we bump the probe frequency. */
-		if (allow_periodic_bump)
-			concheck_periodic_schedule_set (self, addr_family, CONCHECK_SCHEDULE_RETURNED_BUMP);
+		 * we bump the probe frequency. If we are fully connected, we back off. */
+		if (allow_periodic_bump) {
+			concheck_periodic_schedule_set (self,
+			                                addr_family,
+			                                  state == NM_CONNECTIVITY_FULL
+			                                ? CONCHECK_SCHEDULE_RETURNED_STABLE
+			                                : CONCHECK_SCHEDULE_RETURNED_BUMP);
+		}
 		return;
 	}
 	/* we need to update the probe interval before emitting signals. Emitting
@@ -3957,6 +4160,8 @@ carrier_changed (NMDevice *self, gboolean carrier)
 	if (priv->ignore_carrier && !carrier)
 		return;
 
+	concheck_network_changed (self, AF_UNSPEC);
+
 	if (nm_device_is_master (self)) {
 		if (carrier) {
 			/* Force master to retry getting ip addresses when carrier
@@ -6060,8 +6265,8 @@ nm_device_can_auto_connect (NMDevice *self,
 	return TRUE;
 }
 
-static gboolean
-device_has_config (NMDevice *self)
+gboolean
+nm_device_has_config (NMDevice *self)
 {
 	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
 
@@ -6159,7 +6364,7 @@ nm_device_generate_connection (NMDevice *self,
 	}
 
 	/* Return NULL if device is unconfigured. */
-	if (!device_has_config (self)) {
+	if (!nm_device_has_config (self)) {
 		g_set_error (error, NM_DEVICE_ERROR, NM_DEVICE_ERROR_FAILED,
 		             "device has no existing configuration");
 		return NULL;
@@ -7023,6 +7228,8 @@ activate_stage1_device_prepare (NMDevice *self)
 	NMActiveConnection *master;
 	NMDeviceClass *klass;
 
+	_activation_trace (self, ACTIVATION_TRACE_PREPARE);
+
 	priv->v4_route_table_initialized = FALSE;
 	priv->v6_route_table_initialized = FALSE;
 
@@ -7362,6 +7569,8 @@ activate_stage2_device_config (NMDevice *self)
 	gboolean no_firmware = FALSE;
 	CList *iter;
 
+	_activation_trace (self, ACTIVATION_TRACE_CONFIG);
+
 	nm_device_state_changed (self, NM_DEVICE_STATE_CONFIG, NM_DEVICE_STATE_REASON_NONE);
 
 	if (!nm_device_sys_iface_state_is_external_or_assume (self))
@@ -8358,6 +8567,8 @@ dhcp4_state_changed (NMDhcpClient *client,
 		nm_clear_g_source (&priv->dhcp_data_4.grace_id);
 		priv->dhcp_data_4.grace_pending = FALSE;
 
+		_activation_trace (self, ACTIVATION_TRACE_DHCP4_LEASE);
+
 		/* After some failures, we have been able to renew the lease:
 		 * update the ip state
 		 */
@@ -9148,6 +9359,9 @@ dhcp6_state_changed (NMDhcpClient *client,
 	case NM_DHCP_STATE_EXTENDED:
 		nm_clear_g_source (&priv->dhcp_data_6.grace_id);
 		priv->dhcp_data_6.grace_pending = FALSE;
+
+		_activation_trace (self, ACTIVATION_TRACE_DHCP6_LEASE);
+
 		/* If the server sends multiple IPv6 addresses, we receive a state
 		 * changed event for each of them. Use the event ID to merge IPv6
 		 * addresses from the same transaction into a single configuration.
@@ -11138,6 +11352,8 @@ activate_stage3_ip_config_start (NMDevice *self)
 {
 	int ifindex;
 
+	_activation_trace (self, ACTIVATION_TRACE_IP_CONFIG);
+
 	_set_ip_state (self, AF_INET, NM_DEVICE_IP_STATE_WAIT);
 	_set_ip_state (self, AF_INET6, NM_DEVICE_IP_STATE_WAIT);
 
@@ -12996,6 +13212,8 @@ _device_activate (NMDevice *self, NMActRequest *req)
 
 	act_request_set (self, req);
 
+	_activation_trace_reset (self);
+
 	nm_device_activate_schedule_stage1_device_prepare (self, FALSE);
 }
 
@@ -13240,6 +13458,61 @@ nm_device_get_ip4_config (NMDevice *self)
 	return NM_DEVICE_GET_PRIVATE (self)->ip_config_4;
 }
 
+static void
+_l3_commit_data_clear (L3CommitData *l3_commit)
+{
+	nm_clear_pointer (&l3_commit->addresses, g_ptr_array_unref);
+	nm_clear_pointer (&l3_commit->routes, g_ptr_array_unref);
+	l3_commit->valid = FALSE;
+}
+
+static gboolean
+_l3_commit_objs_equal (const GPtrArray *a, const GPtrArray *b, gboolean only_id)
+{
+	guint len = a ? a->len : 0u;
+	guint i;
+
+	if (len != (b ? b->len : 0u))
+		return FALSE;
+
+	for (i = 0; i < len; i++) {
+		if (only_id) {
+			if (!nmp_object_id_equal (a->pdata[i], b->pdata[i]))
+				return FALSE;
+		} else if (!nmp_object_equal (a->pdata[i], b->pdata[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Committing a configuration syncs all addresses and routes of the
+ * interface with platform. When the composite configuration is identical
+ * to the one of the last successful commit and platform did not report any
+ * changes for the interface since then, that sync is a no-op and can be
+ * skipped. The events caused by the commit itself are not counted as
+ * changes (see device_ipx_changed()), so already the second commit of the
+ * same configuration is skipped. */
+static gboolean
+_l3_commit_is_unchanged (NMDevice *self,
+                         int addr_family,
+                         int ifindex,
+                         NMIPRouteTableSyncMode route_table_sync,
+                         const GPtrArray *addresses,
+                         const GPtrArray *routes)
+{
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+	const gboolean IS_IPv4 = (addr_family == AF_INET);
+	const L3CommitData *l3_commit = &priv->l3_commit_x[IS_IPv4];
+
+	return    l3_commit->valid
+	       && !l3_commit->platform_changed
+	       && l3_commit->ifindex == ifindex
+	       && l3_commit->route_table_sync == route_table_sync
+	       && (IS_IPv4 || !priv->rt6_temporary_not_available)
+	       && _l3_commit_objs_equal (l3_commit->addresses, addresses, FALSE)
+	       && _l3_commit_objs_equal (l3_commit->routes, routes, FALSE);
+}
+
 static gboolean
 nm_device_set_ip_config (NMDevice *self,
                          int addr_family,
@@ -13272,33 +13545,92 @@ nm_device_set_ip_config (NMDevice *self,
 	       commit,
 	       new_config);
 
-	/* Always commit to nm-platform to update lifetimes */
+	/* Commit to nm-platform, unless the addresses and routes are the same as
+	 * on the last commit. The comparison includes the lifetimes, so changed
+	 * lifetimes are still committed. */
 	if (commit && new_config) {
+		L3CommitData *l3_commit = &priv->l3_commit_x[IS_IPv4];
+		gs_unref_ptrarray GPtrArray *addresses = NULL;
+		gs_unref_ptrarray GPtrArray *routes = NULL;
+		NMIPRouteTableSyncMode route_table_sync;
+		int ifindex;
 
 		_commit_mtu (self,
 		             IS_IPv4
 		               ? NM_IP4_CONFIG (new_config)
 		               : priv->ip_config_4);
 
+		ifindex = nm_ip_config_get_ifindex (new_config);
+		route_table_sync = _get_route_table_sync_mode_stateful (self, addr_family);
+
 		if (IS_IPv4) {
-			success = nm_ip4_config_commit (NM_IP4_CONFIG (new_config),
-			                                nm_device_get_platform (self),
-			                                _get_route_table_sync_mode_stateful (self,
-			                                                                     AF_INET));
-			nm_platform_ip4_dev_route_blacklist_set (nm_device_get_platform (self),
-			                                         nm_ip_config_get_ifindex (new_config),
-			                                         ip4_dev_route_blacklist);
+			addresses = nm_dedup_multi_objs_to_ptr_array_head (nm_ip4_config_lookup_addresses (NM_IP4_CONFIG (new_config)), NULL, NULL);
+			routes = nm_dedup_multi_objs_to_ptr_array_head (nm_ip4_config_lookup_routes (NM_IP4_CONFIG (new_config)), NULL, NULL);
 		} else {
-			gs_unref_ptrarray GPtrArray *temporary_not_available = NULL;
+			addresses = nm_dedup_multi_objs_to_ptr_array_head (nm_ip6_config_lookup_addresses (NM_IP6_CONFIG (new_config)), NULL, NULL);
+			routes = nm_dedup_multi_objs_to_ptr_array_head (nm_ip6_config_lookup_routes (NM_IP6_CONFIG (new_config)), NULL, NULL);
+		}
 
-			success = nm_ip6_config_commit (NM_IP6_CONFIG (new_config),
-			                                nm_device_get_platform (self),
-			                                _get_route_table_sync_mode_stateful (self,
-			                                                                     AF_INET6),
-			                                &temporary_not_available);
+		if (_l3_commit_is_unchanged (self, addr_family, ifindex, route_table_sync, addresses, routes)) {
+			_LOGT (LOGD_IP_from_af (addr_family),
+			       "ip%c-config: skip commit of unchanged addresses and routes",
+			       nm_utils_addr_family_to_char (addr_family));
+			if (IS_IPv4) {
+				nm_platform_ip4_dev_route_blacklist_set (nm_device_get_platform (self),
+				                                         ifindex,
+				                                         ip4_dev_route_blacklist);
+			}
+		} else {
+			gboolean network_changed;
+			gboolean addresses_synced = FALSE;
+
+			/* only a different set of addresses or routes may change the connectivity.
+			 * Updated lifetimes (or other attributes) don't. */
+			network_changed =    !_l3_commit_objs_equal (l3_commit->addresses, addresses, TRUE)
+			                  || !_l3_commit_objs_equal (l3_commit->routes, routes, TRUE);
+
+			_l3_commit_data_clear (l3_commit);
+			l3_commit->platform_changed = FALSE;
+			l3_commit->committing = TRUE;
+
+			if (IS_IPv4) {
+				success = nm_ip4_config_commit (NM_IP4_CONFIG (new_config),
+				                                nm_device_get_platform (self),
+				                                route_table_sync,
+				                                &addresses_synced);
+				nm_platform_ip4_dev_route_blacklist_set (nm_device_get_platform (self),
+				                                         ifindex,
+				                                         ip4_dev_route_blacklist);
+			} else {
+				gs_unref_ptrarray GPtrArray *temporary_not_available = NULL;
 
-			if (!_rt6_temporary_not_available_set (self, temporary_not_available))
-				success = FALSE;
+				success = nm_ip6_config_commit (NM_IP6_CONFIG (new_config),
+				                                nm_device_get_platform (self),
+				                                route_table_sync,
+				                                &temporary_not_available,
+				                                &addresses_synced);
+
+				if (!_rt6_temporary_not_available_set (self, temporary_not_available))
+					success = FALSE;
+			}
+
+			/* platform processes the netlink events of our requests before
+			 * returning, so the events of the commit were seen by now. */
+			l3_commit->committing = FALSE;
+
+			/* only remember the commit as applied if everything got configured.
+			 * Otherwise, the next identical commit must retry. */
+			if (   success
+			    && addresses_synced) {
+				l3_commit->addresses = g_steal_pointer (&addresses);
+				l3_commit->routes = g_steal_pointer (&routes);
+				l3_commit->ifindex = ifindex;
+				l3_commit->route_table_sync = route_table_sync;
+				l3_commit->valid = TRUE;
+			}
+
+			if (network_changed)
+				concheck_network_changed (self, addr_family);
 		}
 	}
 
@@ -13327,6 +13659,7 @@ nm_device_set_ip_config (NMDevice *self,
 	} else if (old_config /*&& !new_config*/) {
 		has_changes = TRUE;
 		priv->ip_config_x[IS_IPv4] = NULL;
+		_l3_commit_data_clear (&priv->l3_commit_x[IS_IPv4]);
 		_LOGD (LOGD_IP_from_af (addr_family),
 		       "ip%c-config: clear IP Config instance (%s)",
 		       nm_utils_addr_family_to_char (addr_family),
@@ -13515,6 +13848,9 @@ dispatcher_complete_proceed_state (NMDispatcherCallId *call_id, gpointer user_da
 
 	g_return_if_fail (call_id == priv->dispatcher.call_id);
 
+	if (priv->dispatcher.post_state == NM_DEVICE_STATE_SECONDARIES)
+		_activation_trace (self, ACTIVATION_TRACE_PRE_UP_DONE);
+
 	priv->dispatcher.call_id = NULL;
 	nm_device_queue_state (self,
 	                       priv->dispatcher.post_state,
@@ -13523,6 +13859,18 @@ dispatcher_complete_proceed_state (NMDispatcherCallId *call_id, gpointer user_da
 	priv->dispatcher.post_state_reason = NM_DEVICE_STATE_REASON_NONE;
 }
 
+static void
+dispatcher_complete_up (NMDispatcherCallId *call_id, gpointer user_data)
+{
+	NMDevice *self = NM_DEVICE (user_data);
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+
+	g_return_if_fail (call_id == priv->dispatcher.up_call_id);
+
+	priv->dispatcher.up_call_id = NULL;
+	_activation_trace (self, ACTIVATION_TRACE_UP_DONE);
+}
+
 /*****************************************************************************/
 
 static void
@@ -14234,6 +14582,7 @@ queued_ip_config_change (NMDevice *self, int addr_family)
 		    && !nm_ip6_config_has_any_dad_pending (priv->ext_ip6_config_captured,
 		                                           priv->dad6_ip6_config)) {
 			_LOGD (LOGD_DEVICE | LOGD_IP6, "IPv6 DAD terminated");
+			_activation_trace (self, ACTIVATION_TRACE_DAD6_DONE);
 			g_clear_object (&priv->dad6_ip6_config);
 			_set_ip_state (self, addr_family, NM_DEVICE_IP_STATE_DONE);
 			check_ip_state (self, FALSE, TRUE);
@@ -14270,6 +14619,7 @@ device_ipx_changed (NMPlatform *platform,
 	const NMPObjectType obj_type = obj_type_i;
 	const NMPlatformSignalChangeType change_type = change_type_i;
 	NMDevicePrivate *priv;
+	L3CommitData *l3_commit;
 	const NMPlatformIP6Address *addr;
 
 	if (nm_device_get_ip_ifindex (self) != ifindex)
@@ -14285,6 +14635,11 @@ device_ipx_changed (NMPlatform *platform,
 
 	priv = NM_DEVICE_GET_PRIVATE (self);
 
+	l3_commit = &priv->l3_commit_x[NM_IN_SET (obj_type, NMP_OBJECT_TYPE_IP4_ADDRESS,
+	                                                    NMP_OBJECT_TYPE_IP4_ROUTE)];
+	if (!l3_commit->committing)
+		l3_commit->platform_changed = TRUE;
+
 	switch (obj_type) {
 	case NMP_OBJECT_TYPE_IP4_ADDRESS:
 	case NMP_OBJECT_TYPE_IP4_ROUTE:
@@ -14803,6 +15158,37 @@ nm_device_set_unmanaged_by_user_conf (NMDevice *self)
 	                                  NM_DEVICE_STATE_REASON_USER_REQUESTED);
 }
 
+/**
+ * nm_device_dispatcher_pre_down_on_quit:
+ * @self: the #NMDevice
+ *
+ * On shutdown, the manager starts the "pre-down" dispatcher scripts of
+ * all devices that will get deactivated, and waits for them together
+ * before tearing down the first device. This starts the request for
+ * @self, if it is going to be deactivated by
+ * nm_device_set_unmanaged_by_quitting().
+ */
+void
+nm_device_dispatcher_pre_down_on_quit (NMDevice *self)
+{
+	NMDevicePrivate *priv;
+
+	g_return_if_fail (NM_IS_DEVICE (self));
+
+	priv = NM_DEVICE_GET_PRIVATE (self);
+
+	if (   priv->dispatcher.pre_down_on_quit
+	    || !(   nm_device_is_activating (self)
+	         || priv->state == NM_DEVICE_STATE_ACTIVATED))
+		return;
+
+	priv->dispatcher.pre_down_on_quit = TRUE;
+	nm_dispatcher_call_device (NM_DISPATCHER_ACTION_PRE_DOWN,
+	                           self,
+	                           priv->act_request.obj,
+	                           NULL, NULL, NULL);
+}
+
 void
 nm_device_set_unmanaged_by_quitting (NMDevice *self)
 {
@@ -16294,8 +16680,18 @@ _set_state_full (NMDevice *self,
 		priv->ignore_carrier = nm_config_data_get_ignore_carrier (NM_CONFIG_GET_DATA, self);
 
 		if (quitting) {
-			nm_dispatcher_call_device_sync (NM_DISPATCHER_ACTION_PRE_DOWN,
-			                                self, req);
+			/* On shutdown, the manager already started the pre-down scripts of
+			 * all devices via nm_device_dispatcher_pre_down_on_quit() and
+			 * waited for them together. Only start them now, if that
+			 * didn't happen for this device. */
+			if (priv->dispatcher.pre_down_on_quit)
+				priv->dispatcher.pre_down_on_quit = FALSE;
+			else {
+				nm_dispatcher_call_device (NM_DISPATCHER_ACTION_PRE_DOWN,
+				                           self,
+				                           req,
+				                           NULL, NULL, NULL);
+			}
 		} else {
 			priv->dispatcher.post_state = NM_DEVICE_STATE_DISCONNECTED;
 			priv->dispatcher.post_state_reason = reason;
@@ -16333,11 +16729,16 @@ _set_state_full (NMDevice *self,
 		break;
 	case NM_DEVICE_STATE_ACTIVATED:
 		_LOGI (LOGD_DEVICE, "Activation: successful, device activated.");
+		_activation_trace (self, ACTIVATION_TRACE_ACTIVATED);
 		nm_device_update_metered (self);
+		if (priv->dispatcher.up_call_id)
+			nm_dispatcher_call_cancel (g_steal_pointer (&priv->dispatcher.up_call_id));
 		nm_dispatcher_call_device (NM_DISPATCHER_ACTION_UP,
 		                           self,
 		                           req,
-		                           NULL, NULL, NULL);
+		                           dispatcher_complete_up,
+		                           self,
+		                           &priv->dispatcher.up_call_id);
 
 		if (priv->proxy_config)
 			_pacrunner_manager_add (self);
@@ -16410,15 +16811,10 @@ _set_state_full (NMDevice *self,
 
 	if (   (old_state == NM_DEVICE_STATE_ACTIVATED || old_state == NM_DEVICE_STATE_DEACTIVATING)
 	    && (state != NM_DEVICE_STATE_DEACTIVATING)) {
-		if (quitting) {
-			nm_dispatcher_call_device_sync (NM_DISPATCHER_ACTION_DOWN,
-			                                self, req);
-		} else {
-			nm_dispatcher_call_device (NM_DISPATCHER_ACTION_DOWN,
-			                           self,
-			                           req,
-			                           NULL, NULL, NULL);
-		}
+		nm_dispatcher_call_device (NM_DISPATCHER_ACTION_DOWN,
+		                           self,
+		                           req,
+		                           NULL, NULL, NULL);
 	}
 
 	/* IP-related properties are only valid when the device has IP configuration.
@@ -17626,6 +18022,9 @@ get_property (GObject *object, guint prop_id,
 	case PROP_INTERFACE_FLAGS:
 		g_value_set_uint (value, priv->interface_flags);
 		break;
+	case PROP_ACTIVATION_TIMESTAMPS:
+		g_value_take_variant (value, _activation_trace_to_variant (self));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -17883,6 +18282,8 @@ dispose (GObject *object)
 	nm_clear_g_signal_handler (nm_config_get (), &priv->config_changed_id);
 
 	dispatcher_cleanup (self);
+	if (priv->dispatcher.up_call_id)
+		nm_dispatcher_call_cancel (g_steal_pointer (&priv->dispatcher.up_call_id));
 
 	nm_pacrunner_manager_remove_clear (&priv->pacrunner_conf_id);
 
@@ -17970,6 +18371,8 @@ finalize (GObject *object)
 	g_free (priv->hw_addr_initial);
 	g_slist_free (priv->pending_actions);
 	g_slist_free_full (priv->dad6_failed_addrs, (GDestroyNotify) nmp_object_unref);
+	_l3_commit_data_clear (&priv->l3_commit_x[0]);
+	_l3_commit_data_clear (&priv->l3_commit_x[1]);
 	nm_clear_g_free (&priv->physical_port_id);
 	g_free (priv->udi);
 	g_free (priv->path);
@@ -18087,6 +18490,7 @@ static const NMDBusInterfaceInfoExtended interface_info_device = {
 			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE       ("Ip6Connectivity",      "u",      NM_DEVICE_IP6_CONNECTIVITY),
 			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE       ("InterfaceFlags",       "u",      NM_DEVICE_INTERFACE_FLAGS),
 			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE       ("HwAddress",            "s",      NM_DEVICE_HW_ADDRESS),
+			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE       ("ActivationTimestamps", "a{st}",  NM_DEVICE_ACTIVATION_TIMESTAMPS),
 		),
 	),
 };
@@ -18377,6 +18781,13 @@ nm_device_class_init (NMDeviceClass *klass)
 	                       G_PARAM_READABLE |
 	                       G_PARAM_STATIC_STRINGS);
 
+	obj_properties[PROP_ACTIVATION_TIMESTAMPS] =
+	    g_param_spec_variant (NM_DEVICE_ACTIVATION_TIMESTAMPS, "", "",
+	                          G_VARIANT_TYPE ("a{st}"),
+	                          NULL,
+	                          G_PARAM_READABLE |
+	                          G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
 
 	signals[STATE_CHANGED] =
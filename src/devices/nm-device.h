@@ -134,6 +134,7 @@ nm_device_state_reason_check (NMDeviceStateReason reason)
 #define NM_DEVICE_IP4_CONNECTIVITY           "ip4-connectivity"
 #define NM_DEVICE_IP6_CONNECTIVITY           "ip6-connectivity"
 #define NM_DEVICE_INTERFACE_FLAGS            "interface-flags"
+#define NM_DEVICE_ACTIVATION_TIMESTAMPS      "activation-timestamps"
 
 #define NM_TYPE_DEVICE            (nm_device_get_type ())
 #define NM_DEVICE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), NM_TYPE_DEVICE, NMDevice))
@@ -548,6 +549,7 @@ gboolean        nm_device_ignore_carrier_by_default (NMDevice *self);
 
 gboolean        nm_device_is_available          (NMDevice *dev, NMDeviceCheckDevAvailableFlags flags);
 gboolean        nm_device_has_carrier           (NMDevice *dev);
+gboolean        nm_device_has_config            (NMDevice *dev);
 
 NMConnection * nm_device_generate_connection (NMDevice *self,
                                               NMDevice *master,
@@ -679,6 +681,7 @@ void nm_device_set_unmanaged_by_user_settings (NMDevice *self);
 void nm_device_set_unmanaged_by_user_udev (NMDevice *self);
 void nm_device_set_unmanaged_by_user_conf (NMDevice *self);
 void nm_device_set_unmanaged_by_quitting (NMDevice *device);
+void nm_device_dispatcher_pre_down_on_quit (NMDevice *self);
 
 gboolean nm_device_check_unrealized_device_managed (NMDevice *self);
 
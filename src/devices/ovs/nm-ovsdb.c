@@ -11,6 +11,7 @@
 #include <gio/gunixsocketaddress.h>
 
 #include "nm-glib-aux/nm-jansson.h"
+#include "nm-glib-aux/nm-ref-string.h"
 #include "nm-core-utils.h"
 #include "nm-core-internal.h"
 #include "devices/nm-device.h"
@@ -22,21 +23,21 @@
 #endif
 
 typedef struct {
-	char *name;
-	char *connection_uuid;
-	GPtrArray *interfaces;          /* interface uuids */
+	NMRefString *name;
+	NMRefString *connection_uuid;
+	GPtrArray *interfaces;          /* interface uuids (NMRefString) */
 } OpenvswitchPort;
 
 typedef struct {
-	char *name;
-	char *connection_uuid;
-	GPtrArray *ports;               /* port uuids */
+	NMRefString *name;
+	NMRefString *connection_uuid;
+	GPtrArray *ports;               /* port uuids (NMRefString) */
 } OpenvswitchBridge;
 
 typedef struct {
-	char *name;
-	char *type;
-	char *connection_uuid;
+	NMRefString *name;
+	NMRefString *type;
+	NMRefString *connection_uuid;
 } OpenvswitchInterface;
 
 /*****************************************************************************/
@@ -60,9 +61,9 @@ typedef struct {
 	GString *output;                /* JSON stream to be sent. */
 	gint64 seq;
 	GArray *calls;                  /* Method calls waiting for a response. */
-	GHashTable *interfaces;         /* interface uuid => OpenvswitchInterface */
-	GHashTable *ports;              /* port uuid => OpenvswitchPort */
-	GHashTable *bridges;            /* bridge uuid => OpenvswitchBridge */
+	GHashTable *interfaces;         /* interface uuid (NMRefString) => OpenvswitchInterface */
+	GHashTable *ports;              /* port uuid (NMRefString) => OpenvswitchPort */
+	GHashTable *bridges;            /* bridge uuid (NMRefString) => OpenvswitchBridge */
 	char *db_uuid;
 	guint num_failures;
 } NMOvsdbPrivate;
@@ -574,9 +575,9 @@ _add_interface (NMOvsdb *self, json_t *params,
 {
 	NMOvsdbPrivate *priv = NM_OVSDB_GET_PRIVATE (self);
 	GHashTableIter iter;
-	const char *bridge_uuid;
-	const char *port_uuid;
-	const char *interface_uuid;
+	NMRefString *bridge_uuid;
+	NMRefString *port_uuid;
+	NMRefString *interface_uuid;
 	const char *bridge_name;
 	const char *port_name;
 	const char *interface_name;
@@ -646,24 +647,24 @@ _add_interface (NMOvsdb *self, json_t *params,
 
 	g_hash_table_iter_init (&iter, priv->bridges);
 	while (g_hash_table_iter_next (&iter, (gpointer) &bridge_uuid, (gpointer) &ovs_bridge)) {
-		json_array_append_new (bridges, json_pack ("[s, s]", "uuid", bridge_uuid));
+		json_array_append_new (bridges, json_pack ("[s, s]", "uuid", bridge_uuid->str));
 
-		if (   g_strcmp0 (ovs_bridge->name, bridge_name) != 0
-		    || g_strcmp0 (ovs_bridge->connection_uuid, nm_connection_get_uuid (bridge)) != 0)
+		if (   !nm_ref_string_equals_str (ovs_bridge->name, bridge_name)
+		    || !nm_ref_string_equals_str (ovs_bridge->connection_uuid, nm_connection_get_uuid (bridge)))
 			continue;
 
 		for (pi = 0; pi < ovs_bridge->ports->len; pi++) {
 			port_uuid = g_ptr_array_index (ovs_bridge->ports, pi);
 			ovs_port = g_hash_table_lookup (priv->ports, port_uuid);
 
-			json_array_append_new (ports, json_pack ("[s, s]", "uuid", port_uuid));
+			json_array_append_new (ports, json_pack ("[s, s]", "uuid", port_uuid->str));
 
 			if (!ovs_port) {
 				/* This would be a violation of ovsdb's reference integrity (a bug). */
-				_LOGW ("Unknown port '%s' in bridge '%s'", port_uuid, bridge_uuid);
+				_LOGW ("Unknown port '%s' in bridge '%s'", port_uuid->str, bridge_uuid->str);
 				continue;
-			} else if (   strcmp (ovs_port->name, port_name) != 0
-			           || g_strcmp0 (ovs_port->connection_uuid, nm_connection_get_uuid (port)) != 0) {
+			} else if (   !nm_ref_string_equals_str (ovs_port->name, port_name)
+			           || !nm_ref_string_equals_str (ovs_port->connection_uuid, nm_connection_get_uuid (port))) {
 				continue;
 			}
 
@@ -671,13 +672,13 @@ _add_interface (NMOvsdb *self, json_t *params,
 				interface_uuid = g_ptr_array_index (ovs_port->interfaces, ii);
 				ovs_interface = g_hash_table_lookup (priv->interfaces, interface_uuid);
 
-				json_array_append_new (interfaces, json_pack ("[s, s]", "uuid", interface_uuid));
+				json_array_append_new (interfaces, json_pack ("[s, s]", "uuid", interface_uuid->str));
 
 				if (!ovs_interface) {
 					/* This would be a violation of ovsdb's reference integrity (a bug). */
-					_LOGW ("Unknown interface '%s' in port '%s'", interface_uuid, port_uuid);
-				} else if (   strcmp (ovs_interface->name, interface_name) == 0
-				           && g_strcmp0 (ovs_interface->connection_uuid, nm_connection_get_uuid (interface)) == 0) {
+					_LOGW ("Unknown interface '%s' in port '%s'", interface_uuid->str, port_uuid->str);
+				} else if (   nm_ref_string_equals_str (ovs_interface->name, interface_name)
+				           && nm_ref_string_equals_str (ovs_interface->connection_uuid, nm_connection_get_uuid (interface))) {
 					has_interface = TRUE;
 				}
 			}
@@ -703,7 +704,7 @@ _add_interface (NMOvsdb *self, json_t *params,
 		} else {
 			/* Bridge already exists. */
 			g_return_if_fail (ovs_bridge);
-			_expect_bridge_ports (params, ovs_bridge->name, ports);
+			_expect_bridge_ports (params, ovs_bridge->name->str, ports);
 			_set_bridge_ports (params, bridge_name, new_ports);
 			if (bridge_cloned_mac && interface_is_internal)
 				_set_bridge_mac (params, bridge_name, bridge_cloned_mac);
@@ -714,7 +715,7 @@ _add_interface (NMOvsdb *self, json_t *params,
 	} else {
 		/* Port already exists */
 		g_return_if_fail (ovs_port);
-		_expect_port_interfaces (params, ovs_port->name, interfaces);
+		_expect_port_interfaces (params, ovs_port->name->str, interfaces);
 		_set_port_interfaces (params, port_name, new_interfaces);
 	}
 
@@ -735,9 +736,9 @@ _delete_interface (NMOvsdb *self, json_t *params, const char *ifname)
 {
 	NMOvsdbPrivate *priv = NM_OVSDB_GET_PRIVATE (self);
 	GHashTableIter iter;
-	char *bridge_uuid;
-	char *port_uuid;
-	char *interface_uuid;
+	NMRefString *bridge_uuid;
+	NMRefString *port_uuid;
+	NMRefString *interface_uuid;
 	OpenvswitchBridge *ovs_bridge;
 	OpenvswitchPort *ovs_port;
 	OpenvswitchInterface *ovs_interface;
@@ -762,7 +763,7 @@ _delete_interface (NMOvsdb *self, json_t *params, const char *ifname)
 		new_ports = json_array ();
 		ports_changed = FALSE;
 
-		json_array_append_new (bridges, json_pack ("[s,s]", "uuid", bridge_uuid));
+		json_array_append_new (bridges, json_pack ("[s,s]", "uuid", bridge_uuid->str));
 
 		for (pi = 0; pi < ovs_bridge->ports->len; pi++) {
 			nm_auto_decref_json json_t *interfaces = NULL;
@@ -773,13 +774,13 @@ _delete_interface (NMOvsdb *self, json_t *params, const char *ifname)
 			port_uuid = g_ptr_array_index (ovs_bridge->ports, pi);
 			ovs_port = g_hash_table_lookup (priv->ports, port_uuid);
 
-			json_array_append_new (ports, json_pack ("[s,s]", "uuid", port_uuid));
+			json_array_append_new (ports, json_pack ("[s,s]", "uuid", port_uuid->str));
 
 			interfaces_changed = FALSE;
 
 			if (!ovs_port) {
 				/* This would be a violation of ovsdb's reference integrity (a bug). */
-				_LOGW ("Unknown port '%s' in bridge '%s'", port_uuid, bridge_uuid);
+				_LOGW ("Unknown port '%s' in bridge '%s'", port_uuid->str, bridge_uuid->str);
 				continue;
 			}
 
@@ -787,30 +788,30 @@ _delete_interface (NMOvsdb *self, json_t *params, const char *ifname)
 				interface_uuid = g_ptr_array_index (ovs_port->interfaces, ii);
 				ovs_interface = g_hash_table_lookup (priv->interfaces, interface_uuid);
 
-				json_array_append_new (interfaces, json_pack ("[s,s]", "uuid", interface_uuid));
+				json_array_append_new (interfaces, json_pack ("[s,s]", "uuid", interface_uuid->str));
 
 				if (ovs_interface) {
-					if (strcmp (ovs_interface->name, ifname) == 0) {
+					if (nm_ref_string_equals_str (ovs_interface->name, ifname)) {
 						/* skip the interface */
 						interfaces_changed = TRUE;
 						continue;
 					}
 				} else {
 					/* This would be a violation of ovsdb's reference integrity (a bug). */
-					_LOGW ("Unknown interface '%s' in port '%s'", interface_uuid, port_uuid);
+					_LOGW ("Unknown interface '%s' in port '%s'", interface_uuid->str, port_uuid->str);
 				}
 
-				json_array_append_new (new_interfaces, json_pack ("[s,s]", "uuid", interface_uuid));
+				json_array_append_new (new_interfaces, json_pack ("[s,s]", "uuid", interface_uuid->str));
 			}
 
 			if (json_array_size (new_interfaces) == 0) {
 				ports_changed = TRUE;
 			} else {
 				if (interfaces_changed) {
-					_expect_port_interfaces (params, ovs_port->name, interfaces);
-					_set_port_interfaces (params, ovs_port->name, new_interfaces);
+					_expect_port_interfaces (params, ovs_port->name->str, interfaces);
+					_set_port_interfaces (params, ovs_port->name->str, new_interfaces);
 				}
-				json_array_append_new (new_ports, json_pack ("[s,s]", "uuid", port_uuid));
+				json_array_append_new (new_ports, json_pack ("[s,s]", "uuid", port_uuid->str));
 			}
 		}
 
@@ -818,10 +819,10 @@ _delete_interface (NMOvsdb *self, json_t *params, const char *ifname)
 			bridges_changed = TRUE;
 		} else {
 			if (ports_changed) {
-				_expect_bridge_ports (params, ovs_bridge->name, ports);
-				_set_bridge_ports (params, ovs_bridge->name, new_ports);
+				_expect_bridge_ports (params, ovs_bridge->name->str, ports);
+				_set_bridge_ports (params, ovs_bridge->name->str, new_ports);
 			}
-			json_array_append_new (new_bridges, json_pack ("[s,s]", "uuid", bridge_uuid));
+			json_array_append_new (new_bridges, json_pack ("[s,s]", "uuid", bridge_uuid->str));
 		}
 	}
 
@@ -937,6 +938,10 @@ ovsdb_next_command (NMOvsdb *self)
  *
  *   [ "set", [ [ "uuid", "aa095ffb-e1f1-0fc4-8038-82c1ea7e4797" ],
  *              [ "uuid", "185c93f6-0b39-424e-8587-77d074aa7ce0" ], ... ] ]
+ *
+ * The UUIDs are interned as #NMRefString, so that the same UUID that is
+ * referenced from a parent row and used as key of the row itself shares
+ * the allocation.
  */
 static void
 _uuids_to_array (GPtrArray *array, const json_t *items)
@@ -957,7 +962,7 @@ _uuids_to_array (GPtrArray *array, const json_t *items)
 			return;
 
 		if (g_strcmp0 (key, "uuid") == 0 && json_is_string (value)) {
-			g_ptr_array_add (array, g_strdup (json_string_value (value)));
+			g_ptr_array_add (array, nm_ref_string_new (json_string_value (value)));
 		} else if (g_strcmp0 (key, "set") == 0 && json_is_array (value)) {
 			json_array_foreach (value, set_index, set_value) {
 				_uuids_to_array (array, set_value);
@@ -966,7 +971,40 @@ _uuids_to_array (GPtrArray *array, const json_t *items)
 	}
 }
 
-static char *
+/**
+ * _uuids_update:
+ * @p_array: (inout): the array of #NMRefString UUIDs to update.
+ * @items: the UUID atom or set, as accepted by _uuids_to_array().
+ *
+ * Since the UUIDs are interned, the new list can be compared to the existing
+ * one by pointer. The array is only replaced if the content differs.
+ *
+ * Returns: %TRUE if the array changed.
+ */
+static gboolean
+_uuids_update (GPtrArray **p_array, const json_t *items)
+{
+	gs_unref_ptrarray GPtrArray *array = NULL;
+	guint i;
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) _nm_ref_string_unref_non_null);
+	_uuids_to_array (array, items);
+
+	if (   *p_array
+	    && (*p_array)->len == array->len) {
+		for (i = 0; i < array->len; i++) {
+			if (array->pdata[i] != (*p_array)->pdata[i])
+				break;
+		}
+		if (i == array->len)
+			return FALSE;
+	}
+
+	NM_SWAP (*p_array, array);
+	return TRUE;
+}
+
+static NMRefString *
 _connection_uuid_from_external_ids (json_t *external_ids)
 {
 	json_t *value;
@@ -977,18 +1015,35 @@ _connection_uuid_from_external_ids (json_t *external_ids)
 
 	json_array_foreach (json_array_get (external_ids, 1), index, value) {
 		if (g_strcmp0 ("NM.connection.uuid", json_string_value (json_array_get (value, 0))) == 0)
-			return g_strdup (json_string_value (json_array_get (value, 1)));
+			return nm_ref_string_new (json_string_value (json_array_get (value, 1)));
 	}
 
 	return NULL;
 }
 
+static gboolean
+_ref_string_update (NMRefString **p_rstr, NMRefString *rstr)
+{
+	if (*p_rstr == rstr)
+		return FALSE;
+
+	nm_ref_string_unref (*p_rstr);
+	*p_rstr = nm_ref_string_ref (rstr);
+	return TRUE;
+}
+
 /**
  * ovsdb_got_update:
  *
  * Called when we've got an "update" method call (we asked for it with the monitor
  * command). We use it to maintain a consistent view of bridge list regardless of
  * whether the changes are done by us or externally.
+ *
+ * The update only contains the rows that were modified, but it still carries
+ * all the monitored columns of such rows. Also, after a reconnect the initial
+ * reply of the monitor call contains all the rows again. Existing entries are
+ * thus updated in place, and rows whose content did not change are skipped
+ * without logging or emitting signals.
  */
 static void
 ovsdb_got_update (NMOvsdb *self, json_t *msg)
@@ -1022,14 +1077,17 @@ ovsdb_got_update (NMOvsdb *self, json_t *msg)
 
 	if (ovs) {
 		iter = json_object_iter (ovs);
+		g_free (priv->db_uuid);
 		priv->db_uuid = iter ? g_strdup (json_object_iter_key (iter)) : NULL;
 	}
 
 	/* Interfaces */
 	json_object_foreach (interface, key, value) {
+		nm_auto_ref_string NMRefString *connection_uuid = NULL;
 		json_t *error = NULL;
 		gboolean old = FALSE;
 		gboolean new = FALSE;
+		gboolean changed;
 
 		if (json_unpack (value, "{s:{}}", "old") == 0)
 			old = TRUE;
@@ -1041,63 +1099,75 @@ ovsdb_got_update (NMOvsdb *self, json_t *msg)
 		                 "external_ids", &external_ids) == 0)
 			new = TRUE;
 
-		if (old) {
-			ovs_interface = g_hash_table_lookup (priv->interfaces, key);
-			if (!ovs_interface) {
+		ovs_interface = g_hash_table_lookup (priv->interfaces, &key);
+		if (!ovs_interface) {
+			if (old)
 				_LOGW ("Interface '%s' was not seen", key);
-			} else if (!new || strcmp (ovs_interface->name, name) != 0) {
-				old = FALSE;
-				_LOGT ("removed an '%s' interface: %s%s%s",
-				       ovs_interface->type, ovs_interface->name,
-				       ovs_interface->connection_uuid ? ", " : "",
-				       ovs_interface->connection_uuid ?: "");
-				if (g_strcmp0 (ovs_interface->type, "internal") == 0) {
-					/* Currently, the factory only creates NMDevices for
-					 * internal interfaces. Ignore the rest. */
-					g_signal_emit (self, signals[DEVICE_REMOVED], 0,
-					               ovs_interface->name, NM_DEVICE_TYPE_OVS_INTERFACE);
-				}
+		} else if (!new || !nm_ref_string_equals_str (ovs_interface->name, name)) {
+			_LOGT ("removed an '%s' interface: %s%s%s",
+			       ovs_interface->type->str, ovs_interface->name->str,
+			       ovs_interface->connection_uuid ? ", " : "",
+			       ovs_interface->connection_uuid ? ovs_interface->connection_uuid->str : "");
+			if (nm_ref_string_equals_str (ovs_interface->type, "internal")) {
+				/* Currently, the factory only creates NMDevices for
+				 * internal interfaces. Ignore the rest. */
+				g_signal_emit (self, signals[DEVICE_REMOVED], 0,
+				               ovs_interface->name->str, NM_DEVICE_TYPE_OVS_INTERFACE);
 			}
-			g_hash_table_remove (priv->interfaces, key);
+			g_hash_table_remove (priv->interfaces, &key);
+			ovs_interface = NULL;
 		}
 
-		if (new) {
-			ovs_interface = g_slice_new (OpenvswitchInterface);
-			ovs_interface->name = g_strdup (name);
-			ovs_interface->type = g_strdup (type);
-			ovs_interface->connection_uuid = _connection_uuid_from_external_ids (external_ids);
-			g_hash_table_insert (priv->interfaces, g_strdup (key), ovs_interface);
-			if (old) {
-				_LOGT ("changed an '%s' interface: %s%s%s", type, ovs_interface->name,
-				       ovs_interface->connection_uuid ? ", " : "",
-				       ovs_interface->connection_uuid ?: "");
-			} else {
-				_LOGT ("added an '%s' interface: %s%s%s",
-				       ovs_interface->type, ovs_interface->name,
+		if (!new)
+			continue;
+
+		connection_uuid = _connection_uuid_from_external_ids (external_ids);
+
+		if (ovs_interface) {
+			nm_auto_ref_string NMRefString *type_rstr = NULL;
+
+			type_rstr = nm_ref_string_new (type);
+			changed = _ref_string_update (&ovs_interface->type, type_rstr);
+			changed |= _ref_string_update (&ovs_interface->connection_uuid, connection_uuid);
+			if (changed) {
+				_LOGT ("changed an '%s' interface: %s%s%s", type, ovs_interface->name->str,
 				       ovs_interface->connection_uuid ? ", " : "",
-				       ovs_interface->connection_uuid ?: "");
-				if (g_strcmp0 (ovs_interface->type, "internal") == 0) {
-					/* Currently, the factory only creates NMDevices for
-					 * internal interfaces. Ignore the rest. */
-					g_signal_emit (self, signals[DEVICE_ADDED], 0,
-					               ovs_interface->name, NM_DEVICE_TYPE_OVS_INTERFACE);
-				}
+				       ovs_interface->connection_uuid ? ovs_interface->connection_uuid->str : "");
 			}
-			/* The error is a string. No error is indicated by an empty set,
-			 * because why the fuck not: [ "set": [] ] */
-			if (error && json_is_string (error)) {
-				g_signal_emit (self, signals[INTERFACE_FAILED], 0,
-				               ovs_interface->name,
-				               ovs_interface->connection_uuid,
-				               json_string_value (error));
+		} else {
+			ovs_interface = g_slice_new (OpenvswitchInterface);
+			ovs_interface->name = nm_ref_string_new (name);
+			ovs_interface->type = nm_ref_string_new (type);
+			ovs_interface->connection_uuid = g_steal_pointer (&connection_uuid);
+			g_hash_table_insert (priv->interfaces, nm_ref_string_new (key), ovs_interface);
+			_LOGT ("added an '%s' interface: %s%s%s",
+			       ovs_interface->type->str, ovs_interface->name->str,
+			       ovs_interface->connection_uuid ? ", " : "",
+			       ovs_interface->connection_uuid ? ovs_interface->connection_uuid->str : "");
+			if (nm_ref_string_equals_str (ovs_interface->type, "internal")) {
+				/* Currently, the factory only creates NMDevices for
+				 * internal interfaces. Ignore the rest. */
+				g_signal_emit (self, signals[DEVICE_ADDED], 0,
+				               ovs_interface->name->str, NM_DEVICE_TYPE_OVS_INTERFACE);
 			}
 		}
+
+		/* The error is a string. No error is indicated by an empty set,
+		 * because why the fuck not: [ "set": [] ] */
+		if (error && json_is_string (error)) {
+			g_signal_emit (self, signals[INTERFACE_FAILED], 0,
+			               ovs_interface->name->str,
+			               nm_ref_string_get_str (ovs_interface->connection_uuid),
+			               json_string_value (error));
+		}
 	}
 
 	/* Ports */
 	json_object_foreach (port, key, value) {
+		nm_auto_ref_string NMRefString *connection_uuid = NULL;
 		gboolean old = FALSE;
 		gboolean new = FALSE;
+		gboolean changed;
 
 		if (json_unpack (value, "{s:{}}", "old") == 0)
 			old = TRUE;
@@ -1108,44 +1178,54 @@ ovsdb_got_update (NMOvsdb *self, json_t *msg)
 		                 "interfaces", &items) == 0)
 			new = TRUE;
 
-		if (old) {
-			ovs_port = g_hash_table_lookup (priv->ports, key);
-			if (!new || g_strcmp0 (ovs_port->name, name) != 0) {
-				old = FALSE;
-				_LOGT ("removed a port: %s%s%s", ovs_port->name,
-				       ovs_port->connection_uuid ? ", " : "",
-				       ovs_port->connection_uuid ?: "");
-				g_signal_emit (self, signals[DEVICE_REMOVED], 0,
-				               ovs_port->name, NM_DEVICE_TYPE_OVS_PORT);
-			}
-			g_hash_table_remove (priv->ports, key);
+		ovs_port = g_hash_table_lookup (priv->ports, &key);
+		if (!ovs_port) {
+			if (old)
+				_LOGW ("Port '%s' was not seen", key);
+		} else if (!new || !nm_ref_string_equals_str (ovs_port->name, name)) {
+			_LOGT ("removed a port: %s%s%s", ovs_port->name->str,
+			       ovs_port->connection_uuid ? ", " : "",
+			       ovs_port->connection_uuid ? ovs_port->connection_uuid->str : "");
+			g_signal_emit (self, signals[DEVICE_REMOVED], 0,
+			               ovs_port->name->str, NM_DEVICE_TYPE_OVS_PORT);
+			g_hash_table_remove (priv->ports, &key);
+			ovs_port = NULL;
 		}
 
-		if (new) {
-			ovs_port = g_slice_new (OpenvswitchPort);
-			ovs_port->name = g_strdup (name);
-			ovs_port->connection_uuid = _connection_uuid_from_external_ids (external_ids);
-			ovs_port->interfaces = g_ptr_array_new_with_free_func (g_free);
-			_uuids_to_array (ovs_port->interfaces, items);
-			g_hash_table_insert (priv->ports, g_strdup (key), ovs_port);
-			if (old) {
-				_LOGT ("changed a port: %s%s%s", ovs_port->name,
-				       ovs_port->connection_uuid ? ", " : "",
-				       ovs_port->connection_uuid ?: "");
-			} else {
-				_LOGT ("added a port: %s%s%s", ovs_port->name,
+		if (!new)
+			continue;
+
+		connection_uuid = _connection_uuid_from_external_ids (external_ids);
+
+		if (ovs_port) {
+			changed = _ref_string_update (&ovs_port->connection_uuid, connection_uuid);
+			changed |= _uuids_update (&ovs_port->interfaces, items);
+			if (changed) {
+				_LOGT ("changed a port: %s%s%s", ovs_port->name->str,
 				       ovs_port->connection_uuid ? ", " : "",
-				       ovs_port->connection_uuid ?: "");
-				g_signal_emit (self, signals[DEVICE_ADDED], 0,
-				               ovs_port->name, NM_DEVICE_TYPE_OVS_PORT);
+				       ovs_port->connection_uuid ? ovs_port->connection_uuid->str : "");
 			}
+		} else {
+			ovs_port = g_slice_new (OpenvswitchPort);
+			ovs_port->name = nm_ref_string_new (name);
+			ovs_port->connection_uuid = g_steal_pointer (&connection_uuid);
+			ovs_port->interfaces = NULL;
+			_uuids_update (&ovs_port->interfaces, items);
+			g_hash_table_insert (priv->ports, nm_ref_string_new (key), ovs_port);
+			_LOGT ("added a port: %s%s%s", ovs_port->name->str,
+			       ovs_port->connection_uuid ? ", " : "",
+			       ovs_port->connection_uuid ? ovs_port->connection_uuid->str : "");
+			g_signal_emit (self, signals[DEVICE_ADDED], 0,
+			               ovs_port->name->str, NM_DEVICE_TYPE_OVS_PORT);
 		}
 	}
 
 	/* Bridges */
 	json_object_foreach (bridge, key, value) {
+		nm_auto_ref_string NMRefString *connection_uuid = NULL;
 		gboolean old = FALSE;
 		gboolean new = FALSE;
+		gboolean changed;
 
 		if (json_unpack (value, "{s:{}}", "old") == 0)
 			old = TRUE;
@@ -1156,40 +1236,47 @@ ovsdb_got_update (NMOvsdb *self, json_t *msg)
 		                 "ports", &items) == 0)
 			new = TRUE;
 
-		if (old) {
-			ovs_bridge = g_hash_table_lookup (priv->bridges, key);
-			if (!new || g_strcmp0 (ovs_bridge->name, name) != 0) {
-				old = FALSE;
-				_LOGT ("removed a bridge: %s%s%s", ovs_bridge->name,
-				       ovs_bridge->connection_uuid ? ", " : "",
-				       ovs_bridge->connection_uuid ?: "");
-				g_signal_emit (self, signals[DEVICE_REMOVED], 0,
-				               ovs_bridge->name, NM_DEVICE_TYPE_OVS_BRIDGE);
-			}
-			g_hash_table_remove (priv->bridges, key);
+		ovs_bridge = g_hash_table_lookup (priv->bridges, &key);
+		if (!ovs_bridge) {
+			if (old)
+				_LOGW ("Bridge '%s' was not seen", key);
+		} else if (!new || !nm_ref_string_equals_str (ovs_bridge->name, name)) {
+			_LOGT ("removed a bridge: %s%s%s", ovs_bridge->name->str,
+			       ovs_bridge->connection_uuid ? ", " : "",
+			       ovs_bridge->connection_uuid ? ovs_bridge->connection_uuid->str : "");
+			g_signal_emit (self, signals[DEVICE_REMOVED], 0,
+			               ovs_bridge->name->str, NM_DEVICE_TYPE_OVS_BRIDGE);
+			g_hash_table_remove (priv->bridges, &key);
+			ovs_bridge = NULL;
 		}
 
-		if (new) {
-			ovs_bridge = g_slice_new (OpenvswitchBridge);
-			ovs_bridge->name = g_strdup (name);
-			ovs_bridge->connection_uuid = _connection_uuid_from_external_ids (external_ids);
-			ovs_bridge->ports = g_ptr_array_new_with_free_func (g_free);
-			_uuids_to_array (ovs_bridge->ports, items);
-			g_hash_table_insert (priv->bridges, g_strdup (key), ovs_bridge);
-			if (old) {
-				_LOGT ("changed a bridge: %s%s%s", ovs_bridge->name,
-				       ovs_bridge->connection_uuid ? ", " : "",
-				       ovs_bridge->connection_uuid ?: "");
-			} else {
-				_LOGT ("added a bridge: %s%s%s", ovs_bridge->name,
+		if (!new)
+			continue;
+
+		connection_uuid = _connection_uuid_from_external_ids (external_ids);
+
+		if (ovs_bridge) {
+			changed = _ref_string_update (&ovs_bridge->connection_uuid, connection_uuid);
+			changed |= _uuids_update (&ovs_bridge->ports, items);
+			if (changed) {
+				_LOGT ("changed a bridge: %s%s%s", ovs_bridge->name->str,
 				       ovs_bridge->connection_uuid ? ", " : "",
-				       ovs_bridge->connection_uuid ?: "");
-				g_signal_emit (self, signals[DEVICE_ADDED], 0,
-				               ovs_bridge->name, NM_DEVICE_TYPE_OVS_BRIDGE);
+				       ovs_bridge->connection_uuid ? ovs_bridge->connection_uuid->str : "");
 			}
+		} else {
+			ovs_bridge = g_slice_new (OpenvswitchBridge);
+			ovs_bridge->name = nm_ref_string_new (name);
+			ovs_bridge->connection_uuid = g_steal_pointer (&connection_uuid);
+			ovs_bridge->ports = NULL;
+			_uuids_update (&ovs_bridge->ports, items);
+			g_hash_table_insert (priv->bridges, nm_ref_string_new (key), ovs_bridge);
+			_LOGT ("added a bridge: %s%s%s", ovs_bridge->name->str,
+			       ovs_bridge->connection_uuid ? ", " : "",
+			       ovs_bridge->connection_uuid ? ovs_bridge->connection_uuid->str : "");
+			g_signal_emit (self, signals[DEVICE_ADDED], 0,
+			               ovs_bridge->name->str, NM_DEVICE_TYPE_OVS_BRIDGE);
 		}
 	}
-
 }
 
 /**
@@ -1686,9 +1773,9 @@ _free_bridge (gpointer data)
 {
 	OpenvswitchBridge *ovs_bridge = data;
 
-	g_free (ovs_bridge->name);
-	g_free (ovs_bridge->connection_uuid);
-	g_ptr_array_free (ovs_bridge->ports, TRUE);
+	nm_ref_string_unref (ovs_bridge->name);
+	nm_ref_string_unref (ovs_bridge->connection_uuid);
+	g_ptr_array_unref (ovs_bridge->ports);
 	g_slice_free (OpenvswitchBridge, ovs_bridge);
 }
 
@@ -1697,9 +1784,9 @@ _free_port (gpointer data)
 {
 	OpenvswitchPort *ovs_port = data;
 
-	g_free (ovs_port->name);
-	g_free (ovs_port->connection_uuid);
-	g_ptr_array_free (ovs_port->interfaces, TRUE);
+	nm_ref_string_unref (ovs_port->name);
+	nm_ref_string_unref (ovs_port->connection_uuid);
+	g_ptr_array_unref (ovs_port->interfaces);
 	g_slice_free (OpenvswitchPort, ovs_port);
 }
 
@@ -1708,9 +1795,9 @@ _free_interface (gpointer data)
 {
 	OpenvswitchInterface *ovs_interface = data;
 
-	g_free (ovs_interface->name);
-	g_free (ovs_interface->connection_uuid);
-	g_free (ovs_interface->type);
+	nm_ref_string_unref (ovs_interface->name);
+	nm_ref_string_unref (ovs_interface->connection_uuid);
+	nm_ref_string_unref (ovs_interface->type);
 	g_slice_free (OpenvswitchInterface, ovs_interface);
 }
 
@@ -1723,9 +1810,9 @@ nm_ovsdb_init (NMOvsdb *self)
 	g_array_set_clear_func (priv->calls, _clear_call);
 	priv->input = g_string_new (NULL);
 	priv->output = g_string_new (NULL);
-	priv->bridges = g_hash_table_new_full (nm_str_hash, g_str_equal, g_free, _free_bridge);
-	priv->ports = g_hash_table_new_full (nm_str_hash, g_str_equal, g_free, _free_port);
-	priv->interfaces = g_hash_table_new_full (nm_str_hash, g_str_equal, g_free, _free_interface);
+	priv->bridges = g_hash_table_new_full (nm_pstr_hash, nm_pstr_equal, (GDestroyNotify) _nm_ref_string_unref_non_null, _free_bridge);
+	priv->ports = g_hash_table_new_full (nm_pstr_hash, nm_pstr_equal, (GDestroyNotify) _nm_ref_string_unref_non_null, _free_port);
+	priv->interfaces = g_hash_table_new_full (nm_pstr_hash, nm_pstr_equal, (GDestroyNotify) _nm_ref_string_unref_non_null, _free_interface);
 
 	ovsdb_try_connect (self);
 }
@@ -0,0 +1,608 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#include "nm-default.h"
+
+#include "nm-dhcp-lease-store.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nm-glib-aux/nm-io-utils.h"
+#include "nm-std-aux/unaligned.h"
+#include "nm-config.h"
+
+/* The leases of the internal DHCP client are kept in a single file
+ * instead of one file per interface. Updates are appended as small binary
+ * records and synced to disk in batches, so that many interfaces renewing
+ * their lease cost one fsync() instead of one per interface.
+ *
+ * The file starts with a header (magic and version), followed by records:
+ *
+ *   u8     op (SET or REMOVE)
+ *   u8     reserved
+ *   be16   length of the key
+ *   u32    IPv4 address (network byte order)
+ *   key    "$UUID/$IFACE", not NUL terminated
+ *
+ * A later record for the same key replaces the earlier one. When the file
+ * contains too many stale records, it gets rewritten. */
+
+#define LEASE_STORE_FILENAME        "internal-leases.db"
+
+#define LEASE_STORE_MAGIC           "NMDL"
+#define LEASE_STORE_VERSION         1
+#define LEASE_STORE_HEADER_LEN      8
+#define LEASE_STORE_RECORD_LEN      8
+
+#define LEASE_STORE_OP_SET          1
+#define LEASE_STORE_OP_REMOVE       2
+
+#define LEASE_STORE_FILE_MAX        (64u * 1024u * 1024u)
+
+/* how long to collect updates before writing them to disk. */
+#define FLUSH_DELAY_MSEC            1000
+
+/*****************************************************************************/
+
+NM_GOBJECT_PROPERTIES_DEFINE_BASE (
+	PROP_PATH,
+	PROP_MIGRATE_PATH,
+);
+
+typedef struct {
+	char *path;
+
+	/* a lease file that gets merged into @path and removed. */
+	char *migrate_path;
+
+	/* "$UUID/$IFACE" to the address (as GUINT_TO_POINTER()). */
+	GHashTable *leases;
+
+	/* records that are not yet written to disk. */
+	GByteArray *pending;
+
+	GSource *flush_source;
+
+	/* the number of records in the file, including the pending ones. */
+	guint n_records;
+
+	/* the file is invalid or its tail might be broken. Don't append, but
+	 * write it anew. */
+	bool need_rewrite:1;
+} NMDhcpLeaseStorePrivate;
+
+struct _NMDhcpLeaseStore {
+	GObject parent;
+	NMDhcpLeaseStorePrivate _priv;
+};
+
+struct _NMDhcpLeaseStoreClass {
+	GObjectClass parent;
+};
+
+G_DEFINE_TYPE (NMDhcpLeaseStore, nm_dhcp_lease_store, G_TYPE_OBJECT)
+
+#define NM_DHCP_LEASE_STORE_GET_PRIVATE(self) _NM_GET_PRIVATE(self, NMDhcpLeaseStore, NM_IS_DHCP_LEASE_STORE)
+
+/*****************************************************************************/
+
+static const char *
+_default_path (void)
+{
+	if (nm_config_get_configure_and_quit (nm_config_get ()) == NM_CONFIG_CONFIGURE_AND_QUIT_INITRD)
+		return NMRUNDIR "/" LEASE_STORE_FILENAME;
+	return NMSTATEDIR "/" LEASE_STORE_FILENAME;
+}
+
+static const char *
+_default_migrate_path (void)
+{
+	/* the leases that NetworkManager got in the initrd. Like
+	 * nm_dhcp_utils_get_leasefile_path(), prefer them. */
+	if (nm_config_get_configure_and_quit (nm_config_get ()) == NM_CONFIG_CONFIGURE_AND_QUIT_INITRD)
+		return NULL;
+	return NMRUNDIR "/" LEASE_STORE_FILENAME;
+}
+
+NM_DEFINE_SINGLETON_GETTER (NMDhcpLeaseStore, nm_dhcp_lease_store_get, NM_TYPE_DHCP_LEASE_STORE,
+                            NM_DHCP_LEASE_STORE_PATH, _default_path (),
+                            NM_DHCP_LEASE_STORE_MIGRATE_PATH, _default_migrate_path ());
+
+/*****************************************************************************/
+
+#define _NMLOG_PREFIX_NAME    "dhcp-lease-store"
+#define _NMLOG_DOMAIN         LOGD_DHCP4
+#define _NMLOG(level, ...) \
+    G_STMT_START { \
+        const NMDhcpLeaseStore *_self = (self); \
+        char _prefix[64]; \
+        \
+        nm_log ((level), (_NMLOG_DOMAIN), NULL, NULL, \
+                "%s: " _NM_UTILS_MACRO_FIRST(__VA_ARGS__), \
+                (_self != singleton_instance \
+                    ? nm_sprintf_buf (_prefix, "%s[%p]", _NMLOG_PREFIX_NAME, _self) \
+                    : _NMLOG_PREFIX_NAME )\
+                _NM_UTILS_MACRO_REST(__VA_ARGS__)); \
+    } G_STMT_END
+
+/*****************************************************************************/
+
+static void
+_record_append (GByteArray *buf, guint8 op, const char *key, in_addr_t address)
+{
+	gsize key_len = strlen (key);
+	guint8 header[LEASE_STORE_RECORD_LEN] = {
+		[0] = op,
+	};
+
+	nm_assert (key_len <= G_MAXUINT16);
+
+	unaligned_write_be16 (&header[2], key_len);
+	memcpy (&header[4], &address, sizeof (address));
+	g_byte_array_append (buf, header, sizeof (header));
+	g_byte_array_append (buf, (const guint8 *) key, key_len);
+}
+
+static void
+_header_init (guint8 header[static LEASE_STORE_HEADER_LEN])
+{
+	memcpy (header, LEASE_STORE_MAGIC, 4);
+	unaligned_write_be32 (&header[4], LEASE_STORE_VERSION);
+}
+
+/* Reads the records of @path into the leases. Returns %FALSE if the file
+ * doesn't exist or is invalid. @out_complete is set to %FALSE if the last
+ * record is truncated. */
+static gboolean
+_load_file (NMDhcpLeaseStore *self,
+            const char *path,
+            guint *out_n_records,
+            gboolean *out_complete)
+{
+	NMDhcpLeaseStorePrivate *priv = NM_DHCP_LEASE_STORE_GET_PRIVATE (self);
+	gs_free_error GError *error = NULL;
+	gs_free char *contents = NULL;
+	guint n_records = 0;
+	gsize len;
+	gsize offset;
+	int errsv;
+
+	if (!nm_utils_file_get_contents (-1,
+	                                 path,
+	                                 LEASE_STORE_FILE_MAX,
+	                                 NM_UTILS_FILE_GET_CONTENTS_FLAG_NONE,
+	                                 &contents,
+	                                 &len,
+	                                 &errsv,
+	                                 &error)) {
+		if (errsv != ENOENT)
+			_LOGW ("failed to read %s: %s", path, error->message);
+		return FALSE;
+	}
+
+	if (   len < LEASE_STORE_HEADER_LEN
+	    || memcmp (contents, LEASE_STORE_MAGIC, 4) != 0
+	    || unaligned_read_be32 (&contents[4]) != LEASE_STORE_VERSION) {
+		_LOGW ("ignore invalid lease file %s", path);
+		return FALSE;
+	}
+
+	for (offset = LEASE_STORE_HEADER_LEN; offset < len; ) {
+		const guint8 *record = (const guint8 *) &contents[offset];
+		gsize key_len;
+		in_addr_t address;
+		char *key;
+
+		if (offset + LEASE_STORE_RECORD_LEN > len)
+			break;
+		key_len = unaligned_read_be16 (&record[2]);
+		if (offset + LEASE_STORE_RECORD_LEN + key_len > len)
+			break;
+		offset += LEASE_STORE_RECORD_LEN + key_len;
+
+		n_records++;
+
+		key = g_strndup ((const char *) &record[LEASE_STORE_RECORD_LEN], key_len);
+		memcpy (&address, &record[4], sizeof (address));
+		if (   record[0] == LEASE_STORE_OP_SET
+		    && address != INADDR_ANY)
+			g_hash_table_insert (priv->leases, key, GUINT_TO_POINTER (address));
+		else {
+			g_hash_table_remove (priv->leases, key);
+			g_free (key);
+		}
+	}
+
+	if (offset != len) {
+		/* the last write was interrupted. */
+		_LOGD ("lease file %s has a truncated record", path);
+	}
+
+	_LOGD ("loaded %u records from %s", n_records, path);
+
+	*out_n_records = n_records;
+	*out_complete = (offset == len);
+	return TRUE;
+}
+
+static gboolean _rewrite (NMDhcpLeaseStore *self, GError **error);
+
+static void
+_load (NMDhcpLeaseStore *self)
+{
+	NMDhcpLeaseStorePrivate *priv = NM_DHCP_LEASE_STORE_GET_PRIVATE (self);
+	gs_free_error GError *error = NULL;
+	gboolean complete;
+	guint n_records;
+
+	if (!_load_file (self, priv->path, &priv->n_records, &complete))
+		priv->need_rewrite = TRUE;
+	else if (!complete)
+		priv->need_rewrite = TRUE;
+
+	/* In initrd mode, the leases are only stored in NMRUNDIR. Take them
+	 * over. They are newer than ours, so they win. Afterwards, write the
+	 * merged leases and drop the file, so that it doesn't replace newer
+	 * leases on the next start. */
+	if (   priv->migrate_path
+	    && _load_file (self, priv->migrate_path, &n_records, &complete)) {
+		if (!_rewrite (self, &error)) {
+			_LOGW ("failed to write %s: %s", priv->path, error->message);
+			priv->n_records += n_records;
+			priv->need_rewrite = TRUE;
+		} else {
+			_LOGD ("took over the leases from %s", priv->migrate_path);
+			priv->n_records = g_hash_table_size (priv->leases);
+			priv->need_rewrite = FALSE;
+			if (unlink (priv->migrate_path) != 0) {
+				int errsv = errno;
+
+				_LOGW ("failed to remove %s: %s", priv->migrate_path, nm_strerror_native (errsv));
+			}
+		}
+	}
+
+	_LOGD ("loaded %u leases from %u records in %s",
+	       g_hash_table_size (priv->leases),
+	       priv->n_records,
+	       priv->path);
+}
+
+static gboolean
+_write_all (int fd, const guint8 *buf, gsize len, int *out_errsv)
+{
+	while (len > 0) {
+		gssize n;
+
+		n = write (fd, buf, len);
+		if (n < 0) {
+			int errsv = errno;
+
+			if (errsv == EINTR)
+				continue;
+			*out_errsv = errsv;
+			return FALSE;
+		}
+		buf += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+static gboolean
+_append (NMDhcpLeaseStore *self, GError **error)
+{
+	NMDhcpLeaseStorePrivate *priv = NM_DHCP_LEASE_STORE_GET_PRIVATE (self);
+	nm_auto_close int fd = -1;
+	struct stat st;
+	int errsv;
+
+	fd = open (priv->path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		errsv = errno;
+		nm_utils_error_set_errno (error, errsv, "failed to open: %s");
+		return FALSE;
+	}
+
+	if (fstat (fd, &st) != 0) {
+		errsv = errno;
+		nm_utils_error_set_errno (error, errsv, "failed to stat: %s");
+		return FALSE;
+	}
+
+	if (st.st_size == 0) {
+		guint8 header[LEASE_STORE_HEADER_LEN];
+
+		_header_init (header);
+		if (!_write_all (fd, header, sizeof (header), &errsv)) {
+			nm_utils_error_set_errno (error, errsv, "failed to write: %s");
+			return FALSE;
+		}
+	}
+
+	if (!_write_all (fd, priv->pending->data, priv->pending->len, &errsv)) {
+		nm_utils_error_set_errno (error, errsv, "failed to write: %s");
+		return FALSE;
+	}
+
+	if (fsync (fd) != 0) {
+		errsv = errno;
+		nm_utils_error_set_errno (error, errsv, "failed to fsync: %s");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+_rewrite (NMDhcpLeaseStore *self, GError **error)
+{
+	NMDhcpLeaseStorePrivate *priv = NM_DHCP_LEASE_STORE_GET_PRIVATE (self);
+	nm_auto_unref_bytearray GByteArray *buf = NULL;
+	guint8 header[LEASE_STORE_HEADER_LEN];
+	GHashTableIter iter;
+	const char *key;
+	gpointer address;
+
+	buf = g_byte_array_sized_new (LEASE_STORE_HEADER_LEN + g_hash_table_size (priv->leases) * 64);
+	_header_init (header);
+	g_byte_array_append (buf, header, sizeof (header));
+
+	g_hash_table_iter_init (&iter, priv->leases);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &key, &address))
+		_record_append (buf, LEASE_STORE_OP_SET, key, GPOINTER_TO_UINT (address));
+
+	return nm_utils_file_set_contents (priv->path,
+	                                   (const char *) buf->data,
+	                                   buf->len,
+	                                   0600,
+	                                   NULL,
+	                                   error);
+}
+
+/**
+ * nm_dhcp_lease_store_flush:
+ * @self: the #NMDhcpLeaseStore
+ *
+ * Writes pending changes to disk right away.
+ */
+void
+nm_dhcp_lease_store_flush (NMDhcpLeaseStore *self)
+{
+	NMDhcpLeaseStorePrivate *priv;
+	gs_free_error GError *error = NULL;
+	guint n_leases;
+
+	g_return_if_fail (NM_IS_DHCP_LEASE_STORE (self));
+
+	priv = NM_DHCP_LEASE_STORE_GET_PRIVATE (self);
+
+	nm_clear_g_source_inst (&priv->flush_source);
+
+	if (priv->pending->len == 0)
+		return;
+
+	n_leases = g_hash_table_size (priv->leases);
+
+	if (   priv->need_rewrite
+	    || priv->n_records > 2 * n_leases + 64) {
+		if (!_rewrite (self, &error)) {
+			_LOGW ("failed to write %s: %s", priv->path, error->message);
+			priv->need_rewrite = TRUE;
+		} else {
+			_LOGT ("rewrote %s with %u leases", priv->path, n_leases);
+			priv->n_records = n_leases;
+			priv->need_rewrite = FALSE;
+		}
+	} else {
+		if (!_append (self, &error)) {
+			_LOGW ("failed to append to %s: %s", priv->path, error->message);
+			priv->need_rewrite = TRUE;
+		} else
+			_LOGT ("appended %u bytes to %s", priv->pending->len, priv->path);
+	}
+
+	g_byte_array_set_size (priv->pending, 0);
+}
+
+static gboolean
+_flush_cb (gpointer user_data)
+{
+	nm_dhcp_lease_store_flush (user_data);
+	return G_SOURCE_REMOVE;
+}
+
+/*****************************************************************************/
+
+/**
+ * nm_dhcp_lease_store_lookup_ip4:
+ * @self: the #NMDhcpLeaseStore
+ * @uuid: the UUID of the connection
+ * @iface: the interface name
+ * @out_address: (out): the address of the last lease
+ *
+ * Returns: %TRUE if a lease was stored for @uuid on @iface.
+ */
+gboolean
+nm_dhcp_lease_store_lookup_ip4 (NMDhcpLeaseStore *self,
+                                const char *uuid,
+                                const char *iface,
+                                in_addr_t *out_address)
+{
+	NMDhcpLeaseStorePrivate *priv;
+	gs_free char *key = NULL;
+	gpointer address;
+
+	g_return_val_if_fail (NM_IS_DHCP_LEASE_STORE (self), FALSE);
+	g_return_val_if_fail (uuid, FALSE);
+	g_return_val_if_fail (iface, FALSE);
+
+	priv = NM_DHCP_LEASE_STORE_GET_PRIVATE (self);
+
+	key = g_strdup_printf ("%s/%s", uuid, iface);
+	address = g_hash_table_lookup (priv->leases, key);
+	if (!address)
+		return FALSE;
+
+	NM_SET_OUT (out_address, GPOINTER_TO_UINT (address));
+	return TRUE;
+}
+
+/**
+ * nm_dhcp_lease_store_set_ip4:
+ * @self: the #NMDhcpLeaseStore
+ * @uuid: the UUID of the connection
+ * @iface: the interface name
+ * @address: the leased address, or %INADDR_ANY to forget the lease
+ *
+ * Remembers the lease. The change is written to disk with a short delay,
+ * together with the changes of other interfaces. Storing an unchanged
+ * address costs no I/O at all.
+ */
+void
+nm_dhcp_lease_store_set_ip4 (NMDhcpLeaseStore *self,
+                             const char *uuid,
+                             const char *iface,
+                             in_addr_t address)
+{
+	NMDhcpLeaseStorePrivate *priv;
+	gs_free char *key = NULL;
+
+	g_return_if_fail (NM_IS_DHCP_LEASE_STORE (self));
+	g_return_if_fail (uuid);
+	g_return_if_fail (iface);
+
+	priv = NM_DHCP_LEASE_STORE_GET_PRIVATE (self);
+
+	key = g_strdup_printf ("%s/%s", uuid, iface);
+	if (GPOINTER_TO_UINT (g_hash_table_lookup (priv->leases, key)) == address)
+		return;
+
+	if (address != INADDR_ANY) {
+		_record_append (priv->pending, LEASE_STORE_OP_SET, key, address);
+		g_hash_table_insert (priv->leases, g_steal_pointer (&key), GUINT_TO_POINTER (address));
+	} else {
+		_record_append (priv->pending, LEASE_STORE_OP_REMOVE, key, address);
+		g_hash_table_remove (priv->leases, key);
+	}
+	priv->n_records++;
+
+	if (!priv->flush_source) {
+		priv->flush_source = nm_g_timeout_source_new (FLUSH_DELAY_MSEC,
+		                                              G_PRIORITY_DEFAULT,
+		                                              _flush_cb,
+		                                              self,
+		                                              NULL);
+		g_source_attach (priv->flush_source, NULL);
+	}
+}
+
+/*****************************************************************************/
+
+static void
+set_property (GObject *object, guint prop_id,
+              const GValue *value, GParamSpec *pspec)
+{
+	NMDhcpLeaseStorePrivate *priv = NM_DHCP_LEASE_STORE_GET_PRIVATE (object);
+
+	switch (prop_id) {
+	case PROP_PATH:
+		/* construct-only */
+		priv->path = g_value_dup_string (value);
+		break;
+	case PROP_MIGRATE_PATH:
+		/* construct-only */
+		priv->migrate_path = g_value_dup_string (value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+/*****************************************************************************/
+
+static void
+nm_dhcp_lease_store_init (NMDhcpLeaseStore *self)
+{
+	NMDhcpLeaseStorePrivate *priv = NM_DHCP_LEASE_STORE_GET_PRIVATE (self);
+
+	priv->leases = g_hash_table_new_full (nm_str_hash, g_str_equal, g_free, NULL);
+	priv->pending = g_byte_array_new ();
+}
+
+static void
+constructed (GObject *object)
+{
+	NMDhcpLeaseStore *self = NM_DHCP_LEASE_STORE (object);
+
+	G_OBJECT_CLASS (nm_dhcp_lease_store_parent_class)->constructed (object);
+
+	_load (self);
+}
+
+NMDhcpLeaseStore *
+nm_dhcp_lease_store_new (const char *path,
+                         const char *migrate_path)
+{
+	g_return_val_if_fail (path, NULL);
+
+	return g_object_new (NM_TYPE_DHCP_LEASE_STORE,
+	                     NM_DHCP_LEASE_STORE_PATH, path,
+	                     NM_DHCP_LEASE_STORE_MIGRATE_PATH, migrate_path,
+	                     NULL);
+}
+
+static void
+dispose (GObject *object)
+{
+	NMDhcpLeaseStore *self = NM_DHCP_LEASE_STORE (object);
+
+	nm_dhcp_lease_store_flush (self);
+
+	G_OBJECT_CLASS (nm_dhcp_lease_store_parent_class)->dispose (object);
+}
+
+static void
+finalize (GObject *object)
+{
+	NMDhcpLeaseStorePrivate *priv = NM_DHCP_LEASE_STORE_GET_PRIVATE (object);
+
+	g_hash_table_unref (priv->leases);
+	g_byte_array_unref (priv->pending);
+	g_free (priv->path);
+	g_free (priv->migrate_path);
+
+	G_OBJECT_CLASS (nm_dhcp_lease_store_parent_class)->finalize (object);
+}
+
+static void
+nm_dhcp_lease_store_class_init (NMDhcpLeaseStoreClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->set_property = set_property;
+	object_class->constructed = constructed;
+	object_class->dispose = dispose;
+	object_class->finalize = finalize;
+
+	obj_properties[PROP_PATH] =
+	    g_param_spec_string (NM_DHCP_LEASE_STORE_PATH, "", "",
+	                         NULL,
+	                         G_PARAM_WRITABLE |
+	                         G_PARAM_CONSTRUCT_ONLY |
+	                         G_PARAM_STATIC_STRINGS);
+
+	obj_properties[PROP_MIGRATE_PATH] =
+	    g_param_spec_string (NM_DHCP_LEASE_STORE_MIGRATE_PATH, "", "",
+	                         NULL,
+	                         G_PARAM_WRITABLE |
+	                         G_PARAM_CONSTRUCT_ONLY |
+	                         G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
+}
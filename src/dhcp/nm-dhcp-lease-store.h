@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#ifndef __NETWORKMANAGER_DHCP_LEASE_STORE_H__
+#define __NETWORKMANAGER_DHCP_LEASE_STORE_H__
+
+#define NM_TYPE_DHCP_LEASE_STORE           (nm_dhcp_lease_store_get_type ())
+#define NM_DHCP_LEASE_STORE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), NM_TYPE_DHCP_LEASE_STORE, NMDhcpLeaseStore))
+#define NM_IS_DHCP_LEASE_STORE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), NM_TYPE_DHCP_LEASE_STORE))
+#define NM_DHCP_LEASE_STORE_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), NM_TYPE_DHCP_LEASE_STORE, NMDhcpLeaseStoreClass))
+
+#define NM_DHCP_LEASE_STORE_PATH         "path"
+#define NM_DHCP_LEASE_STORE_MIGRATE_PATH "migrate-path"
+
+typedef struct _NMDhcpLeaseStore NMDhcpLeaseStore;
+typedef struct _NMDhcpLeaseStoreClass NMDhcpLeaseStoreClass;
+
+GType nm_dhcp_lease_store_get_type (void);
+
+NMDhcpLeaseStore *nm_dhcp_lease_store_get (void);
+
+NMDhcpLeaseStore *nm_dhcp_lease_store_new (const char *path,
+                                           const char *migrate_path);
+
+gboolean nm_dhcp_lease_store_lookup_ip4 (NMDhcpLeaseStore *self,
+                                         const char *uuid,
+                                         const char *iface,
+                                         in_addr_t *out_address);
+
+void nm_dhcp_lease_store_set_ip4 (NMDhcpLeaseStore *self,
+                                  const char *uuid,
+                                  const char *iface,
+                                  in_addr_t address);
+
+void nm_dhcp_lease_store_flush (NMDhcpLeaseStore *self);
+
+#endif /* __NETWORKMANAGER_DHCP_LEASE_STORE_H__ */
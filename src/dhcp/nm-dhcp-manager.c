@@ -24,10 +24,57 @@
 
 /*****************************************************************************/
 
+#define START_MAX_INFLIGHT_DEFAULT  0
+#define START_JITTER_MS_DEFAULT     0
+#define START_JITTER_MS_MAX         3600000
+#define START_BACKOFF_MS_MAX_DEFAULT 0
+
+#define START_BACKOFF_MS_INITIAL    250
+
+/* how long a started client counts against the in-flight limit if it
+ * neither gets a lease nor fails. */
+#define START_INFLIGHT_TIMEOUT_MS   30000
+
+/* A start request of a DHCP client. The client is created right away, but
+ * the DHCP transaction only begins once the request gets admitted by the
+ * start scheduler. */
+typedef struct {
+	CList start_lst;
+	NMDhcpManager *self;
+	NMDhcpClient *client;
+	GBytes *client_id;
+	char *dhcp_anycast_addr;
+	char *last_ip4_address;
+	GSource *inflight_timeout_source;
+	gint64 requested_msec;
+	gint64 not_before_msec;
+	gint64 started_msec;
+	struct in6_addr ipv6_ll_addr;
+	NMSettingIP6ConfigPrivacy privacy;
+	guint needed_prefixes;
+	bool enforce_duid:1;
+	bool has_ipv6_ll_addr:1;
+	bool inflight:1;
+} StartRequest;
+
 typedef struct {
 	const NMDhcpClientFactory *client_factory;
 	char *default_hostname;
 	CList dhcp_client_lst_head;
+
+	/* NMDhcpClient to StartRequest. */
+	GHashTable *start_requests;
+	CList start_queue_lst_head;
+	GSource *start_queue_source;
+
+	gint64 start_next_msec;
+	guint start_backoff_msec;
+	guint start_n_inflight;
+
+	guint start_max_inflight;
+	guint start_inflight_timeout_msec;
+	guint start_jitter_msec;
+	guint start_backoff_msec_max;
 } NMDhcpManagerPrivate;
 
 struct _NMDhcpManager {
@@ -141,6 +188,243 @@ out:
 
 /*****************************************************************************/
 
+static void _start_queue_process (NMDhcpManager *self);
+
+static void
+_start_request_free (gpointer data)
+{
+	StartRequest *req = data;
+
+	c_list_unlink_stale (&req->start_lst);
+	nm_clear_g_source_inst (&req->inflight_timeout_source);
+	nm_clear_pointer (&req->client_id, g_bytes_unref);
+	g_free (req->dhcp_anycast_addr);
+	g_free (req->last_ip4_address);
+	nm_g_slice_free (req);
+}
+
+static void
+_start_backoff (NMDhcpManager *self, gboolean success)
+{
+	NMDhcpManagerPrivate *priv = NM_DHCP_MANAGER_GET_PRIVATE (self);
+
+	if (success) {
+		priv->start_backoff_msec = 0;
+		return;
+	}
+
+	if (priv->start_backoff_msec_max == 0)
+		return;
+
+	if (priv->start_backoff_msec == 0)
+		priv->start_backoff_msec = START_BACKOFF_MS_INITIAL;
+	else
+		priv->start_backoff_msec *= 2;
+	priv->start_backoff_msec = NM_MIN (priv->start_backoff_msec, priv->start_backoff_msec_max);
+}
+
+/* Releases the in-flight slot of @req, if it holds one. @success tells
+ * whether the DHCP transaction got a lease or failed. With %NM_TERNARY_DEFAULT
+ * there is no result yet, and the backoff is not affected. */
+static void
+_start_request_complete (StartRequest *req, NMTernary success)
+{
+	NMDhcpManager *self = req->self;
+	NMDhcpManagerPrivate *priv = NM_DHCP_MANAGER_GET_PRIVATE (self);
+
+	if (!req->inflight)
+		return;
+
+	req->inflight = FALSE;
+	nm_clear_g_source_inst (&req->inflight_timeout_source);
+	nm_assert (priv->start_n_inflight > 0);
+	priv->start_n_inflight--;
+
+	if (success == NM_TERNARY_TRUE) {
+		nm_log_dbg (LOGD_DHCP, "dhcp%c (%s): got lease %"G_GINT64_FORMAT" msec after start request",
+		            nm_utils_addr_family_to_char (nm_dhcp_client_get_addr_family (req->client)),
+		            nm_dhcp_client_get_iface (req->client),
+		            nm_utils_get_monotonic_timestamp_msec () - req->requested_msec);
+	}
+
+	if (success != NM_TERNARY_DEFAULT)
+		_start_backoff (self, success);
+	_start_queue_process (self);
+}
+
+static gboolean
+_start_request_inflight_timeout_cb (gpointer user_data)
+{
+	StartRequest *req = user_data;
+
+	nm_log_dbg (LOGD_DHCP, "dhcp%c (%s): no lease yet, release start slot",
+	            nm_utils_addr_family_to_char (nm_dhcp_client_get_addr_family (req->client)),
+	            nm_dhcp_client_get_iface (req->client));
+
+	nm_clear_g_source_inst (&req->inflight_timeout_source);
+
+	/* the client is still trying. That is not a failure, for example the DHCP
+	 * server might just be slow. Only give up the slot. */
+	_start_request_complete (req, NM_TERNARY_DEFAULT);
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+_start_request_start (StartRequest *req, GError **error)
+{
+	NMDhcpManagerPrivate *priv = NM_DHCP_MANAGER_GET_PRIVATE (req->self);
+	NMDhcpClient *client = req->client;
+	gint64 now_msec;
+
+	nm_assert (c_list_is_empty (&req->start_lst));
+	nm_assert (!req->inflight);
+
+	now_msec = nm_utils_get_monotonic_timestamp_msec ();
+	req->started_msec = now_msec;
+	req->inflight = TRUE;
+	priv->start_n_inflight++;
+	priv->start_next_msec = now_msec + priv->start_backoff_msec;
+
+	nm_log_dbg (LOGD_DHCP, "dhcp%c (%s): start DHCP transaction after %"G_GINT64_FORMAT" msec (%u in flight, %u backoff msec)",
+	            nm_utils_addr_family_to_char (nm_dhcp_client_get_addr_family (client)),
+	            nm_dhcp_client_get_iface (client),
+	            now_msec - req->requested_msec,
+	            priv->start_n_inflight,
+	            priv->start_backoff_msec);
+
+	req->inflight_timeout_source = nm_g_timeout_source_new (priv->start_inflight_timeout_msec,
+	                                                        G_PRIORITY_DEFAULT,
+	                                                        _start_request_inflight_timeout_cb,
+	                                                        req,
+	                                                        NULL);
+	g_source_attach (req->inflight_timeout_source, NULL);
+
+	/* unfortunately, our implementations work differently per address-family regarding client-id/DUID.
+	 *
+	 * - for IPv4, the calling code may determine a client-id (from NM's connection profile).
+	 *   If present, it is taken. If not present, the DHCP plugin uses a plugin specific default.
+	 *     - for "internal" plugin, the default is just "mac".
+	 *     - for "dhclient", we try to get the configuration from dhclient's /etc/dhcp or fallback
+	 *       to whatever dhclient uses by default.
+	 *   We do it this way, because for dhclient the user may configure a default
+	 *   outside of NM, and we want to honor that. Worse, dhclient could be a wapper
+	 *   script where the wrapper script overwrites the client-id. We need to distinguish
+	 *   between: force a particular client-id and leave it unspecified to whatever dhclient
+	 *   wants.
+	 *
+	 * - for IPv6, the calling code always determines a client-id. It also specifies @enforce_duid,
+	 *   to determine whether the given client-id must be used.
+	 *     - for "internal" plugin @enforce_duid doesn't matter and the given client-id is
+	 *       always used.
+	 *     - for "dhclient", @enforce_duid FALSE means to first try to load the DUID from the
+	 *       lease file, and only otherwise fallback to the given client-id.
+	 *     - other plugins don't support DHCPv6.
+	 *   It's done this way, so that existing dhclient setups don't change behavior on upgrade.
+	 *
+	 * This difference is cumbersome and only exists because of "dhclient" which supports hacking the
+	 * default outside of NetworkManager API.
+	 */
+
+	if (nm_dhcp_client_get_addr_family (client) == AF_INET) {
+		return nm_dhcp_client_start_ip4 (client,
+		                                 req->client_id,
+		                                 req->dhcp_anycast_addr,
+		                                 req->last_ip4_address,
+		                                 error);
+	}
+
+	return nm_dhcp_client_start_ip6 (client,
+	                                 req->client_id,
+	                                 req->enforce_duid,
+	                                 req->dhcp_anycast_addr,
+	                                 req->has_ipv6_ll_addr ? &req->ipv6_ll_addr : NULL,
+	                                 req->privacy,
+	                                 req->needed_prefixes,
+	                                 error);
+}
+
+static gboolean
+_start_request_can_start (NMDhcpManager *self, StartRequest *req, gint64 now_msec)
+{
+	NMDhcpManagerPrivate *priv = NM_DHCP_MANAGER_GET_PRIVATE (self);
+
+	return    (   priv->start_max_inflight == 0
+	           || priv->start_n_inflight < priv->start_max_inflight)
+	       && now_msec >= priv->start_next_msec
+	       && now_msec >= req->not_before_msec;
+}
+
+static gboolean
+_start_queue_timeout_cb (gpointer user_data)
+{
+	NMDhcpManager *self = user_data;
+	NMDhcpManagerPrivate *priv = NM_DHCP_MANAGER_GET_PRIVATE (self);
+
+	nm_clear_g_source_inst (&priv->start_queue_source);
+	_start_queue_process (self);
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+_start_queue_process (NMDhcpManager *self)
+{
+	NMDhcpManagerPrivate *priv = NM_DHCP_MANAGER_GET_PRIVATE (self);
+	StartRequest *req, *req_safe;
+	gint64 next_msec;
+	gint64 now_msec;
+
+again:
+	nm_clear_g_source_inst (&priv->start_queue_source);
+
+	next_msec = 0;
+	now_msec = nm_utils_get_monotonic_timestamp_msec ();
+
+	c_list_for_each_entry_safe (req, req_safe, &priv->start_queue_lst_head, start_lst) {
+		gs_unref_object NMDhcpClient *client = NULL;
+		gs_free_error GError *error = NULL;
+
+		if (   priv->start_max_inflight > 0
+		    && priv->start_n_inflight >= priv->start_max_inflight) {
+			/* wait for a slot to be released. */
+			return;
+		}
+
+		if (!_start_request_can_start (self, req, now_msec)) {
+			gint64 t = NM_MAX (priv->start_next_msec, req->not_before_msec);
+
+			if (next_msec == 0 || t < next_msec)
+				next_msec = t;
+			continue;
+		}
+
+		c_list_unlink (&req->start_lst);
+
+		client = g_object_ref (req->client);
+		if (!_start_request_start (req, &error)) {
+			nm_log_warn (LOGD_DHCP, "dhcp%c (%s): failure to start DHCP: %s",
+			             nm_utils_addr_family_to_char (nm_dhcp_client_get_addr_family (client)),
+			             nm_dhcp_client_get_iface (client),
+			             error->message);
+			/* this removes the client and the start request. */
+			nm_dhcp_client_set_state (client, NM_DHCP_STATE_FAIL, NULL, NULL);
+		}
+
+		/* starting may have changed the queue (or the backoff), start over. */
+		goto again;
+	}
+
+	if (next_msec > 0) {
+		priv->start_queue_source = nm_g_timeout_source_new (NM_MAX (next_msec - now_msec, 1),
+		                                                    G_PRIORITY_DEFAULT,
+		                                                    _start_queue_timeout_cb,
+		                                                    self,
+		                                                    NULL);
+		g_source_attach (priv->start_queue_source, NULL);
+	}
+}
+
+/*****************************************************************************/
+
 static NMDhcpClient *
 get_client_for_ifindex (NMDhcpManager *manager, int addr_family, int ifindex)
 {
@@ -171,9 +455,26 @@ static void client_state_changed (NMDhcpClient *client,
 static void
 remove_client (NMDhcpManager *self, NMDhcpClient *client)
 {
+	NMDhcpManagerPrivate *priv = NM_DHCP_MANAGER_GET_PRIVATE (self);
+	StartRequest *req;
+
 	g_signal_handlers_disconnect_by_func (client, client_state_changed, self);
 	c_list_unlink (&client->dhcp_client_lst);
 
+	req = priv->start_requests
+	      ? g_hash_table_lookup (priv->start_requests, client)
+	      : NULL;
+	if (req) {
+		gboolean inflight = req->inflight;
+
+		g_hash_table_remove (priv->start_requests, client);
+		if (inflight) {
+			nm_assert (priv->start_n_inflight > 0);
+			priv->start_n_inflight--;
+			_start_queue_process (self);
+		}
+	}
+
 	/* Stopping the client is left up to the controlling device
 	 * explicitly since we may want to quit NetworkManager but not terminate
 	 * the DHCP client.
@@ -195,6 +496,16 @@ client_state_changed (NMDhcpClient *client,
                       const char *event_id,
                       NMDhcpManager *self)
 {
+	StartRequest *req;
+
+	if (NM_IN_SET (state, NM_DHCP_STATE_BOUND,
+	                      NM_DHCP_STATE_TIMEOUT,
+	                      NM_DHCP_STATE_FAIL)) {
+		req = g_hash_table_lookup (NM_DHCP_MANAGER_GET_PRIVATE (self)->start_requests, client);
+		if (req)
+			_start_request_complete (req, state == NM_DHCP_STATE_BOUND ? NM_TERNARY_TRUE : NM_TERNARY_FALSE);
+	}
+
 	if (state >= NM_DHCP_STATE_TIMEOUT)
 		remove_client_unref (self, client);
 }
@@ -229,6 +540,7 @@ client_start (NMDhcpManager *self,
 {
 	NMDhcpManagerPrivate *priv;
 	NMDhcpClient *client;
+	StartRequest *req;
 	gboolean success = FALSE;
 	gsize hwaddr_len;
 	GType gtype;
@@ -318,47 +630,48 @@ client_start (NMDhcpManager *self,
 	c_list_link_tail (&priv->dhcp_client_lst_head, &client->dhcp_client_lst);
 	g_signal_connect (client, NM_DHCP_CLIENT_SIGNAL_STATE_CHANGED, G_CALLBACK (client_state_changed), self);
 
-	/* unfortunately, our implementations work differently per address-family regarding client-id/DUID.
-	 *
-	 * - for IPv4, the calling code may determine a client-id (from NM's connection profile).
-	 *   If present, it is taken. If not present, the DHCP plugin uses a plugin specific default.
-	 *     - for "internal" plugin, the default is just "mac".
-	 *     - for "dhclient", we try to get the configuration from dhclient's /etc/dhcp or fallback
-	 *       to whatever dhclient uses by default.
-	 *   We do it this way, because for dhclient the user may configure a default
-	 *   outside of NM, and we want to honor that. Worse, dhclient could be a wapper
-	 *   script where the wrapper script overwrites the client-id. We need to distinguish
-	 *   between: force a particular client-id and leave it unspecified to whatever dhclient
-	 *   wants.
-	 *
-	 * - for IPv6, the calling code always determines a client-id. It also specifies @enforce_duid,
-	 *   to determine whether the given client-id must be used.
-	 *     - for "internal" plugin @enforce_duid doesn't matter and the given client-id is
-	 *       always used.
-	 *     - for "dhclient", @enforce_duid FALSE means to first try to load the DUID from the
-	 *       lease file, and only otherwise fallback to the given client-id.
-	 *     - other plugins don't support DHCPv6.
-	 *   It's done this way, so that existing dhclient setups don't change behavior on upgrade.
-	 *
-	 * This difference is cumbersome and only exists because of "dhclient" which supports hacking the
-	 * default outside of NetworkManager API.
-	 */
-
-	if (addr_family == AF_INET) {
-		success = nm_dhcp_client_start_ip4 (client,
-		                                    dhcp_client_id,
-		                                    dhcp_anycast_addr,
-		                                    last_ip4_address,
-		                                    error);
+	req = g_slice_new (StartRequest);
+	*req = (StartRequest) {
+		.self              = self,
+		.client            = client,
+		.client_id         = dhcp_client_id ? g_bytes_ref (dhcp_client_id) : NULL,
+		.dhcp_anycast_addr = g_strdup (dhcp_anycast_addr),
+		.last_ip4_address  = g_strdup (last_ip4_address),
+		.requested_msec    = nm_utils_get_monotonic_timestamp_msec (),
+		.enforce_duid      = enforce_duid,
+		.has_ipv6_ll_addr  = !!ipv6_ll_addr,
+		.ipv6_ll_addr      = ipv6_ll_addr ? *ipv6_ll_addr : (struct in6_addr) { },
+		.privacy           = privacy,
+		.needed_prefixes   = needed_prefixes,
+	};
+	c_list_init (&req->start_lst);
+	req->not_before_msec = req->requested_msec;
+	if (priv->start_jitter_msec > 0)
+		req->not_before_msec += g_random_int_range (0, priv->start_jitter_msec + 1);
+	g_hash_table_insert (priv->start_requests, client, req);
+
+	if (   c_list_is_empty (&priv->start_queue_lst_head)
+	    && _start_request_can_start (self, req, req->requested_msec)) {
+		/* start right away, so that the caller gets the error. */
+		success = _start_request_start (req, error);
 	} else {
-		success = nm_dhcp_client_start_ip6 (client,
-		                                    dhcp_client_id,
-		                                    enforce_duid,
-		                                    dhcp_anycast_addr,
-		                                    ipv6_ll_addr,
-		                                    privacy,
-		                                    needed_prefixes,
-		                                    error);
+		nm_log_dbg (LOGD_DHCP, "dhcp%c (%s): delay DHCP start (%u in flight, %u backoff msec)",
+		            nm_utils_addr_family_to_char (addr_family),
+		            iface,
+		            priv->start_n_inflight,
+		            priv->start_backoff_msec);
+		c_list_link_tail (&priv->start_queue_lst_head, &req->start_lst);
+
+		/* process the queue from the mainloop, the caller must get the
+		 * client before it can fail. */
+		nm_clear_g_source_inst (&priv->start_queue_source);
+		priv->start_queue_source = nm_g_timeout_source_new (0,
+		                                                    G_PRIORITY_DEFAULT,
+		                                                    _start_queue_timeout_cb,
+		                                                    self,
+		                                                    NULL);
+		g_source_attach (priv->start_queue_source, NULL);
+		success = TRUE;
 	}
 
 	if (!success) {
@@ -551,6 +864,20 @@ nmtst_dhcp_manager_unget (gpointer self)
 	_nmtst_nm_dhcp_manager_get_reset (self);
 }
 
+void
+nmtst_dhcp_manager_set_client_factory (NMDhcpManager *self,
+                                       const NMDhcpClientFactory *client_factory)
+{
+	NM_DHCP_MANAGER_GET_PRIVATE (self)->client_factory = client_factory;
+}
+
+void
+nmtst_dhcp_manager_set_start_inflight_timeout (NMDhcpManager *self,
+                                               guint timeout_msec)
+{
+	NM_DHCP_MANAGER_GET_PRIVATE (self)->start_inflight_timeout_msec = timeout_msec;
+}
+
 static void
 nm_dhcp_manager_init (NMDhcpManager *self)
 {
@@ -562,6 +889,25 @@ nm_dhcp_manager_init (NMDhcpManager *self)
 	const NMDhcpClientFactory *client_factory = NULL;
 
 	c_list_init (&priv->dhcp_client_lst_head);
+	c_list_init (&priv->start_queue_lst_head);
+	priv->start_requests = g_hash_table_new_full (nm_direct_hash, NULL, NULL, _start_request_free);
+
+	priv->start_max_inflight = nm_config_data_get_value_int64 (nm_config_get_data_orig (config),
+	                                                           NM_CONFIG_KEYFILE_GROUP_MAIN,
+	                                                           NM_CONFIG_KEYFILE_KEY_MAIN_DHCP_START_MAX_INFLIGHT,
+	                                                           10, 0, G_MAXINT32,
+	                                                           START_MAX_INFLIGHT_DEFAULT);
+	priv->start_inflight_timeout_msec = START_INFLIGHT_TIMEOUT_MS;
+	priv->start_jitter_msec = nm_config_data_get_value_int64 (nm_config_get_data_orig (config),
+	                                                          NM_CONFIG_KEYFILE_GROUP_MAIN,
+	                                                          NM_CONFIG_KEYFILE_KEY_MAIN_DHCP_START_JITTER,
+	                                                          10, 0, START_JITTER_MS_MAX,
+	                                                          START_JITTER_MS_DEFAULT);
+	priv->start_backoff_msec_max = nm_config_data_get_value_int64 (nm_config_get_data_orig (config),
+	                                                               NM_CONFIG_KEYFILE_GROUP_MAIN,
+	                                                               NM_CONFIG_KEYFILE_KEY_MAIN_DHCP_START_BACKOFF_MAX,
+	                                                               10, 0, G_MAXINT32,
+	                                                               START_BACKOFF_MS_MAX_DEFAULT);
 
 	for (i = 0; i < G_N_ELEMENTS (_nm_dhcp_manager_factories); i++) {
 		const NMDhcpClientFactory *f = _nm_dhcp_manager_factories[i];
@@ -628,6 +974,11 @@ dispose (GObject *object)
 	NMDhcpManagerPrivate *priv = NM_DHCP_MANAGER_GET_PRIVATE (self);
 	NMDhcpClient *client, *client_safe;
 
+	/* drop the start requests first, so that removing the clients
+	 * doesn't start queued ones. */
+	nm_clear_g_source_inst (&priv->start_queue_source);
+	nm_clear_pointer (&priv->start_requests, g_hash_table_unref);
+
 	c_list_for_each_entry_safe (client, client_safe, &priv->dhcp_client_lst_head, dhcp_client_lst)
 		remove_client_unref (self, client);
 
@@ -82,4 +82,10 @@ extern const NMDhcpClientFactory *const _nm_dhcp_manager_factories[6];
 
 void nmtst_dhcp_manager_unget (gpointer singleton_instance);
 
+void nmtst_dhcp_manager_set_client_factory (NMDhcpManager *self,
+                                            const NMDhcpClientFactory *client_factory);
+
+void nmtst_dhcp_manager_set_start_inflight_timeout (NMDhcpManager *self,
+                                                    guint timeout_msec);
+
 #endif /* __NETWORKMANAGER_DHCP_MANAGER_H__ */
@@ -12,6 +12,8 @@
 #include <arpa/inet.h>
 #include <ctype.h>
 #include <net/if_arp.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 #include "nm-sd-adapt-shared.h"
 #include "hostname-util.h"
@@ -23,6 +25,8 @@
 #include "nm-config.h"
 #include "nm-dhcp-utils.h"
 #include "nm-dhcp-options.h"
+#include "nm-dhcp-lease-store.h"
+#include "nm-dhcp-timer-heap.h"
 #include "nm-core-utils.h"
 #include "NetworkManagerUtils.h"
 #include "platform/nm-platform.h"
@@ -49,8 +53,12 @@ typedef struct {
 	NDhcp4Client *client;
 	NDhcp4ClientProbe *probe;
 	NDhcp4ClientLease *lease;
-	GSource *event_source;
-	char *lease_file;
+
+	/* the next timeout of the client on CLOCK_BOOTTIME, in the timer
+	 * heap of the dispatcher. */
+	NMDhcpTimerHeapNode timer_node;
+
+	bool dispatcher_registered:1;
 } NMDhcpNettoolsPrivate;
 
 struct _NMDhcpNettools {
@@ -962,36 +970,28 @@ lease_to_ip4_config (NMDedupMultiIndex *multi_idx,
 /*****************************************************************************/
 
 static void
-lease_save (NMDhcpNettools *self, NDhcp4ClientLease *lease, const char *lease_file)
+lease_save (NMDhcpNettools *self, NDhcp4ClientLease *lease)
 {
+	NMDhcpClient *client = NM_DHCP_CLIENT (self);
 	struct in_addr a_address;
-	nm_auto_free_gstring GString *new_contents = NULL;
-	char sbuf[NM_UTILS_INET_ADDRSTRLEN];
-	gs_free_error GError *error = NULL;
 
 	nm_assert (lease);
-	nm_assert (lease_file);
-
-	new_contents = g_string_new ("# This is private data. Do not parse.\n");
 
 	n_dhcp4_client_lease_get_yiaddr (lease, &a_address);
 	if (a_address.s_addr == INADDR_ANY)
 		return;
 
-	g_string_append_printf (new_contents,
-	                        "ADDRESS=%s\n", _nm_utils_inet4_ntop (a_address.s_addr, sbuf));
-
-	if (!g_file_set_contents (lease_file,
-	                          new_contents->str,
-	                          -1,
-	                          &error))
-		_LOGW ("error saving lease to %s: %s", lease_file, error->message);
+	/* the store writes the leases of all interfaces together, and only
+	 * if the address changed. */
+	nm_dhcp_lease_store_set_ip4 (nm_dhcp_lease_store_get (),
+	                             nm_dhcp_client_get_uuid (client),
+	                             nm_dhcp_client_get_iface (client),
+	                             a_address.s_addr);
 }
 
 static void
 bound4_handle (NMDhcpNettools *self, NDhcp4ClientLease *lease, gboolean extended)
 {
-	NMDhcpNettoolsPrivate *priv = NM_DHCP_NETTOOLS_GET_PRIVATE (self);
 	const char *iface = nm_dhcp_client_get_iface (NM_DHCP_CLIENT (self));
 	gs_unref_object NMIP4Config *ip4_config = NULL;
 	gs_unref_hashtable GHashTable *options = NULL;
@@ -1015,7 +1015,7 @@ bound4_handle (NMDhcpNettools *self, NDhcp4ClientLease *lease, gboolean extended
 	}
 
 	nm_dhcp_option_add_requests_to_options (options, _nm_dhcp_option_dhcp4_options);
-	lease_save (self, lease, priv->lease_file);
+	lease_save (self, lease);
 
 	nm_dhcp_client_set_state (NM_DHCP_CLIENT (self),
 	                          extended ? NM_DHCP_STATE_EXTENDED : NM_DHCP_STATE_BOUND,
@@ -1076,16 +1076,279 @@ dhcp4_event_handle (NMDhcpNettools *self,
 	return TRUE;
 }
 
+/*****************************************************************************/
+
+/* All nettools clients share one dispatcher. Each client has an epoll FD
+ * for its sockets, which is added to the epoll FD of the dispatcher.
+ * The clients don't have a timerfd of their own (see
+ * n_dhcp4_client_config_set_external_timer()). Instead, their timeouts are
+ * kept in a binary heap and the dispatcher arms a single timerfd for the
+ * earliest one. So the main loop polls one FD, regardless of how many
+ * DHCP clients run. */
+
+typedef struct {
+	GSource *io_source;
+
+	/* the timeouts of the clients. */
+	NMDhcpTimerHeap timer_heap;
+
+	guint64 timer_armed;
+
+	int fd_epoll;
+	int fd_timer;
+
+	guint n_clients;
+} NettoolsDispatcher;
+
+static NettoolsDispatcher _dispatcher = {
+	.fd_epoll = -1,
+	.fd_timer = -1,
+};
+
+static void _client_dispatch (NMDhcpNettools *self);
+
+static NMDhcpNettools *
+_timer_node_to_self (NMDhcpTimerHeapNode *node)
+{
+	return (NMDhcpNettools *) (((char *) node) - G_STRUCT_OFFSET (NMDhcpNettools, _priv.timer_node));
+}
+
+static void
+_dispatcher_timer_arm (void)
+{
+	guint64 timeout = 0;
+	guint64 now;
+	guint64 offset;
+	int r;
+
+	if (_dispatcher.fd_timer < 0)
+		return;
+
+	if (nm_dhcp_timer_heap_get_len (&_dispatcher.timer_heap) > 0)
+		timeout = nm_dhcp_timer_heap_peek (&_dispatcher.timer_heap)->timeout;
+
+	if (timeout == _dispatcher.timer_armed)
+		return;
+
+	_dispatcher.timer_armed = timeout;
+
+	/* like n-dhcp4, schedule relative to CLOCK_BOOTTIME, as the timerfd
+	 * might run on CLOCK_MONOTONIC. */
+	if (timeout == 0)
+		offset = 0;
+	else {
+		now = nm_utils_clock_gettime_nsec (CLOCK_BOOTTIME);
+		offset = timeout > now ? timeout - now : 1;
+	}
+
+	r = timerfd_settime (_dispatcher.fd_timer,
+	                     0,
+	                     &((const struct itimerspec) {
+	                         .it_value = {
+	                             .tv_sec  = offset / NM_UTILS_NSEC_PER_SEC,
+	                             .tv_nsec = offset % NM_UTILS_NSEC_PER_SEC,
+	                         },
+	                     }),
+	                     NULL);
+	nm_assert (r == 0);
+}
+
+/* Picks up a changed timeout of the client. Must be called after each
+ * call into the n-dhcp4 client. */
+static void
+_timer_update (NMDhcpNettools *self)
+{
+	NMDhcpNettoolsPrivate *priv = NM_DHCP_NETTOOLS_GET_PRIVATE (self);
+	uint64_t timeout = 0;
+
+	if (!priv->dispatcher_registered)
+		return;
+
+	n_dhcp4_client_get_timeout (priv->client, &timeout);
+
+	if (timeout == priv->timer_node.timeout)
+		return;
+
+	nm_dhcp_timer_heap_set (&_dispatcher.timer_heap, &priv->timer_node, timeout);
+	_dispatcher_timer_arm ();
+}
+
+static gboolean
+_dispatcher_io_cb (int fd,
+                   GIOCondition condition,
+                   gpointer user_data)
+{
+	gs_unref_ptrarray GPtrArray *clients = NULL;
+	struct epoll_event events[64];
+	gboolean timer_expired = FALSE;
+	guint i;
+	int n;
+
+	n = epoll_wait (_dispatcher.fd_epoll, events, G_N_ELEMENTS (events), 0);
+	if (n < 0) {
+		int errsv = errno;
+
+		nm_log_warn (LOGD_DHCP4, "dhcp4: failed to wait for events: %s", nm_strerror_native (errsv));
+		return G_SOURCE_CONTINUE;
+	}
+
+	/* Dispatching a client can destroy other clients, so keep them
+	 * alive until we are done. */
+	clients = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (i = 0; i < (guint) n; i++) {
+		if (events[i].data.ptr == &_dispatcher) {
+			guint64 v;
+
+			if (read (_dispatcher.fd_timer, &v, sizeof (v)) > 0)
+				timer_expired = TRUE;
+		} else
+			g_ptr_array_add (clients, g_object_ref (events[i].data.ptr));
+	}
+
+	if (timer_expired) {
+		guint64 now = nm_utils_clock_gettime_nsec (CLOCK_BOOTTIME);
+
+		_dispatcher.timer_armed = 0;
+		while (TRUE) {
+			NMDhcpTimerHeapNode *node = nm_dhcp_timer_heap_peek (&_dispatcher.timer_heap);
+
+			if (   !node
+			    || node->timeout > now)
+				break;
+
+			/* _timer_update() adds the client again. */
+			nm_dhcp_timer_heap_remove (&_dispatcher.timer_heap, node);
+			g_ptr_array_add (clients, g_object_ref (_timer_node_to_self (node)));
+		}
+	}
+
+	for (i = 0; i < clients->len; i++)
+		_client_dispatch (clients->pdata[i]);
+
+	_dispatcher_timer_arm ();
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+_dispatcher_destroy (void)
+{
+	nm_assert (_dispatcher.n_clients == 0);
+	nm_clear_g_source_inst (&_dispatcher.io_source);
+	nm_dhcp_timer_heap_destroy (&_dispatcher.timer_heap);
+	nm_close (nm_steal_fd (&_dispatcher.fd_timer));
+	nm_close (nm_steal_fd (&_dispatcher.fd_epoll));
+}
+
 static gboolean
-dhcp4_event_cb (int fd,
-                GIOCondition condition,
-                gpointer data)
+_dispatcher_register (NMDhcpNettools *self, GError **error)
+{
+	NMDhcpNettoolsPrivate *priv = NM_DHCP_NETTOOLS_GET_PRIVATE (self);
+	int fd;
+	int errsv;
+
+	nm_assert (!priv->dispatcher_registered);
+
+	if (_dispatcher.fd_epoll < 0) {
+		nm_auto_close int fd_epoll = -1;
+		nm_auto_close int fd_timer = -1;
+
+		fd_epoll = epoll_create1 (EPOLL_CLOEXEC);
+		if (fd_epoll < 0) {
+			errsv = errno;
+			nm_utils_error_set_errno (error, errsv, "failed to create epoll: %s");
+			return FALSE;
+		}
+
+		fd_timer = timerfd_create (CLOCK_BOOTTIME, TFD_CLOEXEC | TFD_NONBLOCK);
+		if (fd_timer < 0 && errno == EINVAL)
+			fd_timer = timerfd_create (CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+		if (fd_timer < 0) {
+			errsv = errno;
+			nm_utils_error_set_errno (error, errsv, "failed to create timerfd: %s");
+			return FALSE;
+		}
+
+		if (epoll_ctl (fd_epoll,
+		               EPOLL_CTL_ADD,
+		               fd_timer,
+		               &((struct epoll_event) {
+		                   .events = EPOLLIN,
+		                   .data.ptr = &_dispatcher,
+		               })) != 0) {
+			errsv = errno;
+			nm_utils_error_set_errno (error, errsv, "failed to add timerfd to epoll: %s");
+			return FALSE;
+		}
+
+		_dispatcher.fd_epoll = nm_steal_fd (&fd_epoll);
+		_dispatcher.fd_timer = nm_steal_fd (&fd_timer);
+		nm_dhcp_timer_heap_init (&_dispatcher.timer_heap);
+		_dispatcher.timer_armed = 0;
+		_dispatcher.io_source = nm_g_unix_fd_source_new (_dispatcher.fd_epoll,
+		                                                 G_IO_IN,
+		                                                 G_PRIORITY_DEFAULT,
+		                                                 _dispatcher_io_cb,
+		                                                 NULL,
+		                                                 NULL);
+		g_source_attach (_dispatcher.io_source, NULL);
+	}
+
+	n_dhcp4_client_get_fd (priv->client, &fd);
+	if (epoll_ctl (_dispatcher.fd_epoll,
+	               EPOLL_CTL_ADD,
+	               fd,
+	               &((struct epoll_event) {
+	                   .events = EPOLLIN,
+	                   .data.ptr = self,
+	               })) != 0) {
+		errsv = errno;
+		nm_utils_error_set_errno (error, errsv, "failed to add client to epoll: %s");
+		if (_dispatcher.n_clients == 0)
+			_dispatcher_destroy ();
+		return FALSE;
+	}
+
+	_dispatcher.n_clients++;
+	priv->dispatcher_registered = TRUE;
+	_timer_update (self);
+	return TRUE;
+}
+
+static void
+_dispatcher_unregister (NMDhcpNettools *self)
+{
+	NMDhcpNettoolsPrivate *priv = NM_DHCP_NETTOOLS_GET_PRIVATE (self);
+	int fd;
+
+	if (!priv->dispatcher_registered)
+		return;
+
+	priv->dispatcher_registered = FALSE;
+	nm_dhcp_timer_heap_remove (&_dispatcher.timer_heap, &priv->timer_node);
+
+	n_dhcp4_client_get_fd (priv->client, &fd);
+	epoll_ctl (_dispatcher.fd_epoll, EPOLL_CTL_DEL, fd, NULL);
+
+	nm_assert (_dispatcher.n_clients > 0);
+	if (--_dispatcher.n_clients > 0) {
+		_dispatcher_timer_arm ();
+		return;
+	}
+
+	_dispatcher_destroy ();
+}
+
+static void
+_client_dispatch (NMDhcpNettools *self)
 {
-	NMDhcpNettools *self = data;
 	NMDhcpNettoolsPrivate *priv = NM_DHCP_NETTOOLS_GET_PRIVATE (self);
 	NDhcp4ClientEvent *event;
 	int r;
 
+	if (!priv->dispatcher_registered)
+		return;
+
 	r = n_dhcp4_client_dispatch (priv->client);
 	if (r < 0) {
 		/* FIXME: if any operation (e.g. send()) fails during the
@@ -1096,16 +1359,16 @@ dhcp4_event_cb (int fd,
 		 * a predefined number of times (possibly infinite).
 		 */
 		_LOGE ("error %d dispatching events", r);
-		nm_clear_g_source_inst (&priv->event_source);
+		_dispatcher_unregister (self);
 		nm_dhcp_client_set_state (NM_DHCP_CLIENT (self), NM_DHCP_STATE_FAIL, NULL, NULL);
-		return G_SOURCE_REMOVE;
+		return;
 	}
 
 	while (!n_dhcp4_client_pop_event (priv->client, &event) && event) {
 		dhcp4_event_handle (self, event);
 	}
 
-	return G_SOURCE_CONTINUE;
+	_timer_update (self);
 }
 
 static gboolean
@@ -1126,7 +1389,7 @@ nettools_create (NMDhcpNettools *self,
 	gs_unref_bytes GBytes *client_id_new = NULL;
 	const uint8_t *client_id_arr;
 	size_t client_id_len;
-	int r, fd, arp_type, transport;
+	int r, arp_type, transport;
 
 	g_return_val_if_fail (!priv->client, FALSE);
 
@@ -1181,6 +1444,7 @@ nettools_create (NMDhcpNettools *self,
 	n_dhcp4_client_config_set_transport (config, transport);
 	n_dhcp4_client_config_set_mac (config, hwaddr_arr, hwaddr_len);
 	n_dhcp4_client_config_set_broadcast_mac (config, bcast_hwaddr_arr, bcast_hwaddr_len);
+	n_dhcp4_client_config_set_external_timer (config, TRUE);
 	r = n_dhcp4_client_config_set_client_id (config,
 	                                         client_id_arr,
 	                                         NM_MIN (client_id_len, 1 + _NM_SD_MAX_CLIENT_ID_LEN));
@@ -1200,15 +1464,10 @@ nettools_create (NMDhcpNettools *self,
 
 	n_dhcp4_client_set_log_level (priv->client, nm_log_level_to_syslog (nm_logging_get_level (LOGD_DHCP4)));
 
-	n_dhcp4_client_get_fd (priv->client, &fd);
-
-	priv->event_source = nm_g_unix_fd_source_new (fd,
-	                                              G_IO_IN,
-	                                              G_PRIORITY_DEFAULT,
-	                                              dhcp4_event_cb,
-	                                              self,
-	                                              NULL);
-	g_source_attach (priv->event_source, NULL);
+	if (!_dispatcher_register (self, error)) {
+		nm_clear_pointer (&priv->client, n_dhcp4_client_unref);
+		return FALSE;
+	}
 
 	return TRUE;
 }
@@ -1226,6 +1485,7 @@ _accept (NMDhcpClient *client,
 	_LOGT ("accept");
 
 	r = n_dhcp4_client_lease_accept (priv->lease);
+	_timer_update (self);
 	if (r) {
 		set_error_nettools (error, r, "failed to accept lease");
 		return FALSE;
@@ -1250,6 +1510,7 @@ decline (NMDhcpClient *client,
 	_LOGT ("dhcp4-client: decline");
 
 	r = n_dhcp4_client_lease_decline (priv->lease, error_message);
+	_timer_update (self);
 	if (r) {
 		set_error_nettools (error, r, "failed to decline lease");
 		return FALSE;
@@ -1285,7 +1546,6 @@ ip4_start (NMDhcpClient *client,
 	nm_auto (n_dhcp4_client_probe_config_freep) NDhcp4ClientProbeConfig *config = NULL;
 	NMDhcpNettools *self = NM_DHCP_NETTOOLS (client);
 	NMDhcpNettoolsPrivate *priv = NM_DHCP_NETTOOLS_GET_PRIVATE (self);
-	gs_free char *lease_file = NULL;
 	struct in_addr last_addr = { 0 };
 	const char *hostname;
 	const char *mud_url;
@@ -1308,27 +1568,27 @@ ip4_start (NMDhcpClient *client,
 	 */
 	n_dhcp4_client_probe_config_set_start_delay (config, 1);
 
-	nm_dhcp_utils_get_leasefile_path (AF_INET,
-	                                  "internal",
-	                                  nm_dhcp_client_get_iface (client),
-	                                  nm_dhcp_client_get_uuid (client),
-	                                  &lease_file);
-
 	if (last_ip4_address)
 		inet_pton (AF_INET, last_ip4_address, &last_addr);
-	else {
-		/*
-		 * TODO: we stick to the systemd-networkd lease file format. Quite easy for now to
-		 * just use the functions in systemd code. Anyway, as in the end we just use the
-		 * ip address from all the options found in the lease, write a function that parses
-		 * the lease file just for the assigned address and returns it in &last_address.
-		 * Then drop reference to systemd-networkd structures and functions.
-		 */
-		nm_auto (sd_dhcp_lease_unrefp) sd_dhcp_lease *lease = NULL;
-
-		dhcp_lease_load (&lease, lease_file);
-		if (lease)
-			sd_dhcp_lease_get_address (lease, &last_addr);
+	else if (!nm_dhcp_lease_store_lookup_ip4 (nm_dhcp_lease_store_get (),
+	                                          nm_dhcp_client_get_uuid (client),
+	                                          nm_dhcp_client_get_iface (client),
+	                                          &last_addr.s_addr)) {
+		gs_free char *lease_file = NULL;
+
+		/* Fall back to the per-interface lease file that older versions
+		 * wrote (in the systemd-networkd lease file format). */
+		if (nm_dhcp_utils_get_leasefile_path (AF_INET,
+		                                      "internal",
+		                                      nm_dhcp_client_get_iface (client),
+		                                      nm_dhcp_client_get_uuid (client),
+		                                      &lease_file)) {
+			nm_auto (sd_dhcp_lease_unrefp) sd_dhcp_lease *lease = NULL;
+
+			dhcp_lease_load (&lease, lease_file);
+			if (lease)
+				sd_dhcp_lease_get_address (lease, &last_addr);
+		}
 	}
 
 	if (last_addr.s_addr) {
@@ -1410,10 +1670,8 @@ ip4_start (NMDhcpClient *client,
 		}
 	}
 
-	g_free (priv->lease_file);
-	priv->lease_file = g_steal_pointer (&lease_file);
-
 	r = n_dhcp4_client_probe (priv->client, &priv->probe, config);
+	_timer_update (self);
 	if (r) {
 		set_error_nettools (error, r, "failed to start DHCP client");
 		return FALSE;
@@ -1438,6 +1696,7 @@ stop (NMDhcpClient *client,
 	       (gpointer) priv->client);
 
 	priv->probe = n_dhcp4_client_probe_free (priv->probe);
+	_timer_update (self);
 }
 
 /*****************************************************************************/
@@ -1445,15 +1704,18 @@ stop (NMDhcpClient *client,
 static void
 nm_dhcp_nettools_init (NMDhcpNettools *self)
 {
+	NMDhcpNettoolsPrivate *priv = NM_DHCP_NETTOOLS_GET_PRIVATE (self);
+
+	priv->timer_node = NM_DHCP_TIMER_HEAP_NODE_INIT;
 }
 
 static void
 dispose (GObject *object)
 {
-	NMDhcpNettoolsPrivate *priv = NM_DHCP_NETTOOLS_GET_PRIVATE (object);
+	NMDhcpNettools *self = NM_DHCP_NETTOOLS (object);
+	NMDhcpNettoolsPrivate *priv = NM_DHCP_NETTOOLS_GET_PRIVATE (self);
 
-	nm_clear_g_free (&priv->lease_file);
-	nm_clear_g_source_inst (&priv->event_source);
+	_dispatcher_unregister (self);
 	nm_clear_pointer (&priv->lease, n_dhcp4_client_lease_unref);
 	nm_clear_pointer (&priv->probe, n_dhcp4_client_probe_free);
 	nm_clear_pointer (&priv->client, n_dhcp4_client_unref);
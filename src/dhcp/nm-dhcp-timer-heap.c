@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#include "nm-default.h"
+
+#include "nm-dhcp-timer-heap.h"
+
+/*****************************************************************************/
+
+static guint64
+_timeout (NMDhcpTimerHeap *heap, guint idx)
+{
+	return ((NMDhcpTimerHeapNode *) heap->nodes->pdata[idx])->timeout;
+}
+
+static void
+_set (NMDhcpTimerHeap *heap, guint idx, NMDhcpTimerHeapNode *node)
+{
+	heap->nodes->pdata[idx] = node;
+	node->idx = idx;
+}
+
+static void
+_swap (NMDhcpTimerHeap *heap, guint a, guint b)
+{
+	NMDhcpTimerHeapNode *tmp = heap->nodes->pdata[a];
+
+	_set (heap, a, heap->nodes->pdata[b]);
+	_set (heap, b, tmp);
+}
+
+static void
+_sift (NMDhcpTimerHeap *heap, guint idx)
+{
+	guint len = heap->nodes->len;
+
+	while (idx > 0 && _timeout (heap, idx) < _timeout (heap, (idx - 1) / 2)) {
+		_swap (heap, idx, (idx - 1) / 2);
+		idx = (idx - 1) / 2;
+	}
+
+	while (TRUE) {
+		guint smallest = idx;
+		guint child;
+
+		child = 2 * idx + 1;
+		if (child < len && _timeout (heap, child) < _timeout (heap, smallest))
+			smallest = child;
+		child++;
+		if (child < len && _timeout (heap, child) < _timeout (heap, smallest))
+			smallest = child;
+		if (smallest == idx)
+			break;
+		_swap (heap, idx, smallest);
+		idx = smallest;
+	}
+}
+
+/*****************************************************************************/
+
+void
+nm_dhcp_timer_heap_init (NMDhcpTimerHeap *heap)
+{
+	heap->nodes = g_ptr_array_new ();
+}
+
+void
+nm_dhcp_timer_heap_destroy (NMDhcpTimerHeap *heap)
+{
+	nm_assert (!heap->nodes || heap->nodes->len == 0);
+
+	nm_clear_pointer (&heap->nodes, g_ptr_array_unref);
+}
+
+/**
+ * nm_dhcp_timer_heap_remove:
+ * @heap: the heap
+ * @node: the node to remove. It's fine if it is not in the heap.
+ */
+void
+nm_dhcp_timer_heap_remove (NMDhcpTimerHeap *heap,
+                           NMDhcpTimerHeapNode *node)
+{
+	guint idx = node->idx;
+	guint last;
+
+	if (idx == G_MAXUINT)
+		return;
+
+	nm_assert (heap->nodes->pdata[idx] == node);
+
+	node->idx = G_MAXUINT;
+	node->timeout = 0;
+	last = heap->nodes->len - 1;
+	if (idx != last)
+		_set (heap, idx, heap->nodes->pdata[last]);
+	g_ptr_array_set_size (heap->nodes, last);
+	if (idx != last)
+		_sift (heap, idx);
+}
+
+/**
+ * nm_dhcp_timer_heap_set:
+ * @heap: the heap
+ * @node: the node
+ * @timeout: the new timeout. 0 removes the node from the heap.
+ *
+ * Adds @node to the heap, or moves it to the position for its new
+ * @timeout.
+ */
+void
+nm_dhcp_timer_heap_set (NMDhcpTimerHeap *heap,
+                        NMDhcpTimerHeapNode *node,
+                        guint64 timeout)
+{
+	if (timeout == 0) {
+		nm_dhcp_timer_heap_remove (heap, node);
+		return;
+	}
+
+	node->timeout = timeout;
+	if (node->idx == G_MAXUINT) {
+		g_ptr_array_add (heap->nodes, node);
+		node->idx = heap->nodes->len - 1;
+	}
+	_sift (heap, node->idx);
+}
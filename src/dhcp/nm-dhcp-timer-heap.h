@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#ifndef __NETWORKMANAGER_DHCP_TIMER_HEAP_H__
+#define __NETWORKMANAGER_DHCP_TIMER_HEAP_H__
+
+/* A min-heap of timeouts. The nodes are embedded in the objects that own
+ * the timeouts, and know their position in the heap, so that they can be
+ * removed or re-keyed without a search. */
+
+typedef struct {
+	/* the timeout, or 0 if the node is not in the heap. */
+	guint64 timeout;
+
+	/* the position in the heap, or G_MAXUINT. */
+	guint idx;
+} NMDhcpTimerHeapNode;
+
+#define NM_DHCP_TIMER_HEAP_NODE_INIT ((NMDhcpTimerHeapNode) { .idx = G_MAXUINT, })
+
+typedef struct {
+	GPtrArray *nodes;
+} NMDhcpTimerHeap;
+
+void nm_dhcp_timer_heap_init (NMDhcpTimerHeap *heap);
+
+void nm_dhcp_timer_heap_destroy (NMDhcpTimerHeap *heap);
+
+void nm_dhcp_timer_heap_set (NMDhcpTimerHeap *heap,
+                             NMDhcpTimerHeapNode *node,
+                             guint64 timeout);
+
+void nm_dhcp_timer_heap_remove (NMDhcpTimerHeap *heap,
+                                NMDhcpTimerHeapNode *node);
+
+static inline guint
+nm_dhcp_timer_heap_get_len (const NMDhcpTimerHeap *heap)
+{
+	return heap->nodes->len;
+}
+
+/* Returns the node with the earliest timeout, or %NULL. */
+static inline NMDhcpTimerHeapNode *
+nm_dhcp_timer_heap_peek (const NMDhcpTimerHeap *heap)
+{
+	return heap->nodes->len > 0 ? heap->nodes->pdata[0] : NULL;
+}
+
+static inline gboolean
+nm_dhcp_timer_heap_node_is_linked (const NMDhcpTimerHeapNode *node)
+{
+	return node->idx != G_MAXUINT;
+}
+
+#endif /* __NETWORKMANAGER_DHCP_TIMER_HEAP_H__ */
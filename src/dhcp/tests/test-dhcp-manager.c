@@ -0,0 +1,350 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#include "nm-default.h"
+
+#include <linux/rtnetlink.h>
+#include <unistd.h>
+
+#include "nm-glib-aux/nm-dedup-multi.h"
+
+#include "dhcp/nm-dhcp-manager.h"
+#include "nm-config.h"
+#include "platform/nm-platform.h"
+
+#include "nm-test-utils-core.h"
+
+#define TEST_MAX_INFLIGHT 2
+
+/*****************************************************************************/
+
+#define NM_TYPE_DHCP_FAKE            (nm_dhcp_fake_get_type ())
+#define NM_DHCP_FAKE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), NM_TYPE_DHCP_FAKE, NMDhcpFake))
+
+typedef struct {
+	NMDhcpClient parent;
+	NMDhcpState state;
+} NMDhcpFake;
+
+typedef struct {
+	NMDhcpClientClass parent;
+} NMDhcpFakeClass;
+
+static GType nm_dhcp_fake_get_type (void);
+
+G_DEFINE_TYPE (NMDhcpFake, nm_dhcp_fake, NM_TYPE_DHCP_CLIENT)
+
+/* the clients in the order in which the manager started them. */
+static GPtrArray *fake_started;
+
+static gboolean
+ip4_start (NMDhcpClient *client,
+           const char *dhcp_anycast_addr,
+           const char *last_ip4_address,
+           GError **error)
+{
+	g_ptr_array_add (fake_started, client);
+
+	/* interfaces named "fail*" fail to start synchronously. */
+	if (g_str_has_prefix (nm_dhcp_client_get_iface (client), "fail")) {
+		nm_utils_error_set_literal (error, NM_UTILS_ERROR_UNKNOWN, "fake failure");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+_fake_state_changed (NMDhcpClient *client,
+                     NMDhcpState state,
+                     GObject *ip_config,
+                     GVariant *options,
+                     const char *event_id,
+                     gpointer user_data)
+{
+	NM_DHCP_FAKE (client)->state = state;
+}
+
+static void
+nm_dhcp_fake_init (NMDhcpFake *self)
+{
+	g_signal_connect (self, NM_DHCP_CLIENT_SIGNAL_STATE_CHANGED, G_CALLBACK (_fake_state_changed), NULL);
+}
+
+static void
+nm_dhcp_fake_class_init (NMDhcpFakeClass *klass)
+{
+	NMDhcpClientClass *client_class = NM_DHCP_CLIENT_CLASS (klass);
+
+	client_class->ip4_start = ip4_start;
+}
+
+static const NMDhcpClientFactory _fake_factory = {
+	.name     = "fake",
+	.get_type = nm_dhcp_fake_get_type,
+};
+
+/*****************************************************************************/
+
+static NMDhcpManager *
+_manager_new (void)
+{
+	NMDhcpManager *manager;
+
+	manager = g_object_new (NM_TYPE_DHCP_MANAGER, NULL);
+	nmtst_dhcp_manager_set_client_factory (manager, &_fake_factory);
+	g_ptr_array_set_size (fake_started, 0);
+	return manager;
+}
+
+static NMDhcpClient *
+_start (NMDhcpManager *manager,
+        NMDedupMultiIndex *multi_idx,
+        const char *iface,
+        int ifindex)
+{
+	const guint8 hwaddr_bin[ETH_ALEN] = { 0x00, 0x11, 0x22, 0x33, 0x44, ifindex };
+	gs_unref_bytes GBytes *hwaddr = g_bytes_new (hwaddr_bin, sizeof (hwaddr_bin));
+	gs_unref_bytes GBytes *bcast_hwaddr = g_bytes_new ((const guint8 []) { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }, ETH_ALEN);
+	gs_free_error GError *error = NULL;
+	NMDhcpClient *client;
+
+	client = nm_dhcp_manager_start_ip4 (manager,
+	                                    multi_idx,
+	                                    iface,
+	                                    ifindex,
+	                                    hwaddr,
+	                                    bcast_hwaddr,
+	                                    "c7a4d8a2-08b4-4ec3-9b3c-6a2e3c1b4c5d",
+	                                    RT_TABLE_MAIN,
+	                                    100,
+	                                    FALSE,
+	                                    NULL,
+	                                    NULL,
+	                                    NM_DHCP_HOSTNAME_FLAG_NONE,
+	                                    NULL,
+	                                    NULL,
+	                                    NM_DHCP_TIMEOUT_INFINITY,
+	                                    NULL,
+	                                    NULL,
+	                                    &error);
+	if (g_str_has_prefix (iface, "fail") && !client) {
+		g_assert (error);
+		return NULL;
+	}
+	g_assert_no_error (error);
+	g_assert (NM_IS_DHCP_CLIENT (client));
+	return client;
+}
+
+static void
+_set_bound (NMDedupMultiIndex *multi_idx, NMDhcpClient *client)
+{
+	gs_unref_object NMIP4Config *ip4_config = NULL;
+	gs_unref_hashtable GHashTable *options = NULL;
+
+	ip4_config = nm_ip4_config_new (multi_idx, nm_dhcp_client_get_ifindex (client));
+	options = g_hash_table_new (nm_str_hash, g_str_equal);
+	nm_dhcp_client_set_state (client, NM_DHCP_STATE_BOUND, NM_IP_CONFIG_CAST (ip4_config), options);
+}
+
+static void
+_iterate (guint timeout_msec)
+{
+	(void) nmtst_main_context_iterate_until (NULL, timeout_msec, FALSE);
+}
+
+/*****************************************************************************/
+
+static void
+test_start_queue (void)
+{
+	nm_auto_unref_dedup_multi_index NMDedupMultiIndex *multi_idx = nm_dedup_multi_index_new ();
+	gs_unref_object NMDhcpManager *manager = _manager_new ();
+	gs_unref_object NMDhcpClient *c1 = NULL;
+	gs_unref_object NMDhcpClient *c2 = NULL;
+	gs_unref_object NMDhcpClient *c3 = NULL;
+	gs_unref_object NMDhcpClient *c4 = NULL;
+	gs_unref_object NMDhcpClient *c5 = NULL;
+	gs_unref_object NMDhcpClient *c6 = NULL;
+	gs_unref_object NMDhcpClient *c7 = NULL;
+
+	/* the first clients start right away. */
+	c1 = _start (manager, multi_idx, "eth1", 1);
+	c2 = _start (manager, multi_idx, "eth2", 2);
+	g_assert_cmpint (fake_started->len, ==, 2);
+	g_assert (fake_started->pdata[0] == c1);
+	g_assert (fake_started->pdata[1] == c2);
+
+	/* the others wait for a free slot. */
+	c3 = _start (manager, multi_idx, "eth3", 3);
+	c4 = _start (manager, multi_idx, "eth4", 4);
+	c5 = _start (manager, multi_idx, "eth5", 5);
+	c6 = _start (manager, multi_idx, "eth6", 6);
+	_iterate (50);
+	g_assert_cmpint (fake_started->len, ==, 2);
+
+	/* a lease releases the slot. */
+	_set_bound (multi_idx, c1);
+	g_assert_cmpint (fake_started->len, ==, 3);
+	g_assert (fake_started->pdata[2] == c3);
+
+	/* so does a failure, ... */
+	nm_dhcp_client_set_state (c2, NM_DHCP_STATE_FAIL, NULL, NULL);
+	g_assert_cmpint (fake_started->len, ==, 4);
+	g_assert (fake_started->pdata[3] == c4);
+
+	/* ... a stopped client ... */
+	nm_dhcp_client_set_state (c3, NM_DHCP_STATE_DONE, NULL, NULL);
+	g_assert_cmpint (fake_started->len, ==, 5);
+	g_assert (fake_started->pdata[4] == c5);
+
+	/* ... and a client that timed out. */
+	nm_dhcp_client_set_state (c4, NM_DHCP_STATE_TIMEOUT, NULL, NULL);
+	g_assert_cmpint (fake_started->len, ==, 6);
+	g_assert (fake_started->pdata[5] == c6);
+
+	/* a renewed lease doesn't free another slot. */
+	c7 = _start (manager, multi_idx, "eth7", 7);
+	_set_bound (multi_idx, c1);
+	_iterate (50);
+	g_assert_cmpint (fake_started->len, ==, 6);
+}
+
+static void
+test_start_inflight_timeout (void)
+{
+	nm_auto_unref_dedup_multi_index NMDedupMultiIndex *multi_idx = nm_dedup_multi_index_new ();
+	gs_unref_object NMDhcpManager *manager = _manager_new ();
+	gs_unref_object NMDhcpClient *c1 = NULL;
+	gs_unref_object NMDhcpClient *c2 = NULL;
+	gs_unref_object NMDhcpClient *c3 = NULL;
+
+	nmtst_dhcp_manager_set_start_inflight_timeout (manager, 100);
+
+	c1 = _start (manager, multi_idx, "eth1", 1);
+	c2 = _start (manager, multi_idx, "eth2", 2);
+	c3 = _start (manager, multi_idx, "eth3", 3);
+	g_assert_cmpint (fake_started->len, ==, 2);
+
+	/* clients without a lease give up their slot after a while, but they
+	 * keep running. */
+	nmtst_main_context_iterate_until_assert (NULL, 5000, fake_started->len == 3);
+	g_assert (fake_started->pdata[2] == c3);
+	g_assert_cmpint (NM_DHCP_FAKE (c1)->state, ==, NM_DHCP_STATE_UNKNOWN);
+	g_assert_cmpint (NM_DHCP_FAKE (c2)->state, ==, NM_DHCP_STATE_UNKNOWN);
+}
+
+static void
+test_start_sync_failure (void)
+{
+	nm_auto_unref_dedup_multi_index NMDedupMultiIndex *multi_idx = nm_dedup_multi_index_new ();
+	gs_unref_object NMDhcpManager *manager = _manager_new ();
+	gs_unref_object NMDhcpClient *c1 = NULL;
+	gs_unref_object NMDhcpClient *c2 = NULL;
+	gs_unref_object NMDhcpClient *c3 = NULL;
+	gs_unref_object NMDhcpClient *f1 = NULL;
+	gs_unref_object NMDhcpClient *f2 = NULL;
+
+	/* a client that is started right away reports the failure to the
+	 * caller, and doesn't keep the slot. */
+	c1 = _start (manager, multi_idx, "eth1", 1);
+	g_assert (!_start (manager, multi_idx, "fail0", 10));
+	g_assert_cmpint (fake_started->len, ==, 2);
+	c2 = _start (manager, multi_idx, "eth2", 2);
+	g_assert_cmpint (fake_started->len, ==, 3);
+	g_assert (fake_started->pdata[2] == c2);
+
+	f1 = _start (manager, multi_idx, "fail1", 11);
+	f2 = _start (manager, multi_idx, "fail2", 12);
+	c3 = _start (manager, multi_idx, "eth3", 3);
+	g_assert_cmpint (fake_started->len, ==, 3);
+
+	/* the failing clients release their slot while the queue is processed.
+	 * The next clients start, until one succeeds. */
+	NMTST_EXPECT_NM_WARN ("*fail1*failure to start DHCP*");
+	NMTST_EXPECT_NM_WARN ("*fail2*failure to start DHCP*");
+	_set_bound (multi_idx, c1);
+	g_test_assert_expected_messages ();
+	g_assert_cmpint (fake_started->len, ==, 6);
+	g_assert (fake_started->pdata[3] == f1);
+	g_assert (fake_started->pdata[4] == f2);
+	g_assert (fake_started->pdata[5] == c3);
+	g_assert_cmpint (NM_DHCP_FAKE (f1)->state, ==, NM_DHCP_STATE_FAIL);
+	g_assert_cmpint (NM_DHCP_FAKE (f2)->state, ==, NM_DHCP_STATE_FAIL);
+	g_assert_cmpint (NM_DHCP_FAKE (c3)->state, ==, NM_DHCP_STATE_UNKNOWN);
+
+	/* c2 and c3 hold the slots. */
+	_iterate (50);
+	g_assert_cmpint (fake_started->len, ==, 6);
+}
+
+/*****************************************************************************/
+
+static void
+_setup_config (const char *config_file)
+{
+	const char *const argv_data[] = {
+		"test-dhcp-manager",
+		"--config", config_file,
+		"--config-dir", "/no/such/dir",
+		"--system-config-dir", "",
+		"--intern-config", "",
+		NULL,
+	};
+	gs_strfreev char **argv = g_strdupv ((char **) argv_data);
+	GOptionContext *context;
+	NMConfigCmdLineOptions *cli;
+	GError *error = NULL;
+	gboolean success;
+
+	cli = nm_config_cmd_line_options_new (FALSE);
+
+	context = g_option_context_new (NULL);
+	nm_config_cmd_line_options_add_to_entries (cli, context);
+	success = g_option_context_parse_strv (context, &argv, &error);
+	g_option_context_free (context);
+	g_assert_no_error (error);
+	g_assert (success);
+
+	nm_config_setup (cli, NULL, &error);
+	g_assert_no_error (error);
+	nm_config_cmd_line_options_free (cli);
+}
+
+NMTST_DEFINE ();
+
+int main (int argc, char **argv)
+{
+	gs_free char *config_file = NULL;
+	GError *error = NULL;
+	int fd;
+	int r;
+
+	nmtst_init_assert_logging (&argc, &argv, "WARN", "DEFAULT");
+
+	fd = g_file_open_tmp ("test-dhcp-manager-XXXXXX.conf", &config_file, &error);
+	g_assert_no_error (error);
+	nm_close (fd);
+	g_file_set_contents (config_file,
+	                     "[main]\n"
+	                     "dhcp=internal\n"
+	                     "dhcp-start-max-inflight="G_STRINGIFY (TEST_MAX_INFLIGHT)"\n",
+	                     -1,
+	                     &error);
+	g_assert_no_error (error);
+	_setup_config (config_file);
+
+	fake_started = g_ptr_array_new ();
+
+	g_test_add_func ("/dhcp/manager/start-queue", test_start_queue);
+	g_test_add_func ("/dhcp/manager/start-inflight-timeout", test_start_inflight_timeout);
+	g_test_add_func ("/dhcp/manager/start-sync-failure", test_start_sync_failure);
+
+	r = g_test_run ();
+
+	unlink (config_file);
+	g_ptr_array_unref (fake_started);
+	return r;
+}
@@ -8,11 +8,15 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <linux/rtnetlink.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "nm-glib-aux/nm-dedup-multi.h"
 #include "nm-utils.h"
 
 #include "dhcp/nm-dhcp-utils.h"
+#include "dhcp/nm-dhcp-lease-store.h"
+#include "dhcp/nm-dhcp-timer-heap.h"
 #include "platform/nm-platform.h"
 
 #include "nm-test-utils-core.h"
@@ -759,6 +763,211 @@ test_client_id_from_string (void)
 	COMPARE_ID (endcolon, TRUE, endcolon, strlen (endcolon));
 }
 
+static gsize
+_file_size (const char *path)
+{
+	struct stat st;
+
+	g_assert_cmpint (stat (path, &st), ==, 0);
+	return st.st_size;
+}
+
+static void
+_lease_store_check (const char *path, guint n, guint changed)
+{
+	gs_unref_object NMDhcpLeaseStore *store = NULL;
+	guint i;
+
+	store = nm_dhcp_lease_store_new (path, NULL);
+	for (i = 0; i < n; i++) {
+		char iface[NMP_IFNAMSIZ];
+		in_addr_t addr;
+		gboolean found;
+
+		nm_sprintf_buf (iface, "mvtap%u", i);
+		found = nm_dhcp_lease_store_lookup_ip4 (store, "uuid", iface, &addr);
+		if (i == 0)
+			g_assert (!found);
+		else {
+			g_assert (found);
+			g_assert_cmpint (addr, ==, htonl (0x0a000000 + i + (i == changed ? 1000 : 0)));
+		}
+	}
+}
+
+static void
+test_lease_store (void)
+{
+	nmtst_auto_unlinkfile char *path = g_strdup ("test-dhcp-lease-store.db");
+	gs_unref_object NMDhcpLeaseStore *store = NULL;
+	const guint N = 100;
+	gsize size;
+	guint i;
+	FILE *f;
+
+	unlink (path);
+
+	store = nm_dhcp_lease_store_new (path, NULL);
+	for (i = 0; i < N; i++) {
+		char iface[NMP_IFNAMSIZ];
+
+		nm_sprintf_buf (iface, "mvtap%u", i);
+		nm_dhcp_lease_store_set_ip4 (store, "uuid", iface, htonl (0x0a000000 + i));
+	}
+	nm_dhcp_lease_store_set_ip4 (store, "uuid", "mvtap0", INADDR_ANY);
+	nm_dhcp_lease_store_flush (store);
+	size = _file_size (path);
+
+	/* renewing with the same address does not write. */
+	nm_dhcp_lease_store_set_ip4 (store, "uuid", "mvtap7", htonl (0x0a000000 + 7));
+	nm_dhcp_lease_store_flush (store);
+	g_assert_cmpint (_file_size (path), ==, size);
+
+	/* a change is appended when the store goes away. */
+	nm_dhcp_lease_store_set_ip4 (store, "uuid", "mvtap7", htonl (0x0a000000 + 7 + 1000));
+	g_clear_object (&store);
+	g_assert_cmpint (_file_size (path), >, size);
+
+	_lease_store_check (path, N, 7);
+
+	/* an interrupted write leaves a truncated record, which is ignored. */
+	f = fopen (path, "a");
+	g_assert (f);
+	g_assert_cmpint (fwrite ("\001\000\000", 1, 3, f), ==, 3);
+	fclose (f);
+
+	_lease_store_check (path, N, 7);
+
+	/* ... and the next flush rewrites the file. */
+	store = nm_dhcp_lease_store_new (path, NULL);
+	nm_dhcp_lease_store_set_ip4 (store, "uuid", "mvtap7", htonl (0x0a000000 + 7));
+	nm_dhcp_lease_store_flush (store);
+	g_clear_object (&store);
+
+	_lease_store_check (path, N, G_MAXUINT);
+}
+
+static void
+test_lease_store_migrate (void)
+{
+	nmtst_auto_unlinkfile char *path = g_strdup ("test-dhcp-lease-store-migrate.db");
+	nmtst_auto_unlinkfile char *migrate_path = g_strdup ("test-dhcp-lease-store-migrate-initrd.db");
+	gs_unref_object NMDhcpLeaseStore *store = NULL;
+	in_addr_t addr;
+
+	unlink (path);
+	unlink (migrate_path);
+
+	store = nm_dhcp_lease_store_new (path, NULL);
+	nm_dhcp_lease_store_set_ip4 (store, "uuid", "eth0", htonl (0x0a000001));
+	nm_dhcp_lease_store_set_ip4 (store, "uuid", "eth1", htonl (0x0a000002));
+	g_clear_object (&store);
+
+	/* the leases that were written in the initrd. */
+	store = nm_dhcp_lease_store_new (migrate_path, NULL);
+	nm_dhcp_lease_store_set_ip4 (store, "uuid", "eth1", htonl (0x0a000012));
+	nm_dhcp_lease_store_set_ip4 (store, "uuid", "eth2", htonl (0x0a000013));
+	g_clear_object (&store);
+
+	/* they are taken over, and win over the older ones. */
+	store = nm_dhcp_lease_store_new (path, migrate_path);
+	g_assert (nm_dhcp_lease_store_lookup_ip4 (store, "uuid", "eth0", &addr));
+	g_assert_cmpint (addr, ==, htonl (0x0a000001));
+	g_assert (nm_dhcp_lease_store_lookup_ip4 (store, "uuid", "eth1", &addr));
+	g_assert_cmpint (addr, ==, htonl (0x0a000012));
+	g_assert (nm_dhcp_lease_store_lookup_ip4 (store, "uuid", "eth2", &addr));
+	g_assert_cmpint (addr, ==, htonl (0x0a000013));
+	g_clear_object (&store);
+
+	/* the initrd file is gone, and the merged leases are persisted. */
+	g_assert (!g_file_test (migrate_path, G_FILE_TEST_EXISTS));
+
+	store = nm_dhcp_lease_store_new (path, migrate_path);
+	g_assert (nm_dhcp_lease_store_lookup_ip4 (store, "uuid", "eth1", &addr));
+	g_assert_cmpint (addr, ==, htonl (0x0a000012));
+	g_assert (nm_dhcp_lease_store_lookup_ip4 (store, "uuid", "eth2", &addr));
+	g_assert_cmpint (addr, ==, htonl (0x0a000013));
+}
+
+static void
+_timer_heap_check (NMDhcpTimerHeap *heap, NMDhcpTimerHeapNode *nodes, guint n_nodes)
+{
+	guint n_linked = 0;
+	guint i;
+
+	for (i = 0; i < nm_dhcp_timer_heap_get_len (heap); i++) {
+		NMDhcpTimerHeapNode *node = heap->nodes->pdata[i];
+
+		g_assert_cmpint (node->idx, ==, i);
+		g_assert_cmpint (node->timeout, >, 0);
+		if (i > 0)
+			g_assert_cmpint (((NMDhcpTimerHeapNode *) heap->nodes->pdata[(i - 1) / 2])->timeout, <=, node->timeout);
+	}
+
+	for (i = 0; i < n_nodes; i++) {
+		if (nm_dhcp_timer_heap_node_is_linked (&nodes[i])) {
+			g_assert (heap->nodes->pdata[nodes[i].idx] == &nodes[i]);
+			n_linked++;
+		} else
+			g_assert_cmpint (nodes[i].timeout, ==, 0);
+	}
+	g_assert_cmpint (n_linked, ==, nm_dhcp_timer_heap_get_len (heap));
+}
+
+static void
+test_timer_heap (void)
+{
+	NMDhcpTimerHeapNode nodes[50];
+	NMDhcpTimerHeap heap;
+	guint64 last;
+	guint i;
+
+	nm_dhcp_timer_heap_init (&heap);
+	for (i = 0; i < G_N_ELEMENTS (nodes); i++)
+		nodes[i] = NM_DHCP_TIMER_HEAP_NODE_INIT;
+
+	g_assert (!nm_dhcp_timer_heap_peek (&heap));
+
+	/* insert */
+	for (i = 0; i < G_N_ELEMENTS (nodes); i++) {
+		nm_dhcp_timer_heap_set (&heap, &nodes[i], 1 + nmtst_get_rand_uint32 () % 1000);
+		_timer_heap_check (&heap, nodes, G_N_ELEMENTS (nodes));
+	}
+
+	/* remove from the middle, twice */
+	for (i = 0; i < 10; i++) {
+		NMDhcpTimerHeapNode *node = heap.nodes->pdata[nm_dhcp_timer_heap_get_len (&heap) / 2];
+
+		nm_dhcp_timer_heap_remove (&heap, node);
+		g_assert (!nm_dhcp_timer_heap_node_is_linked (node));
+		nm_dhcp_timer_heap_remove (&heap, node);
+		_timer_heap_check (&heap, nodes, G_N_ELEMENTS (nodes));
+	}
+
+	/* re-key, to earlier and later timeouts, or to 0 which removes */
+	for (i = 0; i < G_N_ELEMENTS (nodes); i++) {
+		nm_dhcp_timer_heap_set (&heap, &nodes[i], nmtst_get_rand_uint32 () % 2000);
+		_timer_heap_check (&heap, nodes, G_N_ELEMENTS (nodes));
+	}
+	nm_dhcp_timer_heap_set (&heap, &nodes[3], 1);
+	g_assert (nm_dhcp_timer_heap_peek (&heap) == &nodes[3]);
+
+	/* the nodes come out in order */
+	last = 0;
+	while (nm_dhcp_timer_heap_peek (&heap)) {
+		NMDhcpTimerHeapNode *node = nm_dhcp_timer_heap_peek (&heap);
+
+		g_assert_cmpint (node->timeout, >=, last);
+		last = node->timeout;
+		nm_dhcp_timer_heap_remove (&heap, node);
+		_timer_heap_check (&heap, nodes, G_N_ELEMENTS (nodes));
+	}
+
+	nm_dhcp_timer_heap_destroy (&heap);
+}
+
+/*****************************************************************************/
+
 NMTST_DEFINE ();
 
 int main (int argc, char **argv)
@@ -787,6 +996,9 @@ int main (int argc, char **argv)
 	g_test_add_func ("/dhcp/client-id-from-string", test_client_id_from_string);
 	g_test_add_func ("/dhcp/vendor-option-metered", test_vendor_option_metered);
 	g_test_add_func ("/dhcp/parse-search-list", test_parse_search_list);
+	g_test_add_func ("/dhcp/lease-store", test_lease_store);
+	g_test_add_func ("/dhcp/lease-store-migrate", test_lease_store_migrate);
+	g_test_add_func ("/dhcp/timer-heap", test_timer_heap);
 
 	return g_test_run ();
 }
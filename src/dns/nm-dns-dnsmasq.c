@@ -643,6 +643,9 @@ typedef struct {
 
 	GVariant *set_server_ex_args;
 
+	/* the arguments of the last SetServersEx call to the current name owner. */
+	GVariant *set_server_ex_args_sent;
+
 	GCancellable *update_cancellable;
 
 	GCancellable *main_cancellable;
@@ -696,9 +699,6 @@ add_dnsmasq_nameserver (NMDnsDnsmasq *self,
 {
 	g_return_if_fail (ip);
 
-	_LOGD ("adding nameserver '%s'%s%s%s", ip,
-	       NM_PRINT_FMT_QUOTED (domain, " for domain \"", domain, "\"", ""));
-
 	g_variant_builder_open (servers, G_VARIANT_TYPE ("as"));
 
 	g_variant_builder_add (servers, "s", ip);
@@ -827,6 +827,27 @@ create_update_args (NMDnsDnsmasq *self,
 	return g_variant_new ("(aas)", &servers);
 }
 
+static void
+_log_update_args (NMDnsDnsmasq *self, GVariant *args)
+{
+	gs_unref_variant GVariant *servers = NULL;
+	GVariantIter iter;
+	const char **strv;
+
+	if (!_LOGD_ENABLED ())
+		return;
+
+	servers = g_variant_get_child_value (args, 0);
+	g_variant_iter_init (&iter, servers);
+	while (g_variant_iter_next (&iter, "^a&s", &strv)) {
+		const char *domain = strv[0] ? strv[1] : NULL;
+
+		_LOGD ("adding nameserver '%s'%s%s%s", strv[0] ?: "",
+		       NM_PRINT_FMT_QUOTED (domain, " for domain \"", domain, "\"", ""));
+		g_free (strv);
+	}
+}
+
 /*****************************************************************************/
 
 static void
@@ -842,9 +863,12 @@ dnsmasq_update_done (GObject *source_object, GAsyncResult *res, gpointer user_da
 		return;
 
 	self = user_data;
-	if (!response)
+	if (!response) {
 		_LOGW ("dnsmasq update failed: %s", error->message);
-	else
+		/* we don't know what dnsmasq has now. Send the next update
+		 * even if it is the same. */
+		nm_clear_pointer (&NM_DNS_DNSMASQ_GET_PRIVATE (self)->set_server_ex_args_sent, g_variant_unref);
+	} else
 		_LOGD ("dnsmasq update successful");
 }
 
@@ -857,11 +881,21 @@ send_dnsmasq_update (NMDnsDnsmasq *self)
 	    || !priv->set_server_ex_args)
 	    return;
 
+	if (   priv->set_server_ex_args_sent
+	    && g_variant_equal (priv->set_server_ex_args_sent, priv->set_server_ex_args)) {
+		_LOGD ("dnsmasq nameservers are unchanged");
+		return;
+	}
+
 	_LOGD ("trying to update dnsmasq nameservers");
+	_log_update_args (self, priv->set_server_ex_args);
 
 	nm_clear_g_cancellable (&priv->update_cancellable);
 	priv->update_cancellable = g_cancellable_new ();
 
+	nm_clear_pointer (&priv->set_server_ex_args_sent, g_variant_unref);
+	priv->set_server_ex_args_sent = g_variant_ref (priv->set_server_ex_args);
+
 	g_dbus_connection_call (priv->dbus_connection,
 	                        priv->name_owner,
 	                        DNSMASQ_DBUS_PATH,
@@ -888,6 +922,7 @@ _main_cleanup (NMDnsDnsmasq *self, gboolean emit_failed)
 
 	priv->process_pid = 0;
 	nm_clear_g_free (&priv->name_owner);
+	nm_clear_pointer (&priv->set_server_ex_args_sent, g_variant_unref);
 
 	nm_clear_g_dbus_connection_signal (priv->dbus_connection,
 	                                   &priv->name_owner_changed_id);
@@ -919,6 +954,7 @@ name_owner_changed (NMDnsDnsmasq *self,
 
 	g_free (priv->name_owner);
 	priv->name_owner = g_strdup (name_owner);
+	nm_clear_pointer (&priv->set_server_ex_args_sent, g_variant_unref);
 
 	if (!name_owner) {
 		_LOGT ("D-Bus name for dnsmasq disappeared");
@@ -1105,15 +1141,20 @@ update (NMDnsPlugin *plugin,
 {
 	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (plugin);
 	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	gs_unref_variant GVariant *args = NULL;
 
 	if (!start_dnsmasq (self, TRUE, error))
 		return FALSE;
 
-	nm_clear_pointer (&priv->set_server_ex_args, g_variant_unref);
-	priv->set_server_ex_args = g_variant_ref_sink (create_update_args (self,
-	                                                                   global_config,
-	                                                                   ip_config_lst_head,
-	                                                                   hostname));
+	args = g_variant_ref_sink (create_update_args (self,
+	                                               global_config,
+	                                               ip_config_lst_head,
+	                                               hostname));
+	if (   !priv->set_server_ex_args
+	    || !g_variant_equal (priv->set_server_ex_args, args)) {
+		nm_clear_pointer (&priv->set_server_ex_args, g_variant_unref);
+		priv->set_server_ex_args = g_steal_pointer (&args);
+	}
 
 	send_dnsmasq_update (self);
 	return TRUE;
@@ -1162,6 +1203,7 @@ dispose (GObject *object)
 	_main_cleanup (self, FALSE);
 
 	nm_clear_pointer (&priv->set_server_ex_args, g_variant_unref);
+	nm_clear_pointer (&priv->set_server_ex_args_sent, g_variant_unref);
 
 	G_OBJECT_CLASS (nm_dns_dnsmasq_parent_class)->dispose (object);
 
@@ -0,0 +1,1105 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#include "nm-default.h"
+
+#include "nm-dns-forwarder.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "nm-std-aux/unaligned.h"
+#include "nm-glib-aux/nm-random-utils.h"
+#include "nm-ip4-config.h"
+#include "nm-ip6-config.h"
+#include "NetworkManagerUtils.h"
+
+/* A minimal caching DNS forwarder that runs inside NetworkManager.
+ *
+ * It listens for UDP queries on 127.0.0.1, port 53, and forwards them to the
+ * name servers of the connection whose DNS domain matches best (split DNS).
+ * Answers are kept in a LRU cache for their TTL. Negative answers
+ * (NXDOMAIN and NODATA) are cached for the TTL of the SOA record in their
+ * authority section (RFC 2308).
+ *
+ * It does not support TCP, so truncated answers are passed on to the client,
+ * but not cached. */
+
+#define DNS_PORT                    53
+
+#define DNS_HEADER_LEN              12
+/* the maximum payload of a UDP datagram. With EDNS0, the client may
+ * advertise a buffer of up to that size, and the upstream server may
+ * answer with that much. */
+#define DNS_MSG_MAX_LEN             65535
+
+#define DNS_FLAG_QR                 0x8000
+#define DNS_FLAG_TC                 0x0200
+#define DNS_FLAG_RD                 0x0100
+#define DNS_FLAG_RA                 0x0080
+#define DNS_RCODE_MASK              0x000F
+
+#define DNS_RCODE_NOERROR           0
+#define DNS_RCODE_SERVFAIL          2
+#define DNS_RCODE_NXDOMAIN          3
+#define DNS_RCODE_REFUSED           5
+
+#define DNS_TYPE_SOA                6
+#define DNS_TYPE_OPT                41
+
+#define QUERY_TIMEOUT_MSEC          2000
+#define PENDING_QUERIES_MAX         512
+
+#define CACHE_SIZE_MAX              2048
+#define CACHE_MSG_MAX_LEN           4096
+#define CACHE_TTL_MAX               86400
+#define CACHE_NEGATIVE_TTL_MAX      900
+
+#define _NMLOG_DOMAIN      LOGD_DNS
+
+/*****************************************************************************/
+
+typedef union {
+	struct sockaddr sa;
+	struct sockaddr_in in;
+	struct sockaddr_in6 in6;
+} SockAddr;
+
+typedef struct {
+	CList lru_lst;
+	char *key;
+	guint8 *msg;
+	gsize msg_len;
+	gsize question_end;
+	gint64 stored_at;
+	gint64 expires_at;
+} CacheEntry;
+
+typedef struct {
+	NMDnsForwarder *self;
+	GArray *servers;
+	GSource *timeout_source;
+	char *key;
+	guint8 *query;
+	gsize query_len;
+	gsize question_end;
+	SockAddr client;
+	socklen_t client_len;
+	guint server_idx;
+	guint16 id;
+	guint16 client_id;
+} PendingQuery;
+
+typedef struct {
+	/* domain name ("" for the default) to a GArray of SockAddr. */
+	GHashTable *domains;
+
+	GHashTable *cache;
+	CList cache_lru_lst_head;
+
+	/* the ID of the forwarded query to PendingQuery. */
+	GHashTable *pending;
+
+	guint8 *recv_buf;
+
+	GSource *listen_source;
+	GSource *upstream_source_4;
+	GSource *upstream_source_6;
+
+	int listen_fd;
+	int upstream_fd_4;
+	int upstream_fd_6;
+
+	guint cache_size_max;
+
+	guint16 listen_port;
+	guint16 upstream_port;
+
+	guint64 n_cache_hits;
+	guint64 n_cache_misses;
+} NMDnsForwarderPrivate;
+
+struct _NMDnsForwarder {
+	NMDnsPlugin parent;
+	NMDnsForwarderPrivate _priv;
+};
+
+struct _NMDnsForwarderClass {
+	NMDnsPluginClass parent;
+};
+
+G_DEFINE_TYPE (NMDnsForwarder, nm_dns_forwarder, NM_TYPE_DNS_PLUGIN)
+
+#define NM_DNS_FORWARDER_GET_PRIVATE(self) _NM_GET_PRIVATE (self, NMDnsForwarder, NM_IS_DNS_FORWARDER)
+
+/*****************************************************************************/
+
+#define _NMLOG(level, ...) __NMLOG_DEFAULT_WITH_ADDR (level, _NMLOG_DOMAIN, "dns-forwarder", __VA_ARGS__)
+
+/*****************************************************************************/
+
+static gboolean
+_dns_name_read (const guint8 *msg,
+                gsize msg_len,
+                gsize *p_offset,
+                GString *name)
+{
+	gsize offset = *p_offset;
+	gboolean jumped = FALSE;
+	guint n_jumps = 0;
+
+	while (TRUE) {
+		guint8 l;
+
+		if (offset >= msg_len)
+			return FALSE;
+
+		l = msg[offset];
+		if ((l & 0xC0) == 0xC0) {
+			/* compression pointer */
+			if (offset + 1 >= msg_len)
+				return FALSE;
+			if (!jumped)
+				*p_offset = offset + 2;
+			jumped = TRUE;
+			if (++n_jumps > 32)
+				return FALSE;
+			offset = ((gsize) (l & 0x3F) << 8) | msg[offset + 1];
+			continue;
+		}
+		if (l & 0xC0)
+			return FALSE;
+
+		offset++;
+		if (l == 0) {
+			if (!jumped)
+				*p_offset = offset;
+			return TRUE;
+		}
+
+		if (offset + l > msg_len)
+			return FALSE;
+
+		if (name) {
+			guint i;
+
+			if (name->len > 0)
+				g_string_append_c (name, '.');
+			for (i = 0; i < l; i++)
+				g_string_append_c (name, g_ascii_tolower (msg[offset + i]));
+			if (name->len > 255)
+				return FALSE;
+		}
+		offset += l;
+	}
+}
+
+/* Parses the single question of @msg and returns the cache key for it. */
+static char *
+_dns_msg_parse_question (const guint8 *msg,
+                         gsize msg_len,
+                         char **out_name,
+                         gsize *out_question_end)
+{
+	nm_auto_free_gstring GString *name = NULL;
+	gsize offset = DNS_HEADER_LEN;
+	guint16 qtype;
+	guint16 qclass;
+
+	if (msg_len < DNS_HEADER_LEN)
+		return NULL;
+	if (unaligned_read_be16 (&msg[4]) != 1)
+		return NULL;
+
+	name = g_string_sized_new (64);
+	if (!_dns_name_read (msg, msg_len, &offset, name))
+		return NULL;
+	if (offset + 4 > msg_len)
+		return NULL;
+
+	qtype = unaligned_read_be16 (&msg[offset]);
+	qclass = unaligned_read_be16 (&msg[offset + 2]);
+
+	NM_SET_OUT (out_question_end, offset + 4);
+	NM_SET_OUT (out_name, g_strdup (name->str));
+	return g_strdup_printf ("%u/%u/%s", (guint) qclass, (guint) qtype, name->str);
+}
+
+typedef struct {
+	gsize ttl_offset;
+	gsize rdata_offset;
+	guint32 ttl;
+	guint16 type;
+	guint16 rdlength;
+} DnsRR;
+
+static gboolean
+_dns_rr_next (const guint8 *msg,
+              gsize msg_len,
+              gsize *p_offset,
+              DnsRR *rr)
+{
+	gsize offset = *p_offset;
+
+	if (!_dns_name_read (msg, msg_len, &offset, NULL))
+		return FALSE;
+	if (offset + 10 > msg_len)
+		return FALSE;
+
+	rr->type = unaligned_read_be16 (&msg[offset]);
+	rr->ttl_offset = offset + 4;
+	rr->ttl = unaligned_read_be32 (&msg[offset + 4]);
+	rr->rdlength = unaligned_read_be16 (&msg[offset + 8]);
+	rr->rdata_offset = offset + 10;
+	if (rr->rdata_offset + rr->rdlength > msg_len)
+		return FALSE;
+
+	*p_offset = rr->rdata_offset + rr->rdlength;
+	return TRUE;
+}
+
+/* Returns whether the answer @msg can be cached, and for how long. */
+static gboolean
+_dns_msg_get_cache_ttl (const guint8 *msg,
+                        gsize msg_len,
+                        gsize question_end,
+                        guint32 *out_ttl)
+{
+	guint16 flags;
+	guint16 n_an;
+	guint16 n_ns;
+	gsize offset = question_end;
+	guint32 ttl = G_MAXUINT32;
+	guint rcode;
+	guint i;
+	DnsRR rr;
+
+	flags = unaligned_read_be16 (&msg[2]);
+	if (NM_FLAGS_HAS (flags, DNS_FLAG_TC))
+		return FALSE;
+
+	rcode = flags & DNS_RCODE_MASK;
+	n_an = unaligned_read_be16 (&msg[6]);
+	n_ns = unaligned_read_be16 (&msg[8]);
+
+	if (   rcode == DNS_RCODE_NOERROR
+	    && n_an > 0) {
+		for (i = 0; i < (guint) n_an + n_ns; i++) {
+			if (!_dns_rr_next (msg, msg_len, &offset, &rr))
+				return FALSE;
+			if (rr.type != DNS_TYPE_OPT)
+				ttl = NM_MIN (ttl, rr.ttl);
+		}
+		ttl = NM_MIN (ttl, (guint32) CACHE_TTL_MAX);
+	} else if (NM_IN_SET (rcode, DNS_RCODE_NOERROR, DNS_RCODE_NXDOMAIN)) {
+		/* a negative answer. Without SOA record, we must not cache it. */
+		for (i = 0; i < (guint) n_an + n_ns; i++) {
+			if (!_dns_rr_next (msg, msg_len, &offset, &rr))
+				return FALSE;
+			if (   i >= n_an
+			    && rr.type == DNS_TYPE_SOA
+			    && rr.rdlength >= 22) {
+				guint32 minimum;
+
+				minimum = unaligned_read_be32 (&msg[rr.rdata_offset + rr.rdlength - 4]);
+				ttl = NM_MIN (ttl, NM_MIN (rr.ttl, minimum));
+			}
+		}
+		if (ttl == G_MAXUINT32)
+			return FALSE;
+		ttl = NM_MIN (ttl, (guint32) CACHE_NEGATIVE_TTL_MAX);
+	} else
+		return FALSE;
+
+	if (ttl == 0)
+		return FALSE;
+
+	*out_ttl = ttl;
+	return TRUE;
+}
+
+/* Reduces the TTLs in @msg by @age seconds. */
+static void
+_dns_msg_age_ttls (guint8 *msg,
+                   gsize msg_len,
+                   gsize question_end,
+                   guint32 age)
+{
+	gsize offset = question_end;
+	guint n;
+	guint i;
+	DnsRR rr;
+
+	if (age == 0)
+		return;
+
+	n =   (guint) unaligned_read_be16 (&msg[6])
+	    + (guint) unaligned_read_be16 (&msg[8])
+	    + (guint) unaligned_read_be16 (&msg[10]);
+	for (i = 0; i < n; i++) {
+		if (!_dns_rr_next (msg, msg_len, &offset, &rr))
+			return;
+		if (rr.type == DNS_TYPE_OPT)
+			continue;
+		unaligned_write_be32 (&msg[rr.ttl_offset],
+		                      rr.ttl > age ? rr.ttl - age : 0);
+	}
+}
+
+/*****************************************************************************/
+
+static gboolean
+_sock_addr_equal (const SockAddr *a, const SockAddr *b)
+{
+	if (a->sa.sa_family != b->sa.sa_family)
+		return FALSE;
+	if (a->sa.sa_family == AF_INET) {
+		return    a->in.sin_port == b->in.sin_port
+		       && a->in.sin_addr.s_addr == b->in.sin_addr.s_addr;
+	}
+	return    a->in6.sin6_port == b->in6.sin6_port
+	       && IN6_ARE_ADDR_EQUAL (&a->in6.sin6_addr, &b->in6.sin6_addr);
+}
+
+static socklen_t
+_sock_addr_len (const SockAddr *addr)
+{
+	return   addr->sa.sa_family == AF_INET
+	       ? sizeof (struct sockaddr_in)
+	       : sizeof (struct sockaddr_in6);
+}
+
+static void
+_servers_add (NMDnsForwarder *self,
+              GHashTable *domains,
+              const char *domain,
+              int addr_family,
+              gconstpointer addr,
+              int ifindex)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+	gs_free char *domain_down = NULL;
+	SockAddr server = { };
+	GArray *servers;
+	guint i;
+
+	/* names in queries are lowercased before the lookup. DNS names are case
+	 * insensitive, so also lowercase the configured domains. */
+	domain = (domain_down = g_ascii_strdown (domain, -1));
+
+	if (addr_family == AF_INET) {
+		server.in.sin_family = AF_INET;
+		server.in.sin_port = htons (priv->upstream_port);
+		server.in.sin_addr.s_addr = *((const in_addr_t *) addr);
+	} else if (IN6_IS_ADDR_V4MAPPED (addr)) {
+		server.in.sin_family = AF_INET;
+		server.in.sin_port = htons (priv->upstream_port);
+		server.in.sin_addr.s_addr = ((const struct in6_addr *) addr)->s6_addr32[3];
+	} else {
+		server.in6.sin6_family = AF_INET6;
+		server.in6.sin6_port = htons (priv->upstream_port);
+		server.in6.sin6_addr = *((const struct in6_addr *) addr);
+		if (IN6_IS_ADDR_LINKLOCAL (addr))
+			server.in6.sin6_scope_id = ifindex;
+	}
+
+	servers = g_hash_table_lookup (domains, domain);
+	if (!servers) {
+		servers = g_array_new (FALSE, FALSE, sizeof (SockAddr));
+		g_hash_table_insert (domains, g_strdup (domain), servers);
+	}
+
+	for (i = 0; i < servers->len; i++) {
+		if (_sock_addr_equal (&g_array_index (servers, SockAddr, i), &server))
+			return;
+	}
+	g_array_append_val (servers, server);
+}
+
+static GHashTable *
+_servers_build (NMDnsForwarder *self,
+                const NMGlobalDnsConfig *global_config,
+                const CList *ip_config_lst_head)
+{
+	GHashTable *domains;
+	const NMDnsIPConfigData *ip_data;
+	guint i;
+	guint j;
+
+	domains = g_hash_table_new_full (nm_str_hash, g_str_equal, g_free, (GDestroyNotify) g_array_unref);
+
+	if (global_config) {
+		for (i = 0; i < nm_global_dns_config_get_num_domains (global_config); i++) {
+			NMGlobalDnsDomain *domain = nm_global_dns_config_get_domain (global_config, i);
+			const char *const*servers = nm_global_dns_domain_get_servers (domain);
+			const char *name = nm_global_dns_domain_get_name (domain);
+
+			for (j = 0; servers && servers[j]; j++) {
+				NMIPAddr addr;
+				int addr_family;
+
+				if (!nm_utils_parse_inaddr_bin (AF_UNSPEC, servers[j], &addr_family, &addr))
+					continue;
+				_servers_add (self,
+				              domains,
+				              nm_streq (name, "*") ? "" : name,
+				              addr_family,
+				              &addr,
+				              0);
+			}
+		}
+		return domains;
+	}
+
+	c_list_for_each_entry (ip_data, ip_config_lst_head, ip_config_lst) {
+		NMIPConfig *ip_config = ip_data->ip_config;
+		int addr_family = nm_ip_config_get_addr_family (ip_config);
+		guint num;
+
+		num = nm_ip_config_get_num_nameservers (ip_config);
+		if (   num == 0
+		    || !ip_data->domains.search)
+			continue;
+
+		for (i = 0; i < num; i++) {
+			const NMIPAddr *addr = nm_ip_config_get_nameserver (ip_config, i);
+
+			for (j = 0; ip_data->domains.search[j]; j++) {
+				_servers_add (self,
+				              domains,
+				              nm_utils_parse_dns_domain (ip_data->domains.search[j], NULL),
+				              addr_family,
+				              addr,
+				              ip_data->data->ifindex);
+			}
+			for (j = 0; ip_data->domains.reverse && ip_data->domains.reverse[j]; j++) {
+				_servers_add (self,
+				              domains,
+				              ip_data->domains.reverse[j],
+				              addr_family,
+				              addr,
+				              ip_data->data->ifindex);
+			}
+		}
+	}
+
+	return domains;
+}
+
+/* Finds the servers for the longest domain that matches @name. */
+static GArray *
+_servers_lookup (NMDnsForwarder *self, const char *name)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+	GArray *servers;
+
+	if (!priv->domains)
+		return NULL;
+
+	while (TRUE) {
+		servers = g_hash_table_lookup (priv->domains, name);
+		if (servers)
+			return servers;
+		name = strchr (name, '.');
+		if (!name)
+			break;
+		name++;
+	}
+	return g_hash_table_lookup (priv->domains, "");
+}
+
+/*****************************************************************************/
+
+static void
+_cache_entry_free (CacheEntry *entry)
+{
+	c_list_unlink_stale (&entry->lru_lst);
+	g_free (entry->key);
+	g_free (entry->msg);
+	g_slice_free (CacheEntry, entry);
+}
+
+static void
+_cache_clear (NMDnsForwarder *self)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+
+	g_hash_table_remove_all (priv->cache);
+	nm_assert (c_list_is_empty (&priv->cache_lru_lst_head));
+}
+
+static void
+_cache_add (NMDnsForwarder *self,
+            const char *key,
+            const guint8 *msg,
+            gsize msg_len,
+            gsize question_end)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+	CacheEntry *entry;
+	guint32 ttl;
+	gint64 now;
+
+	if (priv->cache_size_max == 0)
+		return;
+	/* large answers are rare. Don't let them blow up the size of the cache. */
+	if (msg_len > CACHE_MSG_MAX_LEN)
+		return;
+	if (!_dns_msg_get_cache_ttl (msg, msg_len, question_end, &ttl))
+		return;
+
+	g_hash_table_remove (priv->cache, key);
+
+	/* the least recently used entries are at the tail. */
+	while (g_hash_table_size (priv->cache) >= priv->cache_size_max) {
+		entry = c_list_last_entry (&priv->cache_lru_lst_head, CacheEntry, lru_lst);
+		g_hash_table_remove (priv->cache, entry->key);
+	}
+
+	now = nm_utils_get_monotonic_timestamp_msec ();
+
+	entry = g_slice_new (CacheEntry);
+	entry->key = g_strdup (key);
+	entry->msg = nm_memdup (msg, msg_len);
+	entry->msg_len = msg_len;
+	entry->question_end = question_end;
+	entry->stored_at = now;
+	entry->expires_at = now + ((gint64) ttl) * 1000;
+	c_list_link_front (&priv->cache_lru_lst_head, &entry->lru_lst);
+	g_hash_table_insert (priv->cache, entry->key, entry);
+
+	_LOGT ("cache: add %s for %u seconds", key, (guint) ttl);
+}
+
+static CacheEntry *
+_cache_lookup (NMDnsForwarder *self, const char *key)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+	CacheEntry *entry;
+
+	entry = g_hash_table_lookup (priv->cache, key);
+	if (!entry)
+		return NULL;
+
+	if (entry->expires_at <= nm_utils_get_monotonic_timestamp_msec ()) {
+		g_hash_table_remove (priv->cache, key);
+		return NULL;
+	}
+
+	nm_c_list_move_front (&priv->cache_lru_lst_head, &entry->lru_lst);
+	return entry;
+}
+
+/*****************************************************************************/
+
+static void
+_send_to (NMDnsForwarder *self,
+          int fd,
+          const guint8 *msg,
+          gsize msg_len,
+          const SockAddr *addr,
+          socklen_t addr_len)
+{
+	if (sendto (fd, msg, msg_len, MSG_NOSIGNAL, &addr->sa, addr_len) < 0) {
+		int errsv = errno;
+
+		_LOGT ("failed to send message: %s", nm_strerror_native (errsv));
+	}
+}
+
+static void
+_reply_error (NMDnsForwarder *self,
+              const guint8 *query,
+              gsize question_end,
+              guint16 client_id,
+              guint rcode,
+              const SockAddr *client,
+              socklen_t client_len)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+	gs_free guint8 *reply = NULL;
+	guint16 flags;
+
+	reply = nm_memdup (query, question_end);
+	unaligned_write_be16 (&reply[0], client_id);
+	flags = unaligned_read_be16 (&reply[2]) & DNS_FLAG_RD;
+	unaligned_write_be16 (&reply[2], flags | DNS_FLAG_QR | DNS_FLAG_RA | rcode);
+	unaligned_write_be16 (&reply[6], 0);
+	unaligned_write_be16 (&reply[8], 0);
+	unaligned_write_be16 (&reply[10], 0);
+
+	_send_to (self, priv->listen_fd, reply, question_end, client, client_len);
+}
+
+static void
+_pending_free (PendingQuery *pq)
+{
+	nm_clear_g_source_inst (&pq->timeout_source);
+	g_array_unref (pq->servers);
+	g_free (pq->key);
+	g_free (pq->query);
+	g_slice_free (PendingQuery, pq);
+}
+
+static int
+_upstream_fd_get (NMDnsForwarder *self, int addr_family);
+
+static gboolean _pending_timeout_cb (gpointer user_data);
+
+/* Sends the query to the next server that accepts it. Returns FALSE,
+ * if there is no server left. */
+static gboolean
+_pending_send_next (PendingQuery *pq)
+{
+	NMDnsForwarder *self = pq->self;
+
+	nm_clear_g_source_inst (&pq->timeout_source);
+
+	for (; pq->server_idx < pq->servers->len; pq->server_idx++) {
+		const SockAddr *server = &g_array_index (pq->servers, SockAddr, pq->server_idx);
+		int fd;
+
+		fd = _upstream_fd_get (self, server->sa.sa_family);
+		if (fd < 0)
+			continue;
+
+		if (sendto (fd, pq->query, pq->query_len, MSG_NOSIGNAL, &server->sa, _sock_addr_len (server)) < 0) {
+			int errsv = errno;
+
+			_LOGT ("query %s: failed to send to server #%u: %s",
+			       pq->key, pq->server_idx, nm_strerror_native (errsv));
+			continue;
+		}
+
+		pq->timeout_source = nm_g_timeout_source_new (QUERY_TIMEOUT_MSEC,
+		                                              G_PRIORITY_DEFAULT,
+		                                              _pending_timeout_cb,
+		                                              pq,
+		                                              NULL);
+		g_source_attach (pq->timeout_source, NULL);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+_pending_fail (PendingQuery *pq)
+{
+	NMDnsForwarder *self = pq->self;
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+
+	_LOGT ("query %s: no server answered", pq->key);
+	_reply_error (self,
+	              pq->query,
+	              pq->question_end,
+	              pq->client_id,
+	              DNS_RCODE_SERVFAIL,
+	              &pq->client,
+	              pq->client_len);
+	g_hash_table_remove (priv->pending, GUINT_TO_POINTER (pq->id));
+}
+
+static gboolean
+_pending_timeout_cb (gpointer user_data)
+{
+	PendingQuery *pq = user_data;
+
+	nm_clear_g_source_inst (&pq->timeout_source);
+
+	pq->server_idx++;
+	if (!_pending_send_next (pq))
+		_pending_fail (pq);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+_handle_query (NMDnsForwarder *self,
+               guint8 *msg,
+               gsize msg_len,
+               const SockAddr *client,
+               socklen_t client_len)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+	gs_free char *key = NULL;
+	gs_free char *name = NULL;
+	PendingQuery *pq;
+	CacheEntry *entry;
+	GArray *servers;
+	gsize question_end;
+	guint16 client_id;
+	guint16 id;
+
+	if (   msg_len < DNS_HEADER_LEN
+	    || NM_FLAGS_HAS (unaligned_read_be16 (&msg[2]), DNS_FLAG_QR))
+		return;
+
+	key = _dns_msg_parse_question (msg, msg_len, &name, &question_end);
+	if (!key)
+		return;
+
+	client_id = unaligned_read_be16 (&msg[0]);
+
+	entry = _cache_lookup (self, key);
+	if (entry) {
+		gs_free guint8 *reply = NULL;
+
+		priv->n_cache_hits++;
+		reply = nm_memdup (entry->msg, entry->msg_len);
+		unaligned_write_be16 (&reply[0], client_id);
+		_dns_msg_age_ttls (reply,
+		                   entry->msg_len,
+		                   entry->question_end,
+		                   (nm_utils_get_monotonic_timestamp_msec () - entry->stored_at) / 1000);
+		_LOGT ("query %s: answer from cache", key);
+		_send_to (self, priv->listen_fd, reply, entry->msg_len, client, client_len);
+		return;
+	}
+
+	priv->n_cache_misses++;
+
+	servers = _servers_lookup (self, name);
+	if (   !servers
+	    || servers->len == 0) {
+		_LOGT ("query %s: no server", key);
+		_reply_error (self, msg, question_end, client_id, DNS_RCODE_SERVFAIL, client, client_len);
+		return;
+	}
+
+	if (g_hash_table_size (priv->pending) >= PENDING_QUERIES_MAX) {
+		_LOGT ("query %s: too many pending queries", key);
+		return;
+	}
+
+	/* a random ID makes it harder to spoof answers. */
+	do {
+		nm_utils_random_bytes (&id, sizeof (id));
+	} while (g_hash_table_contains (priv->pending, GUINT_TO_POINTER (id)));
+
+	pq = g_slice_new0 (PendingQuery);
+	pq->self = self;
+	pq->servers = g_array_ref (servers);
+	pq->key = g_steal_pointer (&key);
+	pq->query = nm_memdup (msg, msg_len);
+	pq->query_len = msg_len;
+	pq->question_end = question_end;
+	memcpy (&pq->client, client, client_len);
+	pq->client_len = client_len;
+	pq->id = id;
+	pq->client_id = client_id;
+	unaligned_write_be16 (&pq->query[0], id);
+	g_hash_table_insert (priv->pending, GUINT_TO_POINTER (id), pq);
+
+	_LOGT ("query %s: forward to %u server(s)", pq->key, servers->len);
+
+	if (!_pending_send_next (pq))
+		_pending_fail (pq);
+}
+
+static void
+_handle_answer (NMDnsForwarder *self,
+                guint8 *msg,
+                gsize msg_len,
+                const SockAddr *from)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+	gs_free char *key = NULL;
+	PendingQuery *pq;
+	gsize question_end;
+	guint rcode;
+
+	if (   msg_len < DNS_HEADER_LEN
+	    || !NM_FLAGS_HAS (unaligned_read_be16 (&msg[2]), DNS_FLAG_QR))
+		return;
+
+	pq = g_hash_table_lookup (priv->pending, GUINT_TO_POINTER (unaligned_read_be16 (&msg[0])));
+	if (!pq)
+		return;
+
+	/* only accept the answer from the server that we asked, and
+	 * for the question that we asked. */
+	if (   pq->server_idx >= pq->servers->len
+	    || !_sock_addr_equal (&g_array_index (pq->servers, SockAddr, pq->server_idx), from))
+		return;
+
+	key = _dns_msg_parse_question (msg, msg_len, NULL, &question_end);
+	if (!nm_streq0 (key, pq->key))
+		return;
+
+	rcode = unaligned_read_be16 (&msg[2]) & DNS_RCODE_MASK;
+	if (NM_IN_SET (rcode, DNS_RCODE_SERVFAIL, DNS_RCODE_REFUSED)) {
+		_LOGT ("query %s: server #%u failed with rcode %u", pq->key, pq->server_idx, rcode);
+		pq->server_idx++;
+		if (!_pending_send_next (pq))
+			_pending_fail (pq);
+		return;
+	}
+
+	_cache_add (self, pq->key, msg, msg_len, question_end);
+
+	unaligned_write_be16 (&msg[0], pq->client_id);
+	_send_to (self, priv->listen_fd, msg, msg_len, &pq->client, pq->client_len);
+
+	g_hash_table_remove (priv->pending, GUINT_TO_POINTER (pq->id));
+}
+
+/*****************************************************************************/
+
+static gboolean
+_fd_cb (int fd,
+        GIOCondition condition,
+        gpointer user_data)
+{
+	NMDnsForwarder *self = user_data;
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+	guint i;
+
+	/* the buffer is too large for the stack. */
+	if (!priv->recv_buf)
+		priv->recv_buf = g_malloc (DNS_MSG_MAX_LEN);
+
+	/* don't starve the other sources, if there is a flood of messages. */
+	for (i = 0; i < 64; i++) {
+		SockAddr from;
+		socklen_t from_len = sizeof (from);
+		ssize_t n;
+
+		n = recvfrom (fd, priv->recv_buf, DNS_MSG_MAX_LEN, MSG_DONTWAIT, &from.sa, &from_len);
+		if (n < 0) {
+			int errsv = errno;
+
+			if (!NM_IN_SET (errsv, EAGAIN, EWOULDBLOCK, EINTR))
+				_LOGT ("failed to receive message: %s", nm_strerror_native (errsv));
+			break;
+		}
+		if (!NM_IN_SET (from.sa.sa_family, AF_INET, AF_INET6))
+			continue;
+
+		if (fd == priv->listen_fd)
+			_handle_query (self, priv->recv_buf, n, &from, from_len);
+		else
+			_handle_answer (self, priv->recv_buf, n, &from);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static int
+_upstream_fd_get (NMDnsForwarder *self, int addr_family)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+	int *p_fd;
+	GSource **p_source;
+	int fd;
+
+	if (addr_family == AF_INET) {
+		p_fd = &priv->upstream_fd_4;
+		p_source = &priv->upstream_source_4;
+	} else {
+		p_fd = &priv->upstream_fd_6;
+		p_source = &priv->upstream_source_6;
+	}
+
+	if (*p_fd >= 0)
+		return *p_fd;
+
+	/* the kernel picks a random source port for an unbound socket. */
+	fd = socket (addr_family, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd < 0) {
+		int errsv = errno;
+
+		_LOGW ("failed to create IPv%c socket: %s",
+		       nm_utils_addr_family_to_char (addr_family),
+		       nm_strerror_native (errsv));
+		return -1;
+	}
+
+	*p_fd = fd;
+	*p_source = nm_g_unix_fd_source_new (fd,
+	                                     G_IO_IN,
+	                                     G_PRIORITY_DEFAULT,
+	                                     _fd_cb,
+	                                     self,
+	                                     NULL);
+	g_source_attach (*p_source, NULL);
+	return fd;
+}
+
+static gboolean
+_listen_start (NMDnsForwarder *self, GError **error)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+	nm_auto_close int fd = -1;
+	SockAddr addr = { };
+	socklen_t addr_len = sizeof (addr.in);
+
+	if (priv->listen_fd >= 0)
+		return TRUE;
+
+	fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd < 0) {
+		int errsv = errno;
+
+		nm_utils_error_set_errno (error, errsv, "failed to create socket: %s");
+		return FALSE;
+	}
+
+	addr.in.sin_family = AF_INET;
+	addr.in.sin_port = htons (priv->listen_port);
+	addr.in.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+	if (bind (fd, &addr.sa, addr_len) < 0) {
+		int errsv = errno;
+
+		nm_utils_error_set_errno (error, errsv, "failed to listen on 127.0.0.1: %s");
+		return FALSE;
+	}
+
+	if (getsockname (fd, &addr.sa, &addr_len) == 0)
+		priv->listen_port = ntohs (addr.in.sin_port);
+
+	_LOGD ("listening on 127.0.0.1:%u", (guint) priv->listen_port);
+
+	priv->listen_fd = nm_steal_fd (&fd);
+	priv->listen_source = nm_g_unix_fd_source_new (priv->listen_fd,
+	                                               G_IO_IN,
+	                                               G_PRIORITY_DEFAULT,
+	                                               _fd_cb,
+	                                               self,
+	                                               NULL);
+	g_source_attach (priv->listen_source, NULL);
+	return TRUE;
+}
+
+static void
+_cleanup (NMDnsForwarder *self)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+
+	if (priv->pending)
+		g_hash_table_remove_all (priv->pending);
+	if (priv->cache)
+		_cache_clear (self);
+	nm_clear_pointer (&priv->domains, g_hash_table_unref);
+
+	nm_clear_g_source_inst (&priv->listen_source);
+	nm_clear_g_source_inst (&priv->upstream_source_4);
+	nm_clear_g_source_inst (&priv->upstream_source_6);
+	nm_close (nm_steal_fd (&priv->listen_fd));
+	nm_close (nm_steal_fd (&priv->upstream_fd_4));
+	nm_close (nm_steal_fd (&priv->upstream_fd_6));
+
+	nm_clear_g_free (&priv->recv_buf);
+}
+
+/*****************************************************************************/
+
+static gboolean
+update (NMDnsPlugin *plugin,
+        const NMGlobalDnsConfig *global_config,
+        const CList *ip_config_lst_head,
+        const char *hostname,
+        GError **error)
+{
+	NMDnsForwarder *self = NM_DNS_FORWARDER (plugin);
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+
+	if (!_listen_start (self, error))
+		return FALSE;
+
+	/* The name servers or their domains changed. Cached answers might
+	 * be from a server that we would no longer ask. */
+	_cache_clear (self);
+
+	nm_clear_pointer (&priv->domains, g_hash_table_unref);
+	priv->domains = _servers_build (self, global_config, ip_config_lst_head);
+
+	_LOGD ("update: %u domains (cache: %"G_GUINT64_FORMAT" hits, %"G_GUINT64_FORMAT" misses)",
+	       g_hash_table_size (priv->domains),
+	       priv->n_cache_hits,
+	       priv->n_cache_misses);
+	return TRUE;
+}
+
+static void
+stop (NMDnsPlugin *plugin)
+{
+	_cleanup (NM_DNS_FORWARDER (plugin));
+}
+
+/*****************************************************************************/
+
+static void
+nm_dns_forwarder_init (NMDnsForwarder *self)
+{
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+
+	priv->listen_fd = -1;
+	priv->upstream_fd_4 = -1;
+	priv->upstream_fd_6 = -1;
+	priv->listen_port = DNS_PORT;
+	priv->upstream_port = DNS_PORT;
+	priv->cache_size_max = CACHE_SIZE_MAX;
+
+	c_list_init (&priv->cache_lru_lst_head);
+	priv->cache = g_hash_table_new_full (nm_str_hash, g_str_equal, NULL, (GDestroyNotify) _cache_entry_free);
+	priv->pending = g_hash_table_new_full (nm_direct_hash, NULL, NULL, (GDestroyNotify) _pending_free);
+}
+
+NMDnsPlugin *
+nm_dns_forwarder_new (void)
+{
+	return g_object_new (NM_TYPE_DNS_FORWARDER, NULL);
+}
+
+NMDnsPlugin *
+nmtst_dns_forwarder_new (guint16 upstream_port,
+                         guint cache_size_max)
+{
+	NMDnsForwarder *self;
+	NMDnsForwarderPrivate *priv;
+
+	self = g_object_new (NM_TYPE_DNS_FORWARDER, NULL);
+	priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+
+	/* let the kernel choose a free port to listen on. */
+	priv->listen_port = 0;
+	priv->upstream_port = upstream_port;
+	priv->cache_size_max = cache_size_max;
+	return NM_DNS_PLUGIN (self);
+}
+
+guint16
+nmtst_dns_forwarder_get_listen_port (NMDnsForwarder *self)
+{
+	return NM_DNS_FORWARDER_GET_PRIVATE (self)->listen_port;
+}
+
+static void
+dispose (GObject *object)
+{
+	NMDnsForwarder *self = NM_DNS_FORWARDER (object);
+	NMDnsForwarderPrivate *priv = NM_DNS_FORWARDER_GET_PRIVATE (self);
+
+	_cleanup (self);
+
+	nm_clear_pointer (&priv->pending, g_hash_table_unref);
+	nm_clear_pointer (&priv->cache, g_hash_table_unref);
+
+	G_OBJECT_CLASS (nm_dns_forwarder_parent_class)->dispose (object);
+}
+
+static void
+nm_dns_forwarder_class_init (NMDnsForwarderClass *klass)
+{
+	NMDnsPluginClass *plugin_class = NM_DNS_PLUGIN_CLASS (klass);
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = dispose;
+
+	plugin_class->plugin_name = "forwarder";
+	plugin_class->is_caching  = TRUE;
+	plugin_class->stop        = stop;
+	plugin_class->update      = update;
+}
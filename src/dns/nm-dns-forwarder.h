@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#ifndef __NETWORKMANAGER_DNS_FORWARDER_H__
+#define __NETWORKMANAGER_DNS_FORWARDER_H__
+
+#include "nm-dns-plugin.h"
+
+#define NM_TYPE_DNS_FORWARDER            (nm_dns_forwarder_get_type ())
+#define NM_DNS_FORWARDER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), NM_TYPE_DNS_FORWARDER, NMDnsForwarder))
+#define NM_DNS_FORWARDER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), NM_TYPE_DNS_FORWARDER, NMDnsForwarderClass))
+#define NM_IS_DNS_FORWARDER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), NM_TYPE_DNS_FORWARDER))
+#define NM_IS_DNS_FORWARDER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), NM_TYPE_DNS_FORWARDER))
+#define NM_DNS_FORWARDER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), NM_TYPE_DNS_FORWARDER, NMDnsForwarderClass))
+
+typedef struct _NMDnsForwarder NMDnsForwarder;
+typedef struct _NMDnsForwarderClass NMDnsForwarderClass;
+
+GType nm_dns_forwarder_get_type (void);
+
+NMDnsPlugin *nm_dns_forwarder_new (void);
+
+/*****************************************************************************/
+
+NMDnsPlugin *nmtst_dns_forwarder_new (guint16 upstream_port,
+                                      guint cache_size_max);
+
+guint16 nmtst_dns_forwarder_get_listen_port (NMDnsForwarder *self);
+
+#endif /* __NETWORKMANAGER_DNS_FORWARDER_H__ */
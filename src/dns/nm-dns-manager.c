@@ -35,11 +35,16 @@
 
 #include "nm-dns-plugin.h"
 #include "nm-dns-dnsmasq.h"
+#include "nm-dns-forwarder.h"
 #include "nm-dns-systemd-resolved.h"
 #include "nm-dns-unbound.h"
 
 #define HASH_LEN   NM_UTILS_CHECKSUM_LENGTH_SHA1
 
+/* Updates that follow each other closer than this are coalesced,
+ * so that a burst of changes rewrites resolv.conf only once. */
+#define UPDATE_DNS_COALESCE_MSEC 300
+
 #ifndef RESOLVCONF_PATH
 #define RESOLVCONF_PATH "/sbin/resolvconf"
 #endif
@@ -62,6 +67,9 @@ typedef struct {
 	GPtrArray *options;
 	const char *nis_domain;
 	GPtrArray *nis_servers;
+	GHashTable *nameservers_idx;
+	GHashTable *searches_idx;
+	GHashTable *nis_servers_idx;
 	NMTernary has_trust_ad;
 } NMResolvConfData;
 
@@ -77,6 +85,8 @@ NM_GOBJECT_PROPERTIES_DEFINE (NMDnsManager,
 	PROP_MODE,
 	PROP_RC_MANAGER,
 	PROP_CONFIGURATION,
+	PROP_RESOLV_CONF_WRITES,
+	PROP_RESOLV_CONF_WRITES_SKIPPED,
 );
 
 static guint signals[LAST_SIGNAL] = { 0 };
@@ -112,6 +122,22 @@ typedef struct {
 		guint num_restarts;
 		guint timer;
 	} plugin_ratelimit;
+
+	struct {
+		gint64 ts;
+		guint timer;
+	} update_coalesce;
+
+	struct {
+		/* the content that we last wrote to our own files in NMRUNDIR,
+		 * and the stat() of the files at that point. */
+		char *my_content;
+		char *no_stub_content;
+		struct stat my_st;
+		struct stat no_stub_st;
+		guint64 n_writes;
+		guint64 n_writes_skipped;
+	} resolv_conf;
 } NMDnsManagerPrivate;
 
 struct _NMDnsManager {
@@ -157,6 +183,10 @@ static void _ip_config_dns_priority_changed (gpointer config,
                                              GParamSpec *pspec,
                                              NMDnsIPConfigData *ip_data);
 
+static void _ip_config_reverse_domains_changed (gpointer config,
+                                                GParamSpec *pspec,
+                                                NMDnsIPConfigData *ip_data);
+
 /*****************************************************************************/
 
 static gboolean
@@ -244,6 +274,19 @@ _ip_config_data_new (NMDnsConfigData *data,
 	                    : "notify::" NM_IP6_CONFIG_DNS_PRIORITY,
 	                  (GCallback) _ip_config_dns_priority_changed, ip_data);
 
+	/* the reverse DNS domains are derived from the addresses and routes. They
+	 * are cached until one of them changes. */
+	g_signal_connect (ip_config,
+	                  NM_IS_IP4_CONFIG (ip_config)
+	                    ? "notify::" NM_IP4_CONFIG_ADDRESS_DATA
+	                    : "notify::" NM_IP6_CONFIG_ADDRESS_DATA,
+	                  (GCallback) _ip_config_reverse_domains_changed, ip_data);
+	g_signal_connect (ip_config,
+	                  NM_IS_IP4_CONFIG (ip_config)
+	                    ? "notify::" NM_IP4_CONFIG_ROUTE_DATA
+	                    : "notify::" NM_IP6_CONFIG_ROUTE_DATA,
+	                  (GCallback) _ip_config_reverse_domains_changed, ip_data);
+
 	_ASSERT_ip_config_data (ip_data);
 	return ip_data;
 }
@@ -262,6 +305,9 @@ _ip_config_data_free (NMDnsIPConfigData *ip_data)
 	g_signal_handlers_disconnect_by_func (ip_data->ip_config,
 	                                      _ip_config_dns_priority_changed,
 	                                      ip_data);
+	g_signal_handlers_disconnect_by_func (ip_data->ip_config,
+	                                      _ip_config_reverse_domains_changed,
+	                                      ip_data);
 
 	g_object_unref (ip_data->ip_config);
 	g_slice_free (NMDnsIPConfigData, ip_data);
@@ -349,23 +395,37 @@ nm_dns_manager_has_systemd_resolved (NMDnsManager *self)
 /*****************************************************************************/
 
 static void
-add_string_item (GPtrArray *array, const char *str, gboolean dup)
+add_string_item (GPtrArray *array, GHashTable **p_idx, const char *str, gboolean dup)
 {
-	int i;
+	char *item;
+	guint i;
 
 	g_return_if_fail (array != NULL);
 	g_return_if_fail (str != NULL);
 
-	/* Check for dupes before adding */
-	for (i = 0; i < array->len; i++) {
-		const char *candidate = g_ptr_array_index (array, i);
-
-		if (candidate && !strcmp (candidate, str))
+	/* Check for dupes before adding. With an index (@p_idx), that is
+	 * a hash lookup, otherwise a linear search of the (short) list. */
+	if (p_idx) {
+		if (   *p_idx
+		    && g_hash_table_contains (*p_idx, str))
 			return;
+	} else {
+		for (i = 0; i < array->len; i++) {
+			const char *candidate = g_ptr_array_index (array, i);
+
+			if (candidate && !strcmp (candidate, str))
+				return;
+		}
 	}
 
 	/* No dupes, add the new item */
-	g_ptr_array_add (array, dup ? g_strdup (str): (gpointer) str);
+	item = dup ? g_strdup (str) : (char *) str;
+	g_ptr_array_add (array, item);
+	if (p_idx) {
+		if (!*p_idx)
+			*p_idx = g_hash_table_new (nm_str_hash, g_str_equal);
+		g_hash_table_add (*p_idx, item);
+	}
 }
 
 static void
@@ -376,7 +436,7 @@ add_dns_option_item (GPtrArray *array, const char *str)
 }
 
 static void
-add_dns_domains (GPtrArray *array, const NMIPConfig *ip_config,
+add_dns_domains (GPtrArray *array, GHashTable **p_idx, const NMIPConfig *ip_config,
                  gboolean include_routing, gboolean dup)
 {
 	guint num_domains, num_searches, i;
@@ -391,7 +451,7 @@ add_dns_domains (GPtrArray *array, const NMIPConfig *ip_config,
 			continue;
 		if (!domain_is_valid (nm_utils_parse_dns_domain (str, NULL), FALSE))
 			continue;
-		add_string_item (array, str, dup);
+		add_string_item (array, p_idx, str, dup);
 	}
 	if (num_domains > 1 || !num_searches) {
 		for (i = 0; i < num_domains; i++) {
@@ -400,7 +460,7 @@ add_dns_domains (GPtrArray *array, const NMIPConfig *ip_config,
 				continue;
 			if (!domain_is_valid (nm_utils_parse_dns_domain (str, NULL), FALSE))
 				continue;
-			add_string_item (array, str, dup);
+			add_string_item (array, p_idx, str, dup);
 		}
 	}
 }
@@ -445,10 +505,10 @@ merge_one_ip_config (NMResolvConfData *rc,
 			}
 		}
 
-		add_string_item (rc->nameservers, buf, TRUE);
+		add_string_item (rc->nameservers, &rc->nameservers_idx, buf, TRUE);
 	}
 
-	add_dns_domains (rc->searches, ip_config, FALSE, TRUE);
+	add_dns_domains (rc->searches, &rc->searches_idx, ip_config, FALSE, TRUE);
 
 	has_trust_ad = FALSE;
 	num = nm_ip_config_get_num_dns_options (ip_config);
@@ -480,6 +540,7 @@ merge_one_ip_config (NMResolvConfData *rc,
 		num = nm_ip4_config_get_num_nis_servers (ip4_config);
 		for (i = 0; i < num; i++) {
 			add_string_item (rc->nis_servers,
+			                 &rc->nis_servers_idx,
 			                 _nm_utils_inet4_ntop (nm_ip4_config_get_nis_server (ip4_config, i), buf),
 			                 TRUE);
 		}
@@ -806,17 +867,89 @@ _read_link_cached (const char *path, gboolean *is_cached, char **cached)
 
 #define NO_STUB_RESOLV_CONF        NMRUNDIR "/no-stub-resolv.conf"
 
+static void
+_resolv_conf_count_write (NMDnsManager *self, gboolean skipped)
+{
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+
+	if (skipped) {
+		priv->resolv_conf.n_writes_skipped++;
+		_notify (self, PROP_RESOLV_CONF_WRITES_SKIPPED);
+	} else {
+		priv->resolv_conf.n_writes++;
+		_notify (self, PROP_RESOLV_CONF_WRITES);
+	}
+}
+
+static void
+_resolv_conf_stat (const char *path,
+                   struct stat *out_st)
+{
+	if (stat (path, out_st) != 0)
+		memset (out_st, 0, sizeof (*out_st));
+}
+
+static gboolean
+_resolv_conf_is_unchanged (const char *path,
+                           const char *cached_content,
+                           struct stat *cached_st,
+                           const char *content)
+{
+	gs_free char *old_content = NULL;
+	struct stat st;
+
+	if (cached_content) {
+		/* one of our own files, that we wrote before. We trust the cached content,
+		 * as long as the file is still the one that we wrote. */
+		if (!nm_streq (cached_content, content))
+			return FALSE;
+		if (stat (path, &st) != 0)
+			return FALSE;
+		if (   st.st_dev == cached_st->st_dev
+		    && st.st_ino == cached_st->st_ino
+		    && st.st_size == cached_st->st_size
+		    && st.st_mtim.tv_sec == cached_st->st_mtim.tv_sec
+		    && st.st_mtim.tv_nsec == cached_st->st_mtim.tv_nsec)
+			return TRUE;
+		/* somebody else touched the file. Check what's in there. */
+	}
+
+	if (!g_file_get_contents (path, &old_content, NULL, NULL))
+		return FALSE;
+	if (!nm_streq (old_content, content))
+		return FALSE;
+
+	if (cached_st)
+		_resolv_conf_stat (path, cached_st);
+	return TRUE;
+}
+
 static void
 update_resolv_conf_no_stub (NMDnsManager *self,
                             const char *const*searches,
                             const char *const*nameservers,
                             const char *const*options)
 {
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
 	gs_free char *content = NULL;
 	GError *local = NULL;
 
 	content = create_resolv_conf (searches, nameservers, options);
 
+	if (_resolv_conf_is_unchanged (NO_STUB_RESOLV_CONF,
+	                               priv->resolv_conf.no_stub_content,
+	                               &priv->resolv_conf.no_stub_st,
+	                               content)) {
+		_LOGT ("update-resolv-no-stub: '%s' is unchanged",
+		       NO_STUB_RESOLV_CONF);
+		_resolv_conf_count_write (self, TRUE);
+		if (!priv->resolv_conf.no_stub_content)
+			priv->resolv_conf.no_stub_content = g_steal_pointer (&content);
+		return;
+	}
+
+	nm_clear_g_free (&priv->resolv_conf.no_stub_content);
+
 	if (!g_file_set_contents (NO_STUB_RESOLV_CONF,
 	                          content,
 	                          -1,
@@ -829,6 +962,9 @@ update_resolv_conf_no_stub (NMDnsManager *self,
 
 	_LOGT ("update-resolv-no-stub: '%s' successfully written",
 	       NO_STUB_RESOLV_CONF);
+	_resolv_conf_count_write (self, FALSE);
+	priv->resolv_conf.no_stub_content = g_steal_pointer (&content);
+	_resolv_conf_stat (NO_STUB_RESOLV_CONF, &priv->resolv_conf.no_stub_st);
 }
 
 static SpawnResult
@@ -839,6 +975,7 @@ update_resolv_conf (NMDnsManager *self,
                     GError **error,
                     NMDnsManagerResolvConfManager rc_manager)
 {
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
 	FILE *f;
 	gboolean success;
 	gs_free char *content = NULL;
@@ -878,7 +1015,11 @@ update_resolv_conf (NMDnsManager *self,
 		/* we first write to /etc/resolv.conf directly. If that fails,
 		 * we still continue to write to runstatedir but remember the
 		 * error. */
-		if (!g_file_set_contents (rc_path, content, -1, &local)) {
+		if (_resolv_conf_is_unchanged (rc_path, NULL, NULL, content)) {
+			_LOGT ("update-resolv-conf: %s is unchanged (rc-manager=%s)",
+			       rc_path, _rc_manager_to_string (rc_manager));
+			_resolv_conf_count_write (self, TRUE);
+		} else if (!g_file_set_contents (rc_path, content, -1, &local)) {
 			_LOGT ("update-resolv-conf: write to %s failed (rc-manager=%s, %s)",
 			       rc_path, _rc_manager_to_string (rc_manager), local->message);
 			g_propagate_error (error, local);
@@ -889,9 +1030,25 @@ update_resolv_conf (NMDnsManager *self,
 		} else {
 			_LOGT ("update-resolv-conf: write to %s succeeded (rc-manager=%s)",
 			       rc_path, _rc_manager_to_string (rc_manager));
+			_resolv_conf_count_write (self, FALSE);
 		}
 	}
 
+	if (_resolv_conf_is_unchanged (MY_RESOLV_CONF,
+	                               priv->resolv_conf.my_content,
+	                               &priv->resolv_conf.my_st,
+	                               content)) {
+		/* Don't rewrite our file and don't replace the symlink. Both would
+		 * only wake up everybody watching resolv.conf for nothing. */
+		_LOGT ("update-resolv-conf: internal file %s is unchanged", MY_RESOLV_CONF);
+		_resolv_conf_count_write (self, TRUE);
+		if (!priv->resolv_conf.my_content)
+			priv->resolv_conf.my_content = g_steal_pointer (&content);
+		return write_file_result;
+	}
+
+	nm_clear_g_free (&priv->resolv_conf.my_content);
+
 	if ((f = fopen (MY_RESOLV_CONF_TMP, "we")) == NULL) {
 		errsv = errno;
 		g_set_error (error,
@@ -944,6 +1101,10 @@ update_resolv_conf (NMDnsManager *self,
 		return SR_ERROR;
 	}
 
+	_resolv_conf_count_write (self, FALSE);
+	priv->resolv_conf.my_content = g_steal_pointer (&content);
+	_resolv_conf_stat (MY_RESOLV_CONF, &priv->resolv_conf.my_st);
+
 	if (rc_manager == NM_DNS_MANAGER_RESOLV_CONF_MAN_FILE) {
 		_LOGT ("update-resolv-conf: write internal file %s succeeded (rc-manager=%s)",
 		       MY_RESOLV_CONF, _rc_manager_to_string (rc_manager));
@@ -1060,14 +1221,14 @@ merge_global_dns_config (NMResolvConfData *rc, NMGlobalDnsConfig *global_conf)
 				continue;
 			if (!domain_is_valid (searches[i], FALSE))
 				continue;
-			add_string_item (rc->searches, searches[i], TRUE);
+			add_string_item (rc->searches, &rc->searches_idx, searches[i], TRUE);
 		}
 	}
 
 	options = nm_global_dns_config_get_options (global_conf);
 	if (options) {
 		for (i = 0; options[i]; i++)
-			add_string_item (rc->options, options[i], TRUE);
+			add_string_item (rc->options, NULL, options[i], TRUE);
 	}
 
 	default_domain = nm_global_dns_config_lookup_domain (global_conf, "*");
@@ -1076,7 +1237,7 @@ merge_global_dns_config (NMResolvConfData *rc, NMGlobalDnsConfig *global_conf)
 	servers = nm_global_dns_domain_get_servers (default_domain);
 	if (servers) {
 		for (i = 0; servers[i]; i++)
-			add_string_item (rc->nameservers, servers[i], TRUE);
+			add_string_item (rc->nameservers, &rc->nameservers_idx, servers[i], TRUE);
 	}
 
 	return TRUE;
@@ -1190,15 +1351,19 @@ _collect_resolv_conf_data (NMDnsManager *self,
 		    && !nm_utils_ipaddr_is_valid (AF_UNSPEC, priv->hostname)) {
 			hostdomain++;
 			if (domain_is_valid (hostdomain, TRUE))
-				add_string_item (rc.searches, hostdomain, TRUE);
+				add_string_item (rc.searches, &rc.searches_idx, hostdomain, TRUE);
 			else if (domain_is_valid (priv->hostname, TRUE))
-				add_string_item (rc.searches, priv->hostname, TRUE);
+				add_string_item (rc.searches, &rc.searches_idx, priv->hostname, TRUE);
 		}
 	}
 
 	if (rc.has_trust_ad == NM_TERNARY_TRUE)
 		g_ptr_array_add (rc.options, g_strdup (NM_SETTING_DNS_OPTION_TRUST_AD));
 
+	nm_clear_pointer (&rc.nameservers_idx, g_hash_table_unref);
+	nm_clear_pointer (&rc.searches_idx, g_hash_table_unref);
+	nm_clear_pointer (&rc.nis_servers_idx, g_hash_table_unref);
+
 	*out_searches = _ptrarray_to_strv (rc.searches);
 	*out_options = _ptrarray_to_strv (rc.options);
 	*out_nameservers = _ptrarray_to_strv (rc.nameservers);
@@ -1206,6 +1371,35 @@ _collect_resolv_conf_data (NMDnsManager *self,
 	*out_nis_domain = rc.nis_domain;
 }
 
+char **
+nmtst_dns_collect_searches (NMIPConfig *const*ip_configs,
+                            guint len)
+{
+	NMResolvConfData rc = {
+		.nameservers  = g_ptr_array_new_with_free_func (g_free),
+		.searches     = g_ptr_array_new (),
+		.options      = g_ptr_array_new_with_free_func (g_free),
+		.nis_servers  = g_ptr_array_new_with_free_func (g_free),
+		.has_trust_ad = NM_TERNARY_DEFAULT,
+	};
+	guint i;
+
+	for (i = 0; i < len; i++) {
+		merge_one_ip_config (&rc,
+		                     nm_ip_config_get_ifindex (ip_configs[i]),
+		                     ip_configs[i]);
+	}
+
+	nm_clear_pointer (&rc.nameservers_idx, g_hash_table_unref);
+	nm_clear_pointer (&rc.searches_idx, g_hash_table_unref);
+	nm_clear_pointer (&rc.nis_servers_idx, g_hash_table_unref);
+	g_ptr_array_unref (rc.nameservers);
+	g_ptr_array_unref (rc.options);
+	g_ptr_array_unref (rc.nis_servers);
+
+	return _ptrarray_to_strv (rc.searches);
+}
+
 static char **
 get_ip_rdns_domains (NMIPConfig *ip_config)
 {
@@ -1404,8 +1598,11 @@ rebuild_domain_lists (NMDnsManager *self)
 		nm_assert (num_dom2 < cap_dom);
 		domains[num_dom2] = NULL;
 
-		g_strfreev (ip_data->domains.reverse);
-		ip_data->domains.reverse = get_ip_rdns_domains (ip_config);
+		if (!ip_data->domains.reverse_valid) {
+			g_strfreev (ip_data->domains.reverse);
+			ip_data->domains.reverse = get_ip_rdns_domains (ip_config);
+			ip_data->domains.reverse_valid = TRUE;
+		}
 	}
 }
 
@@ -1418,7 +1615,9 @@ clear_domain_lists (NMDnsManager *self)
 	head = _ip_config_lst_head (self);
 	c_list_for_each_entry (ip_data, head, ip_config_lst) {
 		nm_clear_g_free (&ip_data->domains.search);
-		nm_clear_pointer (&ip_data->domains.reverse, g_strfreev);
+
+		/* the reverse domains are kept across updates. They only
+		 * get recomputed after _ip_config_reverse_domains_changed(). */
 	}
 }
 
@@ -1446,11 +1645,15 @@ update_dns (NMDnsManager *self,
 
 	nm_assert (!error || !*error);
 
+	nm_clear_g_source (&priv->update_coalesce.timer);
+
 	if (priv->is_stopped) {
 		_LOGD ("update-dns: not updating resolv.conf (is stopped)");
 		return TRUE;
 	}
 
+	priv->update_coalesce.ts = nm_utils_get_monotonic_timestamp_msec ();
+
 	nm_clear_g_source (&priv->plugin_ratelimit.timer);
 
 	if (NM_IN_SET (priv->rc_manager, NM_DNS_MANAGER_RESOLV_CONF_MAN_UNMANAGED,
@@ -1622,6 +1825,51 @@ plugin_skip:
 
 /*****************************************************************************/
 
+static gboolean
+_update_dns_coalesce_cb (gpointer user_data)
+{
+	NMDnsManager *self = user_data;
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+	gs_free_error GError *error = NULL;
+
+	priv->update_coalesce.timer = 0;
+
+	if (!update_dns (self, FALSE, &error))
+		_LOGW ("could not commit DNS changes: %s", error->message);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+_update_dns_coalesced (NMDnsManager *self)
+{
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+	gs_free_error GError *error = NULL;
+	gint64 now;
+
+	if (priv->update_coalesce.timer) {
+		_LOGT ("update-dns: coalesce with pending update");
+		return;
+	}
+
+	now = nm_utils_get_monotonic_timestamp_msec ();
+	if (   priv->update_coalesce.ts != 0
+	    && now < priv->update_coalesce.ts + UPDATE_DNS_COALESCE_MSEC) {
+		/* we just did an update. Delay this one a bit, in case more
+		 * changes follow. */
+		_LOGT ("update-dns: delay update for %d msec",
+		       (int) (priv->update_coalesce.ts + UPDATE_DNS_COALESCE_MSEC - now));
+		priv->update_coalesce.timer = g_timeout_add (priv->update_coalesce.ts + UPDATE_DNS_COALESCE_MSEC - now,
+		                                             _update_dns_coalesce_cb,
+		                                             self);
+		return;
+	}
+
+	if (!update_dns (self, FALSE, &error))
+		_LOGW ("could not commit DNS changes: %s", error->message);
+}
+
+/*****************************************************************************/
+
 static void
 _ip_config_dns_priority_changed (gpointer config,
                                  GParamSpec *pspec,
@@ -1632,6 +1880,16 @@ _ip_config_dns_priority_changed (gpointer config,
 	NM_DNS_MANAGER_GET_PRIVATE (ip_data->data->self)->ip_config_lst_need_sort = TRUE;
 }
 
+static void
+_ip_config_reverse_domains_changed (gpointer config,
+                                    GParamSpec *pspec,
+                                    NMDnsIPConfigData *ip_data)
+{
+	_ASSERT_ip_config_data (ip_data);
+
+	ip_data->domains.reverse_valid = FALSE;
+}
+
 gboolean
 nm_dns_manager_set_ip_config (NMDnsManager *self,
                               NMIPConfig *ip_config,
@@ -1710,12 +1968,8 @@ nm_dns_manager_set_ip_config (NMDnsManager *self,
 	}
 
 changed:
-	if (!priv->updates_queue) {
-		gs_free_error GError *error = NULL;
-
-		if (!update_dns (self, FALSE, &error))
-			_LOGW ("could not commit DNS changes: %s", error->message);
-	}
+	if (!priv->updates_queue)
+		_update_dns_coalesced (self);
 
 	return TRUE;
 }
@@ -1756,12 +2010,8 @@ nm_dns_manager_set_hostname (NMDnsManager *self,
 	if (skip_update)
 		return;
 
-	if (!priv->updates_queue) {
-		gs_free_error GError *error = NULL;
-
-		if (!update_dns (self, FALSE, &error))
-			_LOGW ("could not commit DNS changes: %s", error->message);
-	}
+	if (!priv->updates_queue)
+		_update_dns_coalesced (self);
 }
 
 void
@@ -1785,7 +2035,6 @@ void
 nm_dns_manager_end_updates (NMDnsManager *self, const char *func)
 {
 	NMDnsManagerPrivate *priv;
-	gs_free_error GError *error = NULL;
 	gboolean changed;
 	guint8 new[HASH_LEN];
 
@@ -1806,8 +2055,7 @@ nm_dns_manager_end_updates (NMDnsManager *self, const char *func)
 
 	/* Commit all the outstanding changes */
 	_LOGD ("(%s): committing DNS changes (%d)", func, priv->updates_queue);
-	if (!update_dns (self, FALSE, &error))
-		_LOGW ("could not commit DNS changes: %s", error->message);
+	_update_dns_coalesced (self);
 
 	memset (priv->prev_hash, 0, sizeof (priv->prev_hash));
 }
@@ -1825,19 +2073,27 @@ nm_dns_manager_stop (NMDnsManager *self)
 	_LOGT ("stopping...");
 
 	/* If we're quitting, leave a valid resolv.conf in place, not one
-	 * pointing to 127.0.0.1 if dnsmasq was active.  But if we haven't
+	 * pointing to 127.0.0.1 if dnsmasq or the internal forwarder was
+	 * active. Both go away together with NetworkManager. But if we haven't
 	 * done any DNS updates yet, there's no reason to touch resolv.conf
 	 * on shutdown.
 	 */
 	if (   priv->dns_touched
 	    && priv->plugin
-	    && NM_IS_DNS_DNSMASQ (priv->plugin)) {
+	    && (   NM_IS_DNS_DNSMASQ (priv->plugin)
+	        || NM_IS_DNS_FORWARDER (priv->plugin))) {
 		gs_free_error GError *error = NULL;
 
 		if (!update_dns (self, TRUE, &error))
 			_LOGW ("could not commit DNS changes on shutdown: %s", error->message);
 
 		priv->dns_touched = FALSE;
+	} else if (nm_clear_g_source (&priv->update_coalesce.timer)) {
+		gs_free_error GError *error = NULL;
+
+		/* don't drop an update that is still delayed for coalescing. */
+		if (!update_dns (self, FALSE, &error))
+			_LOGW ("could not commit DNS changes on shutdown: %s", error->message);
 	}
 
 	priv->is_stopped = TRUE;
@@ -2056,6 +2312,12 @@ again:
 			priv->plugin = nm_dns_unbound_new ();
 			plugin_changed = TRUE;
 		}
+	} else if (nm_streq0 (mode, "forwarder")) {
+		if (force_reload_plugin || !NM_IS_DNS_FORWARDER (priv->plugin)) {
+			_clear_plugin (self);
+			priv->plugin = nm_dns_forwarder_new ();
+			plugin_changed = TRUE;
+		}
 	} else {
 		if (!NM_IN_STRSET (mode, "none", "default")) {
 			if (mode)
@@ -2309,6 +2571,12 @@ get_property (GObject *object, guint prop_id,
 	case PROP_CONFIGURATION:
 		g_value_set_variant (value, _get_config_variant (self));
 		break;
+	case PROP_RESOLV_CONF_WRITES:
+		g_value_set_uint64 (value, priv->resolv_conf.n_writes);
+		break;
+	case PROP_RESOLV_CONF_WRITES_SKIPPED:
+		g_value_set_uint64 (value, priv->resolv_conf.n_writes_skipped);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -2366,6 +2634,7 @@ dispose (GObject *object)
 	nm_clear_pointer (&priv->configs, g_hash_table_destroy);
 
 	nm_clear_g_source (&priv->plugin_ratelimit.timer);
+	nm_clear_g_source (&priv->update_coalesce.timer);
 
 	g_clear_object (&priv->config);
 
@@ -2382,6 +2651,8 @@ finalize (GObject *object)
 
 	g_free (priv->hostname);
 	g_free (priv->mode);
+	g_free (priv->resolv_conf.my_content);
+	g_free (priv->resolv_conf.no_stub_content);
 
 	G_OBJECT_CLASS (nm_dns_manager_parent_class)->finalize (object);
 }
@@ -2390,9 +2661,11 @@ static const NMDBusInterfaceInfoExtended interface_info_dns_manager = {
 	.parent = NM_DEFINE_GDBUS_INTERFACE_INFO_INIT (
 		NM_DBUS_INTERFACE_DNS_MANAGER,
 		.properties = NM_DEFINE_GDBUS_PROPERTY_INFOS (
-			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE_L ("Mode",          "s",      NM_DNS_MANAGER_MODE),
-			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE_L ("RcManager",     "s",      NM_DNS_MANAGER_RC_MANAGER),
-			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE_L ("Configuration", "aa{sv}", NM_DNS_MANAGER_CONFIGURATION),
+			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE_L ("Mode",                    "s",      NM_DNS_MANAGER_MODE),
+			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE_L ("RcManager",               "s",      NM_DNS_MANAGER_RC_MANAGER),
+			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE_L ("Configuration",           "aa{sv}", NM_DNS_MANAGER_CONFIGURATION),
+			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE_L ("ResolvConfWrites",        "t",      NM_DNS_MANAGER_RESOLV_CONF_WRITES),
+			NM_DEFINE_DBUS_PROPERTY_INFO_EXTENDED_READABLE_L ("ResolvConfWritesSkipped", "t",      NM_DNS_MANAGER_RESOLV_CONF_WRITES_SKIPPED),
 		),
 	),
 };
@@ -2430,6 +2703,18 @@ nm_dns_manager_class_init (NMDnsManagerClass *klass)
 	                          G_PARAM_READABLE |
 	                          G_PARAM_STATIC_STRINGS);
 
+	obj_properties[PROP_RESOLV_CONF_WRITES] =
+	    g_param_spec_uint64 (NM_DNS_MANAGER_RESOLV_CONF_WRITES, "", "",
+	                         0, G_MAXUINT64, 0,
+	                         G_PARAM_READABLE |
+	                         G_PARAM_STATIC_STRINGS);
+
+	obj_properties[PROP_RESOLV_CONF_WRITES_SKIPPED] =
+	    g_param_spec_uint64 (NM_DNS_MANAGER_RESOLV_CONF_WRITES_SKIPPED, "", "",
+	                         0, G_MAXUINT64, 0,
+	                         G_PARAM_READABLE |
+	                         G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
 
 	signals[CONFIG_CHANGED] =
@@ -37,6 +37,7 @@ typedef struct {
 	struct {
 		const char **search;
 		char **reverse;
+		bool reverse_valid:1;
 	} domains;
 } NMDnsIPConfigData;
 
@@ -57,6 +58,8 @@ typedef struct _NMDnsConfigData {
 #define NM_DNS_MANAGER_MODE "mode"
 #define NM_DNS_MANAGER_RC_MANAGER "rc-manager"
 #define NM_DNS_MANAGER_CONFIGURATION "configuration"
+#define NM_DNS_MANAGER_RESOLV_CONF_WRITES "resolv-conf-writes"
+#define NM_DNS_MANAGER_RESOLV_CONF_WRITES_SKIPPED "resolv-conf-writes-skipped"
 
 /* internal signals */
 #define NM_DNS_MANAGER_CONFIG_CHANGED "config-changed"
@@ -121,4 +124,7 @@ char *nmtst_dns_create_resolv_conf (const char *const*searches,
                                     const char *const*nameservers,
                                     const char *const*options);
 
+char **nmtst_dns_collect_searches (NMIPConfig *const*ip_configs,
+                                   guint len);
+
 #endif /* __NETWORKMANAGER_DNS_MANAGER_H__ */
@@ -36,6 +36,21 @@
 
 /*****************************************************************************/
 
+typedef enum {
+	LINK_OPERATION_DNS,
+	LINK_OPERATION_DOMAINS,
+	LINK_OPERATION_MULTICAST_DNS,
+	LINK_OPERATION_LLMNR,
+	_LINK_OPERATION_NUM,
+} LinkOperation;
+
+static const char *const link_operation_names[_LINK_OPERATION_NUM] = {
+	[LINK_OPERATION_DNS]           = "SetLinkDNS",
+	[LINK_OPERATION_DOMAINS]       = "SetLinkDomains",
+	[LINK_OPERATION_MULTICAST_DNS] = "SetLinkMulticastDNS",
+	[LINK_OPERATION_LLMNR]         = "SetLinkLLMNR",
+};
+
 typedef struct {
 	int ifindex;
 	CList configs_lst_head;
@@ -43,16 +58,33 @@ typedef struct {
 
 typedef struct {
 	CList request_queue_lst;
-	const char *operation;
+	int ifindex;
+	LinkOperation operation;
 	GVariant *argument;
 } RequestItem;
 
+typedef struct {
+	int ifindex;
+
+	/* the arguments of the last calls that were sent to systemd-resolved
+	 * for this link. */
+	GVariant *sent_args[_LINK_OPERATION_NUM];
+} LinkState;
+
 /*****************************************************************************/
 
 typedef struct {
 	GDBusConnection *dbus_connection;
 	GCancellable *cancellable;
 	CList request_queue_lst_head;
+
+	/* ifindex -> LinkState. */
+	GHashTable *link_states;
+
+	/* the number of calls that were not sent, because the link
+	 * already has the same configuration. */
+	guint64 n_suppressed_calls;
+
 	guint name_owner_changed_id;
 	bool send_updates_warn_ratelimited:1;
 	bool try_start_blocked:1;
@@ -90,12 +122,14 @@ _request_item_free (RequestItem *request_item)
 
 static void
 _request_item_append (CList *request_queue_lst_head,
-                      const char *operation,
+                      int ifindex,
+                      LinkOperation operation,
                       GVariant *argument)
 {
 	RequestItem *request_item;
 
 	request_item = g_slice_new (RequestItem);
+	request_item->ifindex = ifindex;
 	request_item->operation = operation;
 	request_item->argument = g_variant_ref_sink (argument);
 	c_list_link_tail (request_queue_lst_head, &request_item->request_queue_lst);
@@ -103,6 +137,43 @@ _request_item_append (CList *request_queue_lst_head,
 
 /*****************************************************************************/
 
+static void
+_link_state_free (LinkState *link_state)
+{
+	guint i;
+
+	for (i = 0; i < _LINK_OPERATION_NUM; i++)
+		nm_clear_pointer (&link_state->sent_args[i], g_variant_unref);
+	g_slice_free (LinkState, link_state);
+}
+
+static LinkState *
+_link_state_get (NMDnsSystemdResolved *self, int ifindex)
+{
+	NMDnsSystemdResolvedPrivate *priv = NM_DNS_SYSTEMD_RESOLVED_GET_PRIVATE (self);
+	LinkState *link_state;
+
+	link_state = g_hash_table_lookup (priv->link_states, &ifindex);
+	if (!link_state) {
+		link_state = g_slice_new0 (LinkState);
+		link_state->ifindex = ifindex;
+		g_hash_table_add (priv->link_states, link_state);
+	}
+	return link_state;
+}
+
+static void
+_link_states_reset (NMDnsSystemdResolved *self)
+{
+	NMDnsSystemdResolvedPrivate *priv = NM_DNS_SYSTEMD_RESOLVED_GET_PRIVATE (self);
+
+	/* we don't know what configuration systemd-resolved has. The next update
+	 * will send all calls again. */
+	g_hash_table_remove_all (priv->link_states);
+}
+
+/*****************************************************************************/
+
 static void
 _interface_config_free (InterfaceConfig *config)
 {
@@ -126,6 +197,10 @@ call_done (GObject *source, GAsyncResult *r, gpointer user_data)
 	priv = NM_DNS_SYSTEMD_RESOLVED_GET_PRIVATE (self);
 
 	if (!v) {
+		/* we don't know which link failed to update. Forget about
+		 * what was sent, so that the next update sends everything. */
+		_link_states_reset (self);
+
 		if (!priv->send_updates_warn_ratelimited) {
 			priv->send_updates_warn_ratelimited = TRUE;
 			_LOGW ("send-updates failed to update systemd-resolved: %s", error->message);
@@ -185,9 +260,32 @@ free_pending_updates (NMDnsSystemdResolved *self)
 }
 
 static void
-prepare_one_interface (NMDnsSystemdResolved *self, InterfaceConfig *ic)
+prepare_one_request (NMDnsSystemdResolved *self,
+                     int ifindex,
+                     LinkOperation operation,
+                     GVariant *argument)
 {
 	NMDnsSystemdResolvedPrivate *priv = NM_DNS_SYSTEMD_RESOLVED_GET_PRIVATE (self);
+	gs_unref_variant GVariant *arg = g_variant_ref_sink (argument);
+	LinkState *link_state;
+
+	link_state = g_hash_table_lookup (priv->link_states, &ifindex);
+	if (   link_state
+	    && link_state->sent_args[operation]
+	    && g_variant_equal (link_state->sent_args[operation], arg)) {
+		priv->n_suppressed_calls++;
+		return;
+	}
+
+	_request_item_append (&priv->request_queue_lst_head,
+	                      ifindex,
+	                      operation,
+	                      arg);
+}
+
+static void
+prepare_one_interface (NMDnsSystemdResolved *self, InterfaceConfig *ic)
+{
 	GVariantBuilder dns, domains;
 	NMCListElem *elem;
 	NMSettingConnectionMdns mdns = NM_SETTING_CONNECTION_MDNS_DEFAULT;
@@ -249,18 +347,22 @@ prepare_one_interface (NMDnsSystemdResolved *self, InterfaceConfig *ic)
 	}
 	nm_assert (llmnr_arg);
 
-	_request_item_append (&priv->request_queue_lst_head,
-	                      "SetLinkDNS",
-	                      g_variant_builder_end (&dns));
-	_request_item_append (&priv->request_queue_lst_head,
-	                      "SetLinkDomains",
-	                      g_variant_builder_end (&domains));
-	_request_item_append (&priv->request_queue_lst_head,
-	                      "SetLinkMulticastDNS",
-	                      g_variant_new ("(is)", ic->ifindex, mdns_arg ?: ""));
-	_request_item_append (&priv->request_queue_lst_head,
-	                      "SetLinkLLMNR",
-	                      g_variant_new ("(is)", ic->ifindex, llmnr_arg ?: ""));
+	prepare_one_request (self,
+	                     ic->ifindex,
+	                     LINK_OPERATION_DNS,
+	                     g_variant_builder_end (&dns));
+	prepare_one_request (self,
+	                     ic->ifindex,
+	                     LINK_OPERATION_DOMAINS,
+	                     g_variant_builder_end (&domains));
+	prepare_one_request (self,
+	                     ic->ifindex,
+	                     LINK_OPERATION_MULTICAST_DNS,
+	                     g_variant_new ("(is)", ic->ifindex, mdns_arg ?: ""));
+	prepare_one_request (self,
+	                     ic->ifindex,
+	                     LINK_OPERATION_LLMNR,
+	                     g_variant_new ("(is)", ic->ifindex, llmnr_arg ?: ""));
 }
 
 static void
@@ -299,16 +401,25 @@ send_updates (NMDnsSystemdResolved *self)
 		return;
 	}
 
-	_LOGT ("send-updates: start %lu requests",
-	       c_list_length (&priv->request_queue_lst_head));
+	_LOGT ("send-updates: start %lu requests (%"G_GUINT64_FORMAT" unchanged requests suppressed so far)",
+	       c_list_length (&priv->request_queue_lst_head),
+	       priv->n_suppressed_calls);
 
-	nm_clear_g_cancellable (&priv->cancellable);
-
-	priv->cancellable = g_cancellable_new ();
+	/* Don't cancel the requests that are still in flight. Later updates only
+	 * send the calls that differ from them, so we must learn about their
+	 * failure. */
+	if (!priv->cancellable)
+		priv->cancellable = g_cancellable_new ();
 
 	while ((request_item = c_list_first_entry (&priv->request_queue_lst_head,
 	                                           RequestItem,
 	                                           request_queue_lst))) {
+		LinkState *link_state;
+
+		link_state = _link_state_get (self, request_item->ifindex);
+		nm_clear_pointer (&link_state->sent_args[request_item->operation], g_variant_unref);
+		link_state->sent_args[request_item->operation] = g_variant_ref (request_item->argument);
+
 		/* Above we explicitly call "StartServiceByName" trying to avoid D-Bus activating systmd-resolved
 		 * multiple times. There is still a race, were we might hit this line although actually
 		 * the service just quit this very moment. In that case, we would try to D-Bus activate the
@@ -321,7 +432,7 @@ send_updates (NMDnsSystemdResolved *self)
 		                        SYSTEMD_RESOLVED_DBUS_SERVICE,
 		                        SYSTEMD_RESOLVED_DBUS_PATH,
 		                        SYSTEMD_RESOLVED_MANAGER_IFACE,
-		                        request_item->operation,
+		                        link_operation_names[request_item->operation],
 		                        request_item->argument,
 		                        NULL,
 		                        G_DBUS_CALL_FLAGS_NONE,
@@ -341,11 +452,14 @@ update (NMDnsPlugin *plugin,
         GError **error)
 {
 	NMDnsSystemdResolved *self = NM_DNS_SYSTEMD_RESOLVED (plugin);
+	NMDnsSystemdResolvedPrivate *priv = NM_DNS_SYSTEMD_RESOLVED_GET_PRIVATE (self);
 	gs_unref_hashtable GHashTable *interfaces = NULL;
 	gs_free gpointer *interfaces_keys = NULL;
 	guint interfaces_len;
 	guint i;
 	NMDnsIPConfigData *ip_data;
+	GHashTableIter iter;
+	LinkState *link_state;
 
 	interfaces = g_hash_table_new_full (nm_direct_hash, NULL,
 	                                    NULL, (GDestroyNotify) _interface_config_free);
@@ -369,8 +483,17 @@ update (NMDnsPlugin *plugin,
 		                  &nm_c_list_elem_new_stale (ip_data)->lst);
 	}
 
+	/* the pending requests are superseded by this update. */
 	free_pending_updates (self);
 
+	/* forget the links that are gone. Should they come back, their
+	 * configuration gets sent again. */
+	g_hash_table_iter_init (&iter, priv->link_states);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &link_state, NULL)) {
+		if (!g_hash_table_contains (interfaces, GINT_TO_POINTER (link_state->ifindex)))
+			g_hash_table_iter_remove (&iter);
+	}
+
 	interfaces_keys = nm_utils_hash_keys_to_array (interfaces,
 	                                               nm_cmp_int2ptr_p_with_data,
 	                                               NULL,
@@ -401,6 +524,12 @@ name_owner_changed (NMDnsSystemdResolved *self,
 	else
 		_LOGT ("D-Bus name for systemd-resolved has owner %s", owner);
 
+	if (priv->dbus_has_owner != (!!owner)) {
+		/* systemd-resolved quit or (re)started. It has no configuration for
+		 * our links. */
+		_link_states_reset (self);
+	}
+
 	priv->dbus_has_owner = !!owner;
 	if (owner)
 		priv->try_start_blocked = FALSE;
@@ -486,6 +615,8 @@ nm_dns_systemd_resolved_init (NMDnsSystemdResolved *self)
 	NMDnsSystemdResolvedPrivate *priv = NM_DNS_SYSTEMD_RESOLVED_GET_PRIVATE (self);
 
 	c_list_init (&priv->request_queue_lst_head);
+	priv->link_states = g_hash_table_new_full (nm_pint_hash, nm_pint_equals,
+	                                           (GDestroyNotify) _link_state_free, NULL);
 
 	priv->dbus_connection = nm_g_object_ref (NM_MAIN_DBUS_CONNECTION_GET);
 	if (!priv->dbus_connection) {
@@ -520,6 +651,7 @@ dispose (GObject *object)
 	NMDnsSystemdResolvedPrivate *priv = NM_DNS_SYSTEMD_RESOLVED_GET_PRIVATE (self);
 
 	free_pending_updates (self);
+	nm_clear_pointer (&priv->link_states, g_hash_table_unref);
 
 	nm_clear_g_dbus_connection_signal (priv->dbus_connection,
 	                                   &priv->name_owner_changed_id);
@@ -0,0 +1,401 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#include "nm-default.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "nm-std-aux/unaligned.h"
+#include "dns/nm-dns-forwarder.h"
+#include "dns/nm-dns-manager.h"
+
+#include "nm-test-utils-core.h"
+
+/*****************************************************************************/
+
+typedef enum {
+	STUB_REPLY_A,
+	STUB_REPLY_NXDOMAIN,
+	STUB_REPLY_LARGE,
+} StubReply;
+
+/* more A records than fit into 4096 bytes. */
+#define STUB_LARGE_N_ANSWERS 300
+
+typedef struct {
+	GSource *source;
+	int fd;
+	guint n_queries;
+	StubReply reply;
+} Stub;
+
+typedef struct {
+	GSource *source;
+	int fd;
+	guint8 buf[8192];
+	gssize len;
+} Client;
+
+static gssize
+_build_query (guint8 *buf, guint16 id, const char *name)
+{
+	gs_strfreev char **labels = g_strsplit (name, ".", -1);
+	gsize offset = 12;
+	guint i;
+
+	memset (buf, 0, 12);
+	unaligned_write_be16 (&buf[0], id);
+	unaligned_write_be16 (&buf[2], 0x0100);
+	unaligned_write_be16 (&buf[4], 1);
+	for (i = 0; labels[i]; i++) {
+		buf[offset++] = strlen (labels[i]);
+		memcpy (&buf[offset], labels[i], strlen (labels[i]));
+		offset += strlen (labels[i]);
+	}
+	buf[offset++] = 0;
+	unaligned_write_be16 (&buf[offset], 1);
+	unaligned_write_be16 (&buf[offset + 2], 1);
+	return offset + 4;
+}
+
+static gboolean
+_stub_cb (int fd, GIOCondition condition, gpointer user_data)
+{
+	Stub *stub = user_data;
+	struct sockaddr_in from;
+	socklen_t from_len = sizeof (from);
+	guint8 buf[8192];
+	gssize n;
+
+	n = recvfrom (fd, buf, 512, 0, (struct sockaddr *) &from, &from_len);
+	g_assert_cmpint (n, >, 12);
+	stub->n_queries++;
+
+	unaligned_write_be16 (&buf[4], 1);
+	if (stub->reply == STUB_REPLY_LARGE) {
+		guint i;
+
+		unaligned_write_be16 (&buf[2], 0x8180);
+		unaligned_write_be16 (&buf[6], STUB_LARGE_N_ANSWERS);
+		for (i = 0; i < STUB_LARGE_N_ANSWERS; i++) {
+			const guint8 answer[] = {
+				0xC0, 0x0C,                     /* name: pointer to the question */
+				0x00, 0x01, 0x00, 0x01,         /* A, IN */
+				0x00, 0x00, 0x01, 0x2C,         /* TTL 300 */
+				0x00, 0x04, 10, 0, (guint8) (i >> 8), (guint8) i, /* 10.0.x.y */
+			};
+
+			g_assert_cmpint (n + sizeof (answer), <=, sizeof (buf));
+			memcpy (&buf[n], answer, sizeof (answer));
+			n += sizeof (answer);
+		}
+	} else if (stub->reply == STUB_REPLY_A) {
+		static const guint8 answer[] = {
+			0xC0, 0x0C,                     /* name: pointer to the question */
+			0x00, 0x01, 0x00, 0x01,         /* A, IN */
+			0x00, 0x00, 0x01, 0x2C,         /* TTL 300 */
+			0x00, 0x04, 192, 0, 2, 1,       /* 192.0.2.1 */
+		};
+
+		unaligned_write_be16 (&buf[2], 0x8180);
+		unaligned_write_be16 (&buf[6], 1);
+		memcpy (&buf[n], answer, sizeof (answer));
+		n += sizeof (answer);
+	} else {
+		static const guint8 authority[] = {
+			0x00,                           /* name: the root */
+			0x00, 0x06, 0x00, 0x01,         /* SOA, IN */
+			0x00, 0x00, 0x0E, 0x10,         /* TTL 3600 */
+			0x00, 0x16,                     /* rdlength 22 */
+			0x00, 0x00,                     /* mname and rname: the root */
+			0x00, 0x00, 0x00, 0x01,         /* serial */
+			0x00, 0x00, 0x00, 0x01,         /* refresh */
+			0x00, 0x00, 0x00, 0x01,         /* retry */
+			0x00, 0x00, 0x00, 0x01,         /* expire */
+			0x00, 0x00, 0x00, 0x3C,         /* minimum 60 */
+		};
+
+		unaligned_write_be16 (&buf[2], 0x8183);
+		unaligned_write_be16 (&buf[8], 1);
+		memcpy (&buf[n], authority, sizeof (authority));
+		n += sizeof (authority);
+	}
+
+	g_assert_cmpint (sendto (fd, buf, n, 0, (struct sockaddr *) &from, from_len), ==, n);
+	return G_SOURCE_CONTINUE;
+}
+
+static guint16
+_stub_start (Stub *stub, const char *addr, guint16 port)
+{
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+		.sin_port = htons (port),
+		.sin_addr.s_addr = nmtst_inet4_from_string (addr),
+	};
+	socklen_t sin_len = sizeof (sin);
+
+	stub->fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	g_assert_cmpint (stub->fd, >=, 0);
+	g_assert_cmpint (bind (stub->fd, (struct sockaddr *) &sin, sizeof (sin)), ==, 0);
+	g_assert_cmpint (getsockname (stub->fd, (struct sockaddr *) &sin, &sin_len), ==, 0);
+
+	stub->source = nm_g_unix_fd_source_new (stub->fd, G_IO_IN, G_PRIORITY_DEFAULT, _stub_cb, stub, NULL);
+	g_source_attach (stub->source, NULL);
+	return ntohs (sin.sin_port);
+}
+
+static void
+_stub_stop (Stub *stub)
+{
+	nm_clear_g_source_inst (&stub->source);
+	nm_close (nm_steal_fd (&stub->fd));
+}
+
+static gboolean
+_client_cb (int fd, GIOCondition condition, gpointer user_data)
+{
+	Client *client = user_data;
+
+	client->len = recv (fd, client->buf, sizeof (client->buf), 0);
+	g_assert_cmpint (client->len, >=, 12);
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+_client_start (Client *client, guint16 port)
+{
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+		.sin_port = htons (port),
+		.sin_addr.s_addr = htonl (INADDR_LOOPBACK),
+	};
+
+	client->fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	g_assert_cmpint (client->fd, >=, 0);
+	g_assert_cmpint (connect (client->fd, (struct sockaddr *) &sin, sizeof (sin)), ==, 0);
+
+	client->source = nm_g_unix_fd_source_new (client->fd, G_IO_IN, G_PRIORITY_DEFAULT, _client_cb, client, NULL);
+	g_source_attach (client->source, NULL);
+}
+
+static void
+_client_stop (Client *client)
+{
+	nm_clear_g_source_inst (&client->source);
+	nm_close (nm_steal_fd (&client->fd));
+}
+
+static guint
+_client_query (Client *client, guint16 id, const char *name)
+{
+	guint8 buf[512];
+	gssize n;
+
+	n = _build_query (buf, id, name);
+	client->len = -1;
+	g_assert_cmpint (send (client->fd, buf, n, 0), ==, n);
+
+	nmtst_main_context_iterate_until_assert (NULL, 5000, client->len >= 0);
+
+	g_assert_cmpint (unaligned_read_be16 (&client->buf[0]), ==, id);
+	return unaligned_read_be16 (&client->buf[2]) & 0x000F;
+}
+
+/*****************************************************************************/
+
+typedef struct {
+	NMDnsConfigData data;
+	NMDnsIPConfigData ip_data;
+	NMIP4Config *ip4_config;
+} TestIPData;
+
+static void
+_ip_data_init (TestIPData *d,
+               CList *lst_head,
+               int ifindex,
+               const char *nameserver,
+               const char *const*search)
+{
+	d->ip4_config = nmtst_ip4_config_new (ifindex);
+	nm_ip4_config_add_nameserver (d->ip4_config, nmtst_inet4_from_string (nameserver));
+
+	d->data = (NMDnsConfigData) {
+		.ifindex = ifindex,
+	};
+	c_list_init (&d->data.data_lst_head);
+
+	d->ip_data = (NMDnsIPConfigData) {
+		.data            = &d->data,
+		.ip_config       = NM_IP_CONFIG_CAST (d->ip4_config),
+		.ip_config_type  = NM_DNS_IP_CONFIG_TYPE_DEFAULT,
+		.domains.search  = (const char **) search,
+	};
+	c_list_link_tail (&d->data.data_lst_head, &d->ip_data.data_lst);
+	c_list_link_tail (lst_head, &d->ip_data.ip_config_lst);
+}
+
+static void
+_ip_data_clear (TestIPData *d)
+{
+	c_list_unlink (&d->ip_data.ip_config_lst);
+	c_list_unlink (&d->ip_data.data_lst);
+	g_clear_object (&d->ip4_config);
+}
+
+/*****************************************************************************/
+
+static void
+test_cache (void)
+{
+	static const char *const search[] = { "~", NULL };
+	gs_unref_object NMDnsPlugin *plugin = NULL;
+	gs_free_error GError *error = NULL;
+	CList lst_head = C_LIST_INIT (lst_head);
+	TestIPData d;
+	Stub stub = { .fd = -1 };
+	Client client = { .fd = -1 };
+	guint16 port;
+
+	port = _stub_start (&stub, "127.0.0.1", 0);
+	_ip_data_init (&d, &lst_head, 1, "127.0.0.1", search);
+
+	plugin = nmtst_dns_forwarder_new (port, 16);
+	g_assert (nm_dns_plugin_update (plugin, NULL, &lst_head, NULL, &error));
+	g_assert_no_error (error);
+
+	_client_start (&client, nmtst_dns_forwarder_get_listen_port (NM_DNS_FORWARDER (plugin)));
+
+	/* a positive answer is forwarded once, then served from the cache. */
+	stub.reply = STUB_REPLY_A;
+	g_assert_cmpint (_client_query (&client, 0x1234, "www.example.com"), ==, 0);
+	g_assert_cmpint (stub.n_queries, ==, 1);
+	g_assert_cmpint (_client_query (&client, 0x4321, "WWW.example.com"), ==, 0);
+	g_assert_cmpint (stub.n_queries, ==, 1);
+	g_assert_cmpint (unaligned_read_be16 (&client.buf[6]), ==, 1);
+
+	/* so is a negative answer with a SOA record. */
+	stub.reply = STUB_REPLY_NXDOMAIN;
+	g_assert_cmpint (_client_query (&client, 1, "nx.example.com"), ==, 3);
+	g_assert_cmpint (stub.n_queries, ==, 2);
+	g_assert_cmpint (_client_query (&client, 2, "nx.example.com"), ==, 3);
+	g_assert_cmpint (stub.n_queries, ==, 2);
+
+	/* an update flushes the cache. */
+	g_assert (nm_dns_plugin_update (plugin, NULL, &lst_head, NULL, &error));
+	g_assert_cmpint (_client_query (&client, 3, "nx.example.com"), ==, 3);
+	g_assert_cmpint (stub.n_queries, ==, 3);
+
+	_client_stop (&client);
+	nm_dns_plugin_stop (plugin);
+	_ip_data_clear (&d);
+	_stub_stop (&stub);
+}
+
+static void
+test_large_answer (void)
+{
+	static const char *const search[] = { "~", NULL };
+	gs_unref_object NMDnsPlugin *plugin = NULL;
+	gs_free_error GError *error = NULL;
+	CList lst_head = C_LIST_INIT (lst_head);
+	TestIPData d;
+	Stub stub = { .fd = -1, .reply = STUB_REPLY_LARGE };
+	Client client = { .fd = -1 };
+	guint16 port;
+
+	port = _stub_start (&stub, "127.0.0.1", 0);
+	_ip_data_init (&d, &lst_head, 1, "127.0.0.1", search);
+
+	plugin = nmtst_dns_forwarder_new (port, 16);
+	g_assert (nm_dns_plugin_update (plugin, NULL, &lst_head, NULL, &error));
+	g_assert_no_error (error);
+
+	_client_start (&client, nmtst_dns_forwarder_get_listen_port (NM_DNS_FORWARDER (plugin)));
+
+	/* an answer larger than 4096 bytes is passed on in full. */
+	g_assert_cmpint (_client_query (&client, 1, "large.example.com"), ==, 0);
+	g_assert_cmpint (client.len, >, 4096);
+	g_assert_cmpint (unaligned_read_be16 (&client.buf[6]), ==, STUB_LARGE_N_ANSWERS);
+	g_assert (!NM_FLAGS_HAS (unaligned_read_be16 (&client.buf[2]), 0x0200));
+	g_assert_cmpint (client.buf[client.len - 1], ==, (guint8) (STUB_LARGE_N_ANSWERS - 1));
+	g_assert_cmpint (stub.n_queries, ==, 1);
+
+	/* but it is not cached. */
+	g_assert_cmpint (_client_query (&client, 2, "large.example.com"), ==, 0);
+	g_assert_cmpint (client.len, >, 4096);
+	g_assert_cmpint (stub.n_queries, ==, 2);
+
+	_client_stop (&client);
+	nm_dns_plugin_stop (plugin);
+	_ip_data_clear (&d);
+	_stub_stop (&stub);
+}
+
+static void
+test_split_dns (void)
+{
+	static const char *const search_default[] = { "~", NULL };
+	static const char *const search_corp[] = { "~corp.example.com", NULL };
+	gs_unref_object NMDnsPlugin *plugin = NULL;
+	gs_free_error GError *error = NULL;
+	CList lst_head = C_LIST_INIT (lst_head);
+	TestIPData d1;
+	TestIPData d2;
+	Stub stub1 = { .fd = -1 };
+	Stub stub2 = { .fd = -1 };
+	Client client = { .fd = -1 };
+	guint16 port;
+
+	port = _stub_start (&stub1, "127.0.0.1", 0);
+	_stub_start (&stub2, "127.0.0.2", port);
+	_ip_data_init (&d1, &lst_head, 1, "127.0.0.1", search_default);
+	_ip_data_init (&d2, &lst_head, 2, "127.0.0.2", search_corp);
+
+	plugin = nmtst_dns_forwarder_new (port, 0);
+	g_assert (nm_dns_plugin_update (plugin, NULL, &lst_head, NULL, &error));
+	g_assert_no_error (error);
+
+	_client_start (&client, nmtst_dns_forwarder_get_listen_port (NM_DNS_FORWARDER (plugin)));
+
+	g_assert_cmpint (_client_query (&client, 1, "www.example.com"), ==, 0);
+	g_assert_cmpint (stub1.n_queries, ==, 1);
+	g_assert_cmpint (stub2.n_queries, ==, 0);
+
+	g_assert_cmpint (_client_query (&client, 2, "host.corp.example.com"), ==, 0);
+	g_assert_cmpint (stub1.n_queries, ==, 1);
+	g_assert_cmpint (stub2.n_queries, ==, 1);
+
+	g_assert_cmpint (_client_query (&client, 3, "corp.example.com"), ==, 0);
+	g_assert_cmpint (stub2.n_queries, ==, 2);
+
+	/* without cache, every query is forwarded. */
+	g_assert_cmpint (_client_query (&client, 4, "www.example.com"), ==, 0);
+	g_assert_cmpint (stub1.n_queries, ==, 2);
+
+	_client_stop (&client);
+	nm_dns_plugin_stop (plugin);
+	_ip_data_clear (&d2);
+	_ip_data_clear (&d1);
+	_stub_stop (&stub2);
+	_stub_stop (&stub1);
+}
+
+/*****************************************************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_assert_logging (&argc, &argv, "INFO", "DEFAULT");
+
+	g_test_add_func ("/dns/forwarder/cache", test_cache);
+	g_test_add_func ("/dns/forwarder/large-answer", test_large_answer);
+	g_test_add_func ("/dns/forwarder/split-dns", test_split_dns);
+
+	return g_test_run ();
+}
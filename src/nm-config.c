@@ -756,6 +756,9 @@ static const ConfigGroup config_groups[] = {
 			NM_CONFIG_KEYFILE_KEY_MAIN_CONFIGURE_AND_QUIT,
 			NM_CONFIG_KEYFILE_KEY_MAIN_DEBUG,
 			NM_CONFIG_KEYFILE_KEY_MAIN_DHCP,
+			NM_CONFIG_KEYFILE_KEY_MAIN_DHCP_START_BACKOFF_MAX,
+			NM_CONFIG_KEYFILE_KEY_MAIN_DHCP_START_JITTER,
+			NM_CONFIG_KEYFILE_KEY_MAIN_DHCP_START_MAX_INFLIGHT,
 			NM_CONFIG_KEYFILE_KEY_MAIN_DNS,
 			NM_CONFIG_KEYFILE_KEY_MAIN_HOSTNAME_MODE,
 			NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_CARRIER,
@@ -763,6 +766,7 @@ static const ConfigGroup config_groups[] = {
 			NM_CONFIG_KEYFILE_KEY_MAIN_NO_AUTO_DEFAULT,
 			NM_CONFIG_KEYFILE_KEY_MAIN_PLUGINS,
 			NM_CONFIG_KEYFILE_KEY_MAIN_RC_MANAGER,
+			NM_CONFIG_KEYFILE_KEY_MAIN_SHUTDOWN_TIMEOUT,
 			NM_CONFIG_KEYFILE_KEY_MAIN_SLAVES_ORDER,
 			NM_CONFIG_KEYFILE_KEY_MAIN_SYSTEMD_RESOLVED,
 		),
@@ -781,6 +785,7 @@ static const ConfigGroup config_groups[] = {
 		.keys = NM_MAKE_STRV (
 			NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_ENABLED,
 			NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_INTERVAL,
+			NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_MAX_INTERVAL,
 			NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_RESPONSE,
 			NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_URI,
 		),
@@ -788,6 +793,8 @@ static const ConfigGroup config_groups[] = {
 	{
 		.group = NM_CONFIG_KEYFILE_GROUP_KEYFILE,
 		.keys = NM_MAKE_STRV (
+			NM_CONFIG_KEYFILE_KEY_KEYFILE_AUTO_RELOAD_DELAY,
+			NM_CONFIG_KEYFILE_KEY_KEYFILE_CONNECTION_CACHE,
 			NM_CONFIG_KEYFILE_KEY_KEYFILE_HOSTNAME,
 			NM_CONFIG_KEYFILE_KEY_KEYFILE_PATH,
 			NM_CONFIG_KEYFILE_KEY_KEYFILE_UNMANAGED_DEVICES,
@@ -2184,6 +2191,7 @@ _nm_config_state_set (NMConfig *self,
 #define DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_MANAGED             "managed"
 #define DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_PERM_HW_ADDR_FAKE   "perm-hw-addr-fake"
 #define DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_CONNECTION_UUID     "connection-uuid"
+#define DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_CONNECTION_CHECKSUM "connection-checksum"
 #define DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_NM_OWNED            "nm-owned"
 #define DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_ROUTE_METRIC_DEFAULT_ASPIRED   "route-metric-default-aspired"
 #define DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_ROUTE_METRIC_DEFAULT_EFFECTIVE "route-metric-default-effective"
@@ -2204,8 +2212,10 @@ _config_device_state_data_new (int ifindex, GKeyFile *kf)
 	NMConfigDeviceStateData *device_state;
 	NMConfigDeviceStateManagedType managed_type = NM_CONFIG_DEVICE_STATE_MANAGED_TYPE_UNKNOWN;
 	gs_free char *connection_uuid = NULL;
+	gs_free char *connection_checksum = NULL;
 	gs_free char *perm_hw_addr_fake = NULL;
 	gsize connection_uuid_len;
+	gsize connection_checksum_len;
 	gsize perm_hw_addr_fake_len;
 	NMTernary nm_owned;
 	char *p;
@@ -2225,6 +2235,12 @@ _config_device_state_data_new (int ifindex, GKeyFile *kf)
 		                                               DEVICE_RUN_STATE_KEYFILE_GROUP_DEVICE,
 		                                               DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_CONNECTION_UUID,
 		                                               NM_CONFIG_GET_VALUE_STRIP | NM_CONFIG_GET_VALUE_NO_EMPTY);
+		if (connection_uuid) {
+			connection_checksum = nm_config_keyfile_get_value (kf,
+			                                                   DEVICE_RUN_STATE_KEYFILE_GROUP_DEVICE,
+			                                                   DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_CONNECTION_CHECKSUM,
+			                                                   NM_CONFIG_GET_VALUE_STRIP | NM_CONFIG_GET_VALUE_NO_EMPTY);
+		}
 		break;
 	case FALSE:
 		managed_type = NM_CONFIG_DEVICE_STATE_MANAGED_TYPE_UNMANAGED;
@@ -2267,15 +2283,18 @@ _config_device_state_data_new (int ifindex, GKeyFile *kf)
 		route_metric_default_aspired = 0;
 
 	connection_uuid_len = connection_uuid ? strlen (connection_uuid) + 1 : 0;
+	connection_checksum_len = connection_checksum ? strlen (connection_checksum) + 1 : 0;
 	perm_hw_addr_fake_len = perm_hw_addr_fake ? strlen (perm_hw_addr_fake) + 1 : 0;
 
 	device_state = g_malloc (sizeof (NMConfigDeviceStateData) +
 	                         connection_uuid_len +
+	                         connection_checksum_len +
 	                         perm_hw_addr_fake_len);
 
 	device_state->ifindex = ifindex;
 	device_state->managed = managed_type;
 	device_state->connection_uuid = NULL;
+	device_state->connection_checksum = NULL;
 	device_state->perm_hw_addr_fake = NULL;
 	device_state->nm_owned = nm_owned;
 	device_state->route_metric_default_aspired = route_metric_default_aspired;
@@ -2287,6 +2306,11 @@ _config_device_state_data_new (int ifindex, GKeyFile *kf)
 		device_state->connection_uuid = p;
 		p += connection_uuid_len;
 	}
+	if (connection_checksum) {
+		memcpy (p, connection_checksum, connection_checksum_len);
+		device_state->connection_checksum = p;
+		p += connection_checksum_len;
+	}
 	if (perm_hw_addr_fake) {
 		memcpy (p, perm_hw_addr_fake, perm_hw_addr_fake_len);
 		device_state->perm_hw_addr_fake = p;
@@ -2389,6 +2413,7 @@ nm_config_device_state_write (int ifindex,
                               NMConfigDeviceStateManagedType managed,
                               const char *perm_hw_addr_fake,
                               const char *connection_uuid,
+                              const char *connection_checksum,
                               NMTernary nm_owned,
                               guint32 route_metric_default_aspired,
                               guint32 route_metric_default_effective,
@@ -2402,6 +2427,7 @@ nm_config_device_state_write (int ifindex,
 	g_return_val_if_fail (ifindex > 0, FALSE);
 	g_return_val_if_fail (!connection_uuid || *connection_uuid, FALSE);
 	g_return_val_if_fail (managed == NM_CONFIG_DEVICE_STATE_MANAGED_TYPE_MANAGED || !connection_uuid, FALSE);
+	g_return_val_if_fail (connection_uuid || !connection_checksum, FALSE);
 
 	nm_assert (!perm_hw_addr_fake || nm_utils_hwaddr_valid (perm_hw_addr_fake, -1));
 
@@ -2428,6 +2454,12 @@ nm_config_device_state_write (int ifindex,
 		                       DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_CONNECTION_UUID,
 		                       connection_uuid);
 	}
+	if (connection_checksum) {
+		g_key_file_set_string (kf,
+		                       DEVICE_RUN_STATE_KEYFILE_GROUP_DEVICE,
+		                       DEVICE_RUN_STATE_KEYFILE_KEY_DEVICE_CONNECTION_CHECKSUM,
+		                       connection_checksum);
+	}
 	if (nm_owned != NM_TERNARY_DEFAULT) {
 		g_key_file_set_boolean (kf,
 		                        DEVICE_RUN_STATE_KEYFILE_GROUP_DEVICE,
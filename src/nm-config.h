@@ -48,6 +48,9 @@
 #define NM_CONFIG_KEYFILE_KEY_MAIN_CONFIGURE_AND_QUIT       "configure-and-quit"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_DEBUG                    "debug"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_DHCP                     "dhcp"
+#define NM_CONFIG_KEYFILE_KEY_MAIN_DHCP_START_BACKOFF_MAX   "dhcp-start-backoff-max"
+#define NM_CONFIG_KEYFILE_KEY_MAIN_DHCP_START_JITTER        "dhcp-start-jitter"
+#define NM_CONFIG_KEYFILE_KEY_MAIN_DHCP_START_MAX_INFLIGHT  "dhcp-start-max-inflight"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_DNS                      "dns"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_HOSTNAME_MODE            "hostname-mode"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_IGNORE_CARRIER           "ignore-carrier"
@@ -55,6 +58,7 @@
 #define NM_CONFIG_KEYFILE_KEY_MAIN_NO_AUTO_DEFAULT          "no-auto-default"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_PLUGINS                  "plugins"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_RC_MANAGER               "rc-manager"
+#define NM_CONFIG_KEYFILE_KEY_MAIN_SHUTDOWN_TIMEOUT         "shutdown-timeout"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_SLAVES_ORDER             "slaves-order"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_SYSTEMD_RESOLVED         "systemd-resolved"
 
@@ -65,9 +69,12 @@
 
 #define NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_ENABLED          "enabled"
 #define NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_INTERVAL         "interval"
+#define NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_MAX_INTERVAL     "max-interval"
 #define NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_RESPONSE         "response"
 #define NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_URI              "uri"
 
+#define NM_CONFIG_KEYFILE_KEY_KEYFILE_AUTO_RELOAD_DELAY     "auto-reload-delay"
+#define NM_CONFIG_KEYFILE_KEY_KEYFILE_CONNECTION_CACHE      "connection-cache"
 #define NM_CONFIG_KEYFILE_KEY_KEYFILE_PATH                  "path"
 #define NM_CONFIG_KEYFILE_KEY_KEYFILE_UNMANAGED_DEVICES     "unmanaged-devices"
 #define NM_CONFIG_KEYFILE_KEY_KEYFILE_HOSTNAME              "hostname"
@@ -239,6 +246,10 @@ struct _NMConfigDeviceStateData {
 	 * on the device. */
 	const char *connection_uuid;
 
+	/* a checksum of the settings-connection at the time the
+	 * state was written. Only set together with @connection_uuid. */
+	const char *connection_checksum;
+
 	const char *perm_hw_addr_fake;
 
 	/* whether the device was nm-owned (0/1) or -1 for
@@ -252,6 +263,7 @@ gboolean nm_config_device_state_write (int ifindex,
                                        NMConfigDeviceStateManagedType managed,
                                        const char *perm_hw_addr_fake,
                                        const char *connection_uuid,
+                                       const char *connection_checksum,
                                        NMTernary nm_owned,
                                        guint32 route_metric_default_aspired,
                                        guint32 route_metric_default_effective,
@@ -24,6 +24,19 @@
 
 #define HEADER_STATUS_ONLINE "X-NetworkManager-Status: online\r\n"
 
+/* the maximum number of HTTP requests that run at the same time. Further
+ * checks wait in a queue. */
+#define CON_MAX_PARALLEL_REQUESTS 16
+
+/* how long an unused pool is kept after the longest periodic check interval
+ * (including its jitter), so that the next check can reuse its connection. */
+#define CON_POOL_IDLE_EXTRA_SEC   30
+
+/* the most response data that we read. The result is usually known after
+ * the first bytes, but we keep receiving the rest of the response, so that
+ * the connection can be reused. */
+#define CON_MAX_RESPONSE_LEN      (100 * 1024)
+
 /*****************************************************************************/
 
 static
@@ -57,6 +70,30 @@ typedef struct {
 	char *response;
 } ConConfig;
 
+#if WITH_CONCHECK
+/* A pool of HTTP connections for one (interface, address family). The curl
+ * multi-handle keeps the connection alive between checks, so that the next
+ * check can skip the TCP (and TLS) handshake. Each pool has a multi-handle of
+ * its own, because the multi-handle also caches the names that we resolve
+ * per interface via systemd-resolved.
+ *
+ * When the network of the interface changes, or a check doesn't find full
+ * connectivity, the kept connection may be stale (or go to a captive portal).
+ * Then the pool gets detached: new checks get a new pool, and the old one is
+ * freed when its last check completes. */
+typedef struct {
+	CList pools_lst;
+	NMConnectivity *self;
+	char *ifspec;
+	CURLM *curl_mhandle;
+	GSource *curl_timer;
+	GSource *idle_source;
+	guint n_requests;
+	int addr_family;
+	bool detached:1;
+} ConPool;
+#endif
+
 struct _NMConnectivityCheckHandle {
 	CList handles_lst;
 	NMConnectivity *self;
@@ -73,14 +110,20 @@ struct _NMConnectivityCheckHandle {
 		ConConfig *con_config;
 
 		GCancellable *resolve_cancellable;
-		CURLM *curl_mhandle;
+		CList queue_lst;
+		ConPool *pool;
 		CURL *curl_ehandle;
 		struct curl_slist *request_headers;
 		struct curl_slist *hosts;
 
 		gsize response_good_cnt;
+		gsize response_len;
+
+		const char *result_reason;
+		NMConnectivityState result_state;
+
+		long num_connects;
 
-		guint curl_timer;
 		int ch_ifindex;
 	} concheck;
 #endif
@@ -106,12 +149,19 @@ static guint signals[LAST_SIGNAL] = { 0 };
 typedef struct {
 	CList handles_lst_head;
 	CList completed_handles_lst_head;
+#if WITH_CONCHECK
+	CList queue_lst_head;
+	CList pools_lst_head;
+	guint n_requests;
+#endif
 	NMConfig *config;
 	ConConfig *con_config;
 	guint interval;
+	guint max_interval;
 
 	bool enabled:1;
 	bool uri_valid:1;
+	bool nmtst_no_resolve:1;
 } NMConnectivityPrivate;
 
 struct _NMConnectivity {
@@ -194,6 +244,11 @@ _con_config_get_response (const ConConfig *con_config)
 
 /*****************************************************************************/
 
+#if WITH_CONCHECK
+static void _con_queue_process (NMConnectivity *self);
+static void _con_pool_release (ConPool *pool, gboolean drop);
+#endif
+
 static void
 cb_data_complete (NMConnectivityCheckHandle *cb_data,
                   NMConnectivityState state,
@@ -216,6 +271,7 @@ cb_data_complete (NMConnectivityCheckHandle *cb_data,
 	c_list_unlink_stale (&cb_data->handles_lst);
 
 #if WITH_CONCHECK
+	c_list_unlink (&cb_data->concheck.queue_lst);
 	if (cb_data->concheck.curl_ehandle) {
 		/* Contrary to what cURL manual claim it is *not* safe to remove
 		 * the easy handle "at any moment"; specifically it's not safe to
@@ -231,15 +287,20 @@ cb_data_complete (NMConnectivityCheckHandle *cb_data,
 		curl_easy_setopt (cb_data->concheck.curl_ehandle, CURLOPT_PRIVATE, NULL);
 		curl_easy_setopt (cb_data->concheck.curl_ehandle, CURLOPT_HTTPHEADER, NULL);
 
-		curl_multi_remove_handle (cb_data->concheck.curl_mhandle,
+		curl_multi_remove_handle (cb_data->concheck.pool->curl_mhandle,
 		                          cb_data->concheck.curl_ehandle);
 		curl_easy_cleanup (cb_data->concheck.curl_ehandle);
-		curl_multi_cleanup (cb_data->concheck.curl_mhandle);
 
 		curl_slist_free_all (cb_data->concheck.request_headers);
 		curl_slist_free_all (cb_data->concheck.hosts);
+
+		_con_pool_release (cb_data->concheck.pool, state != NM_CONNECTIVITY_FULL);
+		cb_data->concheck.pool = NULL;
+
+		nm_assert (NM_CONNECTIVITY_GET_PRIVATE (self)->n_requests > 0);
+		NM_CONNECTIVITY_GET_PRIVATE (self)->n_requests--;
+		_con_queue_process (self);
 	}
-	nm_clear_g_source (&cb_data->concheck.curl_timer);
 	nm_clear_g_cancellable (&cb_data->concheck.resolve_cancellable);
 #endif
 
@@ -351,6 +412,20 @@ _con_curl_check_connectivity (CURLM *mhandle, int sockfd, int ev_bitmask)
 			continue;
 		}
 
+		if (curl_easy_getinfo (msg->easy_handle, CURLINFO_NUM_CONNECTS, &cb_data->concheck.num_connects) != CURLE_OK)
+			cb_data->concheck.num_connects = -1;
+
+		if (cb_data->concheck.result_state != NM_CONNECTIVITY_UNKNOWN) {
+			/* the callbacks already found the result while receiving. That
+			 * holds even if we stopped the transfer because the response
+			 * was too large. */
+			cb_data_queue_completed (cb_data,
+			                         cb_data->concheck.result_state,
+			                         cb_data->concheck.result_reason,
+			                         NULL);
+			continue;
+		}
+
 		if (msg->data.result != CURLE_OK) {
 			cb_data_queue_completed (cb_data,
 			                         NM_CONNECTIVITY_LIMITED,
@@ -408,26 +483,33 @@ _con_curl_check_connectivity (CURLM *mhandle, int sockfd, int ev_bitmask)
 static gboolean
 _con_curl_timeout_cb (gpointer user_data)
 {
-	NMConnectivityCheckHandle *cb_data = user_data;
+	ConPool *pool = user_data;
 
-	_con_curl_check_connectivity (cb_data->concheck.curl_mhandle, CURL_SOCKET_TIMEOUT, 0);
-	_complete_queued (cb_data->self);
+	nm_clear_g_source_inst (&pool->curl_timer);
+	_con_curl_check_connectivity (pool->curl_mhandle, CURL_SOCKET_TIMEOUT, 0);
+	_complete_queued (pool->self);
 	return G_SOURCE_CONTINUE;
 }
 
 static int
 multi_timer_cb (CURLM *multi, long timeout_msec, void *userdata)
 {
-	NMConnectivityCheckHandle *cb_data = userdata;
-
-	nm_clear_g_source (&cb_data->concheck.curl_timer);
-	if (timeout_msec != -1)
-		cb_data->concheck.curl_timer = g_timeout_add (timeout_msec, _con_curl_timeout_cb, cb_data);
+	ConPool *pool = userdata;
+
+	nm_clear_g_source_inst (&pool->curl_timer);
+	if (timeout_msec != -1) {
+		pool->curl_timer = nm_g_timeout_source_new (timeout_msec,
+		                                            G_PRIORITY_DEFAULT,
+		                                            _con_curl_timeout_cb,
+		                                            pool,
+		                                            NULL);
+		g_source_attach (pool->curl_timer, NULL);
+	}
 	return 0;
 }
 
 typedef struct {
-	NMConnectivityCheckHandle *cb_data;
+	ConPool *pool;
 
 	GSource *source;
 
@@ -446,7 +528,7 @@ _con_curl_socketevent_cb (int fd,
                           gpointer user_data)
 {
 	ConCurlSockData *fdp = user_data;
-	NMConnectivityCheckHandle *cb_data = fdp->cb_data;
+	ConPool *pool = fdp->pool;
 	int action = 0;
 	gboolean fdp_destroyed = FALSE;
 	gboolean success;
@@ -461,7 +543,7 @@ _con_curl_socketevent_cb (int fd,
 	nm_assert (!fdp->destroy_notify);
 	fdp->destroy_notify = &fdp_destroyed;
 
-	success = _con_curl_check_connectivity (cb_data->concheck.curl_mhandle, fd, action);
+	success = _con_curl_check_connectivity (pool->curl_mhandle, fd, action);
 
 	if (fdp_destroyed) {
 		/* hups. fdp got invalidated during _con_curl_check_connectivity(). That's fine,
@@ -473,7 +555,7 @@ _con_curl_socketevent_cb (int fd,
 			nm_clear_g_source_inst (&fdp->source);
 	}
 
-	_complete_queued (cb_data->self);
+	_complete_queued (pool->self);
 
 	return G_SOURCE_CONTINUE;
 }
@@ -481,7 +563,7 @@ _con_curl_socketevent_cb (int fd,
 static int
 multi_socket_cb (CURL *e_handle, curl_socket_t fd, int what, void *userdata, void *socketp)
 {
-	NMConnectivityCheckHandle *cb_data = userdata;
+	ConPool *pool = userdata;
 	ConCurlSockData *fdp = socketp;
 
 	(void) _NM_ENSURE_TYPE (int, fd);
@@ -491,7 +573,7 @@ multi_socket_cb (CURL *e_handle, curl_socket_t fd, int what, void *userdata, voi
 			if (fdp->destroy_notify)
 				*fdp->destroy_notify = TRUE;
 			nm_clear_g_source_inst (&fdp->source);
-			curl_multi_assign (cb_data->concheck.curl_mhandle, fd, NULL);
+			curl_multi_assign (pool->curl_mhandle, fd, NULL);
 			g_slice_free (ConCurlSockData, fdp);
 		}
 	} else {
@@ -500,9 +582,9 @@ multi_socket_cb (CURL *e_handle, curl_socket_t fd, int what, void *userdata, voi
 		if (!fdp) {
 			fdp = g_slice_new (ConCurlSockData);
 			*fdp = (ConCurlSockData) {
-				.cb_data = cb_data,
+				.pool = pool,
 			};
-			curl_multi_assign (cb_data->concheck.curl_mhandle, fd, fdp);
+			curl_multi_assign (pool->curl_mhandle, fd, fdp);
 		} else
 			nm_clear_g_source_inst (&fdp->source);
 
@@ -529,25 +611,39 @@ multi_socket_cb (CURL *e_handle, curl_socket_t fd, int what, void *userdata, voi
 	return CURLM_OK;
 }
 
+/* Remembers the result of the check. The transfer still runs to the end,
+ * because aborting it would also close the connection that we want to keep
+ * for the next check. The check completes once curl reports the transfer
+ * as done. */
+static void
+_con_result_set (NMConnectivityCheckHandle *cb_data,
+                 NMConnectivityState state,
+                 const char *reason)
+{
+	nm_assert (state != NM_CONNECTIVITY_UNKNOWN);
+	nm_assert (reason);
+
+	if (cb_data->concheck.result_state != NM_CONNECTIVITY_UNKNOWN)
+		return;
+
+	cb_data->concheck.result_state = state;
+	cb_data->concheck.result_reason = reason;
+}
+
 static size_t
 easy_header_cb (char *buffer, size_t size, size_t nitems, void *userdata)
 {
 	NMConnectivityCheckHandle *cb_data = userdata;
 	size_t len = size * nitems;
 
-	if (cb_data->completed_state != NM_CONNECTIVITY_UNKNOWN) {
-		/* already completed. */
-		return 0;
+	if (cb_data->concheck.result_state != NM_CONNECTIVITY_UNKNOWN) {
+		/* already have a result. Keep receiving. */
+		return len;
 	}
 
 	if (   len >= sizeof (HEADER_STATUS_ONLINE) - 1
-	    && !g_ascii_strncasecmp (buffer, HEADER_STATUS_ONLINE, sizeof (HEADER_STATUS_ONLINE) - 1)) {
-		cb_data_queue_completed (cb_data,
-		                         NM_CONNECTIVITY_FULL,
-		                         "status header found",
-		                         NULL);
-		return 0;
-	}
+	    && !g_ascii_strncasecmp (buffer, HEADER_STATUS_ONLINE, sizeof (HEADER_STATUS_ONLINE) - 1))
+		_con_result_set (cb_data, NM_CONNECTIVITY_FULL, "status header found");
 
 	return len;
 }
@@ -561,45 +657,42 @@ easy_write_cb (void *buffer, size_t size, size_t nmemb, void *userdata)
 	size_t check_len;
 	const char *response;
 
-	if (cb_data->completed_state != NM_CONNECTIVITY_UNKNOWN) {
-		/* already completed. */
+	cb_data->concheck.response_len += len;
+	if (cb_data->concheck.response_len > CON_MAX_RESPONSE_LEN) {
+		/* we expect either an empty response, or a short one. We accept
+		 * any trailing data, but if we get an excessive amount of it, we
+		 * put a stop on it. That costs the connection. */
+		_con_result_set (cb_data,
+		                 NM_CONNECTIVITY_PORTAL,
+		                 "unexpected non-empty response");
 		return 0;
 	}
 
+	if (cb_data->concheck.result_state != NM_CONNECTIVITY_UNKNOWN) {
+		/* already have a result. Keep receiving. */
+		return len;
+	}
+
 	if (len == 0) {
 		/* no data. That can happen, it's fine. */
 		return len;
 	}
 
-	response = _con_config_get_response (cb_data->concheck.con_config);;
+	response = _con_config_get_response (cb_data->concheck.con_config);
 
 	if (response[0] == '\0') {
 		/* no response expected. We are however graceful and accept any
 		 * extra response that we might receive. We determine the empty
 		 * response based on the status code 204.
 		 *
-		 * Continue receiving... */
+		 * We accept either
+		 * 1) status code 204 and any response
+		 * 2) status code 200 and an empty response.
+		 *
+		 * Continue receiving, to see whether we have case 1). Arguably, the
+		 * server shouldn't send us 204 with a non-empty response, but we accept
+		 * that also with a non-empty response. */
 		cb_data->concheck.response_good_cnt += len;
-
-		if (cb_data->concheck.response_good_cnt > (gsize) (100 * 1024)) {
-			/* we expect an empty response. We accept either
-			 * 1) status code 204 and any response
-			 * 2) status code 200 and an empty response.
-			 *
-			 * Here, we want to continue receiving data, to see whether we have
-			 * case 1). Arguably, the server shouldn't send us 204 with a non-empty
-			 * response, but we accept that also with a non-empty response, so
-			 * keep receiving.
-			 *
-			 * However, if we get an excessive amount of data, we put a stop on it
-			 * and fail. */
-			cb_data_queue_completed (cb_data,
-			                         NM_CONNECTIVITY_PORTAL,
-			                         "unexpected non-empty response",
-			                         NULL);
-			return 0;
-		}
-
 		return len;
 	}
 
@@ -613,22 +706,15 @@ easy_write_cb (void *buffer, size_t size, size_t nmemb, void *userdata)
 	if (strncmp (&response[cb_data->concheck.response_good_cnt],
 	             buffer,
 	             check_len) != 0) {
-		cb_data_queue_completed (cb_data,
-		                         NM_CONNECTIVITY_PORTAL,
-		                         "unexpected response",
-		                         NULL);
-		return 0;
+		_con_result_set (cb_data, NM_CONNECTIVITY_PORTAL, "unexpected response");
+		return len;
 	}
 
 	cb_data->concheck.response_good_cnt += len;
 
 	if (cb_data->concheck.response_good_cnt >= response_len) {
 		/* We already have enough data, and it matched. */
-		cb_data_queue_completed (cb_data,
-		                         NM_CONNECTIVITY_FULL,
-		                         "expected response",
-		                         NULL);
-		return 0;
+		_con_result_set (cb_data, NM_CONNECTIVITY_FULL, "expected response");
 	}
 
 	return len;
@@ -663,35 +749,140 @@ _idle_cb (gpointer user_data)
 
 #if WITH_CONCHECK
 static void
-do_curl_request (NMConnectivityCheckHandle *cb_data)
+_con_pool_free (ConPool *pool)
+{
+	nm_assert (pool->n_requests == 0);
+
+	c_list_unlink (&pool->pools_lst);
+	nm_clear_g_source_inst (&pool->idle_source);
+
+	/* this closes the kept-alive connections, which might still call
+	 * multi_socket_cb(). */
+	curl_multi_cleanup (pool->curl_mhandle);
+	nm_clear_g_source_inst (&pool->curl_timer);
+
+	g_free (pool->ifspec);
+	nm_g_slice_free (pool);
+}
+
+static gboolean
+_con_pool_idle_cb (gpointer user_data)
 {
+	ConPool *pool = user_data;
+
+	_con_pool_free (pool);
+	return G_SOURCE_CONTINUE;
+}
+
+static ConPool *
+_con_pool_acquire (NMConnectivity *self,
+                   const char *ifspec,
+                   int addr_family)
+{
+	NMConnectivityPrivate *priv = NM_CONNECTIVITY_GET_PRIVATE (self);
+	ConPool *pool;
 	CURLM *mhandle;
+
+	c_list_for_each_entry (pool, &priv->pools_lst_head, pools_lst) {
+		if (   pool->addr_family == addr_family
+		    && nm_streq (pool->ifspec, ifspec))
+			goto out;
+	}
+
+	mhandle = curl_multi_init ();
+	if (!mhandle)
+		return NULL;
+
+	pool = g_slice_new (ConPool);
+	*pool = (ConPool) {
+		.self         = self,
+		.ifspec       = g_strdup (ifspec),
+		.addr_family  = addr_family,
+		.curl_mhandle = mhandle,
+	};
+	c_list_link_tail (&priv->pools_lst_head, &pool->pools_lst);
+
+	curl_multi_setopt (mhandle, CURLMOPT_SOCKETFUNCTION, multi_socket_cb);
+	curl_multi_setopt (mhandle, CURLMOPT_SOCKETDATA, pool);
+	curl_multi_setopt (mhandle, CURLMOPT_TIMERFUNCTION, multi_timer_cb);
+	curl_multi_setopt (mhandle, CURLMOPT_TIMERDATA, pool);
+
+	/* there is only one check per pool at a time, it needs only one
+	 * connection. */
+	curl_multi_setopt (mhandle, CURLMOPT_MAXCONNECTS, 1L);
+
+out:
+	nm_clear_g_source_inst (&pool->idle_source);
+	pool->n_requests++;
+	return pool;
+}
+
+static void
+_con_pool_detach (ConPool *pool)
+{
+	if (pool->detached)
+		return;
+
+	pool->detached = TRUE;
+	c_list_unlink (&pool->pools_lst);
+}
+
+static void
+_con_pool_release (ConPool *pool, gboolean drop)
+{
+	NMConnectivityPrivate *priv = NM_CONNECTIVITY_GET_PRIVATE (pool->self);
+
+	nm_assert (pool->n_requests > 0);
+
+	if (drop)
+		_con_pool_detach (pool);
+
+	if (--pool->n_requests > 0)
+		return;
+
+	if (pool->detached) {
+		_con_pool_free (pool);
+		return;
+	}
+
+	/* keep the pool (and its connection) around until the next periodic
+	 * check. While the connectivity stays the same, devices back off up to
+	 * max-interval, which is delayed by up to a quarter for jitter. */
+	pool->idle_source = nm_g_timeout_source_new ((priv->max_interval + priv->max_interval / 4 + CON_POOL_IDLE_EXTRA_SEC) * 1000u,
+	                                             G_PRIORITY_DEFAULT,
+	                                             _con_pool_idle_cb,
+	                                             pool,
+	                                             NULL);
+	g_source_attach (pool->idle_source, NULL);
+}
+
+static void
+_con_request_start (NMConnectivityCheckHandle *cb_data)
+{
+	NMConnectivityPrivate *priv = NM_CONNECTIVITY_GET_PRIVATE (cb_data->self);
+	ConPool *pool;
 	CURL *ehandle;
 	long resolve;
 
-	mhandle = curl_multi_init ();
-	if (!mhandle) {
+	pool = _con_pool_acquire (cb_data->self, cb_data->ifspec, cb_data->addr_family);
+	if (!pool) {
 		cb_data_complete (cb_data, NM_CONNECTIVITY_ERROR, "curl error");
 		return;
 	}
 
 	ehandle = curl_easy_init ();
 	if (!ehandle) {
-		curl_multi_cleanup (mhandle);
+		_con_pool_release (pool, FALSE);
 		cb_data_complete (cb_data, NM_CONNECTIVITY_ERROR, "curl error");
 		return;
 	}
 
-	cb_data->concheck.curl_mhandle = mhandle;
+	priv->n_requests++;
+	cb_data->concheck.pool = pool;
 	cb_data->concheck.curl_ehandle = ehandle;
-	cb_data->concheck.request_headers = curl_slist_append (NULL, "Connection: close");
+	cb_data->concheck.request_headers = curl_slist_append (NULL, "Connection: keep-alive");
 	cb_data->timeout_id = g_timeout_add_seconds (20, _timeout_cb, cb_data);
 
-	curl_multi_setopt (mhandle, CURLMOPT_SOCKETFUNCTION, multi_socket_cb);
-	curl_multi_setopt (mhandle, CURLMOPT_SOCKETDATA, cb_data);
-	curl_multi_setopt (mhandle, CURLMOPT_TIMERFUNCTION, multi_timer_cb);
-	curl_multi_setopt (mhandle, CURLMOPT_TIMERDATA, cb_data);
-
 	switch (cb_data->addr_family) {
 	case AF_INET:
 		resolve = CURL_IPRESOLVE_V4;
@@ -717,8 +908,37 @@ do_curl_request (NMConnectivityCheckHandle *cb_data)
 	curl_easy_setopt (ehandle, CURLOPT_INTERFACE, cb_data->ifspec);
 	curl_easy_setopt (ehandle, CURLOPT_RESOLVE, cb_data->concheck.hosts);
 	curl_easy_setopt (ehandle, CURLOPT_IPRESOLVE, resolve);
+	curl_easy_setopt (ehandle, CURLOPT_TCP_KEEPALIVE, 1L);
+
+	curl_multi_add_handle (pool->curl_mhandle, ehandle);
+}
+
+static void
+_con_queue_process (NMConnectivity *self)
+{
+	NMConnectivityPrivate *priv = NM_CONNECTIVITY_GET_PRIVATE (self);
+	NMConnectivityCheckHandle *cb_data;
+
+	while (   priv->n_requests < CON_MAX_PARALLEL_REQUESTS
+	       && (cb_data = c_list_first_entry (&priv->queue_lst_head, NMConnectivityCheckHandle, concheck.queue_lst))) {
+		c_list_unlink (&cb_data->concheck.queue_lst);
+		_con_request_start (cb_data);
+	}
+}
 
-	curl_multi_add_handle (mhandle, ehandle);
+/* Queues the HTTP request of @cb_data. Requests start in the order in which
+ * they are queued, but not more than CON_MAX_PARALLEL_REQUESTS at a time. So
+ * when many devices check at once, their checks get spread out instead of all
+ * hitting the network and the CPU together. */
+static void
+do_curl_request (NMConnectivityCheckHandle *cb_data)
+{
+	NMConnectivityPrivate *priv = NM_CONNECTIVITY_GET_PRIVATE (cb_data->self);
+
+	nm_assert (c_list_is_empty (&cb_data->concheck.queue_lst));
+
+	c_list_link_tail (&priv->queue_lst_head, &cb_data->concheck.queue_lst);
+	_con_queue_process (cb_data->self);
 }
 
 static void
@@ -878,10 +1098,15 @@ nm_connectivity_check_start (NMConnectivity *self,
 	cb_data->user_data = user_data;
 	cb_data->completed_state = NM_CONNECTIVITY_UNKNOWN;
 	cb_data->addr_family = addr_family;
+#if WITH_CONCHECK
+	cb_data->concheck.result_state = NM_CONNECTIVITY_UNKNOWN;
+	cb_data->concheck.num_connects = -1;
+#endif
 	if (iface)
 		cb_data->ifspec = g_strdup_printf ("if!%s", iface);
 
 #if WITH_CONCHECK
+	c_list_init (&cb_data->concheck.queue_lst);
 
 	cb_data->concheck.con_config = _con_config_ref (priv->con_config);
 
@@ -929,7 +1154,8 @@ nm_connectivity_check_start (NMConnectivity *self,
 		 * This is relatively cumbersome to avoid, because we would have to go through
 		 * NMDnsSystemdResolved trying to asynchronously start the service, to ensure there
 		 * is only one attempt to start the service. */
-		has_systemd_resolved = nm_dns_manager_has_systemd_resolved (nm_dns_manager_get ());
+		has_systemd_resolved =    !priv->nmtst_no_resolve
+		                       && nm_dns_manager_has_systemd_resolved (nm_dns_manager_get ());
 
 		if (has_systemd_resolved) {
 			GDBusConnection *dbus_connection;
@@ -1002,6 +1228,72 @@ nm_connectivity_check_cancel (NMConnectivityCheckHandle *cb_data)
 	cb_data_complete (cb_data, NM_CONNECTIVITY_CANCELLED, "cancelled");
 }
 
+/**
+ * nm_connectivity_network_changed:
+ * @self: the #NMConnectivity
+ * @addr_family: the address family that changed, or %AF_UNSPEC for both
+ * @iface: the name of the interface
+ *
+ * Notifies that the carrier, the addresses or the routes of @iface changed.
+ * The connections that were kept alive for the checks on @iface may no longer
+ * work, so the next checks open new ones.
+ */
+void
+nm_connectivity_network_changed (NMConnectivity *self,
+                                 int addr_family,
+                                 const char *iface)
+{
+#if WITH_CONCHECK
+	NMConnectivityPrivate *priv;
+	gs_free char *ifspec = NULL;
+	ConPool *pool;
+	ConPool *pool_safe;
+
+	g_return_if_fail (NM_IS_CONNECTIVITY (self));
+
+	if (!iface)
+		return;
+
+	priv = NM_CONNECTIVITY_GET_PRIVATE (self);
+
+	ifspec = g_strdup_printf ("if!%s", iface);
+	c_list_for_each_entry_safe (pool, pool_safe, &priv->pools_lst_head, pools_lst) {
+		if (   addr_family != AF_UNSPEC
+		    && pool->addr_family != AF_UNSPEC
+		    && pool->addr_family != addr_family)
+			continue;
+		if (!nm_streq (pool->ifspec, ifspec))
+			continue;
+		if (pool->n_requests == 0)
+			_con_pool_free (pool);
+		else
+			_con_pool_detach (pool);
+	}
+#endif
+}
+
+/*****************************************************************************/
+
+/* Don't resolve the name of the check host via systemd-resolved, so that a
+ * test doesn't need the DNS manager. */
+void
+nmtst_connectivity_set_no_resolve (NMConnectivity *self)
+{
+	NM_CONNECTIVITY_GET_PRIVATE (self)->nmtst_no_resolve = TRUE;
+}
+
+/* Returns the number of new connections that the HTTP request of @handle
+ * opened, or -1. Only valid from within the callback. */
+long
+nmtst_connectivity_check_get_num_connects (NMConnectivityCheckHandle *handle)
+{
+#if WITH_CONCHECK
+	return handle->concheck.num_connects;
+#else
+	return -1;
+#endif
+}
+
 /*****************************************************************************/
 
 gboolean
@@ -1022,6 +1314,14 @@ nm_connectivity_get_interval (NMConnectivity *self)
 	       : 0;
 }
 
+guint
+nm_connectivity_get_max_interval (NMConnectivity *self)
+{
+	return nm_connectivity_check_enabled (self)
+	       ? NM_CONNECTIVITY_GET_PRIVATE (self)->max_interval
+	       : 0;
+}
+
 static gboolean
 host_and_port_from_uri (const char *uri, char **host, char **port)
 {
@@ -1075,6 +1375,7 @@ update_config (NMConnectivity *self, NMConfigData *config_data)
 {
 	NMConnectivityPrivate *priv = NM_CONNECTIVITY_GET_PRIVATE (self);
 	guint interval;
+	gint64 max_interval;
 	gboolean enabled;
 	gboolean changed = FALSE;
 	const char *cur_uri = priv->con_config ? priv->con_config->uri : NULL;
@@ -1149,6 +1450,20 @@ update_config (NMConnectivity *self, NMConfigData *config_data)
 		changed = TRUE;
 	}
 
+	/* while the result stays the same, devices check less often, up to
+	 * max-interval. By default, that is four times the interval. */
+	max_interval = nm_config_data_get_value_int64 (config_data,
+	                                               NM_CONFIG_KEYFILE_GROUP_CONNECTIVITY,
+	                                               NM_CONFIG_KEYFILE_KEY_CONNECTIVITY_MAX_INTERVAL,
+	                                               10, 0, G_MAXUINT32, -1);
+	if (max_interval < 0)
+		max_interval = (gint64) interval * 4;
+	max_interval = NM_CLAMP (max_interval, (gint64) interval, NM_MAX ((gint64) interval, (gint64) (7 * 24 * 3600)));
+	if (priv->max_interval != max_interval) {
+		priv->max_interval = max_interval;
+		changed = TRUE;
+	}
+
 	enabled = FALSE;
 #if WITH_CONCHECK
 	if (   priv->uri_valid
@@ -1187,6 +1502,10 @@ nm_connectivity_init (NMConnectivity *self)
 
 	c_list_init (&priv->handles_lst_head);
 	c_list_init (&priv->completed_handles_lst_head);
+#if WITH_CONCHECK
+	c_list_init (&priv->queue_lst_head);
+	c_list_init (&priv->pools_lst_head);
+#endif
 
 	priv->config = g_object_ref (nm_config_get ());
 	g_signal_connect (G_OBJECT (priv->config),
@@ -1211,9 +1530,21 @@ dispose (GObject *object)
 	NMConnectivity *self = NM_CONNECTIVITY (object);
 	NMConnectivityPrivate *priv = NM_CONNECTIVITY_GET_PRIVATE (self);
 	NMConnectivityCheckHandle *cb_data;
+#if WITH_CONCHECK
+	ConPool *pool;
+#endif
 
 	nm_assert (c_list_is_empty (&priv->completed_handles_lst_head));
 
+#if WITH_CONCHECK
+	/* first drop the queued requests, so that completing the running
+	 * ones doesn't start them. */
+	while ((cb_data = c_list_first_entry (&priv->queue_lst_head,
+	                                      NMConnectivityCheckHandle,
+	                                      concheck.queue_lst)))
+		cb_data_complete (cb_data, NM_CONNECTIVITY_DISPOSING, "shutting down");
+#endif
+
 	while ((cb_data = c_list_first_entry (&priv->handles_lst_head,
 	                                      NMConnectivityCheckHandle,
 	                                      handles_lst)))
@@ -1222,6 +1553,9 @@ dispose (GObject *object)
 	nm_clear_pointer (&priv->con_config, _con_config_unref);
 
 #if WITH_CONCHECK
+	while ((pool = c_list_first_entry (&priv->pools_lst_head, ConPool, pools_lst)))
+		_con_pool_free (pool);
+
 	curl_global_cleanup ();
 #endif
 
@@ -50,6 +50,8 @@ gboolean nm_connectivity_check_enabled (NMConnectivity *self);
 
 guint nm_connectivity_get_interval (NMConnectivity *self);
 
+guint nm_connectivity_get_max_interval (NMConnectivity *self);
+
 typedef struct _NMConnectivityCheckHandle NMConnectivityCheckHandle;
 
 typedef void (*NMConnectivityCheckCallback) (NMConnectivity *self,
@@ -67,4 +69,13 @@ NMConnectivityCheckHandle *nm_connectivity_check_start (NMConnectivity *self,
 
 void nm_connectivity_check_cancel (NMConnectivityCheckHandle *handle);
 
+void nm_connectivity_network_changed (NMConnectivity *self,
+                                      int addr_family,
+                                      const char *iface);
+
+/* For testing only */
+void nmtst_connectivity_set_no_resolve (NMConnectivity *self);
+
+long nmtst_connectivity_check_get_num_connects (NMConnectivityCheckHandle *handle);
+
 #endif /* __NETWORKMANAGER_CONNECTIVITY_H__ */
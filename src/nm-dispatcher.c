@@ -62,12 +62,13 @@ struct NMDispatcherCallId {
 
 /*****************************************************************************/
 
-/* FIXME(shutdown): on shutdown, we should not run dispatcher scripts synchronously.
- *   Instead, we should of course still run them asynchronously.
+/* FIXME(shutdown): on shutdown, the "pre-down" requests of all devices are
+ *   started asynchronously and are awaited together with a deadline by
+ *   nm_dispatcher_wait_pending(), before the devices are torn down. If we
+ *   hit the timeout, we log a warning and quit (but leave the scripts running).
  *
- *   Also, we should wait for all pending requests to complete before exiting the main-loop
- *   (with a watchdog). If we hit a timeout, we log a warning and quit (but leave the scripts
- *   running).
+ *   The "down" requests that follow the teardown are only started, not
+ *   waited for. Also, VPN connections still call the dispatcher synchronously.
  *
  *   Finally, cleanup the global structures. */
 static struct {
@@ -894,6 +895,73 @@ nm_dispatcher_call_connectivity (NMConnectivityState connectivity_state,
 	                         callback, user_data, out_call_id);
 }
 
+static gboolean
+_wait_pending_timeout_cb (gpointer user_data)
+{
+	gboolean *p_timed_out = user_data;
+
+	*p_timed_out = TRUE;
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * nm_dispatcher_wait_pending:
+ * @timeout_msec: the maximum time to wait.
+ *
+ * On shutdown, the "pre-down" dispatcher actions for all devices are
+ * started asynchronously, so that the scripts of the devices run in parallel.
+ * This iterates the default main context until all pending requests
+ * completed, or until @timeout_msec passed. In the latter case, we
+ * quit without waiting any longer but leave the scripts running.
+ */
+void
+nm_dispatcher_wait_pending (guint timeout_msec)
+{
+	GSource *timeout_source;
+	gboolean timed_out = FALSE;
+	guint n;
+
+	if (   !gl.requests
+	    || g_hash_table_size (gl.requests) == 0)
+		return;
+
+	_LOGD ("waiting up to %u msec for %u pending requests",
+	       timeout_msec,
+	       g_hash_table_size (gl.requests));
+
+	timeout_source = nm_g_timeout_source_new (timeout_msec,
+	                                          G_PRIORITY_DEFAULT,
+	                                          _wait_pending_timeout_cb,
+	                                          &timed_out,
+	                                          NULL);
+	g_source_attach (timeout_source, NULL);
+
+	while (   !timed_out
+	       && g_hash_table_size (gl.requests) > 0)
+		g_main_context_iteration (NULL, TRUE);
+
+	nm_clear_g_source_inst (&timeout_source);
+
+	n = g_hash_table_size (gl.requests);
+	if (n > 0)
+		_LOGW ("%u requests still pending after %u msec. Don't wait for them", n, timeout_msec);
+}
+
+/**
+ * nm_dispatcher_flush:
+ *
+ * Asynchronous requests are only queued on the D-Bus connection. On shutdown,
+ * flush the connection so that the requests that we don't wait for still
+ * reach the dispatcher before we exit. This blocks on the connection, but
+ * doesn't iterate the main context.
+ */
+void
+nm_dispatcher_flush (void)
+{
+	if (gl.dbus_connection)
+		g_dbus_connection_flush_sync (gl.dbus_connection, NULL, NULL);
+}
+
 void
 nm_dispatcher_call_cancel (NMDispatcherCallId *call_id)
 {
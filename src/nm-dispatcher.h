@@ -71,4 +71,8 @@ gboolean nm_dispatcher_call_connectivity (NMConnectivityState state,
 
 void nm_dispatcher_call_cancel (NMDispatcherCallId *call_id);
 
+void nm_dispatcher_wait_pending (guint timeout_msec);
+
+void nm_dispatcher_flush (void);
+
 #endif /* __NM_DISPATCHER_H__ */
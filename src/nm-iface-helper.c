@@ -126,7 +126,8 @@ dhcp4_state_changed (NMDhcpClient *client,
 		                                    &ip4_dev_route_blacklist);
 		if (!nm_ip4_config_commit (existing,
 		                           NM_PLATFORM_GET,
-		                           NM_IP_ROUTE_TABLE_SYNC_MODE_MAIN))
+		                           NM_IP_ROUTE_TABLE_SYNC_MODE_MAIN,
+		                           NULL))
 			_LOGW (LOGD_DHCP4, "failed to apply DHCPv4 config");
 
 		if (!last_config && !nm_dhcp_client_accept (client, &error))
@@ -244,6 +245,7 @@ ndisc_config_changed (NMNDisc *ndisc, const NMNDiscData *rdata, guint changed_in
 	if (!nm_ip6_config_commit (existing,
 	                           NM_PLATFORM_GET,
 	                           NM_IP_ROUTE_TABLE_SYNC_MODE_MAIN,
+	                           NULL,
 	                           NULL))
 		_LOGW (LOGD_IP6, "failed to apply IPv6 config");
 }
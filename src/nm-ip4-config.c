@@ -821,13 +821,17 @@ again:
 gboolean
 nm_ip4_config_commit (const NMIP4Config *self,
                       NMPlatform *platform,
-                      NMIPRouteTableSyncMode route_table_sync)
+                      NMIPRouteTableSyncMode route_table_sync,
+                      gboolean *out_addresses_synced)
 {
 	gs_unref_ptrarray GPtrArray *addresses = NULL;
 	gs_unref_ptrarray GPtrArray *routes = NULL;
 	gs_unref_ptrarray GPtrArray *routes_prune = NULL;
 	int ifindex;
 	gboolean success = TRUE;
+	gboolean addresses_synced;
+
+	NM_SET_OUT (out_addresses_synced, FALSE);
 
 	g_return_val_if_fail (NM_IS_IP4_CONFIG (self), FALSE);
 
@@ -845,7 +849,10 @@ nm_ip4_config_commit (const NMIP4Config *self,
 	                                                    ifindex,
 	                                                    route_table_sync);
 
-	nm_platform_ip4_address_sync (platform, ifindex, addresses);
+	/* a failure to sync the addresses doesn't fail the commit, but the caller
+	 * may want to know so that it retries later. */
+	addresses_synced = nm_platform_ip4_address_sync (platform, ifindex, addresses);
+	NM_SET_OUT (out_addresses_synced, addresses_synced);
 
 	if (!nm_platform_ip_route_sync (platform,
 	                                AF_INET,
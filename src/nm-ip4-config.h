@@ -165,7 +165,8 @@ void nm_ip4_config_add_dependent_routes (NMIP4Config *self,
 
 gboolean nm_ip4_config_commit (const NMIP4Config *self,
                                NMPlatform *platform,
-                               NMIPRouteTableSyncMode route_table_sync);
+                               NMIPRouteTableSyncMode route_table_sync,
+                               gboolean *out_addresses_synced);
 
 void nm_ip4_config_merge_setting (NMIP4Config *self,
                                   NMSettingIPConfig *setting,
@@ -603,13 +603,17 @@ gboolean
 nm_ip6_config_commit (const NMIP6Config *self,
                       NMPlatform *platform,
                       NMIPRouteTableSyncMode route_table_sync,
-                      GPtrArray **out_temporary_not_available)
+                      GPtrArray **out_temporary_not_available,
+                      gboolean *out_addresses_synced)
 {
 	gs_unref_ptrarray GPtrArray *addresses = NULL;
 	gs_unref_ptrarray GPtrArray *routes = NULL;
 	gs_unref_ptrarray GPtrArray *routes_prune = NULL;
 	int ifindex;
 	gboolean success = TRUE;
+	gboolean addresses_synced;
+
+	NM_SET_OUT (out_addresses_synced, FALSE);
 
 	g_return_val_if_fail (NM_IS_IP6_CONFIG (self), FALSE);
 
@@ -627,7 +631,10 @@ nm_ip6_config_commit (const NMIP6Config *self,
 	                                                    ifindex,
 	                                                    route_table_sync);
 
-	nm_platform_ip6_address_sync (platform, ifindex, addresses, FALSE);
+	/* a failure to sync the addresses doesn't fail the commit, but the caller
+	 * may want to know so that it retries later. */
+	addresses_synced = nm_platform_ip6_address_sync (platform, ifindex, addresses, FALSE);
+	NM_SET_OUT (out_addresses_synced, addresses_synced);
 
 	if (!nm_platform_ip_route_sync (platform,
 	                                AF_INET6,
@@ -100,7 +100,8 @@ void nm_ip6_config_add_dependent_routes (NMIP6Config *self,
 gboolean nm_ip6_config_commit (const NMIP6Config *self,
                                NMPlatform *platform,
                                NMIPRouteTableSyncMode route_table_sync,
-                               GPtrArray **out_temporary_not_available);
+                               GPtrArray **out_temporary_not_available,
+                               gboolean *out_addresses_synced);
 void nm_ip6_config_merge_setting (NMIP6Config *self,
                                   NMSettingIPConfig *setting,
                                   guint32 route_table,
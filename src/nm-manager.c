@@ -1644,6 +1644,16 @@ device_is_wake_on_lan (NMPlatform *platform, NMDevice *device)
 	return nm_platform_link_get_wake_on_lan (platform, ifindex);
 }
 
+static gboolean
+_device_unmanage_on_quit (NMManager *self,
+                          NMDevice *device)
+{
+	/* Leave configured if wo(w)lan and quitting */
+	if (device_is_wake_on_lan (NM_MANAGER_GET_PRIVATE (self)->platform, device))
+		return FALSE;
+	return nm_device_unmanage_on_quit (device);
+}
+
 static void
 remove_device (NMManager *self,
                NMDevice *device,
@@ -1658,13 +1668,9 @@ remove_device (NMManager *self,
 
 	if (nm_device_get_managed (device, FALSE)) {
 
-		if (quitting) {
-			/* Leave configured if wo(w)lan and quitting */
-			if (device_is_wake_on_lan (priv->platform, device))
-				unmanage = FALSE;
-			else
-				unmanage = nm_device_unmanage_on_quit (device);
-		} else {
+		if (quitting)
+			unmanage = _device_unmanage_on_quit (self, device);
+		else {
 			/* the device is already gone. Unmanage it. */
 			unmanage = TRUE;
 		}
@@ -2531,6 +2537,24 @@ new_activation_allowed_for_connection (NMManager *self,
 	                                NULL);
 }
 
+/* a checksum of the connection, to detect on restart whether the connection that was
+ * applied on the device is still the same as the profile. */
+static char *
+_device_state_connection_checksum (NMConnection *connection)
+{
+	gs_unref_variant GVariant *variant = NULL;
+
+	variant = nm_connection_to_dbus (connection,
+	                                 NM_CONNECTION_SERIALIZE_NO_SECRETS);
+	if (!variant)
+		return NULL;
+
+	g_variant_ref_sink (variant);
+	return g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+	                                    g_variant_get_data (variant),
+	                                    g_variant_get_size (variant));
+}
+
 /**
  * get_existing_connection:
  * @manager: #NMManager instance
@@ -2557,6 +2581,7 @@ get_existing_connection (NMManager *self,
 	gboolean assume_state_guess_assume = FALSE;
 	const char *assume_state_connection_uuid = NULL;
 	gboolean maybe_later, only_by_uuid = FALSE;
+	const NMConfigDeviceStateData *dev_state;
 
 	if (out_generated)
 		*out_generated = FALSE;
@@ -2588,6 +2613,42 @@ get_existing_connection (NMManager *self,
 		}
 	}
 
+	nm_device_assume_state_get (device,
+	                            &assume_state_guess_assume,
+	                            &assume_state_connection_uuid);
+
+	/* The device state file in /run also records a checksum of the connection that
+	 * was applied. If the profile still matches it, we restarted (without
+	 * reboot) and the device still has a configuration, take the connection
+	 * right away. Generating a connection from the platform configuration and
+	 * comparing it is expensive, if there are many interfaces. */
+	if (   assume_state_connection_uuid
+	    && ifindex > 0
+	    && (dev_state = nm_config_device_state_get (priv->config, ifindex))
+	    && dev_state->connection_checksum
+	    && nm_streq0 (dev_state->connection_uuid, assume_state_connection_uuid)
+	    && nm_device_has_config (device)
+	    && (connection_checked = nm_settings_get_connection_by_uuid (priv->settings, assume_state_connection_uuid))
+	    && !NM_FLAGS_HAS (nm_settings_connection_get_flags (connection_checked), NM_SETTINGS_CONNECTION_INT_FLAGS_EXTERNAL)
+	    && new_activation_allowed_for_connection (self, connection_checked)
+	    && nm_device_check_connection_compatible (device,
+	                                              nm_settings_connection_get_connection (connection_checked),
+	                                              NULL)) {
+		gs_free char *checksum = NULL;
+
+		checksum = _device_state_connection_checksum (nm_settings_connection_get_connection (connection_checked));
+		if (nm_streq0 (checksum, dev_state->connection_checksum)) {
+			_LOG2I (LOGD_DEVICE, device, "assume: will attempt to assume unchanged connection '%s' (%s) (indicated)",
+			        nm_settings_connection_get_id (connection_checked),
+			        nm_settings_connection_get_uuid (connection_checked));
+			nm_device_assume_state_reset (device);
+			return connection_checked;
+		}
+		_LOG2D (LOGD_DEVICE, device, "assume: connection '%s' changed since it was active",
+		        nm_settings_connection_get_uuid (connection_checked));
+	}
+	connection_checked = NULL;
+
 	/* The core of the API is nm_device_generate_connection() function and
 	 * update_connection() virtual method and the convenient connection_type
 	 * class attribute. Subclasses supporting the new API must have
@@ -2608,10 +2669,6 @@ get_existing_connection (NMManager *self,
 		}
 	}
 
-	nm_device_assume_state_get (device,
-	                            &assume_state_guess_assume,
-	                            &assume_state_connection_uuid);
-
 	/* Now we need to compare the generated connection to each configured
 	 * connection. The comparison function is the heart of the connection
 	 * assumption implementation and it must compare the connections very
@@ -6570,6 +6627,7 @@ nm_manager_write_device_state (NMManager *self, NMDevice *device, int *out_ifind
 	NMDhcpConfig *dhcp_config;
 	const char *next_server = NULL;
 	const char *root_path = NULL;
+	gs_free char *checksum = NULL;
 
 	NM_SET_OUT (out_ifindex, 0);
 
@@ -6590,8 +6648,18 @@ nm_manager_write_device_state (NMManager *self, NMDevice *device, int *out_ifind
 
 		if (nm_device_get_state (device) <= NM_DEVICE_STATE_ACTIVATED)
 			sett_conn = nm_device_get_settings_connection (device);
-		if (sett_conn)
+		if (sett_conn) {
 			uuid = nm_settings_connection_get_uuid (sett_conn);
+			if (nm_device_get_state (device) == NM_DEVICE_STATE_ACTIVATED) {
+				NMConnection *applied_connection;
+
+				/* hash what is actually configured on the device. If the profile was
+				 * modified but not reapplied, the checksum won't match on restart. */
+				applied_connection = nm_device_get_applied_connection (device);
+				if (applied_connection)
+					checksum = _device_state_connection_checksum (applied_connection);
+			}
+		}
 		managed_type = NM_CONFIG_DEVICE_STATE_MANAGED_TYPE_MANAGED;
 	} else if (nm_device_get_unmanaged_flags (device, NM_UNMANAGED_USER_EXPLICIT))
 		managed_type = NM_CONFIG_DEVICE_STATE_MANAGED_TYPE_UNMANAGED;
@@ -6619,6 +6687,7 @@ nm_manager_write_device_state (NMManager *self, NMDevice *device, int *out_ifind
 	                                   managed_type,
 	                                   perm_hw_addr_fake,
 	                                   uuid,
+	                                   checksum,
 	                                   nm_owned,
 	                                   route_metric_default_aspired,
 	                                   route_metric_default_effective,
@@ -6755,9 +6824,28 @@ nm_manager_stop (NMManager *self)
 
 	nm_dbus_manager_stop (nm_dbus_object_get_manager (NM_DBUS_OBJECT (self)));
 
+	/* The pre-down scripts of the devices that we deactivate expect the device
+	 * still configured. Start them for all devices at once, and wait for them
+	 * together with a deadline, before tearing down the first device. The
+	 * "down" scripts that get started afterwards are not waited for. */
+	c_list_for_each_entry (device, &priv->devices_lst_head, devices_lst) {
+		if (   nm_device_get_managed (device, FALSE)
+		    && _device_unmanage_on_quit (self, device))
+			nm_device_dispatcher_pre_down_on_quit (device);
+	}
+	nm_dispatcher_wait_pending (nm_config_data_get_value_int64 (nm_config_get_data (priv->config),
+	                                                            NM_CONFIG_KEYFILE_GROUP_MAIN,
+	                                                            NM_CONFIG_KEYFILE_KEY_MAIN_SHUTDOWN_TIMEOUT,
+	                                                            10, 0, G_MAXINT32,
+	                                                            NM_SHUTDOWN_TIMEOUT_MS));
+
 	while ((device = c_list_first_entry (&priv->devices_lst_head, NMDevice, devices_lst)))
 		remove_device (self, device, TRUE);
 
+	/* make sure the requests that we didn't wait for reach the dispatcher
+	 * before we exit. */
+	nm_dispatcher_flush ();
+
 	_active_connection_cleanup (self);
 
 	nm_clear_g_source (&priv->devices_inited_id);
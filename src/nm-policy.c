@@ -1600,10 +1600,10 @@ activate_slave_connections (NMPolicy *self, NMDevice *device)
 	const char *master_device;
 	const char *master_uuid_settings = NULL;
 	const char *master_uuid_applied = NULL;
-	guint i;
+	const char *masters[3];
+	guint i, j, k;
 	NMActRequest *req;
 	gboolean internal_activation = FALSE;
-	NMSettingsConnection *const*connections;
 	gboolean changed;
 
 	master_device = nm_device_get_iface (device);
@@ -1631,32 +1631,44 @@ activate_slave_connections (NMPolicy *self, NMDevice *device)
 		                      && (nm_auth_subject_get_subject_type (subject) == NM_AUTH_SUBJECT_TYPE_INTERNAL);
 	}
 
+	masters[0] = master_device;
+	masters[1] = master_uuid_applied;
+	masters[2] = master_uuid_settings;
+
 	changed = FALSE;
-	connections = nm_settings_get_connections (priv->settings, NULL);
-	for (i = 0; connections[i]; i++) {
-		NMSettingsConnection *sett_conn = connections[i];
-		NMSettingConnection *s_slave_con;
-		const char *slave_master;
+	for (j = 0; j < G_N_ELEMENTS (masters); j++) {
+		gs_free NMSettingsConnection **connections = NULL;
 
-		s_slave_con = nm_connection_get_setting_connection (nm_settings_connection_get_connection (sett_conn));
-		slave_master = nm_setting_connection_get_master (s_slave_con);
-		if (!slave_master)
+		/* the applied and the settings UUID are usually the same. A profile
+		 * has only one master, so distinct lookups never return the same
+		 * profile twice. Skip the lookups that we already did. */
+		if (!masters[j])
 			continue;
-		if (!NM_IN_STRSET (slave_master, master_device,
-		                                 master_uuid_applied,
-		                                 master_uuid_settings))
+		for (k = 0; k < j; k++) {
+			if (nm_streq0 (masters[k], masters[j]))
+				break;
+		}
+		if (k < j)
 			continue;
 
-		if (!internal_activation) {
-			if (nm_settings_connection_autoconnect_retries_get (sett_conn) == 0)
-				changed = TRUE;
-			nm_settings_connection_autoconnect_retries_reset (sett_conn);
-		}
-		if (nm_settings_connection_autoconnect_blocked_reason_set (sett_conn,
-		                                                           NM_SETTINGS_AUTO_CONNECT_BLOCKED_REASON_FAILED,
-		                                                           FALSE)) {
-			if (!nm_settings_connection_autoconnect_is_blocked (sett_conn))
-				changed = TRUE;
+		connections = nm_settings_get_connections_by_index (priv->settings,
+		                                                    NM_SETTINGS_CONNECTION_INDEX_MASTER,
+		                                                    masters[j],
+		                                                    NULL);
+		for (i = 0; connections && connections[i]; i++) {
+			NMSettingsConnection *sett_conn = connections[i];
+
+			if (!internal_activation) {
+				if (nm_settings_connection_autoconnect_retries_get (sett_conn) == 0)
+					changed = TRUE;
+				nm_settings_connection_autoconnect_retries_reset (sett_conn);
+			}
+			if (nm_settings_connection_autoconnect_blocked_reason_set (sett_conn,
+			                                                           NM_SETTINGS_AUTO_CONNECT_BLOCKED_REASON_FAILED,
+			                                                           FALSE)) {
+				if (!nm_settings_connection_autoconnect_is_blocked (sett_conn))
+					changed = TRUE;
+			}
 		}
 	}
 
@@ -1375,7 +1375,6 @@ impl_settings_connection_get_settings (NMDBusObject *obj,
 
 typedef struct {
 	GDBusMethodInvocation *context;
-	NMAgentManager *agent_mgr;
 	NMAuthSubject *subject;
 	NMConnection *new_settings;
 	NMSettingsUpdate2Flags flags;
@@ -1403,7 +1402,6 @@ update_complete (NMSettingsConnection *self,
 	                            info->subject, error ? error->message : NULL);
 
 	g_clear_object (&info->subject);
-	g_clear_object (&info->agent_mgr);
 	g_clear_object (&info->new_settings);
 	g_free (info->audit_args);
 	g_slice_free (UpdateInfo, info);
@@ -1457,41 +1455,53 @@ _autoconnect_retries_set (NMSettingsConnection *self,
 	}
 }
 
-static void
-update_auth_cb (NMSettingsConnection *self,
-                GDBusMethodInvocation *context,
-                NMAuthSubject *subject,
-                GError *error,
-                gpointer data)
+/**
+ * nm_settings_connection_update_authorized:
+ * @self: the #NMSettingsConnection
+ * @new_settings: (allow-none): the new settings or %NULL to only
+ *   change the persist mode.
+ * @flags: the #NMSettingsUpdate2Flags of the request
+ * @subject: the #NMAuthSubject that requested the update
+ * @out_audit_args: (allow-none) (out) (transfer full): the arguments
+ *   for the audit log.
+ * @error: the failure reason
+ *
+ * Performs an update as requested via D-Bus, after the request
+ * was authorized. If @new_settings contains no secrets, the existing
+ * secrets are kept.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean
+nm_settings_connection_update_authorized (NMSettingsConnection *self,
+                                          NMConnection *new_settings,
+                                          NMSettingsUpdate2Flags flags,
+                                          NMAuthSubject *subject,
+                                          char **out_audit_args,
+                                          GError **error)
 {
-	NMSettingsConnectionPrivate *priv;
-	UpdateInfo *info = data;
+	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (self);
 	gs_free_error GError *local = NULL;
 	NMSettingsConnectionPersistMode persist_mode;
 
-	if (error) {
-		update_complete (self, info, error);
-		return;
-	}
-
-	priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (self);
+	NM_SET_OUT (out_audit_args, NULL);
 
-	if (info->new_settings) {
-		if (!_nm_connection_aggregate (info->new_settings, NM_CONNECTION_AGGREGATE_ANY_SECRETS, NULL)) {
+	if (new_settings) {
+		if (!_nm_connection_aggregate (new_settings, NM_CONNECTION_AGGREGATE_ANY_SECRETS, NULL)) {
 			/* If the new connection has no secrets, we do not want to remove all
 			 * secrets, rather we keep all the existing ones. Do that by merging
 			 * them in to the new connection.
 			 */
 			if (priv->agent_secrets)
-				nm_connection_update_secrets (info->new_settings, NULL, priv->agent_secrets, NULL);
+				nm_connection_update_secrets (new_settings, NULL, priv->agent_secrets, NULL);
 			if (priv->system_secrets)
-				nm_connection_update_secrets (info->new_settings, NULL, priv->system_secrets, NULL);
+				nm_connection_update_secrets (new_settings, NULL, priv->system_secrets, NULL);
 		} else {
 			/* Cache the new secrets from the agent, as stuff like inotify-triggered
 			 * changes to connection's backing config files will blow them away if
 			 * they're in the main connection.
 			 */
-			update_agent_secrets_cache (self, info->new_settings);
+			update_agent_secrets_cache (self, new_settings);
 
 			/* New secrets, allow autoconnection again */
 			if (   nm_settings_connection_autoconnect_blocked_reason_set (self, NM_SETTINGS_AUTO_CONNECT_BLOCKED_REASON_NO_SECRETS, FALSE)
@@ -1500,50 +1510,51 @@ update_auth_cb (NMSettingsConnection *self,
 		}
 	}
 
-	if (info->new_settings) {
+	if (   new_settings
+	    && out_audit_args) {
 		if (nm_audit_manager_audit_enabled (nm_audit_manager_get ())) {
 			gs_unref_hashtable GHashTable *diff = NULL;
 			gboolean same;
 
-			same = nm_connection_diff (nm_settings_connection_get_connection (self), info->new_settings,
+			same = nm_connection_diff (nm_settings_connection_get_connection (self), new_settings,
 			                           NM_SETTING_COMPARE_FLAG_EXACT |
 			                           NM_SETTING_COMPARE_FLAG_DIFF_RESULT_NO_DEFAULT,
 			                           &diff);
 			if (!same && diff)
-				info->audit_args = nm_utils_format_con_diff_for_audit (diff);
+				*out_audit_args = nm_utils_format_con_diff_for_audit (diff);
 		}
 	}
 
-	nm_assert (   !NM_FLAGS_ANY (info->flags, _NM_SETTINGS_UPDATE2_FLAG_ALL_PERSIST_MODES)
-	           || nm_utils_is_power_of_two (info->flags & _NM_SETTINGS_UPDATE2_FLAG_ALL_PERSIST_MODES));
+	nm_assert (   !NM_FLAGS_ANY (flags, _NM_SETTINGS_UPDATE2_FLAG_ALL_PERSIST_MODES)
+	           || nm_utils_is_power_of_two (flags & _NM_SETTINGS_UPDATE2_FLAG_ALL_PERSIST_MODES));
 
-	if (NM_FLAGS_HAS (info->flags, NM_SETTINGS_UPDATE2_FLAG_TO_DISK))
+	if (NM_FLAGS_HAS (flags, NM_SETTINGS_UPDATE2_FLAG_TO_DISK))
 		persist_mode = NM_SETTINGS_CONNECTION_PERSIST_MODE_TO_DISK;
-	else if (NM_FLAGS_ANY (info->flags, NM_SETTINGS_UPDATE2_FLAG_IN_MEMORY))
+	else if (NM_FLAGS_ANY (flags, NM_SETTINGS_UPDATE2_FLAG_IN_MEMORY))
 		persist_mode = NM_SETTINGS_CONNECTION_PERSIST_MODE_IN_MEMORY;
-	else if (NM_FLAGS_ANY (info->flags, NM_SETTINGS_UPDATE2_FLAG_IN_MEMORY_DETACHED))
+	else if (NM_FLAGS_ANY (flags, NM_SETTINGS_UPDATE2_FLAG_IN_MEMORY_DETACHED))
 		persist_mode = NM_SETTINGS_CONNECTION_PERSIST_MODE_IN_MEMORY_DETACHED;
-	else if (NM_FLAGS_HAS (info->flags, NM_SETTINGS_UPDATE2_FLAG_IN_MEMORY_ONLY)) {
+	else if (NM_FLAGS_HAS (flags, NM_SETTINGS_UPDATE2_FLAG_IN_MEMORY_ONLY)) {
 		persist_mode = NM_SETTINGS_CONNECTION_PERSIST_MODE_IN_MEMORY_ONLY;
 	} else
 		persist_mode = NM_SETTINGS_CONNECTION_PERSIST_MODE_KEEP;
 
 	nm_settings_connection_update (self,
-	                               info->new_settings,
+	                               new_settings,
 	                               persist_mode,
-	                               (  NM_FLAGS_HAS (info->flags, NM_SETTINGS_UPDATE2_FLAG_VOLATILE)
+	                               (  NM_FLAGS_HAS (flags, NM_SETTINGS_UPDATE2_FLAG_VOLATILE)
 	                                ? NM_SETTINGS_CONNECTION_INT_FLAGS_VOLATILE
 	                                : NM_SETTINGS_CONNECTION_INT_FLAGS_NONE),
 	                                 NM_SETTINGS_CONNECTION_INT_FLAGS_NM_GENERATED
 	                               | NM_SETTINGS_CONNECTION_INT_FLAGS_VOLATILE
 	                               | NM_SETTINGS_CONNECTION_INT_FLAGS_EXTERNAL,
 	                                 NM_SETTINGS_CONNECTION_UPDATE_REASON_FORCE_RENAME
-	                               | (  NM_FLAGS_HAS (info->flags, NM_SETTINGS_UPDATE2_FLAG_NO_REAPPLY)
+	                               | (  NM_FLAGS_HAS (flags, NM_SETTINGS_UPDATE2_FLAG_NO_REAPPLY)
 	                                  ? NM_SETTINGS_CONNECTION_UPDATE_REASON_NONE
 	                                  : NM_SETTINGS_CONNECTION_UPDATE_REASON_REAPPLY_PARTIAL)
 	                               | NM_SETTINGS_CONNECTION_UPDATE_REASON_RESET_SYSTEM_SECRETS
 	                               | NM_SETTINGS_CONNECTION_UPDATE_REASON_RESET_AGENT_SECRETS
-	                               | (  NM_FLAGS_HAS (info->flags, NM_SETTINGS_UPDATE2_FLAG_BLOCK_AUTOCONNECT)
+	                               | (  NM_FLAGS_HAS (flags, NM_SETTINGS_UPDATE2_FLAG_BLOCK_AUTOCONNECT)
 	                                  ? NM_SETTINGS_CONNECTION_UPDATE_REASON_BLOCK_AUTOCONNECT
 	                                  : NM_SETTINGS_CONNECTION_UPDATE_REASON_NONE),
 	                               "update-from-dbus",
@@ -1559,15 +1570,43 @@ update_auth_cb (NMSettingsConnection *self,
 		for_agent = nm_simple_connection_new_clone (nm_settings_connection_get_connection (self));
 		_nm_connection_clear_secrets_by_secret_flags (for_agent,
 		                                              NM_SETTING_SECRET_FLAG_AGENT_OWNED);
-		nm_agent_manager_save_secrets (info->agent_mgr,
+		nm_agent_manager_save_secrets (priv->agent_mgr,
 		                               nm_dbus_object_get_path (NM_DBUS_OBJECT (self)),
 		                               for_agent,
-		                               info->subject);
+		                               subject);
 	}
 
 	/* Reset auto retries back to default since connection was updated */
 	nm_settings_connection_autoconnect_retries_reset (self);
 
+	if (local) {
+		g_propagate_error (error, g_steal_pointer (&local));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+update_auth_cb (NMSettingsConnection *self,
+                GDBusMethodInvocation *context,
+                NMAuthSubject *subject,
+                GError *error,
+                gpointer data)
+{
+	UpdateInfo *info = data;
+	gs_free_error GError *local = NULL;
+
+	if (error) {
+		update_complete (self, info, error);
+		return;
+	}
+
+	nm_settings_connection_update_authorized (self,
+	                                          info->new_settings,
+	                                          info->flags,
+	                                          info->subject,
+	                                          &info->audit_args,
+	                                          &local);
 	update_complete (self, info, local);
 }
 
@@ -1602,7 +1641,6 @@ settings_connection_update (NMSettingsConnection *self,
                             GVariant *new_settings,
                             NMSettingsUpdate2Flags flags)
 {
-	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (self);
 	NMAuthSubject *subject = NULL;
 	NMConnection *tmp = NULL;
 	GError *error = NULL;
@@ -1650,7 +1688,6 @@ settings_connection_update (NMSettingsConnection *self,
 	info = g_slice_new0 (UpdateInfo);
 	info->is_update2 = is_update2;
 	info->context = context;
-	info->agent_mgr = g_object_ref (priv->agent_mgr);
 	info->subject = subject;
 	info->flags = flags;
 	info->new_settings = tmp;
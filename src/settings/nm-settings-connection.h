@@ -244,6 +244,13 @@ gboolean nm_settings_connection_update (NMSettingsConnection *self,
                                         const char *log_context_name,
                                         GError **error);
 
+gboolean nm_settings_connection_update_authorized (NMSettingsConnection *self,
+                                                   NMConnection *new_settings,
+                                                   NMSettingsUpdate2Flags flags,
+                                                   NMAuthSubject *subject,
+                                                   char **out_audit_args,
+                                                   GError **error);
+
 void nm_settings_connection_delete (NMSettingsConnection *self,
                                     gboolean allow_add_to_no_auto_default);
 
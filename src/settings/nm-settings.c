@@ -369,6 +369,14 @@ typedef struct {
 
 	NMSettingsConnection **connections_cached_list;
 
+	/* secondary indexes of the connections. Each maps the indexed value
+	 * to the set of connections (a GHashTable) that have that value. */
+	GHashTable *conn_idx[_NM_SETTINGS_CONNECTION_INDEX_NUM];
+
+	/* remembers for each connection the keys under which it is currently
+	 * tracked in @conn_idx, so that they can be removed on update and delete. */
+	GHashTable *conn_idx_keys;
+
 	GSList *unmanaged_specs;
 	GSList *unrecognized_specs;
 
@@ -381,8 +389,8 @@ typedef struct {
 
 	guint connections_generation;
 
-	guint kf_db_flush_idle_id_timestamps;
-	guint kf_db_flush_idle_id_seen_bssids;
+	guint kf_db_flush_id_timestamps;
+	guint kf_db_flush_id_seen_bssids;
 
 	bool started:1;
 
@@ -1029,6 +1037,122 @@ _connection_changed_normalize_connection (NMSettingsStorage *storage,
 
 /*****************************************************************************/
 
+typedef struct {
+	char *keys[_NM_SETTINGS_CONNECTION_INDEX_NUM];
+} ConnIdxKeys;
+
+static void
+_conn_idx_keys_free (gpointer data)
+{
+	ConnIdxKeys *idx_keys = data;
+	int i;
+
+	for (i = 0; i < _NM_SETTINGS_CONNECTION_INDEX_NUM; i++)
+		g_free (idx_keys->keys[i]);
+	g_slice_free (ConnIdxKeys, idx_keys);
+}
+
+static char *
+_conn_idx_get_key (NMConnection *connection,
+                   NMSettingsConnectionIndex idx)
+{
+	NMSettingConnection *s_con;
+	NMSettingWired *s_wired;
+	const char *str;
+
+	switch (idx) {
+	case NM_SETTINGS_CONNECTION_INDEX_TYPE:
+		return g_strdup (nm_connection_get_connection_type (connection));
+	case NM_SETTINGS_CONNECTION_INDEX_INTERFACE_NAME:
+		return g_strdup (nm_connection_get_interface_name (connection));
+	case NM_SETTINGS_CONNECTION_INDEX_MAC_ADDRESS:
+		s_wired = nm_connection_get_setting_wired (connection);
+		str = s_wired ? nm_setting_wired_get_mac_address (s_wired) : NULL;
+		return str ? nm_utils_hwaddr_canonical (str, -1) : NULL;
+	case NM_SETTINGS_CONNECTION_INDEX_MASTER:
+		s_con = nm_connection_get_setting_connection (connection);
+		return g_strdup (s_con ? nm_setting_connection_get_master (s_con) : NULL);
+	case _NM_SETTINGS_CONNECTION_INDEX_NUM:
+		break;
+	}
+	nm_assert_not_reached ();
+	return NULL;
+}
+
+static void
+_conn_idx_bucket_add (GHashTable *conn_idx,
+                      const char *key,
+                      NMSettingsConnection *sett_conn)
+{
+	GHashTable *bucket;
+
+	bucket = g_hash_table_lookup (conn_idx, key);
+	if (!bucket) {
+		bucket = g_hash_table_new (nm_direct_hash, NULL);
+		g_hash_table_insert (conn_idx, g_strdup (key), bucket);
+	}
+	if (!g_hash_table_add (bucket, sett_conn))
+		nm_assert_not_reached ();
+}
+
+static void
+_conn_idx_bucket_remove (GHashTable *conn_idx,
+                         const char *key,
+                         NMSettingsConnection *sett_conn)
+{
+	GHashTable *bucket;
+
+	bucket = g_hash_table_lookup (conn_idx, key);
+	if (   !bucket
+	    || !g_hash_table_remove (bucket, sett_conn)) {
+		nm_assert_not_reached ();
+		return;
+	}
+	if (g_hash_table_size (bucket) == 0)
+		g_hash_table_remove (conn_idx, key);
+}
+
+/* Updates the secondary indexes for @sett_conn. If @connection is %NULL,
+ * the connection is removed from all indexes. */
+static void
+_conn_idx_update (NMSettings *self,
+                  NMSettingsConnection *sett_conn,
+                  NMConnection *connection)
+{
+	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	ConnIdxKeys *idx_keys;
+	int i;
+
+	idx_keys = g_hash_table_lookup (priv->conn_idx_keys, sett_conn);
+	if (!idx_keys) {
+		if (!connection)
+			return;
+		idx_keys = g_slice_new0 (ConnIdxKeys);
+		g_hash_table_insert (priv->conn_idx_keys, sett_conn, idx_keys);
+	}
+
+	for (i = 0; i < _NM_SETTINGS_CONNECTION_INDEX_NUM; i++) {
+		char *key;
+
+		key = connection ? _conn_idx_get_key (connection, i) : NULL;
+		if (nm_streq0 (key, idx_keys->keys[i])) {
+			g_free (key);
+			continue;
+		}
+		if (idx_keys->keys[i])
+			_conn_idx_bucket_remove (priv->conn_idx[i], idx_keys->keys[i], sett_conn);
+		if (key)
+			_conn_idx_bucket_add (priv->conn_idx[i], key, sett_conn);
+		g_free (idx_keys->keys[i]);
+		idx_keys->keys[i] = key;
+	}
+
+	if (!connection)
+		g_hash_table_remove (priv->conn_idx_keys, sett_conn);
+}
+
+/*****************************************************************************/
+
 static void
 _connection_changed_update (NMSettings *self,
                             SettConnEntry *sett_conn_entry,
@@ -1059,6 +1183,7 @@ _connection_changed_update (NMSettings *self,
 
 	_nm_settings_connection_set_connection (sett_conn, connection, &connection_old, update_reason);
 
+	_conn_idx_update (self, sett_conn, nm_settings_connection_get_connection (sett_conn));
 
 	if (is_new) {
 		_nm_settings_connection_register_kf_dbs (sett_conn,
@@ -1180,6 +1305,7 @@ _connection_changed_delete (NMSettings *self,
 
 	_clear_connections_cached_list (priv);
 	c_list_unlink (&sett_conn->_connections_lst);
+	_conn_idx_update (self, sett_conn, NULL);
 	priv->connections_len--;
 	priv->connections_generation++;
 
@@ -1432,6 +1558,28 @@ _plugin_connections_reload (NMSettings *self)
 		nm_settings_plugin_load_connections_done (iter->data);
 }
 
+static void
+_plugin_connections_changed (NMSettingsPlugin *plugin,
+                             gpointer user_data)
+{
+	NMSettings *self = NM_SETTINGS (user_data);
+
+	/* Only reload the plugin that asked for it. */
+	nm_settings_plugin_reload_connections (plugin,
+	                                       _plugin_connections_reload_cb,
+	                                       self);
+
+	_connection_changed_process_all_dirty (self,
+	                                       FALSE,
+	                                       NM_SETTINGS_CONNECTION_INT_FLAGS_NONE,
+	                                       NM_SETTINGS_CONNECTION_INT_FLAGS_NONE,
+	                                       TRUE,
+	                                         NM_SETTINGS_CONNECTION_UPDATE_REASON_RESET_SYSTEM_SECRETS
+	                                       | NM_SETTINGS_CONNECTION_UPDATE_REASON_RESET_AGENT_SECRETS);
+
+	nm_settings_plugin_load_connections_done (plugin);
+}
+
 /*****************************************************************************/
 
 static gboolean
@@ -2534,6 +2682,56 @@ done:
 	g_error_free (error);
 }
 
+static gboolean
+_add_connection2_check_args (guint32 flags,
+                             GVariant *args,
+                             GError **error)
+{
+	const char *args_name;
+	GVariantIter iter;
+
+	if (NM_FLAGS_ANY (flags, ~((guint32) (  NM_SETTINGS_ADD_CONNECTION2_FLAG_TO_DISK
+	                                      | NM_SETTINGS_ADD_CONNECTION2_FLAG_IN_MEMORY
+	                                      | NM_SETTINGS_ADD_CONNECTION2_FLAG_BLOCK_AUTOCONNECT)))) {
+		g_set_error_literal (error,
+		                     NM_SETTINGS_ERROR,
+		                     NM_SETTINGS_ERROR_INVALID_ARGUMENTS,
+		                     "Unknown flags");
+		return FALSE;
+	}
+
+	if (!NM_FLAGS_ANY (flags,   NM_SETTINGS_ADD_CONNECTION2_FLAG_TO_DISK
+	                          | NM_SETTINGS_ADD_CONNECTION2_FLAG_IN_MEMORY)) {
+		g_set_error_literal (error,
+		                     NM_SETTINGS_ERROR,
+		                     NM_SETTINGS_ERROR_INVALID_ARGUMENTS,
+		                     "Requires either to-disk (0x1) or in-memory (0x2) flags");
+		return FALSE;
+	}
+
+	if (NM_FLAGS_ALL (flags,   NM_SETTINGS_ADD_CONNECTION2_FLAG_TO_DISK
+	                         | NM_SETTINGS_ADD_CONNECTION2_FLAG_IN_MEMORY)) {
+		g_set_error_literal (error,
+		                     NM_SETTINGS_ERROR,
+		                     NM_SETTINGS_ERROR_INVALID_ARGUMENTS,
+		                     "Cannot set to-disk (0x1) and in-memory (0x2) flags together");
+		return FALSE;
+	}
+
+	nm_assert (g_variant_is_of_type (args, G_VARIANT_TYPE ("a{sv}")));
+
+	g_variant_iter_init (&iter, args);
+	while (g_variant_iter_next (&iter, "{&sv}", &args_name, NULL)) {
+		g_set_error (error,
+		             NM_SETTINGS_ERROR,
+		             NM_SETTINGS_ERROR_INVALID_ARGUMENTS,
+		             "Unsupported argument '%s'", args_name);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static void
 settings_add_connection_add_cb (NMSettings *self,
                                 NMSettingsConnection *connection,
@@ -2663,55 +2861,382 @@ impl_settings_add_connection2 (NMDBusObject *obj,
 	NMSettings *self = NM_SETTINGS (obj);
 	gs_unref_variant GVariant *settings = NULL;
 	gs_unref_variant GVariant *args = NULL;
-	NMSettingsAddConnection2Flags flags;
-	const char *args_name;
-	GVariantIter iter;
+	GError *error = NULL;
 	guint32 flags_u;
 
 	g_variant_get (parameters, "(@a{sa{sv}}u@a{sv})", &settings, &flags_u, &args);
 
-	if (NM_FLAGS_ANY (flags_u, ~((guint32) (  NM_SETTINGS_ADD_CONNECTION2_FLAG_TO_DISK
-	                                        | NM_SETTINGS_ADD_CONNECTION2_FLAG_IN_MEMORY
-	                                        | NM_SETTINGS_ADD_CONNECTION2_FLAG_BLOCK_AUTOCONNECT)))) {
-		g_dbus_method_invocation_take_error (invocation,
-		                                     g_error_new_literal (NM_SETTINGS_ERROR,
-		                                                          NM_SETTINGS_ERROR_INVALID_ARGUMENTS,
-		                                                          "Unknown flags"));
+	if (!_add_connection2_check_args (flags_u, args, &error)) {
+		g_dbus_method_invocation_take_error (invocation, error);
 		return;
 	}
 
-	flags = flags_u;
+	settings_add_connection_helper (self, invocation, TRUE, settings, flags_u);
+}
 
-	if (!NM_FLAGS_ANY (flags,   NM_SETTINGS_ADD_CONNECTION2_FLAG_TO_DISK
-	                          | NM_SETTINGS_ADD_CONNECTION2_FLAG_IN_MEMORY)) {
-		g_dbus_method_invocation_take_error (invocation,
-		                                     g_error_new_literal (NM_SETTINGS_ERROR,
-		                                                          NM_SETTINGS_ERROR_INVALID_ARGUMENTS,
-		                                                          "Requires either to-disk (0x1) or in-memory (0x2) flags"));
-		return;
+/*****************************************************************************/
+
+typedef struct {
+	/* the profiles to add or update, in the order of the request. */
+	GPtrArray *connections;
+
+	/* the NMSettingsConnection instances to delete. */
+	GPtrArray *deletes;
+
+	NMSettingsAddConnection2Flags flags;
+} ModifyConnectionsData;
+
+static void
+_modify_connections_data_free (gpointer data)
+{
+	ModifyConnectionsData *mcd = data;
+
+	g_ptr_array_unref (mcd->connections);
+	g_ptr_array_unref (mcd->deletes);
+	g_slice_free (ModifyConnectionsData, mcd);
+}
+
+static gboolean
+_modify_connections_needs_system (NMConnection *connection)
+{
+	/* If the caller is the only user in the connection's permissions, then
+	 * 'modify.own' is sufficient. Otherwise, we require 'modify.system'. */
+	return nm_setting_connection_get_num_permissions (nm_connection_get_setting_connection (connection)) != 1;
+}
+
+static gboolean
+_modify_connections_check_existing (NMSettingsConnection *sett_conn,
+                                    NMAuthSubject *subject,
+                                    const char *perm,
+                                    GError **error)
+{
+	NMConnection *connection = nm_settings_connection_get_connection (sett_conn);
+
+	if (   nm_streq0 (perm, NM_AUTH_PERMISSION_SETTINGS_MODIFY_OWN)
+	    && _modify_connections_needs_system (connection)) {
+		g_set_error_literal (error,
+		                     NM_SETTINGS_ERROR,
+		                     NM_SETTINGS_ERROR_PERMISSION_DENIED,
+		                     NM_UTILS_ERROR_MSG_INSUFF_PRIV);
+		return FALSE;
 	}
 
-	if (NM_FLAGS_ALL (flags,   NM_SETTINGS_ADD_CONNECTION2_FLAG_TO_DISK
-	                         | NM_SETTINGS_ADD_CONNECTION2_FLAG_IN_MEMORY)) {
-		g_dbus_method_invocation_take_error (invocation,
-		                                     g_error_new_literal (NM_SETTINGS_ERROR,
-		                                                          NM_SETTINGS_ERROR_INVALID_ARGUMENTS,
-		                                                          "Cannot set to-disk (0x1) and in-memory (0x2) flags together"));
+	return nm_auth_is_subject_in_acl_set_error (connection,
+	                                            subject,
+	                                            NM_SETTINGS_ERROR,
+	                                            NM_SETTINGS_ERROR_PERMISSION_DENIED,
+	                                            error);
+}
+
+static const char *
+_modify_connections_audit_op (NMSettings *self,
+                              const ModifyConnectionsData *mcd)
+{
+	guint i;
+
+	for (i = 0; i < mcd->connections->len; i++) {
+		if (!nm_settings_get_connection_by_uuid (self, nm_connection_get_uuid (mcd->connections->pdata[i])))
+			return NM_AUDIT_OP_CONN_ADD;
+	}
+	if (mcd->connections->len > 0)
+		return NM_AUDIT_OP_CONN_UPDATE;
+	return NM_AUDIT_OP_CONN_DELETE;
+}
+
+static void
+pk_modify_connections_cb (NMAuthChain *chain,
+                          GDBusMethodInvocation *context,
+                          gpointer user_data)
+{
+	NMSettings *self = NM_SETTINGS (user_data);
+	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	gs_free_error GError *error = NULL;
+	gs_unref_ptrarray GPtrArray *paths = NULL;
+	ModifyConnectionsData *mcd;
+	NMSettingsConnectionPersistMode persist_mode;
+	NMSettingsUpdate2Flags update2_flags;
+	NMAuthSubject *subject;
+	GVariantBuilder builder;
+	gboolean written_to_disk = FALSE;
+	const char *perm;
+	guint i;
+
+	nm_assert (G_IS_DBUS_METHOD_INVOCATION (context));
+
+	c_list_unlink (nm_auth_chain_parent_lst_list (chain));
+
+	perm = nm_auth_chain_get_data (chain, "perm");
+	mcd = nm_auth_chain_get_data (chain, "data");
+	subject = nm_auth_chain_get_data (chain, "subject");
+
+	if (nm_auth_chain_get_result (chain, perm) != NM_AUTH_CALL_RESULT_YES) {
+		nm_audit_log_connection_op (_modify_connections_audit_op (self, mcd),
+		                            NULL,
+		                            FALSE,
+		                            NULL,
+		                            subject,
+		                            NM_UTILS_ERROR_MSG_INSUFF_PRIV);
+		g_dbus_method_invocation_return_error_literal (context,
+		                                               NM_SETTINGS_ERROR,
+		                                               NM_SETTINGS_ERROR_PERMISSION_DENIED,
+		                                               NM_UTILS_ERROR_MSG_INSUFF_PRIV);
 		return;
 	}
 
-	nm_assert (g_variant_is_of_type (args, G_VARIANT_TYPE ("a{sv}")));
+	if (NM_FLAGS_HAS (mcd->flags, NM_SETTINGS_ADD_CONNECTION2_FLAG_TO_DISK)) {
+		persist_mode = NM_SETTINGS_CONNECTION_PERSIST_MODE_TO_DISK;
+		update2_flags = NM_SETTINGS_UPDATE2_FLAG_TO_DISK;
+	} else {
+		persist_mode = NM_SETTINGS_CONNECTION_PERSIST_MODE_IN_MEMORY_ONLY;
+		update2_flags = NM_SETTINGS_UPDATE2_FLAG_IN_MEMORY;
+	}
+	if (NM_FLAGS_HAS (mcd->flags, NM_SETTINGS_ADD_CONNECTION2_FLAG_BLOCK_AUTOCONNECT))
+		update2_flags |= NM_SETTINGS_UPDATE2_FLAG_BLOCK_AUTOCONNECT;
 
-	g_variant_iter_init (&iter, args);
-	while (g_variant_iter_next (&iter, "{&sv}", &args_name, NULL)) {
-		g_dbus_method_invocation_take_error (invocation,
-		                                     g_error_new (NM_SETTINGS_ERROR,
-		                                                  NM_SETTINGS_ERROR_INVALID_ARGUMENTS,
-		                                                  "Unsupported argument '%s'", args_name));
+	/* Only notify once about the changed "Connections" property, instead of for
+	 * every single profile. */
+	g_object_freeze_notify (G_OBJECT (self));
+
+	for (i = 0; i < mcd->deletes->len; i++) {
+		gs_unref_object NMSettingsConnection *sett_conn = g_object_ref (mcd->deletes->pdata[i]);
+
+		if (!nm_settings_has_connection (self, sett_conn)) {
+			/* already gone. */
+			continue;
+		}
+
+		if (!_modify_connections_check_existing (sett_conn, subject, perm, &error)) {
+			nm_audit_log_connection_op (NM_AUDIT_OP_CONN_DELETE, sett_conn, FALSE, NULL, subject, error->message);
+			goto out;
+		}
+
+		nm_settings_connection_delete (sett_conn, TRUE);
+		nm_audit_log_connection_op (NM_AUDIT_OP_CONN_DELETE, sett_conn, TRUE, NULL, subject, NULL);
+	}
+
+	paths = g_ptr_array_new_full (mcd->connections->len + 1, g_free);
+
+	for (i = 0; i < mcd->connections->len; i++) {
+		NMConnection *connection = mcd->connections->pdata[i];
+		gs_unref_object NMSettingsConnection *sett_conn = NULL;
+
+		sett_conn = nm_g_object_ref (nm_settings_get_connection_by_uuid (self, nm_connection_get_uuid (connection)));
+		if (sett_conn) {
+			gs_free char *audit_args = NULL;
+
+			if (_modify_connections_check_existing (sett_conn, subject, perm, &error)) {
+				nm_settings_connection_update_authorized (sett_conn,
+				                                          connection,
+				                                          update2_flags,
+				                                          subject,
+				                                          &audit_args,
+				                                          &error);
+			}
+			nm_audit_log_connection_op (NM_AUDIT_OP_CONN_UPDATE, sett_conn, !error, audit_args,
+			                            subject, error ? error->message : NULL);
+		} else {
+			if (nm_settings_add_connection (self,
+			                                connection,
+			                                persist_mode,
+			                                  NM_FLAGS_HAS (mcd->flags, NM_SETTINGS_ADD_CONNECTION2_FLAG_BLOCK_AUTOCONNECT)
+			                                ? NM_SETTINGS_CONNECTION_ADD_REASON_BLOCK_AUTOCONNECT
+			                                : NM_SETTINGS_CONNECTION_ADD_REASON_NONE,
+			                                NM_SETTINGS_CONNECTION_INT_FLAGS_NONE,
+			                                &sett_conn,
+			                                &error)) {
+				nm_g_object_ref (sett_conn);
+				send_agent_owned_secrets (self, sett_conn, subject);
+			}
+			nm_audit_log_connection_op (NM_AUDIT_OP_CONN_ADD, sett_conn, !error, NULL,
+			                            subject, error ? error->message : NULL);
+		}
+
+		if (error) {
+			g_prefix_error (&error, "profile #%u (%s): ", i, nm_connection_get_uuid (connection));
+			goto out;
+		}
+
+		if (persist_mode == NM_SETTINGS_CONNECTION_PERSIST_MODE_TO_DISK)
+			written_to_disk = TRUE;
+
+		g_ptr_array_add (paths, g_strdup (nm_dbus_object_get_path (NM_DBUS_OBJECT (sett_conn))));
+	}
+
+out:
+	/* The profiles are written without fsync(). Sync the directory
+	 * once for all of them. */
+	if (written_to_disk)
+		nms_keyfile_plugin_sync_dir (priv->keyfile_plugin);
+
+	g_object_thaw_notify (G_OBJECT (self));
+
+	if (error) {
+		g_dbus_method_invocation_return_gerror (context, error);
 		return;
 	}
 
-	settings_add_connection_helper (self, invocation, TRUE, settings, flags);
+	g_ptr_array_add (paths, NULL);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_dbus_method_invocation_return_value (context,
+	                                       g_variant_new ("(^aoa{sv})",
+	                                                      (char **) paths->pdata,
+	                                                      &builder));
+}
+
+static void
+impl_settings_modify_connections (NMDBusObject *obj,
+                                  const NMDBusInterfaceInfoExtended *interface_info,
+                                  const NMDBusMethodInfoExtended *method_info,
+                                  GDBusConnection *dbus_connection,
+                                  const char *sender,
+                                  GDBusMethodInvocation *invocation,
+                                  GVariant *parameters)
+{
+	NMSettings *self = NM_SETTINGS (obj);
+	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	gs_unref_variant GVariant *settings_list = NULL;
+	gs_unref_variant GVariant *args = NULL;
+	gs_free const char **delete_paths = NULL;
+	gs_unref_object NMAuthSubject *subject = NULL;
+	gs_unref_hashtable GHashTable *uuids = NULL;
+	ModifyConnectionsData *mcd = NULL;
+	GError *error = NULL;
+	GVariantIter iter;
+	GVariant *settings;
+	NMAuthChain *chain;
+	gboolean needs_system = FALSE;
+	const char *perm;
+	guint32 flags_u;
+	guint i;
+
+	g_variant_get (parameters, "(@aa{sa{sv}}^a&ou@a{sv})", &settings_list, &delete_paths, &flags_u, &args);
+
+	if (!_add_connection2_check_args (flags_u, args, &error))
+		goto out_error;
+
+	subject = nm_dbus_manager_new_auth_subject_from_context (invocation);
+	if (!subject) {
+		error = g_error_new_literal (NM_SETTINGS_ERROR,
+		                             NM_SETTINGS_ERROR_PERMISSION_DENIED,
+		                             NM_UTILS_ERROR_MSG_REQ_UID_UKNOWN);
+		goto out_error;
+	}
+
+	mcd = g_slice_new (ModifyConnectionsData);
+	*mcd = (ModifyConnectionsData) {
+		.connections = g_ptr_array_new_with_free_func (g_object_unref),
+		.deletes     = g_ptr_array_new_with_free_func (g_object_unref),
+		.flags       = flags_u,
+	};
+
+	uuids = g_hash_table_new (nm_str_hash, g_str_equal);
+
+	/* Parse and check all profiles first. The request is rejected as whole,
+	 * before anything gets modified. */
+	i = 0;
+	g_variant_iter_init (&iter, settings_list);
+	while ((settings = g_variant_iter_next_value (&iter))) {
+		gs_unref_variant GVariant *settings_free = settings;
+		NMConnection *connection;
+		NMSettingsConnection *sett_conn;
+		const char *uuid;
+
+		connection = _nm_simple_connection_new_from_dbus (settings,
+		                                                    NM_SETTING_PARSE_FLAGS_STRICT
+		                                                  | NM_SETTING_PARSE_FLAGS_NORMALIZE,
+		                                                  &error);
+		if (!connection)
+			goto out_error_profile;
+		g_ptr_array_add (mcd->connections, connection);
+
+		if (!nm_connection_verify_secrets (connection, &error))
+			goto out_error_profile;
+
+		if (!nm_auth_is_subject_in_acl_set_error (connection,
+		                                          subject,
+		                                          NM_SETTINGS_ERROR,
+		                                          NM_SETTINGS_ERROR_PERMISSION_DENIED,
+		                                          &error))
+			goto out_error_profile;
+
+		uuid = nm_connection_get_uuid (connection);
+		if (!g_hash_table_add (uuids, (char *) uuid)) {
+			error = g_error_new (NM_SETTINGS_ERROR,
+			                     NM_SETTINGS_ERROR_INVALID_ARGUMENTS,
+			                     "duplicate UUID %s",
+			                     uuid);
+			goto out_error_profile;
+		}
+
+		needs_system |= _modify_connections_needs_system (connection);
+
+		sett_conn = nm_settings_get_connection_by_uuid (self, uuid);
+		if (sett_conn) {
+			if (!_modify_connections_check_existing (sett_conn, subject, NULL, &error))
+				goto out_error_profile;
+			needs_system |= _modify_connections_needs_system (nm_settings_connection_get_connection (sett_conn));
+		}
+
+		i++;
+	}
+
+	for (i = 0; delete_paths && delete_paths[i]; i++) {
+		NMSettingsConnection *sett_conn;
+
+		sett_conn = nm_settings_get_connection_by_path (self, delete_paths[i]);
+		if (!sett_conn) {
+			error = g_error_new (NM_SETTINGS_ERROR,
+			                     NM_SETTINGS_ERROR_INVALID_CONNECTION,
+			                     "No connection with the path '%s' was found",
+			                     delete_paths[i]);
+			goto out_error;
+		}
+
+		if (g_hash_table_contains (uuids, nm_settings_connection_get_uuid (sett_conn))) {
+			error = g_error_new (NM_SETTINGS_ERROR,
+			                     NM_SETTINGS_ERROR_INVALID_ARGUMENTS,
+			                     "Cannot delete and modify the connection '%s' at the same time",
+			                     delete_paths[i]);
+			goto out_error;
+		}
+
+		if (!_modify_connections_check_existing (sett_conn, subject, NULL, &error))
+			goto out_error;
+
+		needs_system |= _modify_connections_needs_system (nm_settings_connection_get_connection (sett_conn));
+		g_ptr_array_add (mcd->deletes, g_object_ref (sett_conn));
+	}
+
+	/* the strings in @uuids are owned by the connections in @mcd. */
+	nm_clear_pointer (&uuids, g_hash_table_unref);
+
+	perm =   needs_system
+	       ? NM_AUTH_PERMISSION_SETTINGS_MODIFY_SYSTEM
+	       : NM_AUTH_PERMISSION_SETTINGS_MODIFY_OWN;
+
+	chain = nm_auth_chain_new_subject (subject, invocation, pk_modify_connections_cb, self);
+	if (!chain) {
+		error = g_error_new_literal (NM_SETTINGS_ERROR,
+		                             NM_SETTINGS_ERROR_PERMISSION_DENIED,
+		                             NM_UTILS_ERROR_MSG_REQ_AUTH_FAILED);
+		goto out_error;
+	}
+
+	c_list_link_tail (&priv->auth_lst_head, nm_auth_chain_parent_lst_list (chain));
+
+	nm_auth_chain_set_data (chain, "perm", (gpointer) perm, NULL);
+	nm_auth_chain_set_data (chain, "data", g_steal_pointer (&mcd), _modify_connections_data_free);
+	nm_auth_chain_set_data (chain, "subject", g_object_ref (subject), g_object_unref);
+	nm_auth_chain_add_call_unsafe (chain, perm, TRUE);
+	return;
+
+out_error_profile:
+	g_prefix_error (&error, "profile #%u: ", i);
+out_error:
+	nm_clear_pointer (&uuids, g_hash_table_unref);
+	if (mcd)
+		_modify_connections_data_free (mcd);
+	g_dbus_method_invocation_take_error (invocation, error);
 }
 
 /*****************************************************************************/
@@ -3062,6 +3587,52 @@ nm_settings_get_connections_clone (NMSettings *self,
 	return list;
 }
 
+/**
+ * nm_settings_get_connections_by_index:
+ * @self: the #NMSettings
+ * @idx: the #NMSettingsConnectionIndex to look up
+ * @key: the value of the indexed property
+ * @out_len: (allow-none): optional output argument
+ *
+ * Looks up the connections via the secondary indexes, without iterating
+ * over all connections. For %NM_SETTINGS_CONNECTION_INDEX_MAC_ADDRESS,
+ * @key can be any valid notation of the hardware address.
+ *
+ * Returns: (transfer container) (element-type NMSettingsConnection):
+ *   a %NULL terminated array of #NMSettingsConnection objects that have
+ *   @key for the index, or %NULL if there are none. The order is arbitrary.
+ *   Caller is responsible for freeing the returned array with g_free(),
+ *   the contained values do not need to be unrefed.
+ */
+NMSettingsConnection **
+nm_settings_get_connections_by_index (NMSettings *self,
+                                      NMSettingsConnectionIndex idx,
+                                      const char *key,
+                                      guint *out_len)
+{
+	NMSettingsPrivate *priv;
+	gs_free char *key_free = NULL;
+
+	g_return_val_if_fail (NM_IS_SETTINGS (self), NULL);
+	g_return_val_if_fail ((guint) idx < _NM_SETTINGS_CONNECTION_INDEX_NUM, NULL);
+
+	priv = NM_SETTINGS_GET_PRIVATE (self);
+
+	if (   key
+	    && idx == NM_SETTINGS_CONNECTION_INDEX_MAC_ADDRESS)
+		key = (key_free = nm_utils_hwaddr_canonical (key, -1));
+
+	if (!key) {
+		NM_SET_OUT (out_len, 0);
+		return NULL;
+	}
+
+	return (NMSettingsConnection **) nm_utils_hash_keys_to_array (g_hash_table_lookup (priv->conn_idx[idx], key),
+	                                                              NULL,
+	                                                              NULL,
+	                                                              out_len);
+}
+
 NMSettingsConnection *
 nm_settings_get_connection_by_path (NMSettings *self, const char *path)
 {
@@ -3368,29 +3939,93 @@ _hostname_changed_cb (NMHostnameManager *hostname_manager,
 /*****************************************************************************/
 
 static gboolean
-have_connection_for_device (NMSettings *self, NMDevice *device)
+_have_connection_for_device_check (NMDevice *device, NMSettingsConnection *sett_conn)
+{
+	if (!nm_device_check_connection_compatible (device,
+	                                            nm_settings_connection_get_connection (sett_conn),
+	                                            NULL))
+		return FALSE;
+
+	if (nm_settings_connection_default_wired_get_device (sett_conn))
+		return FALSE;
+
+	if (NM_FLAGS_ANY (nm_settings_connection_get_flags (sett_conn),
+	                    NM_SETTINGS_CONNECTION_INT_FLAGS_VOLATILE
+	                  | NM_SETTINGS_CONNECTION_INT_FLAGS_EXTERNAL))
+		return FALSE;
+
+	return TRUE;
+}
+
+static gboolean
+_have_connection_for_device_check_idx (NMSettings *self,
+                                       NMDevice *device,
+                                       NMSettingsConnectionIndex idx,
+                                       const char *key)
 {
-	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
 	NMSettingsConnection *sett_conn;
+	GHashTableIter iter;
+	GHashTable *bucket;
 
-	g_return_val_if_fail (NM_IS_SETTINGS (self), FALSE);
+	if (!key)
+		return FALSE;
 
-	/* Find a wired connection matching for the device, if any */
-	c_list_for_each_entry (sett_conn, &priv->connections_lst_head, _connections_lst) {
-		NMConnection *connection = nm_settings_connection_get_connection (sett_conn);
+	bucket = g_hash_table_lookup (NM_SETTINGS_GET_PRIVATE (self)->conn_idx[idx], key);
+	if (!bucket)
+		return FALSE;
 
-		if (!nm_device_check_connection_compatible (device, connection, NULL))
-			continue;
+	g_hash_table_iter_init (&iter, bucket);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &sett_conn, NULL)) {
+		if (_have_connection_for_device_check (device, sett_conn))
+			return TRUE;
+	}
+	return FALSE;
+}
 
-		if (nm_settings_connection_default_wired_get_device (sett_conn))
-			continue;
+static gboolean
+have_connection_for_device (NMSettings *self, NMDevice *device)
+{
+	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	NMSettingsConnection *sett_conn;
+	const char *connection_type;
 
-		if (NM_FLAGS_ANY (nm_settings_connection_get_flags (sett_conn),
-		                    NM_SETTINGS_CONNECTION_INT_FLAGS_VOLATILE
-		                  | NM_SETTINGS_CONNECTION_INT_FLAGS_EXTERNAL))
-			continue;
+	g_return_val_if_fail (NM_IS_SETTINGS (self), FALSE);
 
-		return TRUE;
+	/* Find a wired connection matching for the device, if any */
+	connection_type = NM_DEVICE_GET_CLASS (device)->connection_type_check_compatible;
+	if (connection_type) {
+		gs_free char *hwaddr = NULL;
+		const char *str;
+
+		/* Profiles that are bound to the device by interface name or MAC
+		 * address are the likely matches. Check them first. */
+		if (_have_connection_for_device_check_idx (self,
+		                                           device,
+		                                           NM_SETTINGS_CONNECTION_INDEX_INTERFACE_NAME,
+		                                           nm_device_get_iface (device)))
+			return TRUE;
+
+		str = nm_device_get_permanent_hw_address (device);
+		if (str)
+			hwaddr = nm_utils_hwaddr_canonical (str, -1);
+		if (_have_connection_for_device_check_idx (self,
+		                                           device,
+		                                           NM_SETTINGS_CONNECTION_INDEX_MAC_ADDRESS,
+		                                           hwaddr))
+			return TRUE;
+
+		/* The device is only compatible with profiles of this type. Only
+		 * look at those, instead of all connections. */
+		if (_have_connection_for_device_check_idx (self,
+		                                           device,
+		                                           NM_SETTINGS_CONNECTION_INDEX_TYPE,
+		                                           connection_type))
+			return TRUE;
+	} else {
+		c_list_for_each_entry (sett_conn, &priv->connections_lst_head, _connections_lst) {
+			if (_have_connection_for_device_check (device, sett_conn))
+				return TRUE;
+		}
 	}
 
 	/* See if there's a known non-NetworkManager configuration for the device */
@@ -3612,6 +4247,8 @@ _kf_db_log_fcn (NMKeyFileDB *kf_db,
 	}
 }
 
+#define KF_DB_FLUSH_TIMEOUT_SEC 5
+
 static gboolean
 _kf_db_got_dirty_flush (NMSettings *self,
                         gboolean is_timestamps)
@@ -3623,11 +4260,11 @@ _kf_db_got_dirty_flush (NMSettings *self,
 	if (is_timestamps) {
 		prefix = "timestamps";
 		kf_db = priv->kf_db_timestamps;
-		priv->kf_db_flush_idle_id_timestamps = 0;
+		priv->kf_db_flush_id_timestamps = 0;
 	} else {
 		prefix = "seen-bssids";
 		kf_db = priv->kf_db_seen_bssids;
-		priv->kf_db_flush_idle_id_seen_bssids = 0;
+		priv->kf_db_flush_id_seen_bssids = 0;
 	}
 
 	if (nm_key_file_db_is_dirty (kf_db))
@@ -3661,18 +4298,18 @@ _kf_db_got_dirty_fcn (NMKeyFileDB *kf_db,
 {
 	NMSettings *self = user_data;
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
-	GSourceFunc idle_func;
+	GSourceFunc flush_func;
 	guint *p_id;
 	const char *prefix;
 
 	if (priv->kf_db_timestamps == kf_db) {
 		prefix = "timestamps";
-		p_id = &priv->kf_db_flush_idle_id_timestamps;
-		idle_func = _kf_db_got_dirty_flush_timestamps_cb;
+		p_id = &priv->kf_db_flush_id_timestamps;
+		flush_func = _kf_db_got_dirty_flush_timestamps_cb;
 	} else if (priv->kf_db_seen_bssids == kf_db) {
 		prefix = "seen-bssids";
-		p_id = &priv->kf_db_flush_idle_id_seen_bssids;
-		idle_func = _kf_db_got_dirty_flush_seen_bssids_cb;
+		p_id = &priv->kf_db_flush_id_seen_bssids;
+		flush_func = _kf_db_got_dirty_flush_seen_bssids_cb;
 	} else {
 		nm_assert_not_reached ();
 		return;
@@ -3681,7 +4318,10 @@ _kf_db_got_dirty_fcn (NMKeyFileDB *kf_db,
 	if (*p_id != 0)
 		return;
 	_LOGT ("[%s-keyfile]: schedule flushing changes to disk", prefix);
-	*p_id = g_idle_add_full (G_PRIORITY_LOW, idle_func, self, NULL);
+
+	/* Coalesce the changes of a few seconds into one write. On shutdown,
+	 * nm_settings_kf_db_write() persists what is still pending. */
+	*p_id = g_timeout_add_seconds_full (G_PRIORITY_LOW, KF_DB_FLUSH_TIMEOUT_SEC, flush_func, self, NULL);
 }
 
 void
@@ -3739,6 +4379,8 @@ nm_settings_start (NMSettings *self, GError **error)
 		                  G_CALLBACK (_plugin_unmanaged_specs_changed), self);
 		g_signal_connect (plugin, NM_SETTINGS_PLUGIN_UNRECOGNIZED_SPECS_CHANGED,
 		                  G_CALLBACK (_plugin_unrecognized_specs_changed), self);
+		g_signal_connect (plugin, NM_SETTINGS_PLUGIN_CONNECTIONS_CHANGED,
+		                  G_CALLBACK (_plugin_connections_changed), self);
 	}
 
 	_plugin_unmanaged_specs_changed (NULL, self);
@@ -3811,10 +4453,18 @@ static void
 nm_settings_init (NMSettings *self)
 {
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	int i;
 
 	c_list_init (&priv->auth_lst_head);
 	c_list_init (&priv->connections_lst_head);
 
+	for (i = 0; i < _NM_SETTINGS_CONNECTION_INDEX_NUM; i++) {
+		priv->conn_idx[i] = g_hash_table_new_full (nm_str_hash, g_str_equal,
+		                                           g_free, (GDestroyNotify) g_hash_table_unref);
+	}
+	priv->conn_idx_keys = g_hash_table_new_full (nm_direct_hash, NULL,
+	                                             NULL, _conn_idx_keys_free);
+
 	c_list_init (&priv->sce_dirty_lst_head);
 	priv->sce_idx = g_hash_table_new_full (nm_pstr_hash, nm_pstr_equal,
 	                                       NULL, (GDestroyNotify) _sett_conn_entry_free);
@@ -3879,11 +4529,17 @@ finalize (GObject *object)
 	NMSettings *self = NM_SETTINGS (object);
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
 	GSList *iter;
+	int i;
 
 	_clear_connections_cached_list (priv);
 
 	nm_assert (c_list_is_empty (&priv->connections_lst_head));
 
+	nm_assert (g_hash_table_size (priv->conn_idx_keys) == 0);
+	nm_clear_pointer (&priv->conn_idx_keys, g_hash_table_destroy);
+	for (i = 0; i < _NM_SETTINGS_CONNECTION_INDEX_NUM; i++)
+		nm_clear_pointer (&priv->conn_idx[i], g_hash_table_destroy);
+
 	nm_assert (c_list_is_empty (&priv->sce_dirty_lst_head));
 	nm_assert (g_hash_table_size (priv->sce_idx) == 0);
 
@@ -3903,8 +4559,8 @@ finalize (GObject *object)
 
 	g_clear_object (&priv->agent_mgr);
 
-	nm_clear_g_source (&priv->kf_db_flush_idle_id_timestamps);
-	nm_clear_g_source (&priv->kf_db_flush_idle_id_seen_bssids);
+	nm_clear_g_source (&priv->kf_db_flush_id_timestamps);
+	nm_clear_g_source (&priv->kf_db_flush_id_seen_bssids);
 	nm_key_file_db_to_file (priv->kf_db_timestamps, FALSE);
 	nm_key_file_db_to_file (priv->kf_db_seen_bssids, FALSE);
 	nm_key_file_db_destroy (priv->kf_db_timestamps);
@@ -3995,6 +4651,22 @@ static const NMDBusInterfaceInfoExtended interface_info_settings = {
 				),
 				.handle = impl_settings_add_connection2,
 			),
+			NM_DEFINE_DBUS_METHOD_INFO_EXTENDED (
+				NM_DEFINE_GDBUS_METHOD_INFO_INIT (
+					"ModifyConnections",
+					.in_args = NM_DEFINE_GDBUS_ARG_INFOS (
+						NM_DEFINE_GDBUS_ARG_INFO ("settings", "aa{sa{sv}}"),
+						NM_DEFINE_GDBUS_ARG_INFO ("delete",   "ao"),
+						NM_DEFINE_GDBUS_ARG_INFO ("flags",    "u"),
+						NM_DEFINE_GDBUS_ARG_INFO ("args",     "a{sv}"),
+					),
+					.out_args = NM_DEFINE_GDBUS_ARG_INFOS (
+						NM_DEFINE_GDBUS_ARG_INFO ("paths", "ao"),
+						NM_DEFINE_GDBUS_ARG_INFO ("result", "a{sv}"),
+					),
+				),
+				.handle = impl_settings_modify_connections,
+			),
 			NM_DEFINE_DBUS_METHOD_INFO_EXTENDED (
 				NM_DEFINE_GDBUS_METHOD_INFO_INIT (
 					"LoadConnections",
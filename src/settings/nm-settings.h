@@ -44,6 +44,27 @@ typedef gboolean (*NMSettingsConnectionFilterFunc) (NMSettings *settings,
                                                     NMSettingsConnection *connection,
                                                     gpointer func_data);
 
+/**
+ * NMSettingsConnectionIndex:
+ * @NM_SETTINGS_CONNECTION_INDEX_TYPE: index by the "connection.type".
+ * @NM_SETTINGS_CONNECTION_INDEX_INTERFACE_NAME: index by the
+ *   interface name, as returned by nm_connection_get_interface_name().
+ * @NM_SETTINGS_CONNECTION_INDEX_MAC_ADDRESS: index by the
+ *   "802-3-ethernet.mac-address".
+ * @NM_SETTINGS_CONNECTION_INDEX_MASTER: index by the "connection.master".
+ *
+ * The secondary indexes that #NMSettings maintains for its connections.
+ * Connections that don't have a value for the indexed property are not
+ * part of the index.
+ */
+typedef enum {
+	NM_SETTINGS_CONNECTION_INDEX_TYPE,
+	NM_SETTINGS_CONNECTION_INDEX_INTERFACE_NAME,
+	NM_SETTINGS_CONNECTION_INDEX_MAC_ADDRESS,
+	NM_SETTINGS_CONNECTION_INDEX_MASTER,
+	_NM_SETTINGS_CONNECTION_INDEX_NUM,
+} NMSettingsConnectionIndex;
+
 typedef struct _NMSettingsClass NMSettingsClass;
 
 typedef void (*NMSettingsSetHostnameCb) (const char *name, gboolean result, gpointer user_data);
@@ -83,6 +104,11 @@ NMSettingsConnection **nm_settings_get_connections_clone (NMSettings *self,
                                                           GCompareDataFunc sort_compare_func,
                                                           gpointer sort_data);
 
+NMSettingsConnection **nm_settings_get_connections_by_index (NMSettings *self,
+                                                             NMSettingsConnectionIndex idx,
+                                                             const char *key,
+                                                             guint *out_len);
+
 gboolean nm_settings_add_connection (NMSettings *settings,
                                      NMConnection *connection,
                                      NMSettingsConnectionPersistMode persist_mode,
@@ -1389,6 +1389,30 @@ read_one_ip4_route (shvarFile *ifcfg,
 	return TRUE;
 }
 
+static guint
+_route_hash (gconstpointer ptr)
+{
+	NMIPRoute *route = (NMIPRoute *) ptr;
+	NMHashState h;
+
+	/* attributes are not hashed, but _route_equal() considers them. */
+	nm_hash_init (&h, 1434226837u);
+	nm_hash_update_vals (&h,
+	                     nm_ip_route_get_prefix (route),
+	                     nm_ip_route_get_metric (route));
+	nm_hash_update_str0 (&h, nm_ip_route_get_dest (route));
+	nm_hash_update_str0 (&h, nm_ip_route_get_next_hop (route));
+	return nm_hash_complete (&h);
+}
+
+static gboolean
+_route_equal (gconstpointer a, gconstpointer b)
+{
+	return nm_ip_route_equal_full ((NMIPRoute *) a,
+	                               (NMIPRoute *) b,
+	                               NM_IP_ROUTE_EQUAL_CMP_FLAGS_WITH_ATTRS);
+}
+
 static gboolean
 read_route_file_parse (int addr_family,
                        const char *filename,
@@ -1397,7 +1421,10 @@ read_route_file_parse (int addr_family,
                        NMSettingIPConfig *s_ip,
                        GError **error)
 {
+	gs_unref_ptrarray GPtrArray *routes = NULL;
+	gs_unref_hashtable GHashTable *routes_idx = NULL;
 	gsize line_num;
+	guint i;
 
 	nm_assert (filename);
 	nm_assert (addr_family == nm_setting_ip_config_get_addr_family (s_ip));
@@ -1406,6 +1433,12 @@ read_route_file_parse (int addr_family,
 	if (len <= 0)
 		return TRUE;  /* missing/empty = success */
 
+	/* route files can contain thousands of routes. Collect them first and
+	 * detect duplicates with a hash table. nm_setting_ip_config_add_route()
+	 * would compare each new route with all the routes added so far. */
+	routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nm_ip_route_unref);
+	routes_idx = g_hash_table_new (_route_hash, _route_equal);
+
 	line_num = 0;
 	while (TRUE) {
 		nm_auto_unref_ip_route NMIPRoute *route = NULL;
@@ -1438,16 +1471,36 @@ read_route_file_parse (int addr_family,
 			goto next;
 		}
 
-		if (!nm_setting_ip_config_add_route (s_ip, route))
+		if (g_hash_table_contains (routes_idx, route)) {
 			PARSE_WARNING ("duplicate IPv%c route", addr_family == AF_INET ? '4' : '6');
+			goto next;
+		}
+		g_hash_table_add (routes_idx, route);
+		g_ptr_array_add (routes, g_steal_pointer (&route));
 
 next:
 		if (!eol)
-			return TRUE;
+			break;
 
 		/* restore original content. */
 		eol[0] = '\n';
 	}
+
+	if (routes->len == 0)
+		return TRUE;
+
+	if (nm_setting_ip_config_get_num_routes (s_ip) == 0) {
+		g_object_set (s_ip,
+		              NM_SETTING_IP_CONFIG_ROUTES, routes,
+		              NULL);
+		return TRUE;
+	}
+
+	for (i = 0; i < routes->len; i++) {
+		if (!nm_setting_ip_config_add_route (s_ip, routes->pdata[i]))
+			PARSE_WARNING ("duplicate IPv%c route", addr_family == AF_INET ? '4' : '6');
+	}
+	return TRUE;
 }
 
 static gboolean
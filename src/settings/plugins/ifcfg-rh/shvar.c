@@ -55,6 +55,11 @@ struct _shvarLine {
 	char *line;
 	char *key_with_prefix;
 
+	/* the unescaped value of @line, as returned by svGetValue(). It is only
+	 * set if unescaping required a new string, and then it caches the result
+	 * for later lookups of the same key. It gets cleared whenever @line changes. */
+	char *line_unescaped;
+
 	/* svSetValue() will clear the dirty flag. */
 	bool dirty:1;
 };
@@ -802,6 +807,7 @@ line_set (shvarLine *line, const char *value)
 		g_free (line->line);
 	}
 
+	nm_clear_g_free (&line->line_unescaped);
 	line->line = value_escaped ?: g_strdup (value);
 	ASSERT_shvarLine (line);
 	return TRUE;
@@ -813,6 +819,7 @@ line_free (shvarLine *line)
 	ASSERT_shvarLine (line);
 	c_list_unlink_stale (&line->lst);
 	g_free (line->line);
+	g_free (line->line_unescaped);
 	g_free (line->key_with_prefix);
 	g_slice_free (shvarLine, line);
 }
@@ -1083,7 +1090,7 @@ svFindFirstNumberedKey (shvarFile *s, const char *key_prefix)
 static const char *
 _svGetValue (shvarFile *s, const char *key, char **to_free)
 {
-	const shvarLine *line;
+	shvarLine *line;
 	const char *v;
 
 	nm_assert (s);
@@ -1095,6 +1102,10 @@ _svGetValue (shvarFile *s, const char *key, char **to_free)
 	line = g_hash_table_lookup (s->lst_idx, &key);
 
 	if (line && line->line) {
+		if (line->line_unescaped) {
+			*to_free = NULL;
+			return line->line_unescaped;
+		}
 		v = svUnescape (line->line, to_free);
 		if (!v) {
 			/* a wrongly quoted value is treated like the empty string.
@@ -1103,6 +1114,11 @@ _svGetValue (shvarFile *s, const char *key, char **to_free)
 			nm_assert (!*to_free);
 			return "";
 		}
+		if (*to_free) {
+			/* the reader looks up many keys more than once. Keep the unescaped
+			 * value, so that the next lookup does not need to unescape again. */
+			line->line_unescaped = g_steal_pointer (to_free);
+		}
 		return v;
 	}
 	*to_free = NULL;
@@ -1307,6 +1323,7 @@ svUnsetAll (shvarFile *s, SvKeyType match_key_type)
 		if (   line->key
 		    && _svKeyMatchesType (line->key, match_key_type)) {
 			if (nm_clear_g_free (&line->line)) {
+				nm_clear_g_free (&line->line_unescaped);
 				ASSERT_shvarLine (line);
 				changed = TRUE;
 			}
@@ -1337,6 +1354,7 @@ svUnsetDirtyWellknown (shvarFile *s, NMTernary new_dirty_value)
 		    && (ti = nms_ifcfg_rh_utils_is_well_known_key (line->key))
 		    && !NM_FLAGS_HAS (ti->key_flags, NMS_IFCFG_KEY_TYPE_KEEP_WHEN_DIRTY)) {
 			if (nm_clear_g_free (&line->line)) {
+				nm_clear_g_free (&line->line_unescaped);
 				ASSERT_shvarLine (line);
 				changed = TRUE;
 			}
@@ -1387,6 +1405,7 @@ svSetValue (shvarFile *s, const char *key, const char *value)
 			/* We only clear the value, but leave the line entry. This way, if we
 			 * happen to re-add the value, we write it to the same line again. */
 			if (nm_clear_g_free (&line->line)) {
+				nm_clear_g_free (&line->line_unescaped);
 				changed = TRUE;
 			}
 		}
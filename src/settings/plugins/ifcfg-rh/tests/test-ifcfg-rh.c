@@ -1461,6 +1461,58 @@ test_read_wired_static_routes_legacy (void)
 	g_object_unref (connection);
 }
 
+static void
+test_read_wired_static_routes_legacy_many (void)
+{
+	nmtst_auto_unlinkfile char *ifcfg_path = g_strdup (TEST_SCRATCH_DIR_TMP"/ifcfg-test-many-routes");
+	nmtst_auto_unlinkfile char *route_path = g_strdup (TEST_SCRATCH_DIR_TMP"/route-test-many-routes");
+	gs_unref_object NMConnection *connection = NULL;
+	nm_auto_free_gstring GString *str = NULL;
+	NMSettingIPConfig *s_ip4;
+	NMIPRoute *ip4_route;
+	const guint n_routes = g_test_perf () ? 50000 : 2000;
+	gint64 start_nsec;
+	gboolean success;
+	guint i;
+
+	success = g_file_set_contents (ifcfg_path,
+	                               "TYPE=Ethernet\n"
+	                               "DEVICE=eth0\n"
+	                               "NAME=\"test-many-routes\"\n"
+	                               "BOOTPROTO=dhcp\n"
+	                               "ONBOOT=yes\n"
+	                               "IPV6INIT=no\n",
+	                               -1,
+	                               NULL);
+	g_assert (success);
+
+	str = g_string_new (NULL);
+	for (i = 0; i < n_routes; i++) {
+		g_string_append_printf (str,
+		                        "%u.%u.%u.0/24 via 192.168.1.%u metric %u\n",
+		                        10 + (i >> 16), (i >> 8) & 0xFF, i & 0xFF,
+		                        1 + (i % 200),
+		                        i % 7);
+	}
+	success = g_file_set_contents (route_path, str->str, str->len, NULL);
+	g_assert (success);
+
+	start_nsec = nm_utils_get_monotonic_timestamp_nsec ();
+	connection = _connection_from_file (ifcfg_path, NULL, TYPE_ETHERNET, NULL);
+	g_test_message ("read %u legacy routes in %.3f msec",
+	                n_routes,
+	                (double) (nm_utils_get_monotonic_timestamp_nsec () - start_nsec) / 1000000.0);
+
+	s_ip4 = nm_connection_get_setting_ip4_config (connection);
+	g_assert (s_ip4);
+	g_assert_cmpint (nm_setting_ip_config_get_num_routes (s_ip4), ==, n_routes);
+
+	ip4_route = nm_setting_ip_config_get_route (s_ip4, n_routes - 1);
+	i = n_routes - 1;
+	g_assert_cmpint (nm_ip_route_get_prefix (ip4_route), ==, 24);
+	g_assert_cmpint (nm_ip_route_get_metric (ip4_route), ==, i % 7);
+}
+
 static void
 test_read_wired_ipv4_manual (gconstpointer data)
 {
@@ -10544,6 +10596,7 @@ int main (int argc, char **argv)
 	g_test_add_func (TPATH "read-defroute-no-gatewaydev-yes", test_read_wired_defroute_no_gatewaydev_yes);
 	g_test_add_func (TPATH "routes/read-static", test_read_wired_static_routes);
 	g_test_add_func (TPATH "routes/read-static-legacy", test_read_wired_static_routes_legacy);
+	g_test_add_func (TPATH "routes/read-static-legacy-many", test_read_wired_static_routes_legacy_many);
 
 	nmtst_add_test_func (TPATH "wired/read/manual/1", test_read_wired_ipv4_manual, TEST_IFCFG_DIR"/ifcfg-test-wired-ipv4-manual-1", "System test-wired-ipv4-manual-1");
 	nmtst_add_test_func (TPATH "wired/read/manual/2", test_read_wired_ipv4_manual, TEST_IFCFG_DIR"/ifcfg-test-wired-ipv4-manual-2", "System test-wired-ipv4-manual-2");
@@ -0,0 +1,388 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "nm-default.h"
+
+#include "nms-keyfile-cache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nm-glib-aux/nm-io-utils.h"
+#include "nm-core-internal.h"
+#include "nms-keyfile-utils.h"
+
+/*****************************************************************************/
+
+/* The cache is a single serialized GVariant, which we mmap() on load. It
+ * contains the normalized connections of all profiles, together with the
+ * stat() information of the file that they were read from. A profile is only
+ * taken from the cache, if the file is still identical.
+ *
+ * Note that the cache contains secrets. It has the same permission requirements
+ * as keyfiles.
+ *
+ * The cached connections are normalized, and normalization changes between
+ * releases. Besides the format version, the header also records the version
+ * of NetworkManager that wrote the cache, and it is discarded after an upgrade. */
+
+#if !defined(NM_DIST_VERSION)
+#define NM_DIST_VERSION VERSION
+#endif
+
+#define CACHE_VERSION    2
+
+#define CACHE_ENTRY_TYPE "(stttxxxxiiisia{sa{sv}})"
+#define CACHE_TYPE       "(ussa"CACHE_ENTRY_TYPE")"
+
+struct _NMSKeyfileCache {
+	GVariant *variant;
+
+	/* the entries by filename. The keys point inside the entries. */
+	GHashTable *entries;
+};
+
+/*****************************************************************************/
+
+#define _NMLOG_DOMAIN      LOGD_SETTINGS
+#define _NMLOG(level, ...) __NMLOG_DEFAULT (level, _NMLOG_DOMAIN, "keyfile", __VA_ARGS__)
+
+/*****************************************************************************/
+
+static NMTernary
+_ternary_from_int (gint32 v)
+{
+	if (NM_IN_SET (v, NM_TERNARY_DEFAULT, NM_TERNARY_FALSE, NM_TERNARY_TRUE))
+		return v;
+	return NM_TERNARY_DEFAULT;
+}
+
+/*****************************************************************************/
+
+NMSKeyfileCache *
+nms_keyfile_cache_load (const char *filename,
+                        const char *plugin_dir)
+{
+	nm_auto_close int fd = -1;
+	struct stat st;
+	gs_free_error GError *error = NULL;
+	GMappedFile *mapped_file;
+	gs_unref_bytes GBytes *bytes = NULL;
+	gs_unref_variant GVariant *variant = NULL;
+	gs_unref_variant GVariant *entries = NULL;
+	NMSKeyfileCache *cache;
+	const char *cache_plugin_dir;
+	const char *cache_dist_version;
+	guint32 version;
+	gsize i, n;
+
+	g_return_val_if_fail (filename && filename[0] == '/', NULL);
+	g_return_val_if_fail (plugin_dir, NULL);
+
+	fd = open (filename, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		_LOGT ("cache: \"%s\" not loaded: %s", filename, nm_strerror_native (errno));
+		return NULL;
+	}
+
+	if (fstat (fd, &st) != 0)
+		return NULL;
+
+	if (!nms_keyfile_utils_check_file_permissions_stat (NMS_KEYFILE_FILETYPE_KEYFILE, &st, &error)) {
+		_LOGW ("cache: \"%s\" ignored: %s", filename, error->message);
+		return NULL;
+	}
+
+	mapped_file = g_mapped_file_new_from_fd (fd, FALSE, &error);
+	if (!mapped_file) {
+		_LOGW ("cache: \"%s\" not loaded: %s", filename, error->message);
+		return NULL;
+	}
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	g_mapped_file_unref (mapped_file);
+
+	variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (CACHE_TYPE),
+	                                                        bytes,
+	                                                        FALSE));
+
+	g_variant_get (variant,
+	               "(u&s&s@a"CACHE_ENTRY_TYPE")",
+	               &version,
+	               &cache_dist_version,
+	               &cache_plugin_dir,
+	               &entries);
+
+	if (   version != CACHE_VERSION
+	    || !nm_streq (cache_dist_version, NM_DIST_VERSION)
+	    || !nm_streq (cache_plugin_dir, plugin_dir)) {
+		_LOGD ("cache: \"%s\" ignored: outdated", filename);
+		return NULL;
+	}
+
+	cache = g_slice_new (NMSKeyfileCache);
+	*cache = (NMSKeyfileCache) {
+		.variant = g_steal_pointer (&variant),
+		.entries = g_hash_table_new_full (nm_str_hash, g_str_equal, NULL, (GDestroyNotify) g_variant_unref),
+	};
+
+	n = g_variant_n_children (entries);
+	for (i = 0; i < n; i++) {
+		GVariant *entry;
+		const char *full_filename;
+
+		entry = g_variant_get_child_value (entries, i);
+		g_variant_get_child (entry, 0, "&s", &full_filename);
+		g_hash_table_replace (cache->entries, (char *) full_filename, entry);
+	}
+
+	_LOGD ("cache: \"%s\" loaded with %u entries", filename, g_hash_table_size (cache->entries));
+
+	return cache;
+}
+
+void
+nms_keyfile_cache_free (NMSKeyfileCache *cache)
+{
+	if (!cache)
+		return;
+
+	g_hash_table_unref (cache->entries);
+	g_variant_unref (cache->variant);
+	g_slice_free (NMSKeyfileCache, cache);
+}
+
+guint
+nms_keyfile_cache_get_num_entries (const NMSKeyfileCache *cache)
+{
+	g_return_val_if_fail (cache, 0);
+
+	return g_hash_table_size (cache->entries);
+}
+
+static gboolean
+_entry_stat_equal (GVariant *entry,
+                   const struct stat *st)
+{
+	guint64 st_dev;
+	guint64 st_ino;
+	guint64 st_size;
+	gint64 mtime_sec;
+	gint64 mtime_nsec;
+	gint64 ctime_sec;
+	gint64 ctime_nsec;
+
+	g_variant_get (entry,
+	               "(&stttxxxxiii&sia{sa{sv}})",
+	               NULL,
+	               &st_dev,
+	               &st_ino,
+	               &st_size,
+	               &mtime_sec,
+	               &mtime_nsec,
+	               &ctime_sec,
+	               &ctime_nsec,
+	               NULL,
+	               NULL,
+	               NULL,
+	               NULL,
+	               NULL,
+	               NULL);
+
+	return    st_dev == (guint64) st->st_dev
+	       && st_ino == (guint64) st->st_ino
+	       && st_size == (guint64) st->st_size
+	       && mtime_sec == (gint64) st->st_mtim.tv_sec
+	       && mtime_nsec == (gint64) st->st_mtim.tv_nsec
+	       && ctime_sec == (gint64) st->st_ctim.tv_sec
+	       && ctime_nsec == (gint64) st->st_ctim.tv_nsec;
+}
+
+/**
+ * nms_keyfile_cache_lookup_entry:
+ * @cache: the #NMSKeyfileCache
+ * @full_filename: the keyfile to look up
+ * @st: the current stat() result of @full_filename
+ *
+ * Returns: (transfer full): the cache entry for @full_filename, if the file
+ *   did not change since. Contrary to nms_keyfile_cache_lookup(), this does
+ *   not create the connection.
+ */
+GVariant *
+nms_keyfile_cache_lookup_entry (const NMSKeyfileCache *cache,
+                                const char *full_filename,
+                                const struct stat *st)
+{
+	GVariant *entry;
+
+	nm_assert (cache);
+	nm_assert (full_filename);
+	nm_assert (st);
+
+	entry = g_hash_table_lookup (cache->entries, full_filename);
+	if (   !entry
+	    || !_entry_stat_equal (entry, st))
+		return NULL;
+
+	return g_variant_ref (entry);
+}
+
+/**
+ * nms_keyfile_cache_lookup:
+ * @cache: the #NMSKeyfileCache
+ * @full_filename: the keyfile to look up
+ * @st: the current stat() result of @full_filename
+ * @out_is_nm_generated: (out): the nmmeta values, as returned
+ *   by nms_keyfile_reader_from_file().
+ * @out_is_volatile: (out):
+ * @out_is_external: (out):
+ * @out_shadowed_storage: (out) (transfer full):
+ * @out_shadowed_owned: (out):
+ * @out_entry: (out) (transfer full): on success, the cache entry, which can
+ *   be passed on to nms_keyfile_cache_write().
+ *
+ * This does not modify @cache and can be called from any thread.
+ *
+ * Returns: (transfer full): the connection from the cache, if there
+ *   is an entry for @full_filename and the file did not change since.
+ */
+NMConnection *
+nms_keyfile_cache_lookup (const NMSKeyfileCache *cache,
+                          const char *full_filename,
+                          const struct stat *st,
+                          NMTernary *out_is_nm_generated,
+                          NMTernary *out_is_volatile,
+                          NMTernary *out_is_external,
+                          char **out_shadowed_storage,
+                          NMTernary *out_shadowed_owned,
+                          GVariant **out_entry)
+{
+	gs_unref_object NMConnection *connection = NULL;
+	gs_unref_variant GVariant *dict = NULL;
+	GVariant *entry;
+	gint32 is_nm_generated;
+	gint32 is_volatile;
+	gint32 is_external;
+	gint32 shadowed_owned;
+	const char *shadowed_storage;
+
+	nm_assert (cache);
+	nm_assert (full_filename);
+	nm_assert (st);
+
+	entry = g_hash_table_lookup (cache->entries, full_filename);
+	if (   !entry
+	    || !_entry_stat_equal (entry, st))
+		return NULL;
+
+	g_variant_get (entry,
+	               "(&stttxxxxiii&si@a{sa{sv}})",
+	               NULL,
+	               NULL,
+	               NULL,
+	               NULL,
+	               NULL,
+	               NULL,
+	               NULL,
+	               NULL,
+	               &is_nm_generated,
+	               &is_volatile,
+	               &is_external,
+	               &shadowed_storage,
+	               &shadowed_owned,
+	               &dict);
+
+	connection = nm_simple_connection_new_from_dbus (dict, NULL);
+	if (!connection)
+		return NULL;
+
+	if (!nm_connection_normalize (connection, NULL, NULL, NULL))
+		return NULL;
+
+	if (!nm_utils_is_uuid (nm_connection_get_uuid (connection)))
+		return NULL;
+
+	NM_SET_OUT (out_is_nm_generated, _ternary_from_int (is_nm_generated));
+	NM_SET_OUT (out_is_volatile, _ternary_from_int (is_volatile));
+	NM_SET_OUT (out_is_external, _ternary_from_int (is_external));
+	NM_SET_OUT (out_shadowed_storage, shadowed_storage[0] ? g_strdup (shadowed_storage) : NULL);
+	NM_SET_OUT (out_shadowed_owned, _ternary_from_int (shadowed_owned));
+	NM_SET_OUT (out_entry, g_variant_ref (entry));
+	return g_steal_pointer (&connection);
+}
+
+/**
+ * nms_keyfile_cache_entry_new:
+ *
+ * Create the cache entry for a connection that was read from @full_filename.
+ * The arguments are as returned by nms_keyfile_reader_from_file().
+ *
+ * Returns: (transfer full): the new entry for nms_keyfile_cache_write().
+ */
+GVariant *
+nms_keyfile_cache_entry_new (const char *full_filename,
+                             const struct stat *st,
+                             NMConnection *connection,
+                             NMTernary is_nm_generated,
+                             NMTernary is_volatile,
+                             NMTernary is_external,
+                             const char *shadowed_storage,
+                             NMTernary shadowed_owned)
+{
+	GVariant *dict;
+
+	nm_assert (full_filename && full_filename[0] == '/');
+	nm_assert (st);
+	nm_assert (NM_IS_CONNECTION (connection));
+
+	dict = nm_connection_to_dbus (connection, NM_CONNECTION_SERIALIZE_ALL);
+	if (!dict)
+		return NULL;
+
+	return g_variant_ref_sink (g_variant_new ("(stttxxxxiiisi@a{sa{sv}})",
+	                                          full_filename,
+	                                          (guint64) st->st_dev,
+	                                          (guint64) st->st_ino,
+	                                          (guint64) st->st_size,
+	                                          (gint64) st->st_mtim.tv_sec,
+	                                          (gint64) st->st_mtim.tv_nsec,
+	                                          (gint64) st->st_ctim.tv_sec,
+	                                          (gint64) st->st_ctim.tv_nsec,
+	                                          (gint32) is_nm_generated,
+	                                          (gint32) is_volatile,
+	                                          (gint32) is_external,
+	                                          shadowed_storage ?: "",
+	                                          (gint32) shadowed_owned,
+	                                          dict));
+}
+
+gboolean
+nms_keyfile_cache_write (const char *filename,
+                         const char *plugin_dir,
+                         GPtrArray *entries,
+                         GError **error)
+{
+	gs_unref_variant GVariant *variant = NULL;
+
+	g_return_val_if_fail (filename && filename[0] == '/', FALSE);
+	g_return_val_if_fail (plugin_dir, FALSE);
+	g_return_val_if_fail (entries, FALSE);
+
+	variant = g_variant_ref_sink (g_variant_new ("(uss@a"CACHE_ENTRY_TYPE")",
+	                                             (guint32) CACHE_VERSION,
+	                                             NM_DIST_VERSION,
+	                                             plugin_dir,
+	                                             g_variant_new_array (G_VARIANT_TYPE (CACHE_ENTRY_TYPE),
+	                                                                  (GVariant *const*) entries->pdata,
+	                                                                  entries->len)));
+
+	if (!nm_utils_file_set_contents (filename,
+	                                 g_variant_get_data (variant),
+	                                 g_variant_get_size (variant),
+	                                 0600,
+	                                 NULL,
+	                                 error))
+		return FALSE;
+
+	_LOGD ("cache: \"%s\" written with %u entries", filename, entries->len);
+	return TRUE;
+}
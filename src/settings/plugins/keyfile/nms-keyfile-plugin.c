@@ -8,6 +8,7 @@
 
 #include "nms-keyfile-plugin.h"
 
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -31,6 +32,7 @@
 #include "settings/nm-settings-storage.h"
 #include "settings/nm-settings-utils.h"
 
+#include "nms-keyfile-cache.h"
 #include "nms-keyfile-storage.h"
 #include "nms-keyfile-writer.h"
 #include "nms-keyfile-reader.h"
@@ -61,6 +63,15 @@ typedef struct {
 
 	NMSettUtilStorages storages;
 
+	/* for the automatic reload (auto-reload-delay). The monitors watch the
+	 * keyfile directories and the names of the changed files are collected
+	 * in @dirty_files, until the (debounced) reload happens. */
+	GPtrArray *monitors;
+	GHashTable *dirty_files;
+	GSource *auto_reload_source;
+	guint auto_reload_delay_msec;
+	bool auto_reload_in_progress:1;
+
 } NMSKeyfilePluginPrivate;
 
 struct _NMSKeyfilePlugin {
@@ -297,6 +308,7 @@ _load_file (NMSKeyfilePlugin *self,
 {
 	NMSKeyfilePluginPrivate *priv;
 	gs_unref_object NMConnection *connection = NULL;
+	NMSKeyfileStorage *storage;
 	NMTernary is_nm_generated_opt;
 	NMTernary is_volatile_opt;
 	NMTernary is_external_opt;
@@ -376,16 +388,18 @@ _load_file (NMSKeyfilePlugin *self,
 		return NULL;
 	}
 
-	return nms_keyfile_storage_new_connection (self,
-	                                           g_steal_pointer (&connection),
-	                                           full_filename,
-	                                           storage_type,
-	                                           is_nm_generated_opt,
-	                                           is_volatile_opt,
-	                                           is_external_opt,
-	                                           shadowed_storage,
-	                                           shadowed_owned_opt,
-	                                           &st.st_mtim);
+	storage = nms_keyfile_storage_new_connection (self,
+	                                              g_steal_pointer (&connection),
+	                                              full_filename,
+	                                              storage_type,
+	                                              is_nm_generated_opt,
+	                                              is_volatile_opt,
+	                                              is_external_opt,
+	                                              shadowed_storage,
+	                                              shadowed_owned_opt,
+	                                              &st.st_mtim);
+	nms_keyfile_storage_set_stat (storage, &st);
+	return storage;
 }
 
 static NMSKeyfileStorage *
@@ -410,41 +424,279 @@ _load_file_from_path (NMSKeyfilePlugin *self,
 	                   error);
 }
 
+/* Directories with fewer files than this are loaded on the main thread.
+ * Otherwise, the files are read and parsed by a pool of worker threads. */
+#define LOAD_DIR_PARALLEL_MIN_FILES 64
+#define LOAD_DIR_PARALLEL_MAX_THREADS 8
+
+typedef struct {
+	const char *plugin_dir;
+
+	/* the compiled cache from the previous load (if any). It is not modified
+	 * while loading, so that the worker threads can use it. */
+	const NMSKeyfileCache *cache;
+
+	/* the entries for writing the new cache, or %NULL if the cache
+	 * is disabled. Only modified on the main thread. */
+	GPtrArray *cache_entries;
+	guint cache_misses;
+
+	/* the names of the files that changed according to the file monitors,
+	 * or %NULL to check all files with stat(). */
+	GHashTable *dirty_files;
+
+	/* the existing storages whose files did not change. They are
+	 * kept as they are and not read again. */
+	GHashTable *storages_unchanged;
+} LoadDirCtx;
+
+typedef struct {
+	const char *filename;
+	char *full_filename;
+	NMConnection *connection;
+	char *shadowed_storage;
+	GVariant *cache_entry;
+	GError *error;
+	NMSKeyfileStorage *storage_unchanged;
+	struct stat st;
+	NMTernary is_nm_generated_opt;
+	NMTernary is_volatile_opt;
+	NMTernary is_external_opt;
+	NMTernary shadowed_owned_opt;
+	bool cache_hit:1;
+} LoadDirFileData;
+
+static void
+_load_dir_file_data_clear (LoadDirFileData *fdata)
+{
+	g_free (fdata->full_filename);
+	nm_clear_g_object (&fdata->connection);
+	g_free (fdata->shadowed_storage);
+	nm_clear_pointer (&fdata->cache_entry, g_variant_unref);
+	g_clear_error (&fdata->error);
+}
+
+static void
+_load_dir_read_fn (gpointer data, gpointer user_data)
+{
+	LoadDirFileData *fdata = data;
+	const LoadDirCtx *ctx = user_data;
+
+	/* Note that this may run on a worker thread. Only the reading and parsing
+	 * of the file happens here. The storages are created on the main thread. */
+
+	if (ctx->cache) {
+		struct stat st;
+
+		if (   nms_keyfile_utils_check_file_permissions (NMS_KEYFILE_FILETYPE_KEYFILE,
+		                                                 fdata->full_filename,
+		                                                 &st,
+		                                                 NULL)
+		    && (fdata->connection = nms_keyfile_cache_lookup (ctx->cache,
+		                                                      fdata->full_filename,
+		                                                      &st,
+		                                                      &fdata->is_nm_generated_opt,
+		                                                      &fdata->is_volatile_opt,
+		                                                      &fdata->is_external_opt,
+		                                                      &fdata->shadowed_storage,
+		                                                      &fdata->shadowed_owned_opt,
+		                                                      &fdata->cache_entry))) {
+			fdata->st = st;
+			fdata->cache_hit = TRUE;
+			return;
+		}
+	}
+
+	fdata->connection = _read_from_file (fdata->full_filename,
+	                                     ctx->plugin_dir,
+	                                     &fdata->st,
+	                                     &fdata->is_nm_generated_opt,
+	                                     &fdata->is_volatile_opt,
+	                                     &fdata->is_external_opt,
+	                                     &fdata->shadowed_storage,
+	                                     &fdata->shadowed_owned_opt,
+	                                     &fdata->error);
+	if (   fdata->connection
+	    && ctx->cache_entries) {
+		fdata->cache_entry = nms_keyfile_cache_entry_new (fdata->full_filename,
+		                                                  &fdata->st,
+		                                                  fdata->connection,
+		                                                  fdata->is_nm_generated_opt,
+		                                                  fdata->is_volatile_opt,
+		                                                  fdata->is_external_opt,
+		                                                  fdata->shadowed_storage,
+		                                                  fdata->shadowed_owned_opt);
+	}
+}
+
+static gboolean
+_load_dir_check_unchanged (const LoadDirCtx *ctx,
+                           NMSKeyfileStorage *storage_old,
+                           LoadDirFileData *fdata)
+{
+	struct stat st;
+
+	if (   storage_old->is_meta_data
+	    || !storage_old->u.conn_data.has_stat)
+		return FALSE;
+
+	if (   ctx->dirty_files
+	    && !ctx->cache_entries
+	    && !g_hash_table_contains (ctx->dirty_files, fdata->full_filename)) {
+		/* the file monitor did not report a change for this file. */
+		return TRUE;
+	}
+
+	if (stat (fdata->full_filename, &st) != 0)
+		return FALSE;
+
+	if (!nms_keyfile_storage_stat_unchanged (storage_old, &st))
+		return FALSE;
+
+	if (ctx->cache_entries) {
+		/* the new cache needs an entry for the file too. If the old cache does
+		 * not have a valid one, we read the file again. */
+		if (!ctx->cache)
+			return FALSE;
+		fdata->cache_entry = nms_keyfile_cache_lookup_entry (ctx->cache, fdata->full_filename, &st);
+		if (!fdata->cache_entry)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 static void
 _load_dir (NMSKeyfilePlugin *self,
            NMSKeyfileStorageType storage_type,
            const char *dirname,
+           LoadDirCtx *ctx,
            NMSettUtilStorages *storages)
 {
+	NMSKeyfilePluginPrivate *priv = NMS_KEYFILE_PLUGIN_GET_PRIVATE (self);
 	const char *filename;
 	GDir *dir;
 	gs_unref_hashtable GHashTable *dupl_filenames = NULL;
+	gs_unref_ptrarray GPtrArray *filenames = NULL;
+	gs_free LoadDirFileData *fdatas = NULL;
+	guint n_read = 0;
+	guint i;
 
 	dir = g_dir_open (dirname, 0, NULL);
 	if (!dir)
 		return;
 
 	dupl_filenames = g_hash_table_new_full (nm_str_hash, g_str_equal, NULL, g_free);
+	filenames = g_ptr_array_new ();
 
 	while ((filename = g_dir_read_name (dir))) {
-		gs_unref_object NMSKeyfileStorage *storage = NULL;
-
 		filename = g_strdup (filename);
 		if (!g_hash_table_add (dupl_filenames, (char *) filename))
 			continue;
+		g_ptr_array_add (filenames, (char *) filename);
+	}
 
-		storage = _load_file (self,
-		                      dirname,
-		                      filename,
-		                      storage_type,
-		                      NULL);
-		if (!storage)
+	g_dir_close (dir);
+
+	if (filenames->len == 0)
+		return;
+
+	fdatas = g_new0 (LoadDirFileData, filenames->len);
+	for (i = 0; i < filenames->len; i++) {
+		LoadDirFileData *fdata = &fdatas[i];
+		NMSKeyfileStorage *storage_old;
+
+		fdata->filename = filenames->pdata[i];
+
+		/* nmmeta files are cheap and handled by _load_file() below. */
+		if (_ignore_filename (storage_type, fdata->filename))
 			continue;
 
-		nm_sett_util_storages_add_take (storages, g_steal_pointer (&storage));
+		fdata->full_filename = g_build_filename (dirname, fdata->filename, NULL);
+
+		storage_old = nm_sett_util_storages_lookup_by_filename (&priv->storages, fdata->full_filename);
+		if (   storage_old
+		    && _load_dir_check_unchanged (ctx, storage_old, fdata)) {
+			fdata->storage_unchanged = storage_old;
+			continue;
+		}
+
+		n_read++;
 	}
 
-	g_dir_close (dir);
+	if (n_read >= LOAD_DIR_PARALLEL_MIN_FILES) {
+		GThreadPool *pool;
+		guint n_threads;
+
+		n_threads = NM_CLAMP (g_get_num_processors (), 1u, (guint) LOAD_DIR_PARALLEL_MAX_THREADS);
+
+		_LOGT ("load: \"%s\": read %u files with %u threads", dirname, n_read, n_threads);
+
+		pool = g_thread_pool_new (_load_dir_read_fn,
+		                          ctx,
+		                          n_threads,
+		                          FALSE,
+		                          NULL);
+		for (i = 0; i < filenames->len; i++) {
+			if (   fdatas[i].full_filename
+			    && !fdatas[i].storage_unchanged)
+				g_thread_pool_push (pool, &fdatas[i], NULL);
+		}
+
+		/* wait for all files to be read. */
+		g_thread_pool_free (pool, FALSE, TRUE);
+	} else {
+		for (i = 0; i < filenames->len; i++) {
+			if (   fdatas[i].full_filename
+			    && !fdatas[i].storage_unchanged)
+				_load_dir_read_fn (&fdatas[i], ctx);
+		}
+	}
+
+	/* merge the results in the order of the directory listing. */
+	for (i = 0; i < filenames->len; i++) {
+		LoadDirFileData *fdata = &fdatas[i];
+		NMSKeyfileStorage *storage;
+
+		if (fdata->storage_unchanged) {
+			if (ctx->cache_entries)
+				g_ptr_array_add (ctx->cache_entries, g_steal_pointer (&fdata->cache_entry));
+			g_hash_table_add (ctx->storages_unchanged, fdata->storage_unchanged);
+			storage = NULL;
+		} else if (!fdata->full_filename) {
+			storage = _load_file (self,
+			                      dirname,
+			                      fdata->filename,
+			                      storage_type,
+			                      NULL);
+		} else if (!fdata->connection) {
+			_LOGW ("load: \"%s\": failed to load connection: %s", fdata->full_filename, fdata->error->message);
+			storage = NULL;
+		} else {
+			if (ctx->cache_entries) {
+				if (!fdata->cache_hit)
+					ctx->cache_misses++;
+				if (fdata->cache_entry)
+					g_ptr_array_add (ctx->cache_entries, g_steal_pointer (&fdata->cache_entry));
+			}
+			storage = nms_keyfile_storage_new_connection (self,
+			                                              g_steal_pointer (&fdata->connection),
+			                                              fdata->full_filename,
+			                                              storage_type,
+			                                              fdata->is_nm_generated_opt,
+			                                              fdata->is_volatile_opt,
+			                                              fdata->is_external_opt,
+			                                              fdata->shadowed_storage,
+			                                              fdata->shadowed_owned_opt,
+			                                              &fdata->st.st_mtim);
+			nms_keyfile_storage_set_stat (storage, &fdata->st);
+		}
+
+		_load_dir_file_data_clear (fdata);
+
+		if (storage)
+			nm_sett_util_storages_add_take (storages, storage);
+	}
 
 #if NM_MORE_ASSERTS
 	{
@@ -463,6 +715,7 @@ _storages_consolidate (NMSKeyfilePlugin *self,
                        NMSettUtilStorages *storages_new,
                        gboolean replace_all,
                        GHashTable *storages_replaced,
+                       GHashTable *storages_unchanged,
                        NMSettingsPluginConnectionLoadCallback callback,
                        gpointer user_data)
 {
@@ -479,8 +732,12 @@ _storages_consolidate (NMSKeyfilePlugin *self,
 	storages_modified = g_ptr_array_new_with_free_func (g_object_unref);
 	c_list_init (&storages_deleted);
 
-	c_list_for_each_entry (storage_old, &priv->storages._storage_lst_head, parent._storage_lst)
-		storage_old->is_dirty = TRUE;
+	/* unchanged storages are neither deleted nor modified, and we don't
+	 * emit a signal for them. */
+	c_list_for_each_entry (storage_old, &priv->storages._storage_lst_head, parent._storage_lst) {
+		storage_old->is_dirty =    !storages_unchanged
+		                        || !g_hash_table_contains (storages_unchanged, storage_old);
+	}
 
 	c_list_for_each_entry_safe (storage_new, storage_safe, &storages_new->_storage_lst_head, parent._storage_lst) {
 		storage_old = nm_sett_util_storages_lookup_by_filename (&priv->storages, nms_keyfile_storage_get_filename (storage_new));
@@ -570,18 +827,72 @@ reload_connections (NMSettingsPlugin *plugin,
 	NMSKeyfilePlugin *self = NMS_KEYFILE_PLUGIN (plugin);
 	NMSKeyfilePluginPrivate *priv = NMS_KEYFILE_PLUGIN_GET_PRIVATE (self);
 	nm_auto_clear_sett_util_storages NMSettUtilStorages storages_new = NM_SETT_UTIL_STORAGES_INIT (storages_new, nms_keyfile_storage_destroy);
+	nm_auto_free_keyfile_cache NMSKeyfileCache *cache = NULL;
+	gs_unref_ptrarray GPtrArray *cache_entries = NULL;
+	gs_unref_hashtable GHashTable *dirty_files = NULL;
+	gs_unref_hashtable GHashTable *storages_unchanged = NULL;
+	LoadDirCtx ctx;
 	int i;
 
-	_load_dir (self, NMS_KEYFILE_STORAGE_TYPE_RUN, priv->dirname_run, &storages_new);
+	/* Files whose stat() information did not change since they were loaded are
+	 * not read again. For the automatic reload we rely on the file monitors and
+	 * only check the files that were reported as changed. An explicit reload
+	 * checks all files. */
+	nm_clear_g_source_inst (&priv->auto_reload_source);
+	if (priv->dirty_files) {
+		dirty_files = g_steal_pointer (&priv->dirty_files);
+		priv->dirty_files = g_hash_table_new_full (nm_str_hash, g_str_equal, g_free, NULL);
+	}
+
+	storages_unchanged = g_hash_table_new (nm_direct_hash, NULL);
+
+	if (nm_config_data_get_value_boolean (NM_CONFIG_GET_DATA,
+	                                      NM_CONFIG_KEYFILE_GROUP_KEYFILE,
+	                                      NM_CONFIG_KEYFILE_KEY_KEYFILE_CONNECTION_CACHE,
+	                                      FALSE)) {
+		cache = nms_keyfile_cache_load (NMS_KEYFILE_CACHE_FILENAME, _get_plugin_dir (priv));
+		cache_entries = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+	}
+
+	ctx = (LoadDirCtx) {
+		.plugin_dir         = _get_plugin_dir (priv),
+		.cache              = cache,
+		.cache_entries      = cache_entries,
+		.dirty_files        = priv->auto_reload_in_progress ? dirty_files : NULL,
+		.storages_unchanged = storages_unchanged,
+	};
+
+	_load_dir (self, NMS_KEYFILE_STORAGE_TYPE_RUN, priv->dirname_run, &ctx, &storages_new);
 	if (priv->dirname_etc)
-		_load_dir (self, NMS_KEYFILE_STORAGE_TYPE_ETC, priv->dirname_etc, &storages_new);
+		_load_dir (self, NMS_KEYFILE_STORAGE_TYPE_ETC, priv->dirname_etc, &ctx, &storages_new);
 	for (i = 0; priv->dirname_libs[i]; i++)
-		_load_dir (self, NMS_KEYFILE_STORAGE_TYPE_LIB (i), priv->dirname_libs[i], &storages_new);
+		_load_dir (self, NMS_KEYFILE_STORAGE_TYPE_LIB (i), priv->dirname_libs[i], &ctx, &storages_new);
+
+	if (g_hash_table_size (storages_unchanged) > 0)
+		_LOGT ("load: %u unchanged connections not read again", g_hash_table_size (storages_unchanged));
+
+	if (cache_entries) {
+		_LOGT ("load: %u of %u connections read from cache",
+		       cache_entries->len - ctx.cache_misses,
+		       cache_entries->len);
+		if (   ctx.cache_misses > 0
+		    || !cache
+		    || nms_keyfile_cache_get_num_entries (cache) != cache_entries->len) {
+			gs_free_error GError *error = NULL;
+
+			if (!nms_keyfile_cache_write (NMS_KEYFILE_CACHE_FILENAME,
+			                              _get_plugin_dir (priv),
+			                              cache_entries,
+			                              &error))
+				_LOGW ("failure to write connection cache \"%s\": %s", NMS_KEYFILE_CACHE_FILENAME, error->message);
+		}
+	}
 
 	_storages_consolidate (self,
 	                       &storages_new,
 	                       TRUE,
 	                       NULL,
+	                       storages_unchanged,
 	                       callback,
 	                       user_data);
 }
@@ -738,6 +1049,7 @@ load_connections (NMSettingsPlugin *plugin,
 	                       &storages_new,
 	                       FALSE,
 	                       storages_replaced,
+	                       NULL,
 	                       callback,
 	                       user_data);
 }
@@ -764,6 +1076,7 @@ nms_keyfile_plugin_add_connection (NMSKeyfilePlugin *self,
 	const char *uuid;
 	gboolean reread_same;
 	struct timespec mtime;
+	struct stat st;
 	char strbuf[100];
 
 	nm_assert (NM_IS_CONNECTION (connection));
@@ -839,6 +1152,10 @@ nms_keyfile_plugin_add_connection (NMSKeyfilePlugin *self,
 	                                              shadowed_storage,
 	                                              shadowed_owned ? NM_TERNARY_TRUE : NM_TERNARY_FALSE,
 	                                              nm_sett_util_stat_mtime (full_filename, FALSE, &mtime));
+	nms_keyfile_storage_set_stat (storage,
+	                                stat (full_filename, &st) == 0
+	                              ? &st
+	                              : NULL);
 
 	nm_sett_util_storages_add_take (&priv->storages, g_object_ref (storage));
 
@@ -889,6 +1206,7 @@ nms_keyfile_plugin_update_connection (NMSKeyfilePlugin *self,
 	gs_free char *full_filename = NULL;
 	gs_free_error GError *local = NULL;
 	struct timespec mtime;
+	struct stat st;
 	const char *previous_filename;
 	gboolean reread_same;
 	const char *uuid;
@@ -965,6 +1283,10 @@ nms_keyfile_plugin_update_connection (NMSKeyfilePlugin *self,
 	storage->u.conn_data.is_external     = is_external;
 	storage->u.conn_data.stat_mtime      = *nm_sett_util_stat_mtime (full_filename, FALSE, &mtime);
 	storage->u.conn_data.shadowed_owned  = shadowed_owned;
+	nms_keyfile_storage_set_stat (storage,
+	                                stat (full_filename, &st) == 0
+	                              ? &st
+	                              : NULL);
 
 	*out_storage = g_object_ref (NM_SETTINGS_STORAGE (storage));
 	*out_connection = g_steal_pointer (&reread);
@@ -1200,6 +1522,128 @@ out:
 	return nmmeta_errno >= 0;
 }
 
+/**
+ * nms_keyfile_plugin_sync_dir:
+ * @self: the #NMSKeyfilePlugin instance
+ *
+ * Flushes the directory entries of the persistent keyfile directory
+ * to disk. New files are written without fsync(), so after adding many
+ * profiles at once, this makes sure that they survive a crash, at the
+ * cost of one sync for all of them.
+ */
+void
+nms_keyfile_plugin_sync_dir (NMSKeyfilePlugin *self)
+{
+	NMSKeyfilePluginPrivate *priv = NMS_KEYFILE_PLUGIN_GET_PRIVATE (self);
+	nm_auto_close int dirfd = -1;
+
+	if (!priv->dirname_etc)
+		return;
+
+	dirfd = open (priv->dirname_etc, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0) {
+		_LOGT ("sync: failure to open directory \"%s\": %s",
+		       priv->dirname_etc, nm_strerror_native (errno));
+		return;
+	}
+
+	if (fsync (dirfd) != 0) {
+		_LOGW ("sync: failure to sync directory \"%s\": %s",
+		       priv->dirname_etc, nm_strerror_native (errno));
+	}
+}
+
+/*****************************************************************************/
+
+static gboolean
+_auto_reload_cb (gpointer user_data)
+{
+	NMSKeyfilePlugin *self = user_data;
+	NMSKeyfilePluginPrivate *priv = NMS_KEYFILE_PLUGIN_GET_PRIVATE (self);
+
+	nm_clear_g_source_inst (&priv->auto_reload_source);
+
+	_LOGD ("reload: %u files changed on disk", g_hash_table_size (priv->dirty_files));
+
+	priv->auto_reload_in_progress = TRUE;
+	_nm_settings_plugin_emit_signal_connections_changed (NM_SETTINGS_PLUGIN (self));
+	priv->auto_reload_in_progress = FALSE;
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+_monitor_changed_cb (GFileMonitor *monitor,
+                     GFile *file,
+                     GFile *other_file,
+                     GFileMonitorEvent event_type,
+                     gpointer user_data)
+{
+	NMSKeyfilePlugin *self = user_data;
+	NMSKeyfilePluginPrivate *priv = NMS_KEYFILE_PLUGIN_GET_PRIVATE (self);
+	char *path;
+
+	if (NM_IN_SET (event_type, G_FILE_MONITOR_EVENT_PRE_UNMOUNT,
+	                           G_FILE_MONITOR_EVENT_UNMOUNTED))
+		return;
+
+	if (file && (path = g_file_get_path (file)))
+		g_hash_table_add (priv->dirty_files, path);
+	if (other_file && (path = g_file_get_path (other_file)))
+		g_hash_table_add (priv->dirty_files, path);
+
+	/* Tools often write a file in several steps. Restart the timer on
+	 * every event, so that we only reload once the files settled. */
+	nm_clear_g_source_inst (&priv->auto_reload_source);
+	priv->auto_reload_source = nm_g_source_attach (nm_g_timeout_source_new (priv->auto_reload_delay_msec,
+	                                                                        G_PRIORITY_DEFAULT,
+	                                                                        _auto_reload_cb,
+	                                                                        self,
+	                                                                        NULL),
+	                                               NULL);
+}
+
+static void
+_monitor_add (NMSKeyfilePlugin *self,
+              const char *dirname)
+{
+	NMSKeyfilePluginPrivate *priv = NMS_KEYFILE_PLUGIN_GET_PRIVATE (self);
+	gs_unref_object GFile *file = NULL;
+	gs_free_error GError *error = NULL;
+	GFileMonitor *monitor;
+
+	file = g_file_new_for_path (dirname);
+	monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, &error);
+	if (!monitor) {
+		_LOGW ("failure to monitor directory \"%s\": %s", dirname, error->message);
+		return;
+	}
+
+	g_signal_connect (monitor, "changed", G_CALLBACK (_monitor_changed_cb), self);
+	g_ptr_array_add (priv->monitors, monitor);
+}
+
+static void
+_monitors_clear (NMSKeyfilePlugin *self)
+{
+	NMSKeyfilePluginPrivate *priv = NMS_KEYFILE_PLUGIN_GET_PRIVATE (self);
+	guint i;
+
+	nm_clear_g_source_inst (&priv->auto_reload_source);
+
+	if (priv->monitors) {
+		for (i = 0; i < priv->monitors->len; i++) {
+			GFileMonitor *monitor = priv->monitors->pdata[i];
+
+			g_signal_handlers_disconnect_by_func (monitor, _monitor_changed_cb, self);
+			g_file_monitor_cancel (monitor);
+		}
+		nm_clear_pointer (&priv->monitors, g_ptr_array_unref);
+	}
+
+	nm_clear_pointer (&priv->dirty_files, g_hash_table_unref);
+}
+
 /*****************************************************************************/
 
 static void
@@ -1297,6 +1741,26 @@ constructed (GObject *object)
 	                              NM_CONFIG_GET_VALUE_RAW))
 		_LOGW ("'monitor-connection-files' option is deprecated and has no effect");
 
+	priv->auto_reload_delay_msec = nm_config_data_get_value_int64 (nm_config_get_data_orig (priv->config),
+	                                                               NM_CONFIG_KEYFILE_GROUP_KEYFILE,
+	                                                               NM_CONFIG_KEYFILE_KEY_KEYFILE_AUTO_RELOAD_DELAY,
+	                                                               10,
+	                                                               0,
+	                                                               G_MAXINT32,
+	                                                               0);
+	if (priv->auto_reload_delay_msec > 0) {
+		int i;
+
+		priv->monitors = g_ptr_array_new_with_free_func (g_object_unref);
+		priv->dirty_files = g_hash_table_new_full (nm_str_hash, g_str_equal, g_free, NULL);
+
+		_monitor_add (self, priv->dirname_run);
+		if (priv->dirname_etc)
+			_monitor_add (self, priv->dirname_etc);
+		for (i = 0; priv->dirname_libs[i]; i++)
+			_monitor_add (self, priv->dirname_libs[i]);
+	}
+
 	g_signal_connect (G_OBJECT (priv->config),
 	                  NM_CONFIG_SIGNAL_CONFIG_CHANGED,
 	                  G_CALLBACK (config_changed_cb),
@@ -1318,6 +1782,8 @@ dispose (GObject *object)
 	if (priv->config)
 		g_signal_handlers_disconnect_by_func (priv->config, config_changed_cb, object);
 
+	_monitors_clear (self);
+
 	nm_sett_util_storages_clear (&priv->storages);
 
 	nm_clear_g_free (&priv->dirname_libs[0]);
@@ -60,4 +60,6 @@ gboolean nms_keyfile_plugin_set_nmmeta_tombstone (NMSKeyfilePlugin *self,
                                                   NMSettingsStorage **out_storage,
                                                   gboolean *out_hard_failure);
 
+void nms_keyfile_plugin_sync_dir (NMSKeyfilePlugin *self);
+
 #endif /* __NMS_KEYFILE_PLUGIN_H__ */
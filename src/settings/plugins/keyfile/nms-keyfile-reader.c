@@ -16,6 +16,14 @@
 
 /*****************************************************************************/
 
+/* nms_keyfile_reader_from_file() is also called from worker threads while
+ * loading the connections of a directory. Hence, we require locking from
+ * nm-logging. Indicate that by setting NM_THREAD_SAFE_ON_MAIN_THREAD to zero. */
+#undef NM_THREAD_SAFE_ON_MAIN_THREAD
+#define NM_THREAD_SAFE_ON_MAIN_THREAD 0
+
+/*****************************************************************************/
+
 static const char *
 _fmt_warn (const NMKeyfileHandlerData *handler_data, char **out_message)
 {
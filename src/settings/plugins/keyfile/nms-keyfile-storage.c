@@ -62,6 +62,52 @@ nms_keyfile_storage_steal_connection (NMSKeyfileStorage *self)
 	       : g_steal_pointer (&self->u.conn_data.connection);
 }
 
+void
+nms_keyfile_storage_set_stat (NMSKeyfileStorage *self,
+                              const struct stat *st)
+{
+	nm_assert (NMS_IS_KEYFILE_STORAGE (self));
+	nm_assert (!self->is_meta_data);
+
+	if (!st) {
+		self->u.conn_data.has_stat = FALSE;
+		return;
+	}
+
+	self->u.conn_data.stat_mtime = st->st_mtim;
+	self->u.conn_data.stat_dev   = st->st_dev;
+	self->u.conn_data.stat_ino   = st->st_ino;
+	self->u.conn_data.stat_size  = st->st_size;
+	self->u.conn_data.stat_ctime = st->st_ctim;
+	self->u.conn_data.has_stat   = TRUE;
+}
+
+/**
+ * nms_keyfile_storage_stat_unchanged:
+ * @self: the #NMSKeyfileStorage
+ * @st: the current stat() result of the storage's file
+ *
+ * Returns: %TRUE, if the file is still the same as when it was loaded (or
+ *   written) for @self. In that case, there is no need to read it again.
+ */
+gboolean
+nms_keyfile_storage_stat_unchanged (const NMSKeyfileStorage *self,
+                                    const struct stat *st)
+{
+	nm_assert (NMS_IS_KEYFILE_STORAGE (self));
+	nm_assert (st);
+
+	return    !self->is_meta_data
+	       && self->u.conn_data.has_stat
+	       && self->u.conn_data.stat_dev           == st->st_dev
+	       && self->u.conn_data.stat_ino           == st->st_ino
+	       && self->u.conn_data.stat_size          == st->st_size
+	       && self->u.conn_data.stat_mtime.tv_sec  == st->st_mtim.tv_sec
+	       && self->u.conn_data.stat_mtime.tv_nsec == st->st_mtim.tv_nsec
+	       && self->u.conn_data.stat_ctime.tv_sec  == st->st_ctim.tv_sec
+	       && self->u.conn_data.stat_ctime.tv_nsec == st->st_ctim.tv_nsec;
+}
+
 /*****************************************************************************/
 
 static int
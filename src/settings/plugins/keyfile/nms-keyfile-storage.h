@@ -6,6 +6,8 @@
 #ifndef __NMS_KEYFILE_STORAGE_H__
 #define __NMS_KEYFILE_STORAGE_H__
 
+#include <sys/stat.h>
+
 #include "c-list/src/c-list.h"
 #include "settings/nm-settings-storage.h"
 #include "nms-keyfile-utils.h"
@@ -56,6 +58,14 @@ typedef struct {
 			 * multiple files with the same UUID, then the newer file gets preferred. */
 			struct timespec stat_mtime;
 
+			/* the remaining stat() information of the keyfile, at the time it was
+			 * read or written. This allows reload to skip files that did not change.
+			 * If @has_stat is unset, the file is always read again. */
+			dev_t stat_dev;
+			ino_t stat_ino;
+			off_t stat_size;
+			struct timespec stat_ctime;
+
 			/* these flags are only relevant for storages with %NMS_KEYFILE_STORAGE_TYPE_RUN
 			 * (and non-metadata). This is to persist and reload these settings flags to
 			 * /run.
@@ -72,6 +82,8 @@ typedef struct {
 			 * shadowing profile: a owned profile will also be deleted. */
 			bool shadowed_owned:1;
 
+			bool has_stat:1;
+
 		} conn_data;
 
 		/* the content from the .nmmeta file. Note that the nmmeta file has the UUID
@@ -127,6 +139,12 @@ void nms_keyfile_storage_copy_content (NMSKeyfileStorage *dst,
 
 NMConnection *nms_keyfile_storage_steal_connection (NMSKeyfileStorage *storage);
 
+void nms_keyfile_storage_set_stat (NMSKeyfileStorage *self,
+                                   const struct stat *st);
+
+gboolean nms_keyfile_storage_stat_unchanged (const NMSKeyfileStorage *self,
+                                             const struct stat *st);
+
 /*****************************************************************************/
 
 static inline const char *
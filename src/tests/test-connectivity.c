@@ -0,0 +1,339 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ */
+
+#include "nm-default.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <unistd.h>
+
+#include "nm-connectivity.h"
+#include "nm-config.h"
+
+#include "nm-test-utils-core.h"
+
+#define TEST_RESPONSE "NetworkManager is online"
+
+#if WITH_CONCHECK
+
+/*****************************************************************************/
+
+/* A minimal HTTP server, that answers each request of a kept-alive
+ * connection with the expected response, followed by some more data. */
+
+typedef struct {
+	GSource *source;
+	GPtrArray *cons;
+	guint n_accepted;
+	guint n_requests;
+	int fd;
+	guint16 port;
+	bool status_header:1;
+} Stub;
+
+typedef struct {
+	Stub *stub;
+	GSource *source;
+	GString *buf;
+	int fd;
+} StubCon;
+
+static void
+_stub_con_free (gpointer data)
+{
+	StubCon *con = data;
+
+	nm_clear_g_source_inst (&con->source);
+	g_string_free (con->buf, TRUE);
+	nm_close (con->fd);
+	g_slice_free (StubCon, con);
+}
+
+static void
+_stub_con_respond (StubCon *con)
+{
+	gs_free char *padding = NULL;
+	gs_free char *body = NULL;
+	gs_free char *msg = NULL;
+	gsize body_len;
+	gsize msg_len;
+	gssize n;
+
+	padding = g_strnfill (1000, 'x');
+	body = g_strdup_printf ("%s\n%s", TEST_RESPONSE, padding);
+	body_len = strlen (body);
+	msg = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+	                       "Content-Type: text/plain\r\n"
+	                       "Content-Length: %"G_GSIZE_FORMAT"\r\n"
+	                       "%s"
+	                       "\r\n"
+	                       "%s",
+	                       body_len,
+	                       con->stub->status_header ? "X-NetworkManager-Status: online\r\n" : "",
+	                       body);
+	msg_len = strlen (msg);
+
+	n = send (con->fd, msg, msg_len, MSG_NOSIGNAL);
+	g_assert_cmpint (n, ==, msg_len);
+}
+
+static gboolean
+_stub_con_cb (int fd, GIOCondition condition, gpointer user_data)
+{
+	StubCon *con = user_data;
+	char buf[1024];
+	const char *end;
+	gssize n;
+
+	n = read (con->fd, buf, sizeof (buf));
+	if (n <= 0) {
+		/* the client closed the connection. */
+		g_ptr_array_remove (con->stub->cons, con);
+		return G_SOURCE_CONTINUE;
+	}
+
+	g_string_append_len (con->buf, buf, n);
+	while ((end = strstr (con->buf->str, "\r\n\r\n"))) {
+		g_string_erase (con->buf, 0, end + 4 - con->buf->str);
+		con->stub->n_requests++;
+		_stub_con_respond (con);
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+_stub_accept_cb (int fd, GIOCondition condition, gpointer user_data)
+{
+	Stub *stub = user_data;
+	StubCon *con;
+	int con_fd;
+
+	con_fd = accept4 (stub->fd, NULL, NULL, SOCK_CLOEXEC);
+	if (con_fd < 0)
+		return G_SOURCE_CONTINUE;
+
+	stub->n_accepted++;
+
+	con = g_slice_new (StubCon);
+	*con = (StubCon) {
+		.stub = stub,
+		.fd   = con_fd,
+		.buf  = g_string_new (NULL),
+	};
+	con->source = nm_g_unix_fd_source_new (con_fd,
+	                                       G_IO_IN,
+	                                       G_PRIORITY_DEFAULT,
+	                                       _stub_con_cb,
+	                                       con,
+	                                       NULL);
+	g_source_attach (con->source, NULL);
+	g_ptr_array_add (stub->cons, con);
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+_stub_init (Stub *stub)
+{
+	struct sockaddr_in addr = {
+		.sin_family      = AF_INET,
+		.sin_addr.s_addr = htonl (INADDR_LOOPBACK),
+	};
+	socklen_t addr_len = sizeof (addr);
+	int r;
+
+	*stub = (Stub) {
+		.cons = g_ptr_array_new_with_free_func (_stub_con_free),
+	};
+
+	stub->fd = socket (AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	g_assert (stub->fd >= 0);
+	r = bind (stub->fd, (struct sockaddr *) &addr, sizeof (addr));
+	g_assert_cmpint (r, ==, 0);
+	r = listen (stub->fd, 5);
+	g_assert_cmpint (r, ==, 0);
+	r = getsockname (stub->fd, (struct sockaddr *) &addr, &addr_len);
+	g_assert_cmpint (r, ==, 0);
+	stub->port = ntohs (addr.sin_port);
+
+	stub->source = nm_g_unix_fd_source_new (stub->fd,
+	                                        G_IO_IN,
+	                                        G_PRIORITY_DEFAULT,
+	                                        _stub_accept_cb,
+	                                        stub,
+	                                        NULL);
+	g_source_attach (stub->source, NULL);
+}
+
+static void
+_stub_reset (Stub *stub, gboolean status_header)
+{
+	g_ptr_array_set_size (stub->cons, 0);
+	stub->n_accepted = 0;
+	stub->n_requests = 0;
+	stub->status_header = status_header;
+}
+
+static Stub stub;
+
+static char *config_file;
+
+/*****************************************************************************/
+
+typedef struct {
+	NMConnectivityState state;
+	long num_connects;
+	bool done:1;
+} CheckResult;
+
+static void
+_check_cb (NMConnectivity *self,
+           NMConnectivityCheckHandle *handle,
+           NMConnectivityState state,
+           gpointer user_data)
+{
+	CheckResult *result = user_data;
+
+	g_assert (!result->done);
+
+	result->done = TRUE;
+	result->state = state;
+	result->num_connects = nmtst_connectivity_check_get_num_connects (handle);
+}
+
+static void
+_check (NMConnectivity *connectivity, CheckResult *result)
+{
+	*result = (CheckResult) { };
+
+	nm_connectivity_check_start (connectivity,
+	                             AF_INET,
+	                             NULL,
+	                             if_nametoindex ("lo"),
+	                             "lo",
+	                             _check_cb,
+	                             result);
+	nmtst_main_context_iterate_until_assert (NULL, 10000, result->done);
+}
+
+static void
+test_keep_alive (gconstpointer test_data)
+{
+	const gboolean status_header = GPOINTER_TO_INT (test_data);
+	gs_unref_object NMConnectivity *connectivity = NULL;
+	CheckResult result;
+
+	_stub_reset (&stub, status_header);
+
+	connectivity = g_object_new (NM_TYPE_CONNECTIVITY, NULL);
+	nmtst_connectivity_set_no_resolve (connectivity);
+	g_assert (nm_connectivity_check_enabled (connectivity));
+
+	_check (connectivity, &result);
+	g_assert_cmpint (result.state, ==, NM_CONNECTIVITY_FULL);
+	g_assert_cmpint (result.num_connects, ==, 1);
+
+	/* the result was known before the response was complete. Still, the
+	 * check received all of it, so the connection is reused. */
+	_check (connectivity, &result);
+	g_assert_cmpint (result.state, ==, NM_CONNECTIVITY_FULL);
+	g_assert_cmpint (result.num_connects, ==, 0);
+
+	g_assert_cmpint (stub.n_accepted, ==, 1);
+	g_assert_cmpint (stub.n_requests, ==, 2);
+}
+
+/*****************************************************************************/
+
+static void
+_setup_config (void)
+{
+	const char *const argv_data[] = {
+		"test-connectivity",
+		"--config", config_file,
+		"--config-dir", "/no/such/dir",
+		"--system-config-dir", "",
+		"--intern-config", "",
+		NULL,
+	};
+	gs_strfreev char **argv = g_strdupv ((char **) argv_data);
+	GOptionContext *context;
+	NMConfigCmdLineOptions *cli;
+	GError *error = NULL;
+	gboolean success;
+
+	cli = nm_config_cmd_line_options_new (FALSE);
+
+	context = g_option_context_new (NULL);
+	nm_config_cmd_line_options_add_to_entries (cli, context);
+	success = g_option_context_parse_strv (context, &argv, &error);
+	g_option_context_free (context);
+	g_assert_no_error (error);
+	g_assert (success);
+
+	nm_config_setup (cli, NULL, &error);
+	g_assert_no_error (error);
+	nm_config_cmd_line_options_free (cli);
+}
+
+static void
+_setup (void)
+{
+	gs_free char *config = NULL;
+	GError *error = NULL;
+	int fd;
+
+	_stub_init (&stub);
+
+	fd = g_file_open_tmp ("test-connectivity-XXXXXX.conf", &config_file, &error);
+	g_assert_no_error (error);
+	nm_close (fd);
+	config = g_strdup_printf ("[connectivity]\n"
+	                          "uri=http://127.0.0.1:%u/check\n"
+	                          "response="TEST_RESPONSE"\n"
+	                          "interval=300\n",
+	                          (guint) stub.port);
+	g_file_set_contents (config_file, config, -1, &error);
+	g_assert_no_error (error);
+	_setup_config ();
+}
+
+static void
+_teardown (void)
+{
+	unlink (config_file);
+	nm_clear_g_free (&config_file);
+	nm_clear_g_source_inst (&stub.source);
+	g_ptr_array_unref (stub.cons);
+	nm_close (stub.fd);
+}
+
+#endif /* WITH_CONCHECK */
+
+/*****************************************************************************/
+
+NMTST_DEFINE ();
+
+int main (int argc, char **argv)
+{
+	int r;
+
+	nmtst_init_assert_logging (&argc, &argv, "WARN", "DEFAULT");
+
+#if WITH_CONCHECK
+	_setup ();
+
+	g_test_add_data_func ("/connectivity/keep-alive/response", GINT_TO_POINTER (FALSE), test_keep_alive);
+	g_test_add_data_func ("/connectivity/keep-alive/status-header", GINT_TO_POINTER (TRUE), test_keep_alive);
+#endif
+
+	r = g_test_run ();
+
+#if WITH_CONCHECK
+	_teardown ();
+#endif
+	return r;
+}
@@ -2003,6 +2003,52 @@ test_dns_create_resolv_conf (void)
 
 }
 
+static void
+test_dns_collect_searches_many (void)
+{
+	const guint n_configs = g_test_perf () ? 10000 : 1000;
+	const guint n_searches = 10;
+	gs_unref_ptrarray GPtrArray *configs = NULL;
+	gs_strfreev char **searches = NULL;
+	gint64 ts;
+	guint i;
+	guint j;
+
+	/* Every two configs share the same search domains, and every config
+	 * also has a routing domain, which is not a search domain. */
+	configs = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; i < n_configs; i++) {
+		NMIP4Config *config;
+
+		config = nmtst_ip4_config_new (i + 1);
+		nm_ip4_config_add_nameserver (config, nmtst_inet4_from_string ("192.168.1.1"));
+		for (j = 0; j < n_searches; j++) {
+			char buf[100];
+
+			nm_ip4_config_add_search (config, nm_sprintf_buf (buf, "s%u.example.com", (i / 2) * n_searches + j));
+		}
+		nm_ip4_config_add_search (config, nm_sprintf_bufa (100, "~r%u.example.com", i));
+		g_ptr_array_add (configs, config);
+	}
+
+	ts = nm_utils_get_monotonic_timestamp_nsec ();
+	searches = nmtst_dns_collect_searches ((NMIPConfig *const*) configs->pdata, configs->len);
+	ts = nm_utils_get_monotonic_timestamp_nsec () - ts;
+
+	g_test_message ("collecting %u search domains of %u configs took %.3f msec",
+	                n_configs * (n_searches + 1),
+	                n_configs,
+	                ts / 1e6);
+
+	g_assert (searches);
+	g_assert_cmpint (NM_PTRARRAY_LEN (searches), ==, ((n_configs + 1) / 2) * n_searches);
+	for (i = 0; searches[i]; i++) {
+		char buf[100];
+
+		g_assert_cmpstr (searches[i], ==, nm_sprintf_buf (buf, "s%u.example.com", i));
+	}
+}
+
 /*****************************************************************************/
 
 static void
@@ -2277,6 +2323,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/general/test_utils_file_is_in_path", test_utils_file_is_in_path);
 
 	g_test_add_func ("/general/test_dns_create_resolv_conf", test_dns_create_resolv_conf);
+	g_test_add_func ("/general/test_dns_collect_searches_many", test_dns_collect_searches_many);
 
 	g_test_add_data_func ("/general/nm_utils_dhcp_client_id_systemd_node_specific/0", GINT_TO_POINTER (0), test_nm_utils_dhcp_client_id_systemd_node_specific);
 	g_test_add_data_func ("/general/nm_utils_dhcp_client_id_systemd_node_specific/1", GINT_TO_POINTER (1), test_nm_utils_dhcp_client_id_systemd_node_specific);
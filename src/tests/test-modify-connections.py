@@ -0,0 +1,156 @@
+#!/usr/bin/env python
+
+# Exercises Settings.ModifyConnections() of a running NetworkManager.
+# The profiles are only created in memory, and are deleted again at the end.
+# Requires permission to modify system connections (usually, run as root).
+
+from gi.repository import GLib
+import sys
+import uuid
+import dbus
+import dbus.mainloop.glib
+
+NM_BUS_NAME = "org.freedesktop.NetworkManager"
+NM_SETTINGS_PATH = "/org/freedesktop/NetworkManager/Settings"
+IFACE_SETTINGS = "org.freedesktop.NetworkManager.Settings"
+IFACE_CONNECTION = "org.freedesktop.NetworkManager.Settings.Connection"
+
+NM_SETTINGS_ADD_CONNECTION2_FLAG_IN_MEMORY = 0x2
+
+N_PROFILES = 20
+
+
+class Test:
+    def __init__(self, bus):
+        self.bus = bus
+        self.settings = bus.get_object(NM_BUS_NAME, NM_SETTINGS_PATH)
+        self.added = []
+        self.removed = []
+
+        self.settings.connect_to_signal(
+            "NewConnection", self.added.append, dbus_interface=IFACE_SETTINGS
+        )
+        self.settings.connect_to_signal(
+            "ConnectionRemoved", self.removed.append, dbus_interface=IFACE_SETTINGS
+        )
+
+    def process_signals(self):
+        # Dispatch the signals that arrived so far. Ping the bus first, so that
+        # all signals that were sent before the reply were also received.
+        self.bus.get_object("org.freedesktop.DBus", "/org/freedesktop/DBus").GetId(
+            dbus_interface="org.freedesktop.DBus"
+        )
+        ctx = GLib.MainContext.default()
+        while ctx.iteration(False):
+            pass
+
+    def modify(self, profiles, delete_paths):
+        paths, result = self.settings.ModifyConnections(
+            dbus.Array(profiles, signature="a{sa{sv}}"),
+            dbus.Array(delete_paths, signature="o"),
+            dbus.UInt32(NM_SETTINGS_ADD_CONNECTION2_FLAG_IN_MEMORY),
+            dbus.Dictionary({}, signature="sv"),
+            dbus_interface=IFACE_SETTINGS,
+        )
+        self.process_signals()
+        return [str(p) for p in paths]
+
+    def get_id(self, path):
+        con = self.bus.get_object(NM_BUS_NAME, path)
+        settings = con.GetSettings(dbus_interface=IFACE_CONNECTION)
+        return str(settings["connection"]["id"])
+
+
+def make_profile(con_uuid, con_id):
+    s_con = dbus.Dictionary(
+        {
+            "type": "802-3-ethernet",
+            "uuid": con_uuid,
+            "id": con_id,
+            "interface-name": "nm-test-bulk",
+            "autoconnect": False,
+        }
+    )
+    return dbus.Dictionary(
+        {
+            "connection": s_con,
+            "802-3-ethernet": dbus.Dictionary({}, signature="sv"),
+            "ipv4": dbus.Dictionary({"method": "disabled"}),
+            "ipv6": dbus.Dictionary({"method": "ignore"}),
+        }
+    )
+
+
+def expect(cond, msg):
+    if not cond:
+        print("FAIL: %s" % (msg))
+        sys.exit(1)
+    print("ok: %s" % (msg))
+
+
+def main():
+    dbus.mainloop.glib.DBusGMainLoop(set_as_default=True)
+
+    test = Test(dbus.SystemBus())
+
+    uuids = [str(uuid.uuid4()) for i in range(N_PROFILES)]
+
+    # a request with an invalid profile must be rejected as whole.
+    broken = make_profile(uuids[1], "nm-test-bulk-broken")
+    broken["connection"]["type"] = "no-such-type"
+    try:
+        test.modify([make_profile(uuids[0], "nm-test-bulk-0"), broken], [])
+        expect(False, "invalid profile is rejected")
+    except dbus.exceptions.DBusException:
+        pass
+    test.process_signals()
+    expect(len(test.added) == 0, "nothing added from a rejected request")
+
+    # duplicate UUIDs in the same request are rejected.
+    try:
+        test.modify(
+            [
+                make_profile(uuids[0], "nm-test-bulk-0"),
+                make_profile(uuids[0], "nm-test-bulk-0b"),
+            ],
+            [],
+        )
+        expect(False, "duplicate UUID is rejected")
+    except dbus.exceptions.DBusException:
+        pass
+    test.process_signals()
+    expect(len(test.added) == 0, "nothing added with duplicate UUIDs")
+
+    # add
+    paths = test.modify(
+        [make_profile(u, "nm-test-bulk-%d" % (i)) for i, u in enumerate(uuids)], []
+    )
+    expect(len(paths) == N_PROFILES, "one path returned per added profile")
+    expect(
+        sorted(test.added) == sorted(paths),
+        "NewConnection emitted once for each added profile",
+    )
+
+    # update, matched by UUID. No new profiles.
+    del test.added[:]
+    paths2 = test.modify(
+        [make_profile(u, "nm-test-bulk-upd-%d" % (i)) for i, u in enumerate(uuids)],
+        [],
+    )
+    expect(paths2 == paths, "updated profiles keep their paths")
+    expect(len(test.added) == 0, "no NewConnection for updated profiles")
+    expect(
+        all(test.get_id(p) == "nm-test-bulk-upd-%d" % (i) for i, p in enumerate(paths)),
+        "profiles got updated",
+    )
+
+    # delete
+    test.modify([], paths)
+    expect(
+        sorted(test.removed) == sorted(paths),
+        "ConnectionRemoved emitted once for each deleted profile",
+    )
+
+
+if __name__ == "__main__":
+    main()